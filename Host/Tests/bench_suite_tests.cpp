@@ -0,0 +1,78 @@
+//
+//  bench_suite_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/bench_suite.hpp"
+
+#include <cstdio>
+#include <unistd.h>
+
+namespace
+{
+
+// A temporary path, removed when it goes out of scope.
+struct TempPath
+{
+    char path[ 32 ] = "/tmp/bench_suiteXXXXXX";
+
+    TempPath() { close( mkstemp( path ) ); }
+    ~TempPath() { unlink( path ); }
+};
+
+std::vector<BenchResult> sampleResults( double cpuMs )
+{
+    BenchResult result;
+    result.scene = "triangles";
+    result.cpuEncode.p50Ms = cpuMs;
+    result.gpu.p50Ms = 2.0;
+    result.memoryBytes = 4096;
+    return { result };
+}
+
+}
+
+TEST_CASE( baselineRoundTripsWithItsBackend )
+{
+    TempPath file;
+    CHECK( saveBenchBaseline( file.path, "mock", sampleResults( 1.0 ) ) );
+
+    std::string backend;
+    std::vector<BenchResult> baseline;
+    CHECK( loadBenchBaseline( file.path, backend, baseline ) );
+    CHECK( backend == "mock" );
+    CHECK( baseline.size() == 1 && baseline[ 0 ].scene == "triangles" );
+    CHECK( baseline[ 0 ].cpuEncode.p50Ms == 1.0 && baseline[ 0 ].memoryBytes == 4096 );
+}
+
+TEST_CASE( baselineWithoutHeaderHasNoBackend )
+{
+    TempPath file;
+    FILE* pFile = fopen( file.path, "w" );
+    fprintf( pFile, "triangles 1.0 2.0 4096\n" );
+    fclose( pFile );
+
+    std::string backend = "stale";
+    std::vector<BenchResult> baseline;
+    CHECK( loadBenchBaseline( file.path, backend, baseline ) );
+    CHECK( backend.empty() && baseline.size() == 1 );
+}
+
+TEST_CASE( reportRejectsBaselineFromAnotherBackend )
+{
+    TempPath file;
+    CHECK( reportAgainstBaseline( "mock", file.path, true, sampleResults( 1.0 ) ) == 0 );
+    CHECK( reportAgainstBaseline( "mock", file.path, false, sampleResults( 1.0 ) ) == 0 );
+    CHECK( reportAgainstBaseline( "metal", file.path, false, sampleResults( 1.0 ) ) == 1 );
+
+    // Still caught as a regression on the same backend.
+    CHECK( reportAgainstBaseline( "mock", file.path, false, sampleResults( 2.0 ) ) == 1 );
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,91 @@
+//
+//  block_compressor_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Core/job_system.hpp"
+#include "Model/block_compressor.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+
+// Largest per-channel difference over the opaque pixels' color, and whether
+// every transparent pixel decoded transparent.
+struct Bc1Check
+{
+    int  maxColorError   = 0;
+    bool holesTransparent = true;
+};
+
+Bc1Check checkBc1( const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, CompressionPreset preset, JobSystem& jobs )
+{
+    CompressedImage image = compressImage( rgba.data(), width, height, BlockFormat::BC1, preset, jobs, false );
+    std::vector<uint8_t> decoded( rgba.size() );
+    decompressImage( image, decoded.data() );
+
+    Bc1Check check;
+    for ( size_t p = 0; p < size_t( width ) * height; ++p )
+    {
+        if ( rgba[ p * 4 + 3 ] < 128 )
+        {
+            check.holesTransparent = check.holesTransparent && decoded[ p * 4 + 3 ] == 0;
+            continue;
+        }
+        for ( int ch = 0; ch < 3; ++ch )
+        {
+            check.maxColorError = std::max( check.maxColorError, std::abs( int( decoded[ p * 4 + ch ] ) - int( rgba[ p * 4 + ch ] ) ) );
+        }
+    }
+    return check;
+}
+
+}
+
+TEST_CASE( bc1PunchThroughFitsOnlyOpaquePixels )
+{
+    // A gray ramp over the left half of the block, transparent magenta on the right.
+    std::vector<uint8_t> rgba( 4 * 4 * 4 );
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        uint8_t* p = &rgba[ i * 4 ];
+        bool hole = ( i & 3 ) >= 2;
+        uint8_t gray = uint8_t( 100 + 10 * ( i & 3 ) + 5 * ( i >> 2 ) );
+        p[ 0 ] = hole ? 255 : gray;
+        p[ 1 ] = hole ? 0 : gray;
+        p[ 2 ] = hole ? 255 : gray;
+        p[ 3 ] = hole ? 0 : 255;
+    }
+
+    JobSystem jobs;
+    for ( CompressionPreset preset : { CompressionPreset::Fast, CompressionPreset::Balanced, CompressionPreset::Quality } )
+    {
+        Bc1Check check = checkBc1( rgba, 4, 4, preset, jobs );
+        CHECK( check.holesTransparent );
+        CHECK( check.maxColorError <= 8 );
+    }
+}
+
+TEST_CASE( bc1FullyTransparentBlockDecodesTransparent )
+{
+    std::vector<uint8_t> rgba( 4 * 4 * 4 );
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        rgba[ i * 4 + 0 ] = uint8_t( i * 16 );
+        rgba[ i * 4 + 3 ] = 0;
+    }
+
+    JobSystem jobs;
+    Bc1Check check = checkBc1( rgba, 4, 4, CompressionPreset::Quality, jobs );
+    CHECK( check.holesTransparent );
+}
+
+int main()
+{
+    return runTests();
+}
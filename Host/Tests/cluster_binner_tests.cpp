@@ -0,0 +1,127 @@
+//
+//  cluster_binner_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/cluster_binner.hpp"
+#include "Core/job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// One light and one cluster at a time, in doubles; the quantized inputs make
+// this exact, so it must agree with the vectorized binner everywhere.
+ClusterLightLists bruteForceBinning( const std::vector<ClusterBounds>& clusters, const std::vector<ClusterSphere>& spheres )
+{
+    ClusterLightLists lists;
+    for ( const ClusterBounds& b : clusters )
+    {
+        lists.offsets.push_back( uint32_t( lists.indices.size() ) );
+        for ( size_t i = 0; i < spheres.size(); ++i )
+        {
+            double distanceSquared = 0.0;
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                double c = spheres[ i ].center[ axis ];
+                double d = std::max( { double( b.min[ axis ] ) - c, c - double( b.max[ axis ] ), 0.0 } );
+                distanceSquared += d * d;
+            }
+            double r = spheres[ i ].radius;
+            if ( distanceSquared <= r * r )
+            {
+                lists.indices.push_back( uint16_t( i ) );
+            }
+        }
+        lists.counts.push_back( uint32_t( lists.indices.size() ) - lists.offsets.back() );
+    }
+    return lists;
+}
+
+std::vector<ClusterSphere> testSpheres( const ClusterGridDesc& grid, uint32_t count )
+{
+    ViewSpaceLightSetDesc desc;
+    desc.count = count;
+    desc.seed = 7;
+    return buildClusterSpheres( grid, generateViewSpaceLights( desc ) );
+}
+
+}
+
+TEST_CASE( binningMatchesBruteForce )
+{
+    ClusterGridDesc grid;
+    std::vector<ClusterBounds> clusters = buildClusterBounds( grid );
+    CHECK( clusters.size() == clusterCount( grid ) );
+
+    // Not a multiple of four or 32, so the padding lanes and the last mask word are partial.
+    std::vector<ClusterSphere> spheres = testSpheres( grid, 301 );
+    JobSystem jobs;
+    ClusterLightLists lists = binLights( clusters, spheres, jobs );
+    ClusterLightLists reference = bruteForceBinning( clusters, spheres );
+
+    CHECK( !reference.indices.empty() );
+    CHECK( lists.offsets == reference.offsets && lists.counts == reference.counts );
+    CHECK( lists.indices == reference.indices );
+    CHECK( countDifferingClusters( lists, reference ) == 0 );
+}
+
+TEST_CASE( binningDoesNotDependOnThreadCount )
+{
+    ClusterGridDesc grid;
+    std::vector<ClusterBounds> clusters = buildClusterBounds( grid );
+    std::vector<ClusterSphere> spheres = testSpheres( grid, 2048 );
+
+    JobSystem serialJobs( 1 );
+    JobSystem parallelJobs( 7 );
+    ClusterLightLists serial = binLights( clusters, spheres, serialJobs );
+    ClusterLightLists parallel = binLights( clusters, spheres, parallelJobs );
+    CHECK( countDifferingClusters( serial, parallel ) == 0 );
+    CHECK( serial.offsets == parallel.offsets && serial.indices == parallel.indices );
+}
+
+TEST_CASE( differingClustersAreCounted )
+{
+    ClusterGridDesc grid;
+    std::vector<ClusterBounds> clusters = buildClusterBounds( grid );
+    JobSystem jobs;
+    ClusterLightLists lists = binLights( clusters, testSpheres( grid, 301 ), jobs );
+
+    // Find two clusters with lights, then break one by count and one by content.
+    std::vector<size_t> lit;
+    for ( size_t c = 0; c < lists.counts.size() && lit.size() < 2; ++c )
+    {
+        if ( lists.counts[ c ] > 0 )
+        {
+            lit.push_back( c );
+        }
+    }
+    CHECK( lit.size() == 2 );
+    if ( lit.size() < 2 )
+    {
+        return;
+    }
+
+    ClusterLightLists changed = lists;
+    changed.indices[ changed.offsets[ lit[ 1 ] ] ] ^= 1;
+    CHECK( countDifferingClusters( lists, changed ) == 1 );
+    changed.counts[ lit[ 0 ] ] -= 1;
+    CHECK( countDifferingClusters( lists, changed ) == 2 );
+    CHECK( countDifferingClusters( changed, lists ) == 2 );
+
+    // A missing cluster counts as differing.
+    ClusterLightLists shorter = lists;
+    shorter.counts.pop_back();
+    shorter.offsets.pop_back();
+    CHECK( countDifferingClusters( lists, shorter ) == 1 );
+}
+
+int main()
+{
+    return runTests();
+}
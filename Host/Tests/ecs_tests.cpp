@@ -0,0 +1,141 @@
+//
+//  ecs_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/ecs.hpp"
+#include "Core/job_system.hpp"
+
+namespace
+{
+
+struct Position { float x, y; };
+struct Velocity { float x, y; };
+struct Tag { uint32_t value; };
+
+struct Huge { uint8_t bytes[ 10000 ]; };
+
+// A row of 8192 bytes, which the 16-byte column alignment pushes past one
+// chunk at capacity 2.
+struct PadA { uint32_t value; };
+struct PadB { uint32_t value; };
+struct Wide { uint8_t bytes[ 8176 ]; };
+
+}
+
+TEST_CASE( worldStoresAndMovesComponents )
+{
+    World world;
+    Entity a = world.create( Position { 1, 2 } );
+    Entity b = world.create( Position { 3, 4 }, Velocity { 1, 0 } );
+    CHECK( world.entityCount() == 2 && world.archetypeCount() == 2 );
+    CHECK( world.get<Velocity>( a ) == nullptr );
+
+    world.add( a, Velocity { 0, 1 } );
+    CHECK( world.get<Position>( a )->y == 2 && world.get<Velocity>( a )->y == 1 );
+    world.remove<Velocity>( b );
+    CHECK( world.get<Velocity>( b ) == nullptr && world.get<Position>( b )->x == 3 );
+
+    world.destroy( a );
+    CHECK( !world.alive( a ) && world.alive( b ) );
+    CHECK( world.get<Position>( a ) == nullptr );
+
+    // The freed index is reused with a new generation.
+    Entity c = world.create( Tag { 7 } );
+    CHECK( c.index == a.index && !( c == a ) );
+    CHECK( !world.alive( a ) && world.get<Tag>( c )->value == 7 );
+}
+
+TEST_CASE( schedulerRunsSystemsOverEveryChunk )
+{
+    World world;
+    const int Count = 5000;
+    for ( int i = 0; i < Count; ++i )
+    {
+        world.create( Position { float( i ), 0 }, Velocity { 1, 2 } );
+    }
+    world.create( Position { 0, 0 } );
+
+    SystemScheduler scheduler;
+    scheduler.add<Position, const Velocity>( "integrate", []( size_t count, Position* p, const Velocity* v )
+    {
+        for ( size_t i = 0; i < count; ++i )
+        {
+            p[ i ].x += v[ i ].x;
+            p[ i ].y += v[ i ].y;
+        }
+    } );
+    JobSystem jobs;
+    scheduler.run( world, jobs );
+    scheduler.run( world, jobs );
+
+    double sumX = 0.0, sumY = 0.0;
+    world.each<const Position>( [&]( const Position& p ) { sumX += p.x; sumY += p.y; } );
+    CHECK( sumX == double( Count ) * ( Count - 1 ) / 2 + 2.0 * Count );
+    CHECK( sumY == 4.0 * Count );
+}
+
+TEST_CASE( archetypeFitsLargeRows )
+{
+    World world;
+    Entity entities[ 3 ];
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        Huge huge;
+        memset( huge.bytes, int( i + 1 ), sizeof( huge.bytes ) );
+        entities[ i ] = world.create( huge, Tag { i } );
+    }
+
+    size_t chunks = 0;
+    world.eachArchetype( componentMask<Huge>(), [&]( Archetype& archetype )
+    {
+        CHECK( archetype.capacity() == 1 );
+        chunks = archetype.chunkCount();
+    } );
+    CHECK( chunks == 3 );
+
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        const Huge* pHuge = world.get<Huge>( entities[ i ] );
+        CHECK( pHuge->bytes[ 0 ] == i + 1 && pHuge->bytes[ sizeof( pHuge->bytes ) - 1 ] == i + 1 );
+        CHECK( world.get<Tag>( entities[ i ] )->value == i );
+    }
+}
+
+TEST_CASE( archetypeShrinksCapacityForPadding )
+{
+    World world;
+    Entity entities[ 3 ];
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        Wide wide;
+        memset( wide.bytes, int( i + 1 ), sizeof( wide.bytes ) );
+        entities[ i ] = world.create( PadA { i }, PadB { 10 + i }, wide );
+    }
+
+    world.eachArchetype( componentMask<Wide>(), [&]( Archetype& archetype )
+    {
+        CHECK( archetype.capacity() == 1 );
+        for ( size_t c = 0; c < archetype.chunkCount(); ++c )
+        {
+            // Every column ends inside the chunk.
+            EcsChunk& chunk = archetype.chunk( c );
+            CHECK( archetype.column<Wide>( chunk ) + 1 <= reinterpret_cast<Wide*>( chunk.pData + kEcsChunkBytes ) );
+        }
+    } );
+
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        CHECK( world.get<PadA>( entities[ i ] )->value == i );
+        CHECK( world.get<PadB>( entities[ i ] )->value == 10 + i );
+        CHECK( world.get<Wide>( entities[ i ] )->bytes[ 8175 ] == i + 1 );
+    }
+}
+
+int main()
+{
+    return runTests();
+}
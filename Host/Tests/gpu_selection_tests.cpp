@@ -0,0 +1,200 @@
+//
+//  gpu_selection_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/gpu_selection.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const double kGiB = 1024.0 * 1024.0 * 1024.0;
+
+bool near( double a, double b )
+{
+    return std::fabs( a - b ) < 1e-6;
+}
+
+GpuDeviceInfo integratedGpu()
+{
+    GpuDeviceInfo integrated;
+    integrated.name = "Mock integrated";
+    integrated.registryId = 1;
+    integrated.macFamily = 2;
+    integrated.workingSetBytes = uint64_t( 1.5 * kGiB );
+    integrated.lowPower = true;
+    integrated.unifiedMemory = true;
+    return integrated;
+}
+
+GpuDeviceInfo discreteGpu()
+{
+    GpuDeviceInfo discrete;
+    discrete.name = "Mock discrete 8GB";
+    discrete.registryId = 2;
+    discrete.macFamily = 2;
+    discrete.workingSetBytes = uint64_t( 7.5 * kGiB );
+    discrete.transferBytesPerSec = uint64_t( 12e9 );
+    discrete.systemDefault = true;
+    return discrete;
+}
+
+// Plugged in over Thunderbolt with no monitor attached.
+GpuDeviceInfo externalGpu()
+{
+    GpuDeviceInfo egpu = discreteGpu();
+    egpu.name = "Mock eGPU 8GB";
+    egpu.registryId = 4;
+    egpu.removable = true;
+    egpu.headless = true;
+    egpu.systemDefault = false;
+    egpu.transferBytesPerSec = uint64_t( 2.5e9 );
+    return egpu;
+}
+
+GpuDeviceInfo appleSiliconGpu()
+{
+    GpuDeviceInfo appleSilicon;
+    appleSilicon.name = "Mock Apple silicon";
+    appleSilicon.registryId = 5;
+    appleSilicon.appleFamily = 8;
+    appleSilicon.macFamily = 2;
+    appleSilicon.workingSetBytes = uint64_t( 21.3 * kGiB );
+    appleSilicon.unifiedMemory = true;
+    appleSilicon.raytracing = true;
+    appleSilicon.systemDefault = true;
+    return appleSilicon;
+}
+
+// Speeds of exactly 2 and 1, and a 1 GB/s link, so the schedule is easy to work out by hand.
+std::vector<GpuDeviceInfo> scheduleMachine()
+{
+    GpuDeviceInfo fast;
+    fast.name = "Fast";
+    fast.macFamily = 2;
+    fast.workingSetBytes = uint64_t( 12 * kGiB );
+    fast.transferBytesPerSec = uint64_t( 1e9 );
+    fast.systemDefault = true;
+
+    GpuDeviceInfo slow = fast;
+    slow.name = "Slow";
+    slow.workingSetBytes = uint64_t( 4 * kGiB );
+    slow.systemDefault = false;
+    return { fast, slow };
+}
+
+double makespan( const std::vector<JobPlacement>& placements )
+{
+    double end = 0.0;
+    for ( const JobPlacement& placement : placements )
+    {
+        end = std::max( end, placement.endMs );
+    }
+    return end;
+}
+
+}
+
+TEST_CASE( integratedOnlyMachineHasNoOffscreenGpu )
+{
+    for ( std::vector<GpuDeviceInfo> devices : { std::vector<GpuDeviceInfo>{ integratedGpu() }, std::vector<GpuDeviceInfo>{ appleSiliconGpu() } } )
+    {
+        for ( GpuPreference preference : { GpuPreference::Performance, GpuPreference::LowPower } )
+        {
+            GpuSelection selection = selectGpus( devices, preference );
+            CHECK( selection.display == 0 && selection.offscreen == -1 );
+        }
+    }
+}
+
+TEST_CASE( dualGpuLaptopSplitsByPreference )
+{
+    std::vector<GpuDeviceInfo> devices = { integratedGpu(), discreteGpu() };
+
+    // The discrete GPU drives the display and the integrated one still helps out.
+    GpuSelection performance = selectGpus( devices, GpuPreference::Performance );
+    CHECK( performance.display == 1 && performance.offscreen == 0 );
+
+    GpuSelection lowPower = selectGpus( devices, GpuPreference::LowPower );
+    CHECK( lowPower.display == 0 && lowPower.offscreen == 1 );
+}
+
+TEST_CASE( externalGpuOnlyTakesOffscreenWork )
+{
+    // Headless, so it never drives the display, even when it is the only
+    // discrete GPU next to an integrated one.
+    std::vector<GpuDeviceInfo> laptop = { integratedGpu(), externalGpu() };
+    CHECK( scoreDisplayGpu( externalGpu(), GpuPreference::Performance ) < 0.0 );
+    for ( GpuPreference preference : { GpuPreference::Performance, GpuPreference::LowPower } )
+    {
+        GpuSelection selection = selectGpus( laptop, preference );
+        CHECK( selection.display == 0 && selection.offscreen == 1 );
+    }
+
+    std::vector<GpuDeviceInfo> desktop = { discreteGpu(), externalGpu() };
+    GpuSelection selection = selectGpus( desktop, GpuPreference::Performance );
+    CHECK( selection.display == 0 && selection.offscreen == 1 );
+
+    // An internal GPU of the same speed beats it for offscreen work, as it can't be unplugged.
+    GpuDeviceInfo workstation = discreteGpu();
+    workstation.workingSetBytes = uint64_t( 15.5 * kGiB );
+    GpuDeviceInfo secondDiscrete = discreteGpu();
+    secondDiscrete.systemDefault = false;
+    selection = selectGpus( { workstation, secondDiscrete, externalGpu() }, GpuPreference::Performance );
+    CHECK( selection.display == 0 && selection.offscreen == 1 );
+}
+
+TEST_CASE( scheduleFinishesEachJobEarliest )
+{
+    std::vector<GpuDeviceInfo> devices = scheduleMachine();
+    GpuSelection selection = selectGpus( devices, GpuPreference::Performance );
+    CHECK( selection.display == 0 && selection.offscreen == 1 );
+    CHECK( near( estimateGpuSpeed( devices[ 0 ] ), 2.0 ) && near( estimateGpuSpeed( devices[ 1 ] ), 1.0 ) );
+
+    std::vector<OffscreenJob> jobs = {
+        { "a", 8.0, 1000000 },
+        { "b", 4.0, 1000000 },
+        { "c", 2.0, 0 },
+    };
+    const double DisplayBusyMs = 2.0;
+    std::vector<JobPlacement> placements = scheduleOffscreenJobs( jobs, devices, selection, DisplayBusyMs );
+    CHECK( placements.size() == 3 );
+    if ( placements.size() != 3 )
+    {
+        return;
+    }
+
+    // a: 2 - 6 ms on the display beats 0 - 9 ms, transfer included, on the other GPU.
+    CHECK( placements[ 0 ].job == 0 && placements[ 0 ].device == 0 );
+    CHECK( near( placements[ 0 ].startMs, 2.0 ) && near( placements[ 0 ].endMs, 6.0 ) && near( placements[ 0 ].transferMs, 0.0 ) );
+    // b: 0 - 5 ms offscreen, 1 ms of it transfer, beats 6 - 8 ms on the display.
+    CHECK( placements[ 1 ].job == 1 && placements[ 1 ].device == 1 );
+    CHECK( near( placements[ 1 ].startMs, 0.0 ) && near( placements[ 1 ].endMs, 5.0 ) && near( placements[ 1 ].transferMs, 1.0 ) );
+    // c: the transfer runs on the copy engines, so c starts at 4 ms, not 5.
+    CHECK( placements[ 2 ].job == 2 && placements[ 2 ].device == 1 );
+    CHECK( near( placements[ 2 ].startMs, 4.0 ) && near( placements[ 2 ].endMs, 6.0 ) );
+    CHECK( near( makespan( placements ), 6.0 ) );
+
+    // On the display GPU alone the jobs run back to back.
+    std::vector<JobPlacement> alone = scheduleOffscreenJobs( jobs, devices, { selection.display, -1 }, DisplayBusyMs );
+    CHECK( alone.size() == 3 );
+    for ( const JobPlacement& placement : alone )
+    {
+        CHECK( placement.device == 0 && placement.transferMs == 0.0 );
+    }
+    CHECK( near( makespan( alone ), 9.0 ) );
+
+    // Nothing to schedule on without a display device.
+    CHECK( scheduleOffscreenJobs( jobs, devices, GpuSelection(), DisplayBusyMs ).empty() );
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,187 @@
+//
+//  lod_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/mesh_simplifier.hpp"
+#include "Model/lod_selector.hpp"
+
+#include <cmath>
+
+namespace
+{
+
+MeshData uvSphere( float radius, uint32_t rings )
+{
+    MeshData mesh;
+    const uint32_t Segments = rings * 2;
+    for ( uint32_t i = 0; i <= rings; ++i )
+    {
+        for ( uint32_t j = 0; j <= Segments; ++j )
+        {
+            float theta = float( M_PI ) * float( i ) / float( rings );
+            float phi = 2.0f * float( M_PI ) * float( j ) / float( Segments );
+            mesh.vertices.push_back( { radius * sinf( theta ) * cosf( phi ), radius * cosf( theta ), radius * sinf( theta ) * sinf( phi ) } );
+        }
+    }
+    for ( uint32_t i = 0; i < rings; ++i )
+    {
+        for ( uint32_t j = 0; j < Segments; ++j )
+        {
+            uint32_t a = i * ( Segments + 1 ) + j, b = a + 1, c = a + Segments + 1, d = c + 1;
+            mesh.indices.insert( mesh.indices.end(), { a, c, b, b, c, d } );
+        }
+    }
+    return mesh;
+}
+
+}
+
+TEST_CASE( simplifyMeshHitsTriangleTargets )
+{
+    MeshData sphere = uvSphere( 1.0f, 16 );
+    for ( size_t target : { 400, 200, 100 } )
+    {
+        SimplifyResult result = simplifyMesh( sphere, target * 3, 1e30f );
+        CHECK( result.mesh.triangleCount() <= target );
+        CHECK( result.mesh.triangleCount() + target / 10 >= target );
+        CHECK( result.error > 0.0f );
+    }
+
+    // A tight error limit stops before the target.
+    SimplifyResult limited = simplifyMesh( sphere, 100 * 3, 1e-4f );
+    CHECK( limited.mesh.triangleCount() > 100 );
+    CHECK( limited.error <= 1e-4f );
+}
+
+TEST_CASE( simplifyErrorIsAnObjectSpaceDistance )
+{
+    // Same shape at ten times the size: ten times the error.
+    SimplifyResult small = simplifyMesh( uvSphere( 1.0f, 16 ), 254 * 3, 1e30f );
+    SimplifyResult large = simplifyMesh( uvSphere( 10.0f, 16 ), 254 * 3, 1e30f );
+    float ratio = large.error / small.error;
+    CHECK( ratio > 8.0f && ratio < 12.0f );
+    CHECK( small.error < 0.1f );
+}
+
+TEST_CASE( lodChainErrorNeverDecreases )
+{
+    std::vector<MeshLod> chain = buildLodChain( uvSphere( 5.0f, 24 ), LodChainSettings() );
+    CHECK( chain.size() >= 4 );
+    CHECK( chain[ 0 ].geometricError == 0.0f );
+    for ( size_t i = 1; i < chain.size(); ++i )
+    {
+        CHECK( chain[ i ].geometricError >= chain[ i - 1 ].geometricError );
+        CHECK( chain[ i ].mesh.triangleCount() < chain[ i - 1 ].mesh.triangleCount() );
+    }
+}
+
+TEST_CASE( selectLodHysteresis )
+{
+    // LOD 1 projects to 1 / distance pixels against a 1 pixel threshold, and
+    // coarsening needs it under 0.8.
+    const float Errors[] = { 0.0f, 0.01f, 1.0f };
+    LodViewParams params;
+    params.pixelErrorThreshold = 1.0f;
+    params.hysteresis = 0.2f;
+    const float Scale = 100.0f;
+
+    CHECK( selectLod( Errors, 3, 1.1f, 0.0f, Scale, params, 0 ) == 0 );     // inside the margin: keep the finer level
+    CHECK( selectLod( Errors, 3, 1.1f, 0.0f, Scale, params, 1 ) == 1 );     // and keep the coarser one too
+    CHECK( selectLod( Errors, 3, 1.3f, 0.0f, Scale, params, 0 ) == 1 );     // past the margin: coarsen
+    CHECK( selectLod( Errors, 3, 0.9f, 0.0f, Scale, params, 1 ) == 0 );     // over the threshold: refine right away
+    CHECK( selectLod( Errors, 3, 200.0f, 0.0f, Scale, params, 0 ) == 2 );
+    CHECK( selectLod( Errors, 3, 5.0f, 5.0f, Scale, params, 2 ) == 0 );     // inside the bounds
+}
+
+TEST_CASE( lodResidencyStaysWithinBudget )
+{
+    LodResidency residency( 1000 );
+    uint32_t mesh = residency.addMesh( { 800, 200, 50 } );
+    std::vector<LodResidency::Change> loads, evictions;
+
+    residency.update( loads, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ].lod == 2 );
+    CHECK( residency.isResident( mesh, 2 ) );
+
+    // Not resident yet, so the pinned coarsest level is drawn meanwhile.
+    CHECK( residency.request( mesh, 0, 1.0f ) == 2 );
+    residency.update( loads, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ].lod == 0 );
+    CHECK( residency.residentBytes() == 850 );
+
+    // LOD 1 does not fit next to LOD 0, which was not used this frame.
+    CHECK( residency.request( mesh, 1, 1.0f ) == 2 );
+    residency.update( loads, evictions );
+    CHECK( evictions.size() == 1 && evictions[ 0 ].lod == 0 );
+    CHECK( loads.size() == 1 && loads[ 0 ].lod == 1 );
+    CHECK( residency.residentBytes() == 250 );
+    CHECK( residency.residentBytes() <= residency.budgetBytes() );
+}
+
+TEST_CASE( lodResidencyKeepsLevelsItCannotReplace )
+{
+    LodResidency residency( 1000 );
+    uint32_t small = residency.addMesh( { 300, 50 } );
+    uint32_t huge = residency.addMesh( { 2000, 50 } );
+    std::vector<LodResidency::Change> loads, evictions;
+    residency.update( loads, evictions );
+
+    residency.request( small, 0, 1.0f );
+    residency.update( loads, evictions );
+    CHECK( residency.isResident( small, 0 ) );
+
+    // Evicting the small mesh's LOD 0 would not make room for 2000 bytes.
+    residency.request( huge, 0, 1.0f );
+    residency.update( loads, evictions );
+    CHECK( evictions.empty() );
+    CHECK( loads.empty() );
+    CHECK( residency.isResident( small, 0 ) );
+    CHECK( !residency.isResident( huge, 0 ) );
+}
+
+TEST_CASE( lodResidencyLoadsByPriority )
+{
+    LodResidency residency( 500 );
+    uint32_t a = residency.addMesh( { 400, 10 } );
+    uint32_t b = residency.addMesh( { 400, 10 } );
+    std::vector<LodResidency::Change> loads, evictions;
+    residency.update( loads, evictions );
+
+    residency.request( a, 0, 1.0f );
+    residency.request( b, 0, 2.0f );
+    residency.update( loads, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ].mesh == b );
+    CHECK( residency.isResident( b, 0 ) && !residency.isResident( a, 0 ) );
+}
+
+TEST_CASE( lodResidencyRetriesFailedLoads )
+{
+    LodResidency residency( 1000 );
+    uint32_t mesh = residency.addMesh( { 300, 50 } );
+    std::vector<LodResidency::Change> loads, evictions;
+    residency.update( loads, evictions );
+
+    residency.request( mesh, 0, 1.0f );
+    residency.update( loads, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ].lod == 0 );
+    CHECK( residency.residentBytes() == 350 );
+
+    residency.loadFailed( mesh, 0 );
+    CHECK( !residency.isResident( mesh, 0 ) );
+    CHECK( residency.residentBytes() == 50 );
+
+    // Drawn from the coarser level until the load is retried.
+    CHECK( residency.request( mesh, 0, 1.0f ) == 1 );
+    residency.update( loads, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ].lod == 0 );
+    CHECK( residency.isResident( mesh, 0 ) );
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,121 @@
+//
+//  resource_tracker_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/resource_tracker.hpp"
+
+#include <atomic>
+#include <thread>
+
+TEST_CASE( trackerCountsReservationsAndCommits )
+{
+    ResourceTracker tracker;
+    ResourceTracker::AllocationId a = tracker.reserve( ResourceCategory::Geometry, 1000, "a" );
+    CHECK( a != ResourceTracker::kNoAllocation );
+    CHECK( tracker.stats( ResourceCategory::Geometry ).currentBytes == 1000 );
+
+    // The allocation came out larger than estimated.
+    tracker.commit( a, 1024 );
+    ResourceTracker::AllocationId b = tracker.add( ResourceCategory::Texture, 4096, "b" );
+    CHECK( tracker.stats( ResourceCategory::Geometry ).currentBytes == 1024 );
+    CHECK( tracker.stats( ResourceCategory::Geometry ).liveCount == 1 );
+    CHECK( tracker.totalBytes() == 5120 );
+
+    std::vector<ResourceTracker::Allocation> live = tracker.liveAllocations();
+    CHECK( live.size() == 2 && live[ 0 ].id == b && live[ 1 ].label == "a" );
+
+    tracker.remove( b );
+    tracker.remove( a );
+    CHECK( tracker.totalBytes() == 0 && tracker.totalHighWaterBytes() == 5120 );
+    CHECK( tracker.stats( ResourceCategory::Geometry ).highWaterBytes == 1024 );
+}
+
+TEST_CASE( trackerRejectsWhatTheBudgetCannotFit )
+{
+    ResourceTracker tracker;
+    tracker.setBudget( ResourceCategory::Streaming, 1000 );
+    ResourceTracker::AllocationId a = tracker.reserve( ResourceCategory::Streaming, 600, "a" );
+    CHECK( a != ResourceTracker::kNoAllocation );
+    CHECK( tracker.reserve( ResourceCategory::Streaming, 600, "b" ) == ResourceTracker::kNoAllocation );
+    CHECK( tracker.stats( ResourceCategory::Streaming ).liveCount == 1 );
+
+    // Other categories and empty allocations are unaffected.
+    CHECK( tracker.reserve( ResourceCategory::Staging, 5000, "c" ) != ResourceTracker::kNoAllocation );
+    tracker.commit( a, 1200 );
+    CHECK( tracker.reserve( ResourceCategory::Streaming, 0, "memoryless" ) != ResourceTracker::kNoAllocation );
+
+    // Rolling back a reservation gives its bytes back.
+    tracker.remove( a );
+    CHECK( tracker.reserve( ResourceCategory::Streaming, 1000, "d" ) != ResourceTracker::kNoAllocation );
+}
+
+TEST_CASE( trackerEvictsToMakeRoom )
+{
+    ResourceTracker tracker;
+    tracker.setBudget( ResourceCategory::Streaming, 1000 );
+    std::vector<ResourceTracker::AllocationId> resident;
+    for ( int i = 0; i < 4; ++i )
+    {
+        resident.push_back( tracker.reserve( ResourceCategory::Streaming, 250, "tile" ) );
+    }
+
+    size_t asked = 0;
+    tracker.setEvictionFunction( ResourceCategory::Streaming, [&]( size_t bytesToFree )
+    {
+        asked += bytesToFree;
+        // Frees one resource per call, so it takes several rounds.
+        if ( !resident.empty() )
+        {
+            tracker.remove( resident.back() );
+            resident.pop_back();
+        }
+    } );
+
+    CHECK( tracker.reserve( ResourceCategory::Streaming, 500, "big" ) != ResourceTracker::kNoAllocation );
+    CHECK( resident.size() == 2 && asked == 500 + 250 );
+    CHECK( tracker.stats( ResourceCategory::Streaming ).currentBytes == 1000 );
+
+    // Stops once eviction makes no progress.
+    resident.clear();
+    CHECK( tracker.reserve( ResourceCategory::Streaming, 100, "more" ) == ResourceTracker::kNoAllocation );
+}
+
+TEST_CASE( trackerBudgetHoldsUnderContention )
+{
+    const size_t Budget = 1000;
+    ResourceTracker tracker;
+    tracker.setBudget( ResourceCategory::Texture, Budget );
+
+    std::atomic<size_t> granted { 0 };
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < 8; ++t )
+    {
+        threads.emplace_back( [&]
+        {
+            for ( int i = 0; i < 1000; ++i )
+            {
+                if ( tracker.reserve( ResourceCategory::Texture, 1, "texel" ) != ResourceTracker::kNoAllocation )
+                {
+                    ++granted;
+                }
+            }
+        } );
+    }
+    for ( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+
+    CHECK( granted == Budget );
+    CHECK( tracker.stats( ResourceCategory::Texture ).currentBytes == Budget );
+    CHECK( tracker.stats( ResourceCategory::Texture ).highWaterBytes == Budget );
+}
+
+int main()
+{
+    return runTests();
+}
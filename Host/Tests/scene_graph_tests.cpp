@@ -0,0 +1,105 @@
+//
+//  scene_graph_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/scene_graph.hpp"
+#include "Core/job_system.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+bool nearlyEqual( const math::float4x4& a, const math::float4x4& b )
+{
+    for ( int c = 0; c < 4; ++c )
+    {
+        for ( int r = 0; r < 4; ++r )
+        {
+            if ( std::fabs( a.columns[ c ][ r ] - b.columns[ c ][ r ] ) > 1e-5f )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool identical( const math::float4x4& a, const math::float4x4& b )
+{
+    return memcmp( &a, &b, sizeof( math::float4x4 ) ) == 0;
+}
+
+}
+
+TEST_CASE( partialUpdateRecomputesOnlyTheDirtySubtree )
+{
+    // root has two subtrees: inner with child, grandchild and leaf under it,
+    // and sibling with cousin. Only inner is moved.
+    const math::float4x4 Step = math::translation4x4( { 1.0f, 0.0f, 0.0f } );
+    const math::float4x4 Turn = math::rotationZ4x4( 0.5f );
+    SceneGraph graph;
+    uint32_t root = graph.addNode( SceneGraph::kNoParent, Step );
+    uint32_t inner = graph.addNode( root, Turn );
+    uint32_t sibling = graph.addNode( root, Turn );
+    uint32_t child = graph.addNode( inner, Step );
+    uint32_t leaf = graph.addNode( inner, Turn );
+    uint32_t cousin = graph.addNode( sibling, Step );
+    uint32_t grandchild = graph.addNode( child, Step );
+
+    JobSystem jobs;
+    std::vector<math::float4x4> upload( graph.size() );
+    CHECK( graph.update( jobs, upload.data() ) == 7 );
+    CHECK( graph.levelCount() == 4 );
+    const math::float4x4 SiblingBefore = graph.world( sibling );
+    const math::float4x4 CousinBefore = graph.world( cousin );
+
+    const math::float4x4 Moved = math::translation4x4( { 0.0f, 2.0f, 0.0f } ) * math::rotationZ4x4( -1.0f );
+    graph.setLocal( inner, Moved );
+    CHECK( graph.update( jobs, upload.data() ) == 4 );
+
+    const math::float4x4 Inner = Step * Moved;
+    CHECK( nearlyEqual( graph.world( inner ), Inner ) );
+    CHECK( nearlyEqual( graph.world( child ), Inner * Step ) );
+    CHECK( nearlyEqual( graph.world( leaf ), Inner * Turn ) );
+    CHECK( nearlyEqual( graph.world( grandchild ), Inner * Step * Step ) );
+
+    // The other subtree is left exactly as it was.
+    CHECK( identical( graph.world( sibling ), SiblingBefore ) );
+    CHECK( identical( graph.world( cousin ), CousinBefore ) );
+
+    // The upload gets every node, not just the recomputed ones.
+    for ( uint32_t node : { root, inner, sibling, child, leaf, cousin, grandchild } )
+    {
+        CHECK( identical( upload[ graph.slot( node ) ], graph.world( node ) ) );
+    }
+
+    // Nothing dirty, nothing recomputed.
+    CHECK( graph.update( jobs, upload.data() ) == 0 );
+}
+
+TEST_CASE( nodesAddedLaterKeepTheirHandles )
+{
+    SceneGraph graph;
+    JobSystem jobs;
+    uint32_t root = graph.addNode( SceneGraph::kNoParent, math::translation4x4( { 1.0f, 0.0f, 0.0f } ) );
+    uint32_t child = graph.addNode( root, math::translation4x4( { 0.0f, 1.0f, 0.0f } ) );
+    graph.update( jobs );
+
+    // A new root after the child moves the child's slot, not its handle.
+    uint32_t second = graph.addNode( SceneGraph::kNoParent, math::translation4x4( { 0.0f, 0.0f, 1.0f } ) );
+    graph.update( jobs );
+    CHECK( graph.slot( second ) < graph.slot( child ) );
+    CHECK( nearlyEqual( graph.world( child ), math::translation4x4( { 1.0f, 1.0f, 0.0f } ) ) );
+    CHECK( nearlyEqual( graph.world( second ), math::translation4x4( { 0.0f, 0.0f, 1.0f } ) ) );
+}
+
+int main()
+{
+    return runTests();
+}
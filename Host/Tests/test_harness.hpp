@@ -0,0 +1,68 @@
+//
+//  test_harness.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef test_harness_hpp
+#define test_harness_hpp
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// Just enough to register test functions and count failed checks, so the host
+// tests need nothing beyond the standard library.
+struct TestCase
+{
+    const char*             name;
+    std::function<void()>   body;
+};
+
+inline std::vector<TestCase>& testCases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline int& testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+struct TestRegistration
+{
+    TestRegistration( const char* name, std::function<void()> body ) { testCases().push_back( { name, body } ); }
+};
+
+#define TEST_CASE( name ) \
+    static void name(); \
+    static TestRegistration name##Registration( #name, name ); \
+    static void name()
+
+#define CHECK( condition ) \
+    do \
+    { \
+        if ( !( condition ) ) \
+        { \
+            __builtin_printf( "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #condition ); \
+            ++testFailures(); \
+        } \
+    } while ( false )
+
+// Runs every registered case and returns the process exit code.
+inline int runTests()
+{
+    for ( const TestCase& test : testCases() )
+    {
+        int before = testFailures();
+        test.body();
+        __builtin_printf( "%s %s\n", testFailures() == before ? "PASS" : "FAIL", test.name );
+    }
+    __builtin_printf( "%zu tests, %d failed checks\n", testCases().size(), testFailures() );
+    return testFailures() ? 1 : 0;
+}
+
+#endif /* test_harness_hpp */
@@ -0,0 +1,229 @@
+//
+//  tile_streaming_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/tile_cache.hpp"
+#include "Model/async_file_reader.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+
+// One frame of feedback asking for mip 0 at the listed cells of a 4x4 grid.
+void feed( TileCache& cache, std::initializer_list<TileKey> cells )
+{
+    uint8_t feedback[ 16 ];
+    memset( feedback, TileCache::kNoFeedback, sizeof( feedback ) );
+    for ( const TileKey& cell : cells )
+    {
+        feedback[ cell.y * 4 + cell.x ] = uint8_t( cell.mip );
+    }
+    cache.addFeedback( feedback );
+}
+
+bool contains( const std::vector<TileKey>& keys, const TileKey& key )
+{
+    return std::find( keys.begin(), keys.end(), key ) != keys.end();
+}
+
+// Collects completions until count have arrived or a second has passed.
+std::vector<AsyncFileReader::Completion> waitFor( AsyncFileReader& reader, size_t count )
+{
+    std::vector<AsyncFileReader::Completion> completions;
+    for ( int i = 0; i < 1000 && completions.size() < count; ++i )
+    {
+        reader.poll( completions );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    return completions;
+}
+
+// A temporary file of size bytes where byte i holds i & 0xff.
+struct TempFile
+{
+    char path[ 32 ] = "/tmp/tile_streamingXXXXXX";
+
+    explicit TempFile( size_t size )
+    {
+        int fd = mkstemp( path );
+        std::vector<uint8_t> bytes( size );
+        for ( size_t i = 0; i < size; ++i )
+        {
+            bytes[ i ] = uint8_t( i );
+        }
+        CHECK( write( fd, bytes.data(), size ) == ssize_t( size ) );
+        close( fd );
+    }
+
+    ~TempFile() { unlink( path ); }
+};
+
+}
+
+TEST_CASE( tileCacheEvictsLeastRecentlyUsedWithinCapacity )
+{
+    const TileLayout Layout = { 4, 4, 1 };
+    TileCache cache( Layout, 4, 2 );
+    std::vector<TileKey> loads, prefetches, evictions;
+
+    feed( cache, { { 0, 0, 0 }, { 0, 3, 3 } } );
+    cache.update( 8, loads, prefetches, evictions );
+    CHECK( loads.size() == 2 );
+    // Prefetches only take the capacity that is left.
+    CHECK( prefetches.size() == 2 );
+    CHECK( evictions.empty() );
+    for ( const std::vector<TileKey>* pKeys : { &loads, &prefetches } )
+    {
+        for ( const TileKey& key : *pKeys )
+        {
+            cache.markResident( key );
+        }
+    }
+    CHECK( cache.size() == cache.capacity() );
+
+    for ( int frame = 0; frame < 3; ++frame )
+    {
+        feed( cache, { { 0, 0, 0 } } );
+        cache.update( 8, loads, prefetches, evictions );
+        CHECK( loads.empty() && evictions.empty() );
+    }
+
+    // The cold prefetched tile goes first; the recently sampled ones stay.
+    feed( cache, { { 0, 0, 0 }, { 0, 2, 2 } } );
+    cache.update( 8, loads, prefetches, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ] == TileKey( { 0, 2, 2 } ) );
+    CHECK( evictions.size() == 1 && contains( { { 0, 1, 0 }, { 0, 0, 1 } }, evictions[ 0 ] ) );
+    CHECK( cache.isResident( { 0, 0, 0 } ) && cache.isResident( { 0, 3, 3 } ) );
+    CHECK( cache.size() <= cache.capacity() );
+    cache.markResident( loads[ 0 ] );
+
+    // Everything sampled within the retain window is kept, even over a new request.
+    feed( cache, { { 0, 0, 0 }, { 0, 2, 2 }, { 0, 3, 3 }, { 0, 1, 1 } } );
+    cache.update( 8, loads, prefetches, evictions );
+    CHECK( loads.size() == 1 && evictions.size() == 1 );
+    cache.markResident( loads[ 0 ] );
+    feed( cache, { { 0, 0, 0 }, { 0, 2, 2 }, { 0, 3, 3 }, { 0, 1, 1 }, { 0, 2, 1 } } );
+    cache.update( 8, loads, prefetches, evictions );
+    CHECK( loads.empty() && evictions.empty() && prefetches.empty() );
+    CHECK( cache.size() == cache.capacity() );
+}
+
+TEST_CASE( tileCacheLoadsCoarseMipsFirst )
+{
+    const TileLayout Layout = { 4, 4, 2 };
+    TileCache cache( Layout, 16 );
+    std::vector<TileKey> loads, prefetches, evictions;
+
+    // Sampling mip 0 also wants its mip 1 parent, which must come first.
+    feed( cache, { { 0, 0, 0 } } );
+    cache.update( 1, loads, prefetches, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ] == TileKey( { 1, 0, 0 } ) );
+    cache.markResident( loads[ 0 ] );
+
+    std::vector<uint8_t> map;
+    cache.buildResidencyMap( map );
+    CHECK( map[ 0 ] == 1 && map[ 5 ] == 1 && map[ 2 ] == 2 && map[ 15 ] == 2 );
+
+    // The most recently sampled tile of a mip goes before older requests.
+    feed( cache, { { 0, 0, 0 } } );
+    feed( cache, { { 0, 1, 0 } } );
+    cache.update( 1, loads, prefetches, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ] == TileKey( { 0, 1, 0 } ) );
+
+    // A failed load releases its slot so it is requested again.
+    cache.cancel( loads[ 0 ] );
+    CHECK( !cache.isResident( loads[ 0 ] ) );
+    feed( cache, { { 0, 1, 0 } } );
+    cache.update( 1, loads, prefetches, evictions );
+    CHECK( loads.size() == 1 && loads[ 0 ] == TileKey( { 0, 1, 0 } ) );
+}
+
+TEST_CASE( asyncFileReaderReadsRanges )
+{
+    TempFile file( 4096 );
+    AsyncFileReader reader( file.path );
+    CHECK( reader.isOpen() );
+
+    reader.submit( { 7, 100, 16, 0 } );
+    reader.submit( { 8, 4090, 16, 0 } );    // runs past the end of the file
+    std::vector<AsyncFileReader::Completion> completions = waitFor( reader, 2 );
+    CHECK( completions.size() == 2 );
+    for ( const AsyncFileReader::Completion& c : completions )
+    {
+        if ( c.tag == 7 )
+        {
+            CHECK( c.ok && c.data.size() == 16 && c.data[ 0 ] == 100 && c.data[ 15 ] == 115 );
+        }
+        else
+        {
+            CHECK( c.tag == 8 && !c.ok );
+        }
+    }
+}
+
+TEST_CASE( asyncFileReaderServesHighestPriorityFirst )
+{
+    // The first read keeps the reader thread busy while the rest are queued.
+    const size_t BlockerBytes = 64 << 20;
+    TempFile file( BlockerBytes );
+    AsyncFileReader reader( file.path );
+    reader.submit( { 0, 0, BlockerBytes, 0 } );
+    const int Priorities[] = { 0, 2, 1, 2, 0, 1 };
+    for ( uint64_t i = 0; i < 6; ++i )
+    {
+        reader.submit( { i + 1, i * 16, 16, Priorities[ i ] } );
+    }
+
+    std::vector<AsyncFileReader::Completion> completions = waitFor( reader, 7 );
+    CHECK( completions.size() == 7 );
+    std::vector<uint64_t> order;
+    for ( const AsyncFileReader::Completion& c : completions )
+    {
+        if ( c.tag != 0 )
+        {
+            order.push_back( c.tag );
+        }
+    }
+    // Highest priority first, submission order within a priority.
+    CHECK( order == std::vector<uint64_t>( { 2, 4, 3, 6, 1, 5 } ) );
+}
+
+TEST_CASE( asyncFileReaderCancelsQueuedRequests )
+{
+    const size_t BlockerBytes = 64 << 20;
+    TempFile file( BlockerBytes );
+    AsyncFileReader reader( file.path );
+    reader.submit( { 0, 0, BlockerBytes, 1 } );
+    for ( uint64_t tag = 1; tag <= 4; ++tag )
+    {
+        reader.submit( { tag, tag * 16, 16, 0 } );
+    }
+
+    CHECK( reader.cancel( 2 ) );
+    CHECK( reader.cancel( 4 ) );
+    CHECK( !reader.cancel( 4 ) );
+    CHECK( !reader.cancel( 99 ) );
+
+    std::vector<AsyncFileReader::Completion> completions = waitFor( reader, 3 );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    reader.poll( completions );
+    CHECK( completions.size() == 3 );
+    for ( const AsyncFileReader::Completion& c : completions )
+    {
+        CHECK( c.tag != 2 && c.tag != 4 );
+    }
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,107 @@
+//
+//  timeline_tests.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "test_harness.hpp"
+#include "Model/mock_timeline.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+TEST_CASE( waitReturnsOnceSignaled )
+{
+    MockTimeline timeline;
+    CHECK( timeline.signaledValue() == 0 );
+    CHECK( !timeline.wait( 1, 10 ) );
+
+    std::thread signaller( [&] { timeline.signal( 2 ); } );
+    CHECK( timeline.wait( 2, 5000 ) );
+    signaller.join();
+
+    // Values at or below the signalled one are already reached.
+    CHECK( timeline.wait( 1, 0 ) && timeline.reached( 2 ) );
+    CHECK( !timeline.wait( 3, 10 ) );
+}
+
+TEST_CASE( listenersFireExactlyOnce )
+{
+    MockTimeline timeline;
+    int early = 0;
+    int late = 0;
+    uint64_t earlySeen = 0;
+    timeline.notify( 2, [&]( uint64_t value ) { ++early; earlySeen = value; } );
+
+    timeline.signal( 1 );
+    CHECK( early == 0 );
+    timeline.signal( 3 );
+    CHECK( early == 1 && earlySeen == 3 );
+
+    // Already reached, so it runs right away on the caller.
+    timeline.notify( 2, [&]( uint64_t ) { ++late; } );
+    CHECK( late == 1 );
+
+    timeline.signal( 4 );
+    timeline.signal( 5 );
+    CHECK( early == 1 && late == 1 );
+}
+
+TEST_CASE( queuesRunAlongTheirDependencies )
+{
+    MockTimeline timelineA;
+    MockTimeline timelineB;
+    std::mutex orderMutex;
+    std::vector<int> order;
+    auto record = [&]( int step )
+    {
+        std::lock_guard<std::mutex> lock( orderMutex );
+        order.push_back( step );
+    };
+
+    {
+        MockQueue queueA;
+        MockQueue queueB;
+
+        // Submitted first, but B's work may not start before A signals 1.
+        MockQueue::Submission consume;
+        consume.waits.push_back( { &timelineA, 1 } );
+        consume.work = [&] { record( 2 ); };
+        consume.pSignal = &timelineB;
+        consume.signalValue = 1;
+        queueB.submit( consume );
+
+        MockQueue::Submission produce;
+        produce.work = [&]
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+            record( 1 );
+        };
+        produce.pSignal = &timelineA;
+        produce.signalValue = 1;
+        queueA.submit( produce );
+
+        // A second A submission waiting on B closes the chain.
+        MockQueue::Submission finish;
+        finish.waits.push_back( { &timelineB, 1 } );
+        finish.work = [&] { record( 3 ); };
+        finish.pSignal = &timelineA;
+        finish.signalValue = 2;
+        queueA.submit( finish );
+
+        queueA.drain();
+        queueB.drain();
+        CHECK( timelineA.signaledValue() == 2 && timelineB.signaledValue() == 1 );
+    }
+
+    CHECK( order.size() == 3 );
+    CHECK( order == std::vector<int>( { 1, 2, 3 } ) );
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,165 @@
+//
+//  bench_main.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include "Core/job_system.hpp"
+#include "Core/trace_recorder.hpp"
+#include "Model/bench_suite.hpp"
+#include "Model/mock_bench_backend.hpp"
+#include "Model/bvh_builder.hpp"
+#include "Model/scene_graph.hpp"
+#include "Model/render_extraction.hpp"
+#include "Model/simd_kernels.hpp"
+#include "Model/block_compressor.hpp"
+#include "Model/cluster_binner.hpp"
+
+namespace
+{
+
+// Matches the app's runBench().
+const uint32_t kBenchFrames = 120;
+const uint32_t kBenchWarmupFrames = 10;
+const uint32_t kBvhBenchFrames = 60;
+const uint32_t kSceneBenchFrames = 60;
+const uint32_t kEcsBenchFrames = 60;
+const uint32_t kMathBenchFrames = 120;
+const uint32_t kTraceBenchRuns = 20;
+const uint32_t kCompressionBenchRuns = 5;
+const uint32_t kClusterBenchFrames = 60;
+
+// Quick runs only check that a backend works: its smallest size, a few frames.
+const uint32_t kQuickFrames = 5;
+
+std::vector<uint32_t> sizes( std::vector<uint32_t> full, bool quick )
+{
+    return quick ? std::vector<uint32_t>{ full.front() } : full;
+}
+
+uint32_t frames( uint32_t full, bool quick )
+{
+    return quick ? kQuickFrames : full;
+}
+
+}
+
+// The benchmarks that need no GPU, for hosts the app does not run on.
+// host_bench [backend [quick]] takes the backend from the argument, then
+// TEST_BENCH, then defaults to mock; TEST_BENCH_BASELINE and TEST_BENCH_UPDATE
+// work as they do for the app. ctest runs every backend quick.
+int main( int argc, const char* argv[] )
+{
+    const char* backendName = argc > 1 ? argv[ 1 ] : getenv( "TEST_BENCH" );
+    backendName = backendName ? backendName : "mock";
+    const bool Quick = argc > 2 && strcmp( argv[ 2 ], "quick" ) == 0;
+
+    std::vector<BenchResult> results;
+    if ( strcmp( backendName, "mock" ) == 0 )
+    {
+        MockBenchBackend backend;
+        results = runBenchSuite( backend, defaultBenchScenes(), frames( kBenchFrames, Quick ), kBenchWarmupFrames );
+    }
+    else if ( strcmp( backendName, "bvh" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runBvhBench( sizes( { 10000, 100000, 500000 }, Quick ), frames( kBvhBenchFrames, Quick ), jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "BVH validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "scene" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runSceneGraphBench( sizes( { 10000, 100000, 1000000 }, Quick ), frames( kSceneBenchFrames, Quick ), jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "Scene graph validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "ecs" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runEcsBench( sizes( { 10000, 100000, 1000000 }, Quick ), frames( kEcsBenchFrames, Quick ), jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "ECS validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "math" ) == 0 )
+    {
+        size_t problems = 0;
+        __builtin_printf( "Math backend: %s\n", math::backendName() );
+        results = runSimdMathBench( sizes( { 10000, 100000, 1000000 }, Quick ), frames( kMathBenchFrames, Quick ), problems );
+        if ( problems )
+        {
+            __builtin_printf( "Math kernel validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "trace" ) == 0 )
+    {
+        // Milliseconds per million scopes, which reads as nanoseconds per scope.
+        const size_t Iterations = Quick ? 100000 : 1000000;
+        std::vector<double> disabledMs, enabledMs;
+        for ( uint32_t run = 0; run < frames( kTraceBenchRuns, Quick ); ++run )
+        {
+            TraceOverhead overhead = measureTraceOverhead( Iterations );
+            disabledMs.push_back( overhead.disabledNsPerScope );
+            enabledMs.push_back( overhead.enabledNsPerScope );
+        }
+        for ( bool enabled : { false, true } )
+        {
+            BenchResult& result = results.emplace_back();
+            result.scene = enabled ? "trace-scope-on-1M" : "trace-scope-off-1M";
+            result.cpuEncode = summarizeFrameTimes( enabled ? enabledMs : disabledMs );
+        }
+    }
+    else if ( strcmp( backendName, "compress" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runCompressionBench( sizes( { 256, 1024 }, Quick ), frames( kCompressionBenchRuns, Quick ), jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "Compression validation: %zu encodes below their minimum PSNR\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "lights" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runClusterBinningBench( sizes( { 256, 4096, 16384 }, Quick ), frames( kClusterBenchFrames, Quick ), jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "Cluster binning validation: %zu differing clusters\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else
+    {
+        __builtin_printf( "Bench: unknown host backend \"%s\", expected mock, bvh, scene, ecs, math, trace, compress or lights\n", backendName );
+        return 1;
+    }
+
+    printBenchResults( backendName, results );
+    const char* update = getenv( "TEST_BENCH_UPDATE" );
+    return reportAgainstBaseline( backendName, getenv( "TEST_BENCH_BASELINE" ), update && atoi( update ) != 0, results );
+}
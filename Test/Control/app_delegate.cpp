@@ -13,6 +13,7 @@ MyAppDelegate::~MyAppDelegate()
     _pWindow->release();
     _pDevice->release();
     delete _pViewDelegate;
+    delete _pDevices;
 }
 
 void MyAppDelegate::applicationDidFinishLaunching( NS::Notification* pNotification )
@@ -25,17 +26,72 @@ void MyAppDelegate::applicationDidFinishLaunching( NS::Notification* pNotificati
         NS::BackingStoreBuffered,
         false );
 
-    _pDevice = MTL::CreateSystemDefaultDevice();
+    // Scored over every GPU rather than the system default, which on dual-GPU
+    // laptops is whichever one is active. TEST_GPU_POWER=low prefers the
+    // integrated GPU.
+    const char* gpuPower = getenv( "TEST_GPU_POWER" );
+    _pDevices = new DeviceSet( gpuPower && strcmp( gpuPower, "low" ) == 0 ? GpuPreference::LowPower : GpuPreference::Performance );
+    _pDevice = _pDevices->display()->retain();
 
     _pMtkView = MTK::View::alloc()->init( frame, _pDevice );
     _pMtkView->setColorPixelFormat( MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB );
     _pMtkView->setClearColor( MTL::ClearColor::Make( 1.0, 1.0, 1.0, 1.0 ) );
-    _pMtkView->setDepthStencilPixelFormat(MTL::PixelFormatDepth32Float);
-    _pMtkView->setClearDepth(1.0);
+    // No depth from the view: the renderer attaches its own, memoryless where
+    // the GPU allows, instead of a full allocation MTK::View would keep around.
+    _pMtkView->setDepthStencilPixelFormat( MTL::PixelFormatInvalid );
 
     _pViewDelegate = new MyMTKViewDelegate( _pDevice );
     _pMtkView->setDelegate( _pViewDelegate );
 
+    // Start at the display rate; the renderer's frame pacer lowers it when frames
+    // do not fit. TEST_DISPLAY_HZ=120 for ProMotion displays, TEST_PACING=throughput
+    // to trade input latency for GPU occupancy.
+    const char* displayHz = getenv( "TEST_DISPLAY_HZ" );
+    const char* pacing = getenv( "TEST_PACING" );
+    FramePacer& pacer = _pViewDelegate->renderer()->framePacer();
+    pacer.setDisplayHz( displayHz ? uint32_t( atoi( displayHz ) ) : 60 );
+    pacer.setMode( pacing && strcmp( pacing, "throughput" ) == 0 ? PacingMode::Throughput : PacingMode::Latency );
+    _pMtkView->setPreferredFramesPerSecond( NS::Integer( pacer.targetFps() ) );
+
+    // TEST_MSAA=4 multisamples the scene in tile memory and resolves on store.
+    const char* msaa = getenv( "TEST_MSAA" );
+    if ( msaa )
+    {
+        _pViewDelegate->renderer()->setSampleCount( NS::UInteger( atoi( msaa ) ) );
+    }
+
+    // TEST_DYNAMIC_RES=1 scales render resolution with GPU load, =ratemap also
+    // shades the screen edges at half rate.
+    const char* dynamicRes = getenv( "TEST_DYNAMIC_RES" );
+    if ( dynamicRes && strcmp( dynamicRes, "0" ) != 0 )
+    {
+        _pViewDelegate->renderer()->enableDynamicResolution( strcmp( dynamicRes, "ratemap" ) == 0 );
+    }
+
+    // TEST_ASYNC_COMPUTE=1 moves per-frame compute work to a second queue.
+    const char* asyncCompute = getenv( "TEST_ASYNC_COMPUTE" );
+    if ( asyncCompute && atoi( asyncCompute ) != 0 )
+    {
+        _pViewDelegate->renderer()->enableAsyncCompute();
+    }
+
+    // TEST_SHADER_SOURCE=/path/to/Shaders.metal reloads shaders from that file on save.
+    if ( const char* shaderSource = getenv( "TEST_SHADER_SOURCE" ) )
+    {
+        _pViewDelegate->renderer()->enableShaderHotReload( shaderSource );
+    }
+
+    // TEST_CAPTURE=/path/to/dir captures frames after hitches, or on kill -USR1,
+    // into that directory; TEST_CAPTURE_MS also captures any frame over that time.
+    if ( const char* captureDir = getenv( "TEST_CAPTURE" ) )
+    {
+        CaptureTriggerSettings settings;
+        const char* captureMs = getenv( "TEST_CAPTURE_MS" );
+        settings.absoluteMs = captureMs ? atof( captureMs ) : 0.0;
+        _pViewDelegate->renderer()->enableGpuCapture( captureDir, settings );
+        _pViewDelegate->renderer()->gpuCapture()->installSignalHandler();
+    }
+
     _pWindow->setContentView( _pMtkView );
     _pWindow->setTitle( NS::String::string( "00 - Window", NS::StringEncoding::UTF8StringEncoding ) );
 
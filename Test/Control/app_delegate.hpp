@@ -12,6 +12,7 @@
 #include <AppKit/AppKit.hpp>
 #include <MetalKit/MetalKit.hpp>
 #include "view_delegate.hpp"
+#include "View/multi_gpu.hpp"
 
 class MyAppDelegate : public NS::ApplicationDelegate
 {
@@ -25,6 +26,7 @@ class MyAppDelegate : public NS::ApplicationDelegate
         MTK::View* _pMtkView;
         MTL::Device* _pDevice;
         MyMTKViewDelegate* _pViewDelegate = nullptr;
+        DeviceSet* _pDevices = nullptr;
 };
 
 #endif /* app_delegate_hpp */
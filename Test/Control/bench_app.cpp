@@ -0,0 +1,232 @@
+//
+//  bench_app.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "bench_app.hpp"
+
+#include <Metal/Metal.hpp>
+#include <cstring>
+#include "Core/job_system.hpp"
+#include "Model/mock_bench_backend.hpp"
+#include "Model/bvh_builder.hpp"
+#include "Model/scene_graph.hpp"
+#include "Model/render_extraction.hpp"
+#include "Model/simd_kernels.hpp"
+#include "Model/block_compressor.hpp"
+#include "View/metal_bench_backend.hpp"
+#include "View/renderer.hpp"
+#include "View/tile_deferred_renderer.hpp"
+#include "View/gpu_cluster_binner.hpp"
+#include "View/async_compute.hpp"
+#include "View/material_stitcher.hpp"
+#include "View/gpu_mip_generator.hpp"
+#include "View/resource_registry.hpp"
+#include "View/lod_streamer.hpp"
+#include "View/sparse_texture_streamer.hpp"
+
+namespace
+{
+
+const uint32_t kBenchFrames = 120;
+const uint32_t kBenchWarmupFrames = 10;
+
+// Light scaling runs at 1080p, where per-pixel light cost dominates.
+const uint32_t kLightBenchWidth = 1920;
+const uint32_t kLightBenchHeight = 1080;
+const uint32_t kLightBenchFrames = 60;
+const uint32_t kClusterBenchLights = 4096;
+
+const uint32_t kBvhBenchFrames = 60;
+const uint32_t kSceneBenchFrames = 60;
+const uint32_t kEcsBenchFrames = 60;
+const uint32_t kMathBenchFrames = 120;
+const uint32_t kCompressionBenchRuns = 5;
+
+// The blit box filter against the CPU one, allowing for rounding and the
+// driver's sRGB conversion.
+const uint32_t kMipBenchSize = 1024;
+const int kMipMaxChannelDifference = 2;
+
+// A scene's worth of materials, most of them sharing a graph with another.
+const uint32_t kMaterialBenchCount = 256;
+const uint32_t kMaterialBenchGraphs = 64;
+
+// Long enough for the camera's flight, or the texture window's sweep, to stream
+// everything in and out.
+const uint32_t kStreamingBenchFrames = 600;
+
+// Smooth gradients with a fine checkerboard and noise on top, so every mip
+// level has detail left to filter.
+std::vector<uint8_t> mipTestImage( uint32_t width, uint32_t height )
+{
+    std::vector<uint8_t> rgba( size_t( width ) * height * 4 );
+    uint32_t seed = 1;
+    for ( uint32_t y = 0; y < height; ++y )
+    {
+        for ( uint32_t x = 0; x < width; ++x )
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint8_t* pPixel = &rgba[ ( size_t( y ) * width + x ) * 4 ];
+            pPixel[ 0 ] = uint8_t( x * 255 / ( width - 1 ) );
+            pPixel[ 1 ] = uint8_t( ( ( x ^ y ) & 4 ) ? 200 : 40 );
+            pPixel[ 2 ] = uint8_t( seed >> 24 );
+            pPixel[ 3 ] = uint8_t( y * 255 / ( height - 1 ) );
+        }
+    }
+    return rgba;
+}
+
+}
+
+int runBench( const char* backendName, const char* baselinePath, bool updateBaseline )
+{
+    std::vector<BenchResult> results;
+    if ( strcmp( backendName, "mock" ) == 0 )
+    {
+        MockBenchBackend backend;
+        results = runBenchSuite( backend, defaultBenchScenes(), kBenchFrames, kBenchWarmupFrames );
+    }
+    else if ( strcmp( backendName, "metal" ) == 0 )
+    {
+        MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+        Renderer* pRenderer = new Renderer( pDevice );
+        MetalBenchBackend* pBackend = new MetalBenchBackend( pRenderer );
+        results = runBenchSuite( *pBackend, defaultBenchScenes(), kBenchFrames, kBenchWarmupFrames );
+        delete pBackend;
+        delete pRenderer;
+        pDevice->release();
+    }
+    else if ( strcmp( backendName, "lights" ) == 0 )
+    {
+        MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+        MTL::CommandQueue* pQueue = pDevice->newCommandQueue();
+        results = runLightScalingBench( pDevice, pQueue, kLightBenchWidth, kLightBenchHeight,
+                                        { 16, 64, 256, 1024, 4096 }, kLightBenchFrames, kBenchWarmupFrames );
+
+        // The clustered binning must match its CPU oracle exactly.
+        JobSystem jobs;
+        ViewSpaceLightSetDesc lightDesc;
+        lightDesc.count = kClusterBenchLights;
+        ClusterValidation validation = validateGpuClusterBinning( pDevice, pQueue, ClusterGridDesc(), generateViewSpaceLights( lightDesc ), jobs );
+        __builtin_printf( "Cluster binning, %u lights: %zu indices, CPU %.3f ms, GPU %.3f ms, %zu differing clusters\n",
+                          kClusterBenchLights, validation.indexCount, validation.cpuMs, validation.gpuMs, validation.differingClusters );
+        pQueue->release();
+        pDevice->release();
+        if ( validation.differingClusters )
+        {
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "async" ) == 0 )
+    {
+        MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+        MTL::CommandQueue* pQueue = pDevice->newCommandQueue();
+        results = runAsyncComputeBench( pDevice, pQueue, kLightBenchWidth, kLightBenchHeight, kLightBenchFrames, kBenchWarmupFrames );
+        pQueue->release();
+        pDevice->release();
+    }
+    else if ( strcmp( backendName, "materials" ) == 0 )
+    {
+        MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+        results = runMaterialBench( pDevice, kMaterialBenchCount, kMaterialBenchGraphs );
+        pDevice->release();
+    }
+    else if ( strcmp( backendName, "streaming" ) == 0 )
+    {
+        MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+        MTL::CommandQueue* pQueue = pDevice->newCommandQueue();
+        results = runLodStreamingBench( pDevice, pQueue, kStreamingBenchFrames, kBenchWarmupFrames );
+        std::vector<BenchResult> textures = runTextureStreamingBench( pDevice, pQueue, kStreamingBenchFrames, kBenchWarmupFrames );
+        results.insert( results.end(), textures.begin(), textures.end() );
+        pQueue->release();
+        pDevice->release();
+    }
+    else if ( strcmp( backendName, "mips" ) == 0 )
+    {
+        // A correctness check only, there are no timings to compare.
+        MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+        MTL::CommandQueue* pQueue = pDevice->newCommandQueue();
+        ResourceRegistry* pResources = new ResourceRegistry( pDevice );
+        JobSystem jobs;
+        std::vector<uint8_t> image = mipTestImage( kMipBenchSize, kMipBenchSize );
+        bool ok = validateGpuMipmaps( pResources, pQueue, image.data(), kMipBenchSize, kMipBenchSize, kMipMaxChannelDifference, jobs );
+        __builtin_printf( "GPU mipmaps %s, tolerance %d per channel\n", ok ? "match" : "DIFFER", kMipMaxChannelDifference );
+        delete pResources;
+        pQueue->release();
+        pDevice->release();
+        return ok ? 0 : 1;
+    }
+    else if ( strcmp( backendName, "bvh" ) == 0 )
+    {
+        // CPU only, so it runs on any host.
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runBvhBench( { 10000, 100000, 500000 }, kBvhBenchFrames, jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "BVH validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "scene" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runSceneGraphBench( { 10000, 100000, 1000000 }, kSceneBenchFrames, jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "Scene graph validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "ecs" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runEcsBench( { 10000, 100000, 1000000 }, kEcsBenchFrames, jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "ECS validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "math" ) == 0 )
+    {
+        size_t problems = 0;
+        __builtin_printf( "Math backend: %s\n", math::backendName() );
+        results = runSimdMathBench( { 10000, 100000, 1000000 }, kMathBenchFrames, problems );
+        if ( problems )
+        {
+            __builtin_printf( "Math kernel validation: %zu problems\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else if ( strcmp( backendName, "compress" ) == 0 )
+    {
+        JobSystem jobs;
+        size_t problems = 0;
+        results = runCompressionBench( { 256, 1024 }, kCompressionBenchRuns, jobs, problems );
+        if ( problems )
+        {
+            __builtin_printf( "Compression validation: %zu encodes below their minimum PSNR\n", problems );
+            printBenchResults( backendName, results );
+            return 1;
+        }
+    }
+    else
+    {
+        __builtin_printf( "Bench: unknown backend \"%s\", expected metal, mock, lights, mips, bvh, scene, ecs, math, async, materials, streaming or compress\n", backendName );
+        return 1;
+    }
+
+    printBenchResults( backendName, results );
+    return reportAgainstBaseline( backendName, baselinePath, updateBaseline, results );
+}
@@ -0,0 +1,25 @@
+//
+//  bench_app.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef bench_app_hpp
+#define bench_app_hpp
+
+// Runs the default benchmark scenes on the named backend ("metal" or "mock"),
+// the tile deferred against forward light scaling runs plus the clustered
+// binning check ("lights"), the GPU mipmap check against the CPU box filter
+// ("mips"), the CPU BVH build and refit runs ("bvh"), scene graph transform
+// updates ("scene"), ECS systems and draw packet extraction ("ecs"), the SIMD
+// math transform and culling kernels against scalar loops ("math"), serial
+// against async compute frames ("async"), stitched against standalone material
+// pipeline builds ("materials"), LOD and sparse texture streaming over a moving
+// view ("streaming"), or block compression in every format and preset
+// ("compress"), and prints the results.
+// With a baseline path, compares against it and returns 1 on any regression;
+// with updateBaseline, rewrites the baseline instead.
+int runBench( const char* backendName, const char* baselinePath, bool updateBaseline );
+
+#endif /* bench_app_hpp */
@@ -0,0 +1,138 @@
+//
+//  gpu_app.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "gpu_app.hpp"
+
+#include <Metal/Metal.hpp>
+#include <algorithm>
+#include <cstring>
+#include "Model/gpu_selection.hpp"
+#include "View/multi_gpu.hpp"
+#include "View/resource_registry.hpp"
+
+namespace
+{
+
+// The display GPU's own frame, which offscreen work queues behind.
+const double kDisplayFrameMs = 8.0;
+
+const uint32_t kTransferSize = 1024;
+
+std::vector<OffscreenJob> sampleJobs()
+{
+    return {
+        { "shadow bake",        6.0, 4u * 2048 * 2048 },
+        { "probe relight",      4.0, 8u * 128 * 128 * 6 },
+        { "bvh build",          2.5, 32u << 20 },
+        { "ambient occlusion",  3.0, 2u * 1920 * 1080 },
+        { "particle sim",       0.5, 1u << 20 },
+    };
+}
+
+void printSchedule( const std::vector<GpuDeviceInfo>& devices, const GpuSelection& selection )
+{
+    std::vector<OffscreenJob> jobs = sampleJobs();
+    std::vector<JobPlacement> placements = scheduleOffscreenJobs( jobs, devices, selection, kDisplayFrameMs );
+    GpuSelection alone = { selection.display, -1 };
+    std::vector<JobPlacement> serial = scheduleOffscreenJobs( jobs, devices, alone, kDisplayFrameMs );
+
+    double makespan = 0.0, serialMakespan = 0.0;
+    for ( size_t i = 0; i < placements.size(); ++i )
+    {
+        const JobPlacement& placement = placements[ i ];
+        __builtin_printf( "    %-18s on %-9s %6.2f - %6.2f ms, transfer %.2f ms\n", jobs[ placement.job ].name.c_str(),
+                          placement.device == selection.display ? "display" : "offscreen",
+                          placement.startMs, placement.endMs, placement.transferMs );
+        makespan = std::max( makespan, placement.endMs );
+        serialMakespan = std::max( serialMakespan, serial[ i ].endMs );
+    }
+    __builtin_printf( "    done at %.2f ms, %.2f ms on the display GPU alone\n", makespan, serialMakespan );
+}
+
+// Round-trips a pattern from the offscreen GPU to the display GPU and checks
+// every byte arrived.
+bool checkTransfer( MTL::Device* pSource, MTL::Device* pDestination )
+{
+    const size_t Bytes = size_t( kTransferSize ) * kTransferSize * 4;
+    ResourceRegistry* pSourceResources = new ResourceRegistry( pSource );
+    ResourceRegistry* pDestinationResources = new ResourceRegistry( pDestination );
+
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatRGBA8Unorm, kTransferSize, kTransferSize, false );
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    MTL::Texture* pSourceTexture = pSourceResources->newTexture( pDesc, ResourceCategory::Texture, "Transfer check source" );
+    MTL::Texture* pDestinationTexture = pDestinationResources->newTexture( pDesc, ResourceCategory::Texture, "Transfer check destination" );
+    pDesc->release();
+
+    MTL::Buffer* pPattern = pSourceResources->newBuffer( Bytes, MTL::ResourceStorageModeShared, ResourceCategory::Staging, "Transfer check pattern" );
+    MTL::Buffer* pReadback = pDestinationResources->newBuffer( Bytes, MTL::ResourceStorageModeShared, ResourceCategory::Readback, "Transfer check readback" );
+    uint8_t* pBytes = static_cast<uint8_t*>( pPattern->contents() );
+    for ( size_t i = 0; i < Bytes; ++i )
+    {
+        pBytes[ i ] = uint8_t( i * 31 + ( i >> 12 ) );
+    }
+
+    CrossDeviceTransfer* pTransfer = new CrossDeviceTransfer( pSourceResources, pDestinationResources, kTransferSize, kTransferSize, 4 );
+    MTL::CommandQueue* pSourceQueue = pSource->newCommandQueue();
+    MTL::CommandQueue* pDestinationQueue = pDestination->newCommandQueue();
+
+    MTL::CommandBuffer* pSourceCmd = pSourceQueue->commandBuffer();
+    MTL::BlitCommandEncoder* pBlit = pSourceCmd->blitCommandEncoder();
+    pBlit->copyFromBuffer( pPattern, 0, kTransferSize * 4, Bytes, MTL::Size::Make( kTransferSize, kTransferSize, 1 ),
+                           pSourceTexture, 0, 0, MTL::Origin::Make( 0, 0, 0 ) );
+    pBlit->endEncoding();
+    uint64_t value = pTransfer->encodeSend( pSourceCmd, pSourceTexture );
+
+    // Committed first, so it has to wait on the GPU for the send.
+    MTL::CommandBuffer* pDestinationCmd = pDestinationQueue->commandBuffer();
+    pTransfer->encodeReceive( pDestinationCmd, value, pDestinationTexture );
+    pBlit = pDestinationCmd->blitCommandEncoder();
+    pBlit->copyFromTexture( pDestinationTexture, 0, 0, MTL::Origin::Make( 0, 0, 0 ), MTL::Size::Make( kTransferSize, kTransferSize, 1 ),
+                            pReadback, 0, kTransferSize * 4, Bytes );
+    pBlit->endEncoding();
+    pDestinationCmd->commit();
+    pSourceCmd->commit();
+    pDestinationCmd->waitUntilCompleted();
+
+    bool matches = memcmp( pReadback->contents(), pPattern->contents(), Bytes ) == 0;
+    __builtin_printf( "  Transfer %u x %u RGBA8: %s, %.2f ms send, %.2f ms receive\n", kTransferSize, kTransferSize,
+                      matches ? "ok" : "MISMATCH",
+                      ( pSourceCmd->GPUEndTime() - pSourceCmd->GPUStartTime() ) * 1e3,
+                      ( pDestinationCmd->GPUEndTime() - pDestinationCmd->GPUStartTime() ) * 1e3 );
+
+    pDestinationQueue->release();
+    pSourceQueue->release();
+    delete pTransfer;
+    pDestinationResources->release( pReadback );
+    pSourceResources->release( pPattern );
+    pDestinationResources->release( pDestinationTexture );
+    pSourceResources->release( pSourceTexture );
+    delete pDestinationResources;
+    delete pSourceResources;
+    return matches;
+}
+
+}
+
+int runGpuReport( const char* mode )
+{
+    if ( strcmp( mode, "metal" ) != 0 )
+    {
+        __builtin_printf( "TEST_GPUS: unknown mode \"%s\", expected metal\n", mode );
+        return 1;
+    }
+
+    DeviceSet devices( GpuPreference::Performance );
+    if ( !devices.display() )
+    {
+        __builtin_printf( "TEST_GPUS: no Metal device\n" );
+        return 1;
+    }
+    __builtin_printf( "%zu GPUs:\n", devices.infos().size() );
+    printGpuSelection( devices.infos(), devices.selection() );
+    printSchedule( devices.infos(), devices.selection() );
+    return devices.offscreen() && !checkTransfer( devices.offscreen(), devices.display() ) ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+//
+//  gpu_app.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef gpu_app_hpp
+#define gpu_app_hpp
+
+// Prints which GPUs would drive the display and take offscreen work, and how
+// a sample set of offscreen jobs would be split between them, then round-trips
+// a texture between the two when there is a second one. "metal" is the only
+// mode; Host/Tests/gpu_selection_tests.cpp covers mock machines. Returns the
+// process exit code.
+int runGpuReport( const char* mode );
+
+#endif /* gpu_app_hpp */
@@ -0,0 +1,64 @@
+//
+//  headless_app.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "headless_app.hpp"
+
+#include <Metal/Metal.hpp>
+#include <atomic>
+#include <cstdio>
+#include "View/renderer.hpp"
+#include "View/offscreen_runner.hpp"
+
+int runHeadless( const char* spec, unsigned readbackInterval )
+{
+    OffscreenSettings settings;
+    unsigned width = 0, height = 0, frames = 0;
+    int fields = sscanf( spec, "%ux%ux%u", &width, &height, &frames );
+    if ( fields < 2 || width == 0 || height == 0 )
+    {
+        __builtin_printf( "TEST_HEADLESS expects WIDTHxHEIGHT[xFRAMES], got \"%s\"\n", spec );
+        return 1;
+    }
+    settings.width = width;
+    settings.height = height;
+    if ( fields == 3 && frames > 0 )
+    {
+        settings.frames = frames;
+    }
+    settings.readbackInterval = readbackInterval;
+
+    MTL::Device* pDevice = MTL::CreateSystemDefaultDevice();
+    Renderer* pRenderer = new Renderer( pDevice );
+    OffscreenRunner* pRunner = new OffscreenRunner( pDevice, pRenderer, settings );
+
+    std::atomic<uint32_t> readbacks { 0 };
+    std::atomic<uint32_t> lastCenterPixel { 0 };
+    pRunner->setReadbackFunction( [&]( uint64_t, const uint8_t* pPixels, uint32_t w, uint32_t h, size_t bytesPerRow )
+    {
+        const uint8_t* pCenter = pPixels + ( h / 2 ) * bytesPerRow + ( w / 2 ) * 4;
+        lastCenterPixel = uint32_t( pCenter[ 0 ] ) | uint32_t( pCenter[ 1 ] ) << 8 | uint32_t( pCenter[ 2 ] ) << 16 | uint32_t( pCenter[ 3 ] ) << 24;
+        ++readbacks;
+    } );
+
+    __builtin_printf( "Headless: %ux%u, %u frames after %u warmup on %s\n", settings.width, settings.height,
+                      settings.frames, settings.warmupFrames, pDevice->name()->utf8String() );
+    OffscreenReport report = pRunner->run();
+    printFrameTimeStats( "Frame", report.frameTimes );
+    printFrameTimeStats( "GPU", report.gpuTimes );
+    if ( readbackInterval )
+    {
+        __builtin_printf( "Read back %u frames, last center pixel BGRA 0x%08x\n", readbacks.load(), lastCenterPixel.load() );
+    }
+
+    pRenderer->resources()->dump();
+    pRenderer->attachments()->printSavings();
+
+    delete pRunner;
+    delete pRenderer;
+    pDevice->release();
+    return 0;
+}
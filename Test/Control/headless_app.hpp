@@ -0,0 +1,16 @@
+//
+//  headless_app.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef headless_app_hpp
+#define headless_app_hpp
+
+// Renders offscreen with no window and prints a frame time report.
+// spec is "WIDTHxHEIGHT[xFRAMES]", e.g. "3840x2160x2000"; readbackInterval of 0
+// disables reading frames back. Returns the process exit code.
+int runHeadless( const char* spec, unsigned readbackInterval );
+
+#endif /* headless_app_hpp */
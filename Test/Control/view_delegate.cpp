@@ -6,6 +6,7 @@
 //
 
 #include "view_delegate.hpp"
+#include "Core/trace_recorder.hpp"
 
 MyMTKViewDelegate::MyMTKViewDelegate( MTL::Device* pDevice )
 : MTK::ViewDelegate()
@@ -20,5 +21,6 @@ MyMTKViewDelegate::~MyMTKViewDelegate()
 
 void MyMTKViewDelegate::drawInMTKView( MTK::View* pView )
 {
+    TRACE_SCOPE( "MyMTKViewDelegate::drawInMTKView" );
     _pRenderer->draw( pView );
 }
@@ -22,6 +22,8 @@ public:
     virtual ~MyMTKViewDelegate() override;
     virtual void drawInMTKView( MTK::View* pView ) override;
 
+    Renderer* renderer() const { return _pRenderer; }
+
 private:
     Renderer* _pRenderer;
 };
@@ -0,0 +1,88 @@
+//
+//  file_watcher.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "file_watcher.hpp"
+#include "trace_recorder.hpp"
+
+#include <chrono>
+#include <climits>
+#include <filesystem>
+
+namespace
+{
+
+// Modification time mixed with size; kMissing while the file is missing, as
+// it is for a moment when editors save by renaming over it.
+const int64_t kMissing = INT64_MIN;
+
+int64_t fileStamp( const std::string& path )
+{
+    std::error_code error;
+    auto time = std::filesystem::last_write_time( path, error );
+    if ( error )
+    {
+        return kMissing;
+    }
+    uintmax_t size = std::filesystem::file_size( path, error );
+    return int64_t( time.time_since_epoch().count() ) ^ ( error ? 0 : int64_t( size ) << 40 );
+}
+
+}
+
+FileWatcher::FileWatcher( uint32_t intervalMs )
+: _intervalMs( intervalMs )
+, _thread( [this] { threadMain(); } )
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _quit = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+void FileWatcher::watch( const std::string& path, const Callback& callback )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    _entries.push_back( { path, callback, fileStamp( path ) } );
+}
+
+void FileWatcher::threadMain()
+{
+    TraceRecorder::setThreadName( "FileWatcher" );
+    std::unique_lock<std::mutex> lock( _mutex );
+    while ( !_wake.wait_for( lock, std::chrono::milliseconds( _intervalMs ), [this] { return _quit; } ) )
+    {
+        // Copied out, so the callbacks run unlocked and may take their time or add watches.
+        std::vector<std::pair<std::string, Callback>> calls;
+        for ( Entry& entry : _entries )
+        {
+            int64_t stamp = fileStamp( entry.path );
+            if ( stamp != entry.stamp )
+            {
+                entry.stamp = stamp;
+                entry.pending = true;
+            }
+            else if ( entry.pending && stamp != kMissing )
+            {
+                entry.pending = false;
+                calls.emplace_back( entry.path, entry.callback );
+            }
+        }
+
+        lock.unlock();
+        for ( const std::pair<std::string, Callback>& call : calls )
+        {
+            call.second( call.first );
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  file_watcher.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef file_watcher_hpp
+#define file_watcher_hpp
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Polls files for changes on its own thread. Polling keeps it portable and
+// costs a stat per file per interval, which is nothing for a handful of shader
+// sources. A change is reported once the file has stopped changing for one
+// interval, so editors that save in several writes trigger one callback.
+// Callbacks run on the watcher thread, one at a time.
+class FileWatcher
+{
+public:
+    using Callback = std::function<void( const std::string& path )>;
+
+    explicit FileWatcher( uint32_t intervalMs = 250 );
+    ~FileWatcher();
+
+    void watch( const std::string& path, const Callback& callback );
+
+private:
+    struct Entry
+    {
+        std::string path;
+        Callback    callback;
+        int64_t     stamp;              // last seen modification time and size
+        bool        pending = false;    // changed, waiting to settle
+    };
+
+    void threadMain();
+
+    uint32_t                    _intervalMs;
+    std::mutex                  _mutex;
+    std::condition_variable     _wake;
+    std::vector<Entry>          _entries;
+    bool                        _quit = false;
+    std::thread                 _thread;
+};
+
+#endif /* file_watcher_hpp */
@@ -0,0 +1,123 @@
+//
+//  job_system.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "job_system.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem( unsigned threadCount )
+{
+    if ( threadCount == 0 )
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    _workers.reserve( threadCount );
+    for ( unsigned i = 0; i < threadCount; ++i )
+    {
+        _workers.emplace_back( &JobSystem::workerMain, this );
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _quit = true;
+    }
+    _wake.notify_all();
+
+    for ( std::thread& worker : _workers )
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor( size_t count, size_t grain, const RangeFunction& body )
+{
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    grain = std::max< size_t >( grain, 1 );
+    if ( _workers.empty() || count <= grain )
+    {
+        body( 0, count );
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit( _submitMutex );
+    {
+        std::unique_lock<std::mutex> lock( _mutex );
+        // A worker that woke up late for the previous job may still be on its way out.
+        _done.wait( lock, [this] { return _busyWorkers == 0; } );
+
+        _pBody = &body;
+        _count = count;
+        _grain = grain;
+        _next = 0;
+        _remaining = ( count + grain - 1 ) / grain;
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock( _mutex );
+    _done.wait( lock, [this] { return _remaining == 0 && _busyWorkers == 0; } );
+    _pBody = nullptr;
+}
+
+void JobSystem::runChunks()
+{
+    for ( ;; )
+    {
+        size_t begin = _next.fetch_add( 1 ) * _grain;
+        if ( begin >= _count )
+        {
+            return;
+        }
+
+        ( *_pBody )( begin, std::min( begin + _grain, _count ) );
+
+        if ( _remaining.fetch_sub( 1 ) == 1 )
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _done.notify_all();
+        }
+    }
+}
+
+void JobSystem::workerMain()
+{
+    uint64_t seen = 0;
+    for ( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( _mutex );
+            _wake.wait( lock, [&] { return _quit || _generation != seen; } );
+            if ( _quit )
+            {
+                return;
+            }
+            seen = _generation;
+            if ( !_pBody )
+            {
+                continue;
+            }
+            ++_busyWorkers;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        --_busyWorkers;
+        _done.notify_all();
+    }
+}
@@ -0,0 +1,59 @@
+//
+//  job_system.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef job_system_hpp
+#define job_system_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads for data-parallel CPU work.
+//
+// parallelFor() splits [0, count) into chunks of `grain` items, runs them on the
+// workers and on the calling thread, and returns once every chunk is done. Calls
+// are serialized, so it is safe to share one JobSystem between systems as long
+// as the body does not call back into parallelFor().
+class JobSystem
+{
+public:
+    using RangeFunction = std::function<void( size_t begin, size_t end )>;
+
+    // threadCount of 0 uses one worker per hardware thread, minus the caller.
+    explicit JobSystem( unsigned threadCount = 0 );
+    ~JobSystem();
+
+    void parallelFor( size_t count, size_t grain, const RangeFunction& body );
+
+    unsigned workerCount() const { return unsigned( _workers.size() ); }
+
+private:
+    void workerMain();
+    void runChunks();
+
+    std::vector<std::thread>    _workers;
+    std::mutex                  _submitMutex;
+    std::mutex                  _mutex;
+    std::condition_variable     _wake;
+    std::condition_variable     _done;
+
+    const RangeFunction*        _pBody = nullptr;
+    size_t                      _count = 0;
+    size_t                      _grain = 1;
+    std::atomic<size_t>         _next { 0 };
+    std::atomic<size_t>         _remaining { 0 };
+    uint64_t                    _generation = 0;
+    unsigned                    _busyWorkers = 0;
+    bool                        _quit = false;
+};
+
+#endif /* job_system_hpp */
@@ -0,0 +1,426 @@
+//
+//  trace_recorder.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+std::atomic<bool> TraceRecorder::_enabled { false };
+
+namespace
+{
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t    startNs;
+    uint64_t    durationNs;
+};
+
+// Single producer (the owning thread), single consumer (whoever flushes).
+struct ThreadBuffer
+{
+    static constexpr uint64_t kCapacity = 16384;
+
+    uint32_t                tid;
+    char                    name[ 32 ];
+    std::atomic<uint64_t>   head { 0 };     // next slot the owner writes
+    std::atomic<uint64_t>   tail { 0 };     // next slot the consumer reads
+    std::atomic<uint64_t>   dropped { 0 };
+    TraceEvent              events[ kCapacity ];
+};
+
+// Buffers outlive their threads so late flushes still see their events; they are
+// never freed.
+std::mutex                  gRegistryMutex;
+std::vector<ThreadBuffer*>  gBuffers;
+std::atomic<uint32_t>       gNextTid { 1 };
+std::mutex                  gFlushMutex;
+std::string                 gExitPath;
+
+thread_local ThreadBuffer*  tBuffer = nullptr;
+
+ThreadBuffer* threadBuffer()
+{
+    if ( !tBuffer )
+    {
+        ThreadBuffer* pBuffer = new ThreadBuffer;
+        pBuffer->tid = gNextTid.fetch_add( 1, std::memory_order_relaxed );
+        snprintf( pBuffer->name, sizeof( pBuffer->name ), "Thread %u", pBuffer->tid );
+
+        std::lock_guard<std::mutex> lock( gRegistryMutex );
+        gBuffers.push_back( pBuffer );
+        tBuffer = pBuffer;
+    }
+    return tBuffer;
+}
+
+struct ThreadEvents
+{
+    uint32_t                tid;
+    std::string             name;
+    std::vector<TraceEvent> events;
+};
+
+// Copies out every thread's events overlapping [startNs, endNs). Consuming
+// drains also free their ring slots; peeks leave the events for the next drain.
+std::vector<ThreadEvents> drain( bool consume = true, uint64_t startNs = 0, uint64_t endNs = UINT64_MAX )
+{
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock( gRegistryMutex );
+        buffers = gBuffers;
+    }
+
+    std::vector<ThreadEvents> result;
+    for ( ThreadBuffer* pBuffer : buffers )
+    {
+        ThreadEvents& thread = result.emplace_back();
+        thread.tid = pBuffer->tid;
+        thread.name = pBuffer->name;
+
+        uint64_t tail = pBuffer->tail.load( std::memory_order_relaxed );
+        uint64_t head = pBuffer->head.load( std::memory_order_acquire );
+        for ( uint64_t i = tail; i < head; ++i )
+        {
+            const TraceEvent& event = pBuffer->events[ i % ThreadBuffer::kCapacity ];
+            if ( event.startNs < endNs && event.startNs + event.durationNs >= startNs )
+            {
+                thread.events.push_back( event );
+            }
+        }
+        if ( consume )
+        {
+            pBuffer->tail.store( head, std::memory_order_release );
+        }
+
+        // Parents before children: by start, then longest first.
+        std::sort( thread.events.begin(), thread.events.end(), []( const TraceEvent& a, const TraceEvent& b )
+        {
+            return a.startNs != b.startNs ? a.startNs < b.startNs : a.durationNs > b.durationNs;
+        } );
+    }
+    return result;
+}
+
+void writeJsonString( FILE* pFile, const char* s )
+{
+    fputc( '"', pFile );
+    for ( ; *s; ++s )
+    {
+        if ( *s == '"' || *s == '\\' )
+        {
+            fputc( '\\', pFile );
+        }
+        if ( uint8_t( *s ) >= 0x20 )
+        {
+            fputc( *s, pFile );
+        }
+    }
+    fputc( '"', pFile );
+}
+
+bool writeChromeJson( FILE* pFile, const std::vector<ThreadEvents>& threads )
+{
+    const int Pid = int( getpid() );
+    fprintf( pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+    bool first = true;
+    for ( const ThreadEvents& thread : threads )
+    {
+        fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                 first ? "" : ",\n", Pid, thread.tid );
+        writeJsonString( pFile, thread.name.c_str() );
+        fprintf( pFile, "}}" );
+        first = false;
+
+        for ( const TraceEvent& event : thread.events )
+        {
+            fprintf( pFile, ",\n{\"name\":" );
+            writeJsonString( pFile, event.name );
+            fprintf( pFile, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     Pid, thread.tid, double( event.startNs ) * 1e-3, double( event.durationNs ) * 1e-3 );
+        }
+    }
+    fprintf( pFile, "\n]}\n" );
+    return true;
+}
+
+// Minimal protobuf writer for the handful of Perfetto messages we emit.
+class ProtoWriter
+{
+public:
+    void varint( uint64_t value )
+    {
+        while ( value >= 0x80 )
+        {
+            _bytes.push_back( uint8_t( value ) | 0x80 );
+            value >>= 7;
+        }
+        _bytes.push_back( uint8_t( value ) );
+    }
+
+    void fieldVarint( uint32_t field, uint64_t value )
+    {
+        varint( uint64_t( field ) << 3 );
+        varint( value );
+    }
+
+    void fieldBytes( uint32_t field, const void* pData, size_t size )
+    {
+        varint( ( uint64_t( field ) << 3 ) | 2 );
+        varint( size );
+        const uint8_t* p = static_cast<const uint8_t*>( pData );
+        _bytes.insert( _bytes.end(), p, p + size );
+    }
+
+    void fieldString( uint32_t field, const char* s ) { fieldBytes( field, s, strlen( s ) ); }
+    void fieldMessage( uint32_t field, const ProtoWriter& message ) { fieldBytes( field, message._bytes.data(), message._bytes.size() ); }
+
+    const std::vector<uint8_t>& bytes() const { return _bytes; }
+
+private:
+    std::vector<uint8_t> _bytes;
+};
+
+// Field numbers from perfetto/protos/perfetto/trace.
+enum : uint32_t
+{
+    kTracePacket                = 1,    // Trace.packet
+    kPacketTimestamp            = 8,
+    kPacketSequenceId           = 10,
+    kPacketTrackEvent           = 11,
+    kPacketTrackDescriptor      = 60,
+    kTrackUuid                  = 1,    // TrackDescriptor
+    kTrackThread                = 4,
+    kThreadPid                  = 1,    // ThreadDescriptor
+    kThreadTid                  = 2,
+    kThreadName                 = 5,
+    kEventType                  = 9,    // TrackEvent
+    kEventTrackUuid             = 11,
+    kEventName                  = 23,
+    kSliceBegin                 = 1,    // TrackEvent.Type
+    kSliceEnd                   = 2,
+};
+
+void writePerfettoEvent( ProtoWriter& trace, uint64_t track, uint64_t timestamp, uint64_t type, const char* name )
+{
+    ProtoWriter event;
+    event.fieldVarint( kEventType, type );
+    event.fieldVarint( kEventTrackUuid, track );
+    if ( name )
+    {
+        event.fieldString( kEventName, name );
+    }
+
+    ProtoWriter packet;
+    packet.fieldVarint( kPacketTimestamp, timestamp );
+    packet.fieldVarint( kPacketSequenceId, track );
+    packet.fieldMessage( kPacketTrackEvent, event );
+    trace.fieldMessage( kTracePacket, packet );
+}
+
+bool writePerfetto( FILE* pFile, const std::vector<ThreadEvents>& threads )
+{
+    const uint64_t Pid = uint64_t( getpid() );
+    ProtoWriter trace;
+    for ( const ThreadEvents& thread : threads )
+    {
+        const uint64_t Track = thread.tid;
+
+        ProtoWriter threadDesc;
+        threadDesc.fieldVarint( kThreadPid, Pid );
+        threadDesc.fieldVarint( kThreadTid, thread.tid );
+        threadDesc.fieldString( kThreadName, thread.name.c_str() );
+        ProtoWriter trackDesc;
+        trackDesc.fieldVarint( kTrackUuid, Track );
+        trackDesc.fieldMessage( kTrackThread, threadDesc );
+        ProtoWriter packet;
+        packet.fieldVarint( kPacketSequenceId, Track );
+        packet.fieldMessage( kPacketTrackDescriptor, trackDesc );
+        trace.fieldMessage( kTracePacket, packet );
+
+        // Turn complete slices into properly nested begin/end pairs.
+        std::vector<uint64_t> openEnds;
+        for ( const TraceEvent& event : thread.events )
+        {
+            while ( !openEnds.empty() && openEnds.back() <= event.startNs )
+            {
+                writePerfettoEvent( trace, Track, openEnds.back(), kSliceEnd, nullptr );
+                openEnds.pop_back();
+            }
+            uint64_t end = event.startNs + event.durationNs;
+            if ( !openEnds.empty() )
+            {
+                end = std::min( end, openEnds.back() );
+            }
+            writePerfettoEvent( trace, Track, event.startNs, kSliceBegin, event.name );
+            openEnds.push_back( end );
+        }
+        while ( !openEnds.empty() )
+        {
+            writePerfettoEvent( trace, Track, openEnds.back(), kSliceEnd, nullptr );
+            openEnds.pop_back();
+        }
+    }
+    return fwrite( trace.bytes().data(), 1, trace.bytes().size(), pFile ) == trace.bytes().size();
+}
+
+void writeTraceAtExit()
+{
+    TraceRecorder::writeTrace( gExitPath.c_str() );
+}
+
+}
+
+void TraceRecorder::setEnabled( bool enabled )
+{
+    _enabled.store( enabled, std::memory_order_relaxed );
+}
+
+uint64_t TraceRecorder::nowNs()
+{
+#ifdef __APPLE__
+    return clock_gettime_nsec_np( CLOCK_UPTIME_RAW );
+#else
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return uint64_t( ts.tv_sec ) * 1000000000ull + uint64_t( ts.tv_nsec );
+#endif
+}
+
+void TraceRecorder::record( const char* name, uint64_t startNs, uint64_t durationNs )
+{
+    ThreadBuffer* pBuffer = threadBuffer();
+    uint64_t head = pBuffer->head.load( std::memory_order_relaxed );
+    if ( head - pBuffer->tail.load( std::memory_order_acquire ) >= ThreadBuffer::kCapacity )
+    {
+        pBuffer->dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    pBuffer->events[ head % ThreadBuffer::kCapacity ] = { name, startNs, durationNs };
+    pBuffer->head.store( head + 1, std::memory_order_release );
+}
+
+void TraceRecorder::setThreadName( const char* name )
+{
+    ThreadBuffer* pBuffer = threadBuffer();
+    snprintf( pBuffer->name, sizeof( pBuffer->name ), "%s", name );
+}
+
+bool TraceRecorder::writeTrace( const char* path )
+{
+    return writeTrace( path, true, 0, UINT64_MAX );
+}
+
+bool TraceRecorder::writeTraceWindow( const char* path, uint64_t startNs, uint64_t endNs )
+{
+    return writeTrace( path, false, startNs, endNs );
+}
+
+void TraceRecorder::discardTrace()
+{
+    std::lock_guard<std::mutex> lock( gFlushMutex );
+    drain();
+}
+
+bool TraceRecorder::writeTrace( const char* path, bool consume, uint64_t startNs, uint64_t endNs )
+{
+    std::lock_guard<std::mutex> lock( gFlushMutex );
+
+    FILE* pFile = fopen( path, "wb" );
+    if ( !pFile )
+    {
+        __builtin_printf( "TraceRecorder: could not open %s\n", path );
+        return false;
+    }
+
+    std::vector<ThreadEvents> threads = drain( consume, startNs, endNs );
+    size_t length = strlen( path );
+    bool json = length >= 5 && strcmp( path + length - 5, ".json" ) == 0;
+    bool ok = json ? writeChromeJson( pFile, threads ) : writePerfetto( pFile, threads );
+    fclose( pFile );
+
+    if ( uint64_t dropped = droppedEvents() )
+    {
+        __builtin_printf( "TraceRecorder: %llu events dropped, rings were full\n", (unsigned long long)dropped );
+    }
+    return ok;
+}
+
+void TraceRecorder::writeTraceOnExit( const char* path )
+{
+    bool first = gExitPath.empty();
+    gExitPath = path;
+    setEnabled( true );
+    if ( first )
+    {
+        atexit( writeTraceAtExit );
+    }
+}
+
+uint64_t TraceRecorder::droppedEvents()
+{
+    std::lock_guard<std::mutex> lock( gRegistryMutex );
+    uint64_t dropped = 0;
+    for ( ThreadBuffer* pBuffer : gBuffers )
+    {
+        dropped += pBuffer->dropped.load( std::memory_order_relaxed );
+    }
+    return dropped;
+}
+
+TraceOverhead measureTraceOverhead( size_t iterations )
+{
+    TraceOverhead result;
+    const bool WasEnabled = TraceRecorder::enabled();
+
+    std::thread bench( [&]
+    {
+        using Clock = std::chrono::steady_clock;
+        ThreadBuffer* pBuffer = threadBuffer();
+        snprintf( pBuffer->name, sizeof( pBuffer->name ), "Trace overhead" );
+
+        TraceRecorder::setEnabled( false );
+        Clock::time_point start = Clock::now();
+        for ( size_t i = 0; i < iterations; ++i )
+        {
+            TRACE_SCOPE( "overhead" );
+        }
+        result.disabledNsPerScope = std::chrono::duration<double, std::nano>( Clock::now() - start ).count() / double( iterations );
+
+        // Keep the ring from filling up so every iteration pays for a real write.
+        TraceRecorder::setEnabled( true );
+        double enabledNs = 0.0;
+        for ( size_t done = 0; done < iterations; )
+        {
+            size_t batch = std::min< size_t >( iterations - done, ThreadBuffer::kCapacity );
+            start = Clock::now();
+            for ( size_t i = 0; i < batch; ++i )
+            {
+                TRACE_SCOPE( "overhead" );
+            }
+            enabledNs += std::chrono::duration<double, std::nano>( Clock::now() - start ).count();
+            pBuffer->tail.store( pBuffer->head.load( std::memory_order_acquire ), std::memory_order_release );
+            done += batch;
+        }
+        result.enabledNsPerScope = enabledNs / double( iterations );
+    } );
+    bench.join();
+
+    TraceRecorder::setEnabled( WasEnabled );
+    return result;
+}
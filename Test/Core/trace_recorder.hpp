@@ -0,0 +1,112 @@
+//
+//  trace_recorder.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef trace_recorder_hpp
+#define trace_recorder_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// CPU trace recorder.
+//
+// TRACE_SCOPE( "name" ) records a slice from the point it is declared to the end
+// of the enclosing scope. Every thread writes into its own fixed-size ring with
+// no locks and no allocation after its first event; a full ring drops events
+// instead of blocking. writeTrace() drains all rings into a Chrome trace JSON
+// file (chrome://tracing, ui.perfetto.dev) or a Perfetto protobuf trace.
+//
+// While disabled a scope costs one relaxed atomic load. Building with
+// TRACE_DISABLED compiles the markers out entirely.
+//
+// Timestamps are nanoseconds on CLOCK_UPTIME_RAW on Apple platforms, the clock
+// behind the CPU half of MTL::Device::sampleTimestamps(), and CLOCK_MONOTONIC
+// elsewhere.
+class TraceRecorder
+{
+public:
+    static bool enabled() { return _enabled.load( std::memory_order_relaxed ); }
+    static void setEnabled( bool enabled );
+
+    static uint64_t nowNs();
+
+    // Records a finished slice on the calling thread. name must be a string with
+    // static storage; only the pointer is kept until the next flush.
+    static void record( const char* name, uint64_t startNs, uint64_t durationNs );
+
+    // Names the calling thread in exported traces.
+    static void setThreadName( const char* name );
+
+    // Drains every thread's ring into path. Paths ending in .json are written as
+    // Chrome trace JSON, anything else as Perfetto protobuf. Events recorded
+    // while writing land in the next flush.
+    static bool writeTrace( const char* path );
+
+    // Writes only the events overlapping [startNs, endNs), leaving every event
+    // in place for the next writeTrace(), such as the one at exit.
+    static bool writeTraceWindow( const char* path, uint64_t startNs, uint64_t endNs );
+
+    // Drops every recorded event.
+    static void discardTrace();
+
+    // Enables recording and writes the trace to path when the process exits.
+    static void writeTraceOnExit( const char* path );
+
+    // Events dropped because a thread's ring was full.
+    static uint64_t droppedEvents();
+
+private:
+    static bool writeTrace( const char* path, bool consume, uint64_t startNs, uint64_t endNs );
+
+    static std::atomic<bool> _enabled;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope( const char* name )
+    : _name( TraceRecorder::enabled() ? name : nullptr )
+    , _startNs( _name ? TraceRecorder::nowNs() : 0 )
+    {
+    }
+
+    ~TraceScope()
+    {
+        if ( _name )
+        {
+            TraceRecorder::record( _name, _startNs, TraceRecorder::nowNs() - _startNs );
+        }
+    }
+
+    TraceScope( const TraceScope& ) = delete;
+    TraceScope& operator=( const TraceScope& ) = delete;
+
+private:
+    const char* _name;
+    uint64_t    _startNs;
+};
+
+struct TraceOverhead
+{
+    double disabledNsPerScope = 0.0;
+    double enabledNsPerScope  = 0.0;
+};
+
+// Times empty scopes with recording off and on, on a scratch thread whose events
+// are discarded. Recording is left in the state it was found.
+TraceOverhead measureTraceOverhead( size_t iterations = 1000000 );
+
+#define TRACE_CONCAT_INNER( a, b ) a##b
+#define TRACE_CONCAT( a, b ) TRACE_CONCAT_INNER( a, b )
+
+#ifdef TRACE_DISABLED
+#define TRACE_SCOPE( name ) ((void)0)
+#else
+#define TRACE_SCOPE( name ) TraceScope TRACE_CONCAT( _traceScope, __LINE__ )( name )
+#endif
+
+#endif /* trace_recorder_hpp */
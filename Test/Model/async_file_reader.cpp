@@ -0,0 +1,109 @@
+//
+//  async_file_reader.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "async_file_reader.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+AsyncFileReader::AsyncFileReader( const char* path )
+{
+    _fd = open( path, O_RDONLY );
+    if ( _fd < 0 )
+    {
+        __builtin_printf( "AsyncFileReader: could not open %s\n", path );
+        return;
+    }
+    _thread = std::thread( &AsyncFileReader::run, this );
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _quit = true;
+    }
+    _wake.notify_one();
+
+    if ( _thread.joinable() )
+    {
+        _thread.join();
+    }
+    if ( _fd >= 0 )
+    {
+        close( _fd );
+    }
+}
+
+void AsyncFileReader::submit( const Request& request )
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        // Keep the queue sorted by priority, FIFO within the same priority.
+        auto it = std::find_if( _queue.begin(), _queue.end(),
+                                [&]( const Request& r ) { return r.priority < request.priority; } );
+        _queue.insert( it, request );
+    }
+    _wake.notify_one();
+}
+
+bool AsyncFileReader::cancel( uint64_t tag )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    auto it = std::find_if( _queue.begin(), _queue.end(), [&]( const Request& r ) { return r.tag == tag; } );
+    if ( it == _queue.end() )
+    {
+        return false;
+    }
+    _queue.erase( it );
+    return true;
+}
+
+void AsyncFileReader::poll( std::vector<Completion>& out )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    for ( Completion& c : _completed )
+    {
+        out.push_back( std::move( c ) );
+    }
+    _completed.clear();
+}
+
+void AsyncFileReader::run()
+{
+    for ( ;; )
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock( _mutex );
+            _wake.wait( lock, [this] { return _quit || !_queue.empty(); } );
+            if ( _quit )
+            {
+                return;
+            }
+            request = _queue.front();
+            _queue.pop_front();
+        }
+
+        Completion completion = { request.tag, false, std::vector<uint8_t>( request.size ) };
+        size_t done = 0;
+        while ( done < request.size )
+        {
+            ssize_t n = pread( _fd, completion.data.data() + done, request.size - done, off_t( request.offset + done ) );
+            if ( n <= 0 )
+            {
+                break;
+            }
+            done += size_t( n );
+        }
+        completion.ok = done == request.size;
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        _completed.push_back( std::move( completion ) );
+    }
+}
@@ -0,0 +1,64 @@
+//
+//  async_file_reader.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef async_file_reader_hpp
+#define async_file_reader_hpp
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reads byte ranges of a single file on a background thread. Requests are served
+// highest priority first; prefetches are queued at low priority and are the first
+// to be dropped by cancel(). Finished reads are collected by polling from the
+// render thread, so no callbacks run on the reader thread.
+class AsyncFileReader
+{
+public:
+    struct Request
+    {
+        uint64_t tag;          // caller defined, echoed back in Completion
+        uint64_t offset;
+        size_t   size;
+        int      priority;
+    };
+
+    struct Completion
+    {
+        uint64_t             tag;
+        bool                 ok;
+        std::vector<uint8_t> data;
+    };
+
+    explicit AsyncFileReader( const char* path );
+    ~AsyncFileReader();
+
+    bool isOpen() const { return _fd >= 0; }
+
+    void submit( const Request& request );
+    // Drops a queued request that has not started yet. Returns false if it is in flight or done.
+    bool cancel( uint64_t tag );
+    // Moves every finished read into out.
+    void poll( std::vector<Completion>& out );
+
+private:
+    void run();
+
+    int                         _fd = -1;
+    std::thread                 _thread;
+    std::mutex                  _mutex;
+    std::condition_variable     _wake;
+    std::deque<Request>         _queue;
+    std::vector<Completion>     _completed;
+    bool                        _quit = false;
+};
+
+#endif /* async_file_reader_hpp */
@@ -0,0 +1,84 @@
+//
+//  bench_scene.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "bench_scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+BenchScene buildBenchScene( const BenchSceneDesc& desc )
+{
+    BenchScene scene;
+    scene.desc = desc;
+
+    const uint32_t Cells = ( desc.trianglesPerDraw + 1 ) / 2;
+    const uint32_t Cols = std::max( 1u, uint32_t( std::ceil( std::sqrt( double( Cells ) ) ) ) );
+    const uint32_t Rows = std::max( 1u, ( Cells + Cols - 1 ) / Cols );
+    const float Coverage = std::min( 1.0f, desc.overdraw / float( std::max( desc.drawCount, 1u ) ) );
+    const float Side = 2.0f * std::sqrt( Coverage );
+
+    // Fixed-seed LCG so every run places the draws identically.
+    uint32_t seed = 0x9e3779b9u;
+    auto random01 = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return float( seed >> 8 ) / float( 1u << 24 );
+    };
+
+    scene.mesh.vertices.reserve( size_t( desc.drawCount ) * ( Cols + 1 ) * ( Rows + 1 ) );
+    scene.mesh.indices.reserve( size_t( desc.drawCount ) * desc.trianglesPerDraw * 3 );
+    scene.draws.reserve( desc.drawCount );
+
+    for ( uint32_t draw = 0; draw < desc.drawCount; ++draw )
+    {
+        float x0 = -1.0f + random01() * ( 2.0f - Side );
+        float y0 = -1.0f + random01() * ( 2.0f - Side );
+        float z = float( draw ) / float( desc.drawCount );
+
+        uint32_t baseVertex = uint32_t( scene.mesh.vertices.size() );
+        for ( uint32_t y = 0; y <= Rows; ++y )
+        {
+            for ( uint32_t x = 0; x <= Cols; ++x )
+            {
+                scene.mesh.vertices.push_back( { x0 + Side * float( x ) / float( Cols ), y0 + Side * float( y ) / float( Rows ), z } );
+            }
+        }
+
+        BenchDraw out;
+        out.firstIndex = uint32_t( scene.mesh.indices.size() );
+        out.pso = draw % std::max( desc.psoCount, 1u );
+        out.texture = ( draw / std::max( desc.psoCount, 1u ) ) % std::max( desc.textureCount, 1u );
+        out.coverage = Coverage;
+
+        uint32_t emitted = 0;
+        for ( uint32_t cell = 0; cell < Cells && emitted < desc.trianglesPerDraw; ++cell )
+        {
+            uint32_t i0 = baseVertex + ( cell / Cols ) * ( Cols + 1 ) + cell % Cols;
+            uint32_t i1 = i0 + 1, i2 = i0 + Cols + 1, i3 = i2 + 1;
+            scene.mesh.indices.insert( scene.mesh.indices.end(), { i0, i1, i2 } );
+            if ( ++emitted < desc.trianglesPerDraw )
+            {
+                scene.mesh.indices.insert( scene.mesh.indices.end(), { i1, i3, i2 } );
+                ++emitted;
+            }
+        }
+        out.indexCount = uint32_t( scene.mesh.indices.size() ) - out.firstIndex;
+        scene.draws.push_back( out );
+    }
+    return scene;
+}
+
+std::vector<BenchSceneDesc> defaultBenchScenes()
+{
+    return {
+        { "triangle",        1,     1,     0.1f, 1,  1  },
+        { "many_draws",      4096,  2,     1.0f, 1,  1  },
+        { "heavy_geometry",  16,    65536, 1.0f, 1,  1  },
+        { "overdraw",        8,     2,     8.0f, 1,  1  },
+        { "state_changes",   2048,  32,    2.0f, 32, 64 },
+    };
+}
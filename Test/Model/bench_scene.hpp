@@ -0,0 +1,50 @@
+//
+//  bench_scene.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef bench_scene_hpp
+#define bench_scene_hpp
+
+#include <cstdint>
+#include <vector>
+#include "Model/mesh.hpp"
+
+// Parameters of a synthetic benchmark scene. The same description always builds
+// the same geometry, so results are comparable between runs and machines.
+struct BenchSceneDesc
+{
+    const char* name;
+    uint32_t    drawCount;
+    uint32_t    trianglesPerDraw;
+    float       overdraw;           // total screen coverage of all draws, in screens
+    uint32_t    psoCount;           // distinct pipelines, cycled between draws
+    uint32_t    textureCount;       // distinct textures, cycled between draws
+};
+
+struct BenchDraw
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t pso;
+    uint32_t texture;
+    float    coverage;              // fraction of the screen the draw covers
+};
+
+struct BenchScene
+{
+    BenchSceneDesc          desc;
+    MeshData                mesh;       // positions in normalized device coordinates
+    std::vector<BenchDraw>  draws;
+};
+
+// Each draw is a grid of trianglesPerDraw triangles over a square placed at a
+// pseudo-random spot on screen, sized so the draws add up to `overdraw` screens.
+BenchScene buildBenchScene( const BenchSceneDesc& desc );
+
+// Triangle count, draw count, overdraw and state change heavy cases.
+std::vector<BenchSceneDesc> defaultBenchScenes();
+
+#endif /* bench_scene_hpp */
@@ -0,0 +1,182 @@
+//
+//  bench_suite.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "bench_suite.hpp"
+
+#include <cstdio>
+
+std::vector<BenchResult> runBenchSuite( BenchBackend& backend, const std::vector<BenchSceneDesc>& scenes,
+                                        uint32_t frames, uint32_t warmupFrames )
+{
+    std::vector<BenchResult> results;
+    for ( const BenchSceneDesc& desc : scenes )
+    {
+        BenchScene scene = buildBenchScene( desc );
+        backend.load( scene );
+
+        for ( uint32_t i = 0; i < warmupFrames; ++i )
+        {
+            backend.renderFrame();
+        }
+
+        std::vector<double> cpuMs, gpuMs;
+        for ( uint32_t i = 0; i < frames; ++i )
+        {
+            BenchFrameTiming timing = backend.renderFrame();
+            cpuMs.push_back( timing.cpuEncodeMs );
+            gpuMs.push_back( timing.gpuMs );
+        }
+
+        BenchResult& result = results.emplace_back();
+        result.scene = desc.name;
+        result.cpuEncode = summarizeFrameTimes( cpuMs );
+        result.gpu = summarizeFrameTimes( gpuMs );
+        result.memoryBytes = backend.memoryBytes();
+
+        backend.unload();
+    }
+    return results;
+}
+
+bool loadBenchBaseline( const char* path, std::string& backendName, std::vector<BenchResult>& baseline )
+{
+    FILE* pFile = fopen( path, "r" );
+    if ( !pFile )
+    {
+        return false;
+    }
+
+    backendName.clear();
+    char line[ 256 ];
+    for ( bool first = true; fgets( line, sizeof( line ), pFile ); first = false )
+    {
+        char scene[ 128 ];
+        if ( first && sscanf( line, "# %127s backend:", scene ) == 1 )
+        {
+            backendName = scene;
+            continue;
+        }
+
+        double cpuMs = 0.0, gpuMs = 0.0;
+        unsigned long long memory = 0;
+        if ( line[ 0 ] == '#' || sscanf( line, "%127s %lf %lf %llu", scene, &cpuMs, &gpuMs, &memory ) != 4 )
+        {
+            continue;
+        }
+
+        BenchResult& result = baseline.emplace_back();
+        result.scene = scene;
+        result.cpuEncode.p50Ms = cpuMs;
+        result.gpu.p50Ms = gpuMs;
+        result.memoryBytes = size_t( memory );
+    }
+    fclose( pFile );
+    return true;
+}
+
+bool saveBenchBaseline( const char* path, const char* backendName, const std::vector<BenchResult>& results )
+{
+    FILE* pFile = fopen( path, "w" );
+    if ( !pFile )
+    {
+        __builtin_printf( "Bench: could not write %s\n", path );
+        return false;
+    }
+
+    fprintf( pFile, "# %s backend: scene cpu_p50_ms gpu_p50_ms memory_bytes\n", backendName );
+    for ( const BenchResult& result : results )
+    {
+        fprintf( pFile, "%s %.4f %.4f %llu\n", result.scene.c_str(), result.cpuEncode.p50Ms, result.gpu.p50Ms,
+                 (unsigned long long)result.memoryBytes );
+    }
+    fclose( pFile );
+    return true;
+}
+
+std::vector<BenchRegression> compareToBaseline( const std::vector<BenchResult>& results,
+                                                const std::vector<BenchResult>& baseline,
+                                                const BenchThresholds& thresholds )
+{
+    std::vector<BenchRegression> regressions;
+    auto check = [&]( const std::string& scene, const char* metric, double before, double after, double allowed, double floor )
+    {
+        if ( after > before * ( 1.0 + allowed ) && after - before > floor )
+        {
+            regressions.push_back( { scene, metric, before, after } );
+        }
+    };
+
+    for ( const BenchResult& result : results )
+    {
+        for ( const BenchResult& reference : baseline )
+        {
+            if ( reference.scene != result.scene )
+            {
+                continue;
+            }
+            check( result.scene, "cpu_p50_ms", reference.cpuEncode.p50Ms, result.cpuEncode.p50Ms, thresholds.cpu, thresholds.noiseFloorMs );
+            check( result.scene, "gpu_p50_ms", reference.gpu.p50Ms, result.gpu.p50Ms, thresholds.gpu, thresholds.noiseFloorMs );
+            check( result.scene, "memory_bytes", double( reference.memoryBytes ), double( result.memoryBytes ), thresholds.memory, 0.0 );
+        }
+    }
+    return regressions;
+}
+
+void printBenchResults( const char* backendName, const std::vector<BenchResult>& results )
+{
+    __builtin_printf( "%-16s %12s %12s %12s %12s %10s   (%s)\n", "scene", "cpu p50 ms", "cpu p99 ms",
+                      "gpu p50 ms", "gpu p99 ms", "memory MB", backendName );
+    for ( const BenchResult& result : results )
+    {
+        __builtin_printf( "%-16s %12.3f %12.3f %12.3f %12.3f %10.2f\n", result.scene.c_str(),
+                          result.cpuEncode.p50Ms, result.cpuEncode.p99Ms, result.gpu.p50Ms, result.gpu.p99Ms,
+                          double( result.memoryBytes ) / ( 1024.0 * 1024.0 ) );
+    }
+}
+
+int reportAgainstBaseline( const char* backendName, const char* baselinePath, bool updateBaseline,
+                           const std::vector<BenchResult>& results )
+{
+    if ( !baselinePath )
+    {
+        return 0;
+    }
+    if ( updateBaseline )
+    {
+        return saveBenchBaseline( baselinePath, backendName, results ) ? 0 : 1;
+    }
+
+    std::string baselineBackend;
+    std::vector<BenchResult> baseline;
+    if ( !loadBenchBaseline( baselinePath, baselineBackend, baseline ) )
+    {
+        __builtin_printf( "Bench: no baseline at %s, run with TEST_BENCH_UPDATE=1 to create it\n", baselinePath );
+        return 1;
+    }
+
+    // Timings from different backends say nothing about each other.
+    if ( baselineBackend.empty() )
+    {
+        __builtin_printf( "Bench: %s does not say which backend recorded it, comparing anyway\n", baselinePath );
+    }
+    else if ( baselineBackend != backendName )
+    {
+        __builtin_printf( "Bench: %s was recorded on the %s backend, not %s; run with TEST_BENCH_UPDATE=1 to replace it\n",
+                          baselinePath, baselineBackend.c_str(), backendName );
+        return 1;
+    }
+
+    std::vector<BenchRegression> regressions = compareToBaseline( results, baseline, BenchThresholds() );
+    for ( const BenchRegression& regression : regressions )
+    {
+        __builtin_printf( "REGRESSION %s %s: %.4f -> %.4f (%+.1f%%)\n", regression.scene.c_str(), regression.metric,
+                          regression.baseline, regression.current,
+                          regression.baseline > 0.0 ? ( regression.current / regression.baseline - 1.0 ) * 100.0 : 100.0 );
+    }
+    __builtin_printf( "Bench: %zu regressions against %s\n", regressions.size(), baselinePath );
+    return regressions.empty() ? 0 : 1;
+}
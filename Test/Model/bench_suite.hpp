@@ -0,0 +1,85 @@
+//
+//  bench_suite.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef bench_suite_hpp
+#define bench_suite_hpp
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Model/bench_scene.hpp"
+#include "Model/frame_stats.hpp"
+
+struct BenchFrameTiming
+{
+    double cpuEncodeMs;
+    double gpuMs;
+};
+
+// What the suite renders scenes with: the Metal renderer, or the mock backend
+// that runs anywhere.
+class BenchBackend
+{
+public:
+    virtual ~BenchBackend() { }
+
+    virtual const char* name() const = 0;
+    virtual void load( const BenchScene& scene ) = 0;
+    virtual BenchFrameTiming renderFrame() = 0;
+    virtual size_t memoryBytes() const = 0;     // resources held for the loaded scene
+    virtual void unload() = 0;
+};
+
+struct BenchResult
+{
+    std::string     scene;
+    FrameTimeStats  cpuEncode;
+    FrameTimeStats  gpu;
+    size_t          memoryBytes = 0;
+};
+
+std::vector<BenchResult> runBenchSuite( BenchBackend& backend, const std::vector<BenchSceneDesc>& scenes,
+                                        uint32_t frames, uint32_t warmupFrames );
+
+// Allowed growth over the baseline, as fractions. Time differences under the
+// noise floor never count as regressions.
+struct BenchThresholds
+{
+    double cpu          = 0.15;
+    double gpu          = 0.10;
+    double memory       = 0.05;
+    double noiseFloorMs = 0.05;
+};
+
+struct BenchRegression
+{
+    std::string scene;
+    const char* metric;
+    double      baseline;
+    double      current;
+};
+
+// Baselines are text files with one "scene cpu_p50_ms gpu_p50_ms memory_bytes"
+// line per scene; lines starting with # are comments. The first line names the
+// backend that recorded them, returned in backendName (empty if it does not).
+bool loadBenchBaseline( const char* path, std::string& backendName, std::vector<BenchResult>& baseline );
+bool saveBenchBaseline( const char* path, const char* backendName, const std::vector<BenchResult>& results );
+
+// Scenes missing from the baseline are skipped.
+std::vector<BenchRegression> compareToBaseline( const std::vector<BenchResult>& results,
+                                                const std::vector<BenchResult>& baseline,
+                                                const BenchThresholds& thresholds );
+
+void printBenchResults( const char* backendName, const std::vector<BenchResult>& results );
+
+// With updateBaseline, writes results to baselinePath. Otherwise compares them
+// against it and prints each regression. Returns 1 on any regression, or when
+// the baseline is missing or was recorded on another backend; 0 without a path.
+int reportAgainstBaseline( const char* backendName, const char* baselinePath, bool updateBaseline,
+                           const std::vector<BenchResult>& results );
+
+#endif /* bench_suite_hpp */
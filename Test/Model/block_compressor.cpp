@@ -0,0 +1,1180 @@
+//
+//  block_compressor.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "block_compressor.hpp"
+#include "Core/job_system.hpp"
+#include "Model/simd_math.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+using namespace math;
+
+namespace
+{
+
+struct Block
+{
+    float4          lanes[ 4 ][ 4 ];    // [channel][quad]: the 16 pixels in structure-of-arrays form
+    float           px[ 16 ][ 4 ];      // the same pixels, one RGBA tuple each
+    float           weight[ 16 ];       // 0 leaves a pixel out of the fit, as BC1 does for transparent ones
+};
+
+struct Settings
+{
+    bool usePrincipalAxis;
+    bool alsoTryBoundingBox;    // the principal axis is not always the better start
+    int  refineIterations;
+
+    int seedCount() const { return usePrincipalAxis && alsoTryBoundingBox ? 2 : 1; }
+    bool principalAxisSeed( int seed ) const { return usePrincipalAxis && seed == 0; }
+};
+
+Settings settingsFor( CompressionPreset preset )
+{
+    switch ( preset )
+    {
+        case CompressionPreset::Fast:     return { false, false, 0 };
+        case CompressionPreset::Balanced: return { true, false, 1 };
+        case CompressionPreset::Quality:  return { true, true, 4 };
+    }
+    return { true, false, 1 };
+}
+
+void loadBlock( const uint8_t* pRgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& b )
+{
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        uint32_t x = std::min( bx * 4 + ( i & 3 ), width - 1 );
+        uint32_t y = std::min( by * 4 + ( i >> 2 ), height - 1 );
+        const uint8_t* p = pRgba + ( size_t( y ) * width + x ) * 4;
+        b.weight[ i ] = 1.0f;
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            b.px[ i ][ ch ] = float( p[ ch ] );
+            b.lanes[ ch ][ i >> 2 ][ i & 3 ] = float( p[ ch ] );
+        }
+    }
+}
+
+// Nearest palette entry for every pixel, four pixels per step. Returns the summed
+// weighted squared error over the pixels in the fit.
+float selectIndices( const Block& b, const float palette[][ 4 ], int count, const float weights[ 4 ], uint8_t indices[ 16 ] )
+{
+    float total = 0.0f;
+    for ( int q = 0; q < 4; ++q )
+    {
+        // Palette indices are small integers, exact as floats.
+        detail::Vec4 best = detail::splat( FLT_MAX );
+        detail::Vec4 bestIndex = detail::splat( 0.0f );
+
+        for ( int k = 0; k < count; ++k )
+        {
+            detail::Vec4 d = detail::splat( 0.0f );
+            for ( int ch = 0; ch < 4; ++ch )
+            {
+                detail::Vec4 diff = detail::sub( detail::load( b.lanes[ ch ][ q ] ), detail::splat( palette[ k ][ ch ] ) );
+                d = detail::add( d, detail::mul( detail::mul( detail::splat( weights[ ch ] ), diff ), diff ) );
+            }
+            detail::Mask4 closer = detail::less( d, best );
+            best = detail::select( closer, d, best );
+            bestIndex = detail::select( closer, detail::splat( float( k ) ), bestIndex );
+        }
+
+        float4 errors = detail::toFloat4( best ), chosen = detail::toFloat4( bestIndex );
+        for ( int i = 0; i < 4; ++i )
+        {
+            indices[ q * 4 + i ] = uint8_t( chosen[ i ] );
+            total += errors[ i ] * b.weight[ q * 4 + i ];
+        }
+    }
+    return total;
+}
+
+// Initial line through the block colors: the bounding box diagonal, or the
+// principal axis of the covariance found by power iteration. Channels with a
+// zero weight are pinned to their mean. Needs at least one pixel in the fit.
+void fitEndpoints( const Block& b, const float weights[ 4 ], bool principalAxis, float e0[ 4 ], float e1[ 4 ] )
+{
+    float mean[ 4 ] = { 0, 0, 0, 0 }, lo[ 4 ], hi[ 4 ];
+    float count = 0.0f;
+    for ( int i = 0; i < 16; ++i )
+    {
+        count += b.weight[ i ];
+    }
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        lo[ ch ] = 255.0f;
+        hi[ ch ] = 0.0f;
+        for ( int i = 0; i < 16; ++i )
+        {
+            if ( b.weight[ i ] > 0.0f )
+            {
+                mean[ ch ] += b.weight[ i ] * b.px[ i ][ ch ];
+                lo[ ch ] = std::min( lo[ ch ], b.px[ i ][ ch ] );
+                hi[ ch ] = std::max( hi[ ch ], b.px[ i ][ ch ] );
+            }
+        }
+        mean[ ch ] /= count;
+    }
+
+    if ( !principalAxis )
+    {
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            float inset = ( hi[ ch ] - lo[ ch ] ) / 16.0f;
+            e0[ ch ] = weights[ ch ] > 0.0f ? lo[ ch ] + inset : mean[ ch ];
+            e1[ ch ] = weights[ ch ] > 0.0f ? hi[ ch ] - inset : mean[ ch ];
+        }
+        return;
+    }
+
+    float cov[ 4 ][ 4 ] = {};
+    for ( int i = 0; i < 16; ++i )
+    {
+        float d[ 4 ];
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            d[ ch ] = ( b.px[ i ][ ch ] - mean[ ch ] ) * ( weights[ ch ] > 0.0f ? 1.0f : 0.0f );
+        }
+        for ( int r = 0; r < 4; ++r )
+        {
+            for ( int c = 0; c < 4; ++c )
+            {
+                cov[ r ][ c ] += b.weight[ i ] * d[ r ] * d[ c ];
+            }
+        }
+    }
+
+    float axis[ 4 ];
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        axis[ ch ] = weights[ ch ] > 0.0f ? hi[ ch ] - lo[ ch ] : 0.0f;
+    }
+    for ( int iter = 0; iter < 8; ++iter )
+    {
+        float next[ 4 ] = {};
+        for ( int r = 0; r < 4; ++r )
+        {
+            for ( int c = 0; c < 4; ++c )
+            {
+                next[ r ] += cov[ r ][ c ] * axis[ c ];
+            }
+        }
+        float len = std::sqrt( next[ 0 ] * next[ 0 ] + next[ 1 ] * next[ 1 ] + next[ 2 ] * next[ 2 ] + next[ 3 ] * next[ 3 ] );
+        if ( len < 1e-6f )
+        {
+            break;
+        }
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            axis[ ch ] = next[ ch ] / len;
+        }
+    }
+
+    float len = std::sqrt( axis[ 0 ] * axis[ 0 ] + axis[ 1 ] * axis[ 1 ] + axis[ 2 ] * axis[ 2 ] + axis[ 3 ] * axis[ 3 ] );
+    if ( len < 1e-6f )
+    {
+        std::copy( mean, mean + 4, e0 );
+        std::copy( mean, mean + 4, e1 );
+        return;
+    }
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        axis[ ch ] /= len;
+    }
+
+    float tMin = FLT_MAX, tMax = -FLT_MAX;
+    for ( int i = 0; i < 16; ++i )
+    {
+        if ( b.weight[ i ] == 0.0f )
+        {
+            continue;
+        }
+        float t = 0.0f;
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            t += ( b.px[ i ][ ch ] - mean[ ch ] ) * axis[ ch ];
+        }
+        tMin = std::min( tMin, t );
+        tMax = std::max( tMax, t );
+    }
+
+    float inset = ( tMax - tMin ) / 32.0f;
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        e0[ ch ] = std::clamp( mean[ ch ] + axis[ ch ] * ( tMin + inset ), 0.0f, 255.0f );
+        e1[ ch ] = std::clamp( mean[ ch ] + axis[ ch ] * ( tMax - inset ), 0.0f, 255.0f );
+    }
+}
+
+// Least-squares endpoints for fixed indices, where ramp[k] is the interpolation
+// factor of palette entry k between e0 (0) and e1 (1).
+bool refineEndpoints( const Block& b, const uint8_t indices[ 16 ], const float* ramp, float e0[ 4 ], float e1[ 4 ] )
+{
+    float aa = 0, ab = 0, bb = 0;
+    float ax[ 4 ] = {}, bx[ 4 ] = {};
+    for ( int i = 0; i < 16; ++i )
+    {
+        float w = b.weight[ i ];
+        float t = ramp[ indices[ i ] ];
+        float s = 1.0f - t;
+        aa += w * s * s;
+        ab += w * s * t;
+        bb += w * t * t;
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            ax[ ch ] += w * s * b.px[ i ][ ch ];
+            bx[ ch ] += w * t * b.px[ i ][ ch ];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if ( std::fabs( det ) < 1e-6f )
+    {
+        return false;
+    }
+
+    float inv = 1.0f / det;
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        e0[ ch ] = std::clamp( ( ax[ ch ] * bb - bx[ ch ] * ab ) * inv, 0.0f, 255.0f );
+        e1[ ch ] = std::clamp( ( bx[ ch ] * aa - ax[ ch ] * ab ) * inv, 0.0f, 255.0f );
+    }
+    return true;
+}
+
+// LSB-first bit packing, as every format here stores its fields.
+struct BitWriter
+{
+    uint8_t* data;
+    int      pos = 0;
+
+    void write( uint32_t value, int bits )
+    {
+        for ( int i = 0; i < bits; ++i, ++pos )
+        {
+            if ( value & ( 1u << i ) )
+            {
+                data[ pos >> 3 ] |= uint8_t( 1u << ( pos & 7 ) );
+            }
+        }
+    }
+};
+
+struct BitReader
+{
+    const uint8_t* data;
+    int            pos = 0;
+
+    uint32_t read( int bits )
+    {
+        uint32_t value = 0;
+        for ( int i = 0; i < bits; ++i, ++pos )
+        {
+            value |= uint32_t( ( data[ pos >> 3 ] >> ( pos & 7 ) ) & 1 ) << i;
+        }
+        return value;
+    }
+};
+
+//
+// BC1
+//
+
+uint16_t to565( const float c[ 4 ] )
+{
+    uint32_t r = uint32_t( std::lround( c[ 0 ] * 31.0f / 255.0f ) );
+    uint32_t g = uint32_t( std::lround( c[ 1 ] * 63.0f / 255.0f ) );
+    uint32_t b = uint32_t( std::lround( c[ 2 ] * 31.0f / 255.0f ) );
+    return uint16_t( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+void from565( uint16_t v, int c[ 3 ] )
+{
+    int r = ( v >> 11 ) & 31, g = ( v >> 5 ) & 63, b = v & 31;
+    c[ 0 ] = ( r << 3 ) | ( r >> 2 );
+    c[ 1 ] = ( g << 2 ) | ( g >> 4 );
+    c[ 2 ] = ( b << 3 ) | ( b >> 2 );
+}
+
+void bc1Palette( uint16_t c0, uint16_t c1, int palette[ 4 ][ 4 ] )
+{
+    int a[ 3 ], b[ 3 ];
+    from565( c0, a );
+    from565( c1, b );
+    for ( int ch = 0; ch < 3; ++ch )
+    {
+        palette[ 0 ][ ch ] = a[ ch ];
+        palette[ 1 ][ ch ] = b[ ch ];
+        if ( c0 > c1 )
+        {
+            palette[ 2 ][ ch ] = ( 2 * a[ ch ] + b[ ch ] ) / 3;
+            palette[ 3 ][ ch ] = ( a[ ch ] + 2 * b[ ch ] ) / 3;
+        }
+        else
+        {
+            palette[ 2 ][ ch ] = ( a[ ch ] + b[ ch ] ) / 2;
+            palette[ 3 ][ ch ] = 0;
+        }
+    }
+    palette[ 0 ][ 3 ] = palette[ 1 ][ 3 ] = palette[ 2 ][ 3 ] = 255;
+    palette[ 3 ][ 3 ] = c0 > c1 ? 255 : 0;
+}
+
+void writeBC1( uint16_t c0, uint16_t c1, const uint8_t indices[ 16 ], uint8_t* out )
+{
+    uint32_t bits = 0;
+    for ( int i = 0; i < 16; ++i )
+    {
+        bits |= uint32_t( indices[ i ] ) << ( 2 * i );
+    }
+    out[ 0 ] = uint8_t( c0 );
+    out[ 1 ] = uint8_t( c0 >> 8 );
+    out[ 2 ] = uint8_t( c1 );
+    out[ 3 ] = uint8_t( c1 >> 8 );
+    memcpy( out + 4, &bits, 4 );
+}
+
+// Color part of BC1/BC3. With allowPunchThrough, blocks containing alpha < 128
+// use the three-color mode whose fourth entry is transparent black, and the
+// endpoints are fitted to the opaque pixels only.
+void encodeBC1Color( const Block& block, const Settings& s, bool allowPunchThrough, uint8_t* out )
+{
+    static const float kWeights[ 4 ] = { 1, 1, 1, 0 };
+
+    bool punchThrough = false;
+    Block opaque;
+    if ( allowPunchThrough )
+    {
+        int opaqueCount = 0;
+        for ( int i = 0; i < 16; ++i )
+        {
+            punchThrough |= block.px[ i ][ 3 ] < 128.0f;
+            opaqueCount += block.px[ i ][ 3 ] >= 128.0f;
+        }
+        if ( opaqueCount == 0 )
+        {
+            static const uint8_t kTransparent[ 16 ] = { 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3 };
+            writeBC1( 0, 0, kTransparent, out );
+            return;
+        }
+        if ( punchThrough )
+        {
+            opaque = block;
+            for ( int i = 0; i < 16; ++i )
+            {
+                opaque.weight[ i ] = block.px[ i ][ 3 ] < 128.0f ? 0.0f : 1.0f;
+            }
+        }
+    }
+    const Block& b = punchThrough ? opaque : block;
+
+    // Palette entries in ramp order, and where each one lives in the BC1 index space.
+    static const float kRamp4[ 4 ] = { 0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f };
+    static const uint8_t kSlot4[ 4 ] = { 0, 2, 3, 1 };
+    static const float kRamp3[ 3 ] = { 0.0f, 0.5f, 1.0f };
+    static const uint8_t kSlot3[ 3 ] = { 0, 2, 1 };
+
+    const float* ramp = punchThrough ? kRamp3 : kRamp4;
+    const uint8_t* slot = punchThrough ? kSlot3 : kSlot4;
+    const int rampSize = punchThrough ? 3 : 4;
+
+    float bestError = FLT_MAX;
+    for ( int seed = 0; seed < s.seedCount(); ++seed )
+    {
+        float e0[ 4 ], e1[ 4 ];
+        fitEndpoints( b, kWeights, s.principalAxisSeed( seed ), e0, e1 );
+
+        for ( int iter = 0; iter <= s.refineIterations; ++iter )
+        {
+            uint16_t c0 = to565( e0 ), c1 = to565( e1 );
+            // Four-color mode needs c0 > c1, three-color mode c0 <= c1.
+            if ( punchThrough ? c0 > c1 : c0 < c1 )
+            {
+                std::swap( c0, c1 );
+            }
+
+            int decoded[ 4 ][ 4 ];
+            bc1Palette( c0, c1, decoded );
+
+            float palette[ 4 ][ 4 ];
+            for ( int k = 0; k < rampSize; ++k )
+            {
+                for ( int ch = 0; ch < 4; ++ch )
+                {
+                    palette[ k ][ ch ] = float( decoded[ slot[ k ] ][ ch ] );
+                }
+            }
+
+            uint8_t rampIndices[ 16 ];
+            float error = selectIndices( b, palette, c0 == c1 && !punchThrough ? 1 : rampSize, kWeights, rampIndices );
+
+            uint8_t indices[ 16 ];
+            for ( int i = 0; i < 16; ++i )
+            {
+                bool transparent = punchThrough && b.px[ i ][ 3 ] < 128.0f;
+                indices[ i ] = transparent ? 3 : slot[ rampIndices[ i ] ];
+            }
+
+            if ( error < bestError )
+            {
+                bestError = error;
+                writeBC1( c0, c1, indices, out );
+            }
+
+            // Endpoint order may have been swapped by the mode rule; refine in that order.
+            int a[ 3 ], z[ 3 ];
+            from565( c0, a );
+            from565( c1, z );
+            for ( int ch = 0; ch < 3; ++ch )
+            {
+                e0[ ch ] = float( a[ ch ] );
+                e1[ ch ] = float( z[ ch ] );
+            }
+            if ( iter == s.refineIterations || !refineEndpoints( b, rampIndices, ramp, e0, e1 ) )
+            {
+                break;
+            }
+        }
+    }
+}
+
+void decodeBC1( const uint8_t* in, bool forceFourColor, uint8_t out[ 16 ][ 4 ] )
+{
+    uint16_t c0 = uint16_t( in[ 0 ] | ( in[ 1 ] << 8 ) );
+    uint16_t c1 = uint16_t( in[ 2 ] | ( in[ 3 ] << 8 ) );
+    uint32_t bits;
+    memcpy( &bits, in + 4, 4 );
+
+    int palette[ 4 ][ 4 ];
+    if ( forceFourColor && c0 <= c1 )
+    {
+        // BC2/BC3 color blocks always interpolate, whatever the endpoint order.
+        int a[ 3 ], b[ 3 ];
+        from565( c0, a );
+        from565( c1, b );
+        for ( int ch = 0; ch < 3; ++ch )
+        {
+            palette[ 0 ][ ch ] = a[ ch ];
+            palette[ 1 ][ ch ] = b[ ch ];
+            palette[ 2 ][ ch ] = ( 2 * a[ ch ] + b[ ch ] ) / 3;
+            palette[ 3 ][ ch ] = ( a[ ch ] + 2 * b[ ch ] ) / 3;
+        }
+        for ( int k = 0; k < 4; ++k )
+        {
+            palette[ k ][ 3 ] = 255;
+        }
+    }
+    else
+    {
+        bc1Palette( c0, c1, palette );
+    }
+
+    for ( int i = 0; i < 16; ++i )
+    {
+        int index = ( bits >> ( 2 * i ) ) & 3;
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            out[ i ][ ch ] = uint8_t( palette[ index ][ ch ] );
+        }
+    }
+}
+
+//
+// BC4 (also the alpha of BC3 and both channels of BC5)
+//
+
+void bc4Palette( int r0, int r1, int palette[ 8 ] )
+{
+    palette[ 0 ] = r0;
+    palette[ 1 ] = r1;
+    if ( r0 > r1 )
+    {
+        for ( int k = 1; k < 7; ++k )
+        {
+            palette[ k + 1 ] = ( ( 7 - k ) * r0 + k * r1 ) / 7;
+        }
+    }
+    else
+    {
+        for ( int k = 1; k < 5; ++k )
+        {
+            palette[ k + 1 ] = ( ( 5 - k ) * r0 + k * r1 ) / 5;
+        }
+        palette[ 6 ] = 0;
+        palette[ 7 ] = 255;
+    }
+}
+
+void encodeBC4Channel( const Block& b, int channel, const Settings& s, uint8_t* out )
+{
+    float weights[ 4 ] = { 0, 0, 0, 0 };
+    weights[ channel ] = 1.0f;
+
+    static const float kRamp[ 8 ] = { 0, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f, 1 };
+    static const uint8_t kSlot[ 8 ] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+    // Ramp runs from r0 (the larger value) down to r1.
+    float lo = 255.0f, hi = 0.0f;
+    for ( int i = 0; i < 16; ++i )
+    {
+        lo = std::min( lo, b.px[ i ][ channel ] );
+        hi = std::max( hi, b.px[ i ][ channel ] );
+    }
+    float e0[ 4 ] = {}, e1[ 4 ] = {};
+    e0[ channel ] = hi;
+    e1[ channel ] = lo;
+
+    float bestError = FLT_MAX;
+    for ( int iter = 0; iter <= s.refineIterations; ++iter )
+    {
+        int r0 = int( std::lround( e0[ channel ] ) ), r1 = int( std::lround( e1[ channel ] ) );
+        if ( r0 < r1 )
+        {
+            std::swap( r0, r1 );
+        }
+
+        uint8_t indices[ 16 ] = {};
+        uint8_t rampIndices[ 16 ] = {};
+        float error;
+        if ( r0 == r1 )
+        {
+            float palette[ 1 ][ 4 ] = {};
+            palette[ 0 ][ channel ] = float( r0 );
+            error = selectIndices( b, palette, 1, weights, rampIndices );
+        }
+        else
+        {
+            int decoded[ 8 ];
+            bc4Palette( r0, r1, decoded );
+            float palette[ 8 ][ 4 ] = {};
+            for ( int k = 0; k < 8; ++k )
+            {
+                palette[ k ][ channel ] = float( decoded[ kSlot[ k ] ] );
+            }
+            error = selectIndices( b, palette, 8, weights, rampIndices );
+            for ( int i = 0; i < 16; ++i )
+            {
+                indices[ i ] = kSlot[ rampIndices[ i ] ];
+            }
+        }
+
+        if ( error < bestError )
+        {
+            bestError = error;
+            memset( out, 0, 8 );
+            out[ 0 ] = uint8_t( r0 );
+            out[ 1 ] = uint8_t( r1 );
+            BitWriter w { out + 2 };
+            for ( int i = 0; i < 16; ++i )
+            {
+                w.write( indices[ i ], 3 );
+            }
+        }
+
+        e0[ channel ] = float( r0 );
+        e1[ channel ] = float( r1 );
+        if ( r0 == r1 || iter == s.refineIterations || !refineEndpoints( b, rampIndices, kRamp, e0, e1 ) )
+        {
+            break;
+        }
+    }
+}
+
+void decodeBC4Channel( const uint8_t* in, int channel, uint8_t out[ 16 ][ 4 ] )
+{
+    int palette[ 8 ];
+    bc4Palette( in[ 0 ], in[ 1 ], palette );
+    BitReader r { in + 2 };
+    for ( int i = 0; i < 16; ++i )
+    {
+        out[ i ][ channel ] = uint8_t( palette[ r.read( 3 ) ] );
+    }
+}
+
+//
+// BC7, mode 6 only: one subset, 7-bit RGBA endpoints with a p-bit each, 4-bit indices.
+//
+
+const int kBC7Weights4[ 16 ] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+void encodeBC7( const Block& b, const Settings& s, uint8_t* out )
+{
+    static const float kWeights[ 4 ] = { 1, 1, 1, 1 };
+    float ramp[ 16 ];
+    for ( int k = 0; k < 16; ++k )
+    {
+        ramp[ k ] = kBC7Weights4[ k ] / 64.0f;
+    }
+
+    float bestError = FLT_MAX;
+    int bestQ[ 2 ][ 4 ] = {}, bestP[ 2 ] = {};
+    uint8_t bestIndices[ 16 ] = {};
+
+    for ( int seed = 0; seed < s.seedCount(); ++seed )
+    {
+        float e0[ 4 ], e1[ 4 ];
+        fitEndpoints( b, kWeights, s.principalAxisSeed( seed ), e0, e1 );
+
+        for ( int iter = 0; iter <= s.refineIterations; ++iter )
+        {
+            uint8_t iterIndices[ 16 ];
+            float iterError = FLT_MAX;
+
+            // Every p-bit combination; each shifts the reachable 8-bit grid by one.
+            for ( int p = 0; p < 4; ++p )
+            {
+                int p0 = p & 1, p1 = p >> 1;
+                int q0[ 4 ], q1[ 4 ], d0[ 4 ], d1[ 4 ];
+                for ( int ch = 0; ch < 4; ++ch )
+                {
+                    q0[ ch ] = std::clamp( int( std::lround( ( e0[ ch ] - p0 ) / 2.0f ) ), 0, 127 );
+                    q1[ ch ] = std::clamp( int( std::lround( ( e1[ ch ] - p1 ) / 2.0f ) ), 0, 127 );
+                    d0[ ch ] = ( q0[ ch ] << 1 ) | p0;
+                    d1[ ch ] = ( q1[ ch ] << 1 ) | p1;
+                }
+
+                float palette[ 16 ][ 4 ];
+                for ( int k = 0; k < 16; ++k )
+                {
+                    for ( int ch = 0; ch < 4; ++ch )
+                    {
+                        palette[ k ][ ch ] = float( ( ( 64 - kBC7Weights4[ k ] ) * d0[ ch ] + kBC7Weights4[ k ] * d1[ ch ] + 32 ) >> 6 );
+                    }
+                }
+
+                uint8_t indices[ 16 ];
+                float error = selectIndices( b, palette, 16, kWeights, indices );
+                if ( error < iterError )
+                {
+                    iterError = error;
+                    memcpy( iterIndices, indices, 16 );
+                }
+                if ( error < bestError )
+                {
+                    bestError = error;
+                    memcpy( bestQ[ 0 ], q0, sizeof( q0 ) );
+                    memcpy( bestQ[ 1 ], q1, sizeof( q1 ) );
+                    bestP[ 0 ] = p0;
+                    bestP[ 1 ] = p1;
+                    memcpy( bestIndices, indices, 16 );
+                }
+            }
+
+            if ( iter == s.refineIterations || !refineEndpoints( b, iterIndices, ramp, e0, e1 ) )
+            {
+                break;
+            }
+        }
+    }
+
+    // The anchor (pixel 0) index is stored without its top bit, so it must be < 8.
+    if ( bestIndices[ 0 ] >= 8 )
+    {
+        std::swap( bestQ[ 0 ], bestQ[ 1 ] );
+        std::swap( bestP[ 0 ], bestP[ 1 ] );
+        for ( uint8_t& index : bestIndices )
+        {
+            index = uint8_t( 15 - index );
+        }
+    }
+
+    memset( out, 0, 16 );
+    BitWriter w { out };
+    w.write( 1u << 6, 7 );
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        w.write( uint32_t( bestQ[ 0 ][ ch ] ), 7 );
+        w.write( uint32_t( bestQ[ 1 ][ ch ] ), 7 );
+    }
+    w.write( uint32_t( bestP[ 0 ] ), 1 );
+    w.write( uint32_t( bestP[ 1 ] ), 1 );
+    for ( int i = 0; i < 16; ++i )
+    {
+        w.write( bestIndices[ i ], i == 0 ? 3 : 4 );
+    }
+}
+
+void decodeBC7( const uint8_t* in, uint8_t out[ 16 ][ 4 ] )
+{
+    BitReader r { in };
+    if ( r.read( 7 ) != ( 1u << 6 ) )
+    {
+        memset( out, 0, 64 );
+        return;
+    }
+
+    int d[ 2 ][ 4 ];
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        d[ 0 ][ ch ] = int( r.read( 7 ) ) << 1;
+        d[ 1 ][ ch ] = int( r.read( 7 ) ) << 1;
+    }
+    int p0 = int( r.read( 1 ) ), p1 = int( r.read( 1 ) );
+    for ( int ch = 0; ch < 4; ++ch )
+    {
+        d[ 0 ][ ch ] |= p0;
+        d[ 1 ][ ch ] |= p1;
+    }
+
+    for ( int i = 0; i < 16; ++i )
+    {
+        int w = kBC7Weights4[ r.read( i == 0 ? 3 : 4 ) ];
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            out[ i ][ ch ] = uint8_t( ( ( 64 - w ) * d[ 0 ][ ch ] + w * d[ 1 ][ ch ] + 32 ) >> 6 );
+        }
+    }
+}
+
+//
+// ASTC 4x4, LDR. Single partition with 8-bit direct endpoints: opaque blocks use
+// CEM 8 (RGB) with 3-bit weights, blocks with alpha use CEM 12 (RGBA) with 2-bit
+// weights, so that every field is a plain bit field (no trit/quint packing).
+//
+
+const int kAstcWeights3[ 8 ] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+const int kAstcWeights2[ 4 ] = { 0, 21, 43, 64 };
+
+// Block mode for a 4x4 weight grid, single plane, low precision range:
+// A = 2, B = 0, layout bits [3:2] = 0, R = 7 (range 0..7) or R = 4 (range 0..3).
+constexpr uint32_t kAstcModeWeights3 = 0x053;
+constexpr uint32_t kAstcModeWeights2 = 0x042;
+constexpr uint32_t kAstcCemRgb  = 8;
+constexpr uint32_t kAstcCemRgba = 12;
+
+int astcInterpolate( int e0, int e1, int w )
+{
+    int c0 = ( e0 << 8 ) | e0, c1 = ( e1 << 8 ) | e1;
+    return ( ( c0 * ( 64 - w ) + c1 * w + 32 ) >> 6 ) >> 8;
+}
+
+void encodeASTC( const Block& b, const Settings& s, uint8_t* out )
+{
+    bool hasAlpha = false;
+    for ( int i = 0; i < 16; ++i )
+    {
+        hasAlpha |= b.px[ i ][ 3 ] < 255.0f;
+    }
+
+    const float weights[ 4 ] = { 1, 1, 1, hasAlpha ? 1.0f : 0.0f };
+    const int* levels = hasAlpha ? kAstcWeights2 : kAstcWeights3;
+    const int levelCount = hasAlpha ? 4 : 8;
+    const int weightBits = hasAlpha ? 2 : 3;
+    const int channels = hasAlpha ? 4 : 3;
+
+    float ramp[ 8 ];
+    for ( int k = 0; k < levelCount; ++k )
+    {
+        ramp[ k ] = levels[ k ] / 64.0f;
+    }
+
+    float bestError = FLT_MAX;
+    int bestQ[ 2 ][ 4 ] = {};
+    uint8_t bestIndices[ 16 ] = {};
+
+    for ( int seed = 0; seed < s.seedCount(); ++seed )
+    {
+        float e0[ 4 ], e1[ 4 ];
+        fitEndpoints( b, weights, s.principalAxisSeed( seed ), e0, e1 );
+
+        for ( int iter = 0; iter <= s.refineIterations; ++iter )
+        {
+            int q0[ 4 ], q1[ 4 ];
+            for ( int ch = 0; ch < 4; ++ch )
+            {
+                q0[ ch ] = ch < channels ? std::clamp( int( std::lround( e0[ ch ] ) ), 0, 255 ) : 255;
+                q1[ ch ] = ch < channels ? std::clamp( int( std::lround( e1[ ch ] ) ), 0, 255 ) : 255;
+            }
+
+            float palette[ 8 ][ 4 ];
+            for ( int k = 0; k < levelCount; ++k )
+            {
+                for ( int ch = 0; ch < 4; ++ch )
+                {
+                    palette[ k ][ ch ] = float( astcInterpolate( q0[ ch ], q1[ ch ], levels[ k ] ) );
+                }
+            }
+
+            uint8_t indices[ 16 ];
+            float error = selectIndices( b, palette, levelCount, weights, indices );
+            if ( error < bestError )
+            {
+                bestError = error;
+                memcpy( bestQ[ 0 ], q0, sizeof( q0 ) );
+                memcpy( bestQ[ 1 ], q1, sizeof( q1 ) );
+                memcpy( bestIndices, indices, 16 );
+            }
+
+            if ( iter == s.refineIterations || !refineEndpoints( b, indices, ramp, e0, e1 ) )
+            {
+                break;
+            }
+        }
+    }
+
+    // The decoder applies blue contraction when the second endpoint has the smaller
+    // RGB sum; keep the order that decodes the endpoints as written.
+    if ( bestQ[ 1 ][ 0 ] + bestQ[ 1 ][ 1 ] + bestQ[ 1 ][ 2 ] < bestQ[ 0 ][ 0 ] + bestQ[ 0 ][ 1 ] + bestQ[ 0 ][ 2 ] )
+    {
+        std::swap( bestQ[ 0 ], bestQ[ 1 ] );
+        for ( uint8_t& index : bestIndices )
+        {
+            index = uint8_t( levelCount - 1 - index );
+        }
+    }
+
+    memset( out, 0, 16 );
+    BitWriter w { out };
+    w.write( hasAlpha ? kAstcModeWeights2 : kAstcModeWeights3, 11 );
+    w.write( 0, 2 );    // one partition
+    w.write( hasAlpha ? kAstcCemRgba : kAstcCemRgb, 4 );
+    for ( int ch = 0; ch < channels; ++ch )
+    {
+        w.write( uint32_t( bestQ[ 0 ][ ch ] ), 8 );
+        w.write( uint32_t( bestQ[ 1 ][ ch ] ), 8 );
+    }
+
+    // Weights are read from the top of the block downwards, bit-reversed.
+    uint8_t weightBuffer[ 16 ] = {};
+    BitWriter ww { weightBuffer };
+    for ( int i = 0; i < 16; ++i )
+    {
+        ww.write( bestIndices[ i ], weightBits );
+    }
+    for ( int bit = 0; bit < ww.pos; ++bit )
+    {
+        if ( weightBuffer[ bit >> 3 ] & ( 1u << ( bit & 7 ) ) )
+        {
+            int dst = 127 - bit;
+            out[ dst >> 3 ] |= uint8_t( 1u << ( dst & 7 ) );
+        }
+    }
+}
+
+void decodeASTC( const uint8_t* in, uint8_t out[ 16 ][ 4 ] )
+{
+    BitReader r { in };
+    uint32_t mode = r.read( 11 );
+    r.read( 2 );
+    uint32_t cem = r.read( 4 );
+
+    bool hasAlpha = cem == kAstcCemRgba;
+    if ( ( mode != kAstcModeWeights3 && mode != kAstcModeWeights2 ) || ( cem != kAstcCemRgb && !hasAlpha ) )
+    {
+        memset( out, 0, 64 );
+        return;
+    }
+
+    int e[ 2 ][ 4 ] = { { 0, 0, 0, 255 }, { 0, 0, 0, 255 } };
+    for ( int ch = 0; ch < ( hasAlpha ? 4 : 3 ); ++ch )
+    {
+        e[ 0 ][ ch ] = int( r.read( 8 ) );
+        e[ 1 ][ ch ] = int( r.read( 8 ) );
+    }
+
+    const int weightBits = mode == kAstcModeWeights2 ? 2 : 3;
+    const int* levels = weightBits == 2 ? kAstcWeights2 : kAstcWeights3;
+    for ( int i = 0; i < 16; ++i )
+    {
+        int index = 0;
+        for ( int bit = 0; bit < weightBits; ++bit )
+        {
+            int src = 127 - ( i * weightBits + bit );
+            index |= ( ( in[ src >> 3 ] >> ( src & 7 ) ) & 1 ) << bit;
+        }
+        for ( int ch = 0; ch < 4; ++ch )
+        {
+            out[ i ][ ch ] = uint8_t( astcInterpolate( e[ 0 ][ ch ], e[ 1 ][ ch ], levels[ index ] ) );
+        }
+    }
+}
+
+void encodeBlock( BlockFormat format, const Block& b, const Settings& s, uint8_t* out )
+{
+    switch ( format )
+    {
+        case BlockFormat::BC1:
+            encodeBC1Color( b, s, true, out );
+            break;
+        case BlockFormat::BC3:
+            encodeBC4Channel( b, 3, s, out );
+            encodeBC1Color( b, s, false, out + 8 );
+            break;
+        case BlockFormat::BC4:
+            encodeBC4Channel( b, 0, s, out );
+            break;
+        case BlockFormat::BC5:
+            encodeBC4Channel( b, 0, s, out );
+            encodeBC4Channel( b, 1, s, out + 8 );
+            break;
+        case BlockFormat::BC7:
+            encodeBC7( b, s, out );
+            break;
+        case BlockFormat::ASTC4x4:
+            encodeASTC( b, s, out );
+            break;
+    }
+}
+
+void decodeBlock( BlockFormat format, const uint8_t* in, uint8_t out[ 16 ][ 4 ] )
+{
+    switch ( format )
+    {
+        case BlockFormat::BC1:
+            decodeBC1( in, false, out );
+            break;
+        case BlockFormat::BC3:
+            decodeBC1( in + 8, true, out );
+            decodeBC4Channel( in, 3, out );
+            break;
+        case BlockFormat::BC4:
+            memset( out, 0, 64 );
+            decodeBC4Channel( in, 0, out );
+            break;
+        case BlockFormat::BC5:
+            memset( out, 0, 64 );
+            decodeBC4Channel( in, 0, out );
+            decodeBC4Channel( in + 8, 1, out );
+            break;
+        case BlockFormat::BC7:
+            decodeBC7( in, out );
+            break;
+        case BlockFormat::ASTC4x4:
+            decodeASTC( in, out );
+            break;
+    }
+}
+
+int channelsStored( BlockFormat format )
+{
+    switch ( format )
+    {
+        case BlockFormat::BC4: return 1;
+        case BlockFormat::BC5: return 2;
+        default:               return 4;
+    }
+}
+
+}
+
+size_t blockSizeInBytes( BlockFormat format )
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+const char* blockFormatName( BlockFormat format )
+{
+    switch ( format )
+    {
+        case BlockFormat::BC1:     return "bc1";
+        case BlockFormat::BC3:     return "bc3";
+        case BlockFormat::BC4:     return "bc4";
+        case BlockFormat::BC5:     return "bc5";
+        case BlockFormat::BC7:     return "bc7";
+        case BlockFormat::ASTC4x4: return "astc4x4";
+    }
+    return "unknown";
+}
+
+const char* compressionPresetName( CompressionPreset preset )
+{
+    switch ( preset )
+    {
+        case CompressionPreset::Fast:     return "fast";
+        case CompressionPreset::Balanced: return "balanced";
+        case CompressionPreset::Quality:  return "quality";
+    }
+    return "unknown";
+}
+
+CompressedImage compressImage( const uint8_t* pRgba, uint32_t width, uint32_t height,
+                               BlockFormat format, CompressionPreset preset,
+                               JobSystem& jobs, bool measureQuality )
+{
+    CompressedImage image;
+    image.format = format;
+    image.width = width;
+    image.height = height;
+
+    const uint32_t BlocksX = ( width + 3 ) / 4;
+    const uint32_t BlocksY = ( height + 3 ) / 4;
+    const size_t BlockBytes = blockSizeInBytes( format );
+    image.data.resize( size_t( BlocksX ) * BlocksY * BlockBytes );
+
+    const Settings settings = settingsFor( preset );
+
+    auto start = std::chrono::steady_clock::now();
+    jobs.parallelFor( BlocksY, 1, [&]( size_t begin, size_t end )
+    {
+        Block block;
+        for ( size_t by = begin; by < end; ++by )
+        {
+            for ( uint32_t bx = 0; bx < BlocksX; ++bx )
+            {
+                loadBlock( pRgba, width, height, bx, uint32_t( by ), block );
+                encodeBlock( format, block, settings, &image.data[ ( by * BlocksX + bx ) * BlockBytes ] );
+            }
+        }
+    } );
+    auto end = std::chrono::steady_clock::now();
+
+    image.stats.seconds = std::chrono::duration<double>( end - start ).count();
+    image.stats.megabytesPerSecond = image.stats.seconds > 0.0
+        ? double( width ) * height * 4.0 / ( 1024.0 * 1024.0 ) / image.stats.seconds
+        : 0.0;
+
+    if ( measureQuality )
+    {
+        std::vector<uint8_t> decoded( size_t( width ) * height * 4 );
+        decompressImage( image, decoded.data() );
+
+        // BC1 stores transparent pixels as black, so only their alpha counts.
+        const int Channels = channelsStored( format );
+        double sum = 0.0;
+        size_t samples = 0;
+        for ( size_t p = 0; p < size_t( width ) * height; ++p )
+        {
+            bool transparent = format == BlockFormat::BC1 && pRgba[ p * 4 + 3 ] < 128;
+            for ( int ch = transparent ? 3 : 0; ch < Channels; ++ch )
+            {
+                double d = double( decoded[ p * 4 + ch ] ) - double( pRgba[ p * 4 + ch ] );
+                sum += d * d;
+                ++samples;
+            }
+        }
+        double mse = sum / double( samples );
+        image.stats.psnr = mse > 0.0 ? 10.0 * std::log10( 255.0 * 255.0 / mse ) : 99.0;
+    }
+
+    return image;
+}
+
+void decompressImage( const CompressedImage& image, uint8_t* pRgba )
+{
+    const uint32_t BlocksX = ( image.width + 3 ) / 4;
+    const uint32_t BlocksY = ( image.height + 3 ) / 4;
+    const size_t BlockBytes = blockSizeInBytes( image.format );
+
+    uint8_t texels[ 16 ][ 4 ];
+    for ( uint32_t by = 0; by < BlocksY; ++by )
+    {
+        for ( uint32_t bx = 0; bx < BlocksX; ++bx )
+        {
+            decodeBlock( image.format, &image.data[ ( size_t( by ) * BlocksX + bx ) * BlockBytes ], texels );
+            for ( uint32_t i = 0; i < 16; ++i )
+            {
+                uint32_t x = bx * 4 + ( i & 3 ), y = by * 4 + ( i >> 2 );
+                if ( x < image.width && y < image.height )
+                {
+                    memcpy( pRgba + ( size_t( y ) * image.width + x ) * 4, texels[ i ], 4 );
+                }
+            }
+        }
+    }
+}
+
+namespace
+{
+
+// Smooth gradients and a hard-edged checker, with fully transparent holes whose
+// color is unrelated to their surroundings. Alpha is otherwise opaque, so BC1's
+// one bit can hold it and every format is measured on the same image.
+std::vector<uint8_t> compressionTestImage( uint32_t size )
+{
+    std::vector<uint8_t> rgba( size_t( size ) * size * 4 );
+    for ( uint32_t y = 0; y < size; ++y )
+    {
+        for ( uint32_t x = 0; x < size; ++x )
+        {
+            uint8_t* pPixel = &rgba[ ( size_t( y ) * size + x ) * 4 ];
+            float u = float( x ) / float( size ), v = float( y ) / float( size );
+            bool checker = ( ( x / 32 ) ^ ( y / 32 ) ) & 1;
+            // Off the 4x4 grid, so most holes share blocks with opaque pixels.
+            bool hole = ( ( ( x + 2 ) / 6 ) % 5 == 0 ) && ( ( ( y + 1 ) / 6 ) % 7 == 0 );
+            pPixel[ 0 ] = uint8_t( 255.0f * u );
+            pPixel[ 1 ] = uint8_t( 128.0f + 100.0f * std::sin( v * 12.0f ) );
+            pPixel[ 2 ] = checker ? 200 : uint8_t( 255.0f * v );
+            pPixel[ 3 ] = hole ? 0 : 255;
+            if ( hole )
+            {
+                pPixel[ 0 ] = 255;
+                pPixel[ 1 ] = 0;
+                pPixel[ 2 ] = 255;
+            }
+        }
+    }
+    return rgba;
+}
+
+// Comfortably below what each format reaches on the test image with the fast
+// preset. The formats with real alpha have to keep the holes' color too, which
+// the fast bounding box fit handles poorly; BC1 drops it, and fell to 29 dB
+// when it still fitted its endpoints to the holes.
+double minimumPsnr( BlockFormat format )
+{
+    switch ( format )
+    {
+        case BlockFormat::BC1:     return 35.0;
+        case BlockFormat::BC3:     return 20.0;
+        case BlockFormat::BC4:     return 40.0;
+        case BlockFormat::BC5:     return 40.0;
+        case BlockFormat::BC7:     return 20.0;
+        case BlockFormat::ASTC4x4: return 20.0;
+    }
+    return 0.0;
+}
+
+}
+
+std::vector<BenchResult> runCompressionBench( const std::vector<uint32_t>& sizes, uint32_t runs,
+                                              JobSystem& jobs, size_t& problems )
+{
+    static const BlockFormat kFormats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4,
+                                            BlockFormat::BC5, BlockFormat::BC7, BlockFormat::ASTC4x4 };
+    static const CompressionPreset kPresets[] = { CompressionPreset::Fast, CompressionPreset::Balanced, CompressionPreset::Quality };
+
+    std::vector<BenchResult> results;
+    problems = 0;
+    for ( uint32_t size : sizes )
+    {
+        std::vector<uint8_t> image = compressionTestImage( size );
+        for ( BlockFormat format : kFormats )
+        {
+            for ( CompressionPreset preset : kPresets )
+            {
+                // Quality is measured once; the timed runs skip it.
+                CompressedImage compressed = compressImage( image.data(), size, size, format, preset, jobs );
+                const double Psnr = compressed.stats.psnr;
+                std::vector<double> encodeMs, megabytesPerSecond;
+                for ( uint32_t run = 0; run < runs; ++run )
+                {
+                    compressed = compressImage( image.data(), size, size, format, preset, jobs, false );
+                    encodeMs.push_back( compressed.stats.seconds * 1e3 );
+                    megabytesPerSecond.push_back( compressed.stats.megabytesPerSecond );
+                }
+                std::sort( megabytesPerSecond.begin(), megabytesPerSecond.end() );
+
+                BenchResult& result = results.emplace_back();
+                result.scene = std::string( blockFormatName( format ) ) + "-" + compressionPresetName( preset ) + "-" + std::to_string( size );
+                result.cpuEncode = summarizeFrameTimes( encodeMs );
+                result.memoryBytes = compressed.data.size();
+
+                bool ok = Psnr >= minimumPsnr( format );
+                problems += ok ? 0 : 1;
+                __builtin_printf( "Compress %-22s PSNR %6.2f dB, %8.1f MB/s%s\n", result.scene.c_str(), Psnr,
+                                  megabytesPerSecond[ megabytesPerSecond.size() / 2 ], ok ? "" : " BELOW MINIMUM" );
+            }
+        }
+    }
+    return results;
+}
@@ -0,0 +1,75 @@
+//
+//  block_compressor.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef block_compressor_hpp
+#define block_compressor_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "Model/bench_suite.hpp"
+
+class JobSystem;
+
+// 4x4 block formats the compressor can produce. View/compressed_texture maps
+// them onto the matching MTL::PixelFormat.
+enum class BlockFormat
+{
+    BC1,        // RGB + 1-bit alpha, 8 bytes per block
+    BC3,        // BC1 color + BC4 alpha, 16 bytes
+    BC4,        // R only, 8 bytes
+    BC5,        // RG, 16 bytes
+    BC7,        // RGBA, 16 bytes (mode 6 only)
+    ASTC4x4,    // RGB or RGBA LDR, 16 bytes (single partition, direct endpoints)
+};
+
+enum class CompressionPreset
+{
+    Fast,       // bounding-box endpoints, no refinement
+    Balanced,   // principal-axis endpoints, one least-squares refinement
+    Quality,    // best of principal-axis and bounding-box starts, several refinements
+};
+
+struct CompressionStats
+{
+    double psnr               = 0.0;  // over the channels the format stores, in dB; BC1 ignores transparent pixels' color
+    double seconds            = 0.0;  // encode time, excluding the PSNR pass
+    double megabytesPerSecond = 0.0;  // source RGBA8 bytes per second
+};
+
+struct CompressedImage
+{
+    BlockFormat          format;
+    uint32_t             width  = 0;
+    uint32_t             height = 0;
+    std::vector<uint8_t> data;       // blocks in row-major order
+    CompressionStats     stats;
+};
+
+size_t blockSizeInBytes( BlockFormat format );
+
+// Compresses a tightly packed RGBA8 image. Blocks are encoded in parallel over the
+// job system; edge blocks of non multiple-of-4 images replicate the last row/column.
+CompressedImage compressImage( const uint8_t* pRgba, uint32_t width, uint32_t height,
+                               BlockFormat format, CompressionPreset preset,
+                               JobSystem& jobs, bool measureQuality = true );
+
+// Decodes back to RGBA8, used for the PSNR report. Only understands the block
+// modes compressImage() emits.
+void decompressImage( const CompressedImage& image, uint8_t* pRgba );
+
+const char* blockFormatName( BlockFormat format );
+const char* compressionPresetName( CompressionPreset preset );
+
+// Compresses a generated image of each size, with gradients, hard edges and
+// cut-out alpha, in every format and preset `runs` times ("bc1-fast-N": encode
+// time, compressed bytes) and prints PSNR and MB/s for each. problems counts
+// encodes below the format's minimum PSNR.
+std::vector<BenchResult> runCompressionBench( const std::vector<uint32_t>& sizes, uint32_t runs,
+                                              JobSystem& jobs, size_t& problems );
+
+#endif /* block_compressor_hpp */
@@ -0,0 +1,775 @@
+//
+//  bvh_builder.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "bvh_builder.hpp"
+#include "Core/job_system.hpp"
+#include "Model/simd_math.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+using namespace math;
+
+namespace
+{
+
+const size_t kChunkSize = 4096;
+const uint32_t kMaxBins = 64;
+
+struct Aabb
+{
+    float4 min = { INFINITY, INFINITY, INFINITY, INFINITY };
+    float4 max = { -INFINITY, -INFINITY, -INFINITY, -INFINITY };
+
+    void grow( const Aabb& other )
+    {
+        min = math::min( min, other.min );
+        max = math::max( max, other.max );
+    }
+
+    void grow( const float4& p )
+    {
+        min = math::min( min, p );
+        max = math::max( max, p );
+    }
+
+    // Half the surface area, which is all SAH ratios need.
+    float area() const
+    {
+        float4 e = max - min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+struct Bin
+{
+    Aabb     bounds;
+    uint32_t count = 0;
+};
+
+// A primitive's bounds and index, moved as a unit when ranges are partitioned
+// so every pass over a node reads memory in order.
+struct PrimRef
+{
+    Aabb     bounds;
+    uint32_t index;
+
+    float4 centroid() const { return ( bounds.min + bounds.max ) * 0.5f; }
+};
+
+struct NodeRange
+{
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct Split
+{
+    int      axis = -1;     // -1 when no bin boundary separates the centroids
+    uint32_t bin = 0;       // left side takes bins [ 0, bin ]
+    float    cost = INFINITY;
+};
+
+// Bins on every axis over a common centroid box.
+struct Binning
+{
+    float4   origin;
+    float4   scale;         // 0 on axes where all centroids coincide
+    uint32_t binCount;
+
+    Binning( const Aabb& centroidBounds, uint32_t bins )
+    : origin( centroidBounds.min )
+    , binCount( bins )
+    {
+        float4 extent = centroidBounds.max - centroidBounds.min;
+        for ( int axis = 0; axis < 4; ++axis )
+        {
+            scale[ axis ] = axis < 3 && extent[ axis ] > 0.0f ? float( bins ) / extent[ axis ] * 0.99999f : 0.0f;
+        }
+    }
+
+    uint32_t binOf( const float4& centroid, int axis ) const
+    {
+        float b = ( centroid[ axis ] - origin[ axis ] ) * scale[ axis ];
+        return std::min( uint32_t( std::max( b, 0.0f ) ), binCount - 1 );
+    }
+
+    void add( const PrimRef& ref, Bin* bins ) const
+    {
+        float4 b = ( ref.centroid() - origin ) * scale;
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            uint32_t index = std::min( uint32_t( std::max( b[ axis ], 0.0f ) ), binCount - 1 );
+            Bin& bin = bins[ axis * binCount + index ];
+            bin.bounds.grow( ref.bounds );
+            ++bin.count;
+        }
+    }
+};
+
+void storeBounds( const Aabb& bounds, BvhNode& node )
+{
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        node.min[ axis ] = bounds.min[ axis ];
+        node.max[ axis ] = bounds.max[ axis ];
+    }
+}
+
+Aabb loadBounds( const BvhNode& node )
+{
+    Aabb bounds;
+    bounds.min = float4 { node.min[ 0 ], node.min[ 1 ], node.min[ 2 ], 0.0f };
+    bounds.max = float4 { node.max[ 0 ], node.max[ 1 ], node.max[ 2 ], 0.0f };
+    return bounds;
+}
+
+// Sweeps each axis' bins from both ends and returns the cheapest boundary, as
+// the sum over both sides of primitive count times surface area.
+Split findSplit( const Bin* bins, const Binning& binning )
+{
+    const uint32_t Bins = binning.binCount;
+    Split best;
+    float rightCost[ kMaxBins ];
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        if ( binning.scale[ axis ] == 0.0f )
+        {
+            continue;
+        }
+        const Bin* axisBins = bins + axis * Bins;
+
+        Aabb right;
+        uint32_t rightCount = 0;
+        for ( uint32_t i = Bins - 1; i > 0; --i )
+        {
+            right.grow( axisBins[ i ].bounds );
+            rightCount += axisBins[ i ].count;
+            rightCost[ i - 1 ] = rightCount ? float( rightCount ) * right.area() : INFINITY;
+        }
+
+        Aabb left;
+        uint32_t leftCount = 0;
+        for ( uint32_t i = 0; i + 1 < Bins; ++i )
+        {
+            left.grow( axisBins[ i ].bounds );
+            leftCount += axisBins[ i ].count;
+            float cost = leftCount ? float( leftCount ) * left.area() + rightCost[ i ] : INFINITY;
+            if ( cost < best.cost )
+            {
+                best = { axis, i, cost };
+            }
+        }
+    }
+    return best;
+}
+
+// Node bounds and centroid bounds of refs[ 0, count ), chunked across the job
+// system when one is given.
+void measureRange( const PrimRef* refs, uint32_t count,
+                   JobSystem* pJobs, Aabb& bounds, Aabb& centroidBounds )
+{
+    bounds = Aabb();
+    centroidBounds = Aabb();
+    if ( !pJobs )
+    {
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            bounds.grow( refs[ i ].bounds );
+            centroidBounds.grow( refs[ i ].centroid() );
+        }
+        return;
+    }
+
+    const size_t Chunks = ( count + kChunkSize - 1 ) / kChunkSize;
+    std::vector<Aabb> chunkBounds( Chunks ), chunkCentroids( Chunks );
+    pJobs->parallelFor( Chunks, 1, [&]( size_t begin, size_t end )
+    {
+        for ( size_t chunk = begin; chunk < end; ++chunk )
+        {
+            size_t last = std::min< size_t >( count, ( chunk + 1 ) * kChunkSize );
+            for ( size_t i = chunk * kChunkSize; i < last; ++i )
+            {
+                chunkBounds[ chunk ].grow( refs[ i ].bounds );
+                chunkCentroids[ chunk ].grow( refs[ i ].centroid() );
+            }
+        }
+    } );
+    for ( size_t chunk = 0; chunk < Chunks; ++chunk )
+    {
+        bounds.grow( chunkBounds[ chunk ] );
+        centroidBounds.grow( chunkCentroids[ chunk ] );
+    }
+}
+
+void binRange( const PrimRef* refs, uint32_t count, const Binning& binning,
+               JobSystem* pJobs, std::vector<Bin>& bins )
+{
+    bins.assign( 3 * binning.binCount, Bin() );
+    if ( !pJobs )
+    {
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            binning.add( refs[ i ], bins.data() );
+        }
+        return;
+    }
+
+    const size_t Chunks = ( count + kChunkSize - 1 ) / kChunkSize;
+    std::vector<Bin> chunkBins( Chunks * bins.size() );
+    pJobs->parallelFor( Chunks, 1, [&]( size_t begin, size_t end )
+    {
+        for ( size_t chunk = begin; chunk < end; ++chunk )
+        {
+            Bin* out = &chunkBins[ chunk * bins.size() ];
+            size_t last = std::min< size_t >( count, ( chunk + 1 ) * kChunkSize );
+            for ( size_t i = chunk * kChunkSize; i < last; ++i )
+            {
+                binning.add( refs[ i ], out );
+            }
+        }
+    } );
+    for ( size_t chunk = 0; chunk < Chunks; ++chunk )
+    {
+        for ( size_t b = 0; b < bins.size(); ++b )
+        {
+            bins[ b ].bounds.grow( chunkBins[ chunk * bins.size() + b ].bounds );
+            bins[ b ].count += chunkBins[ chunk * bins.size() + b ].count;
+        }
+    }
+}
+
+// Partitions refs[ 0, count ) into bins [ 0, split.bin ] and the rest. Returns
+// the size of the left side.
+uint32_t partitionRange( PrimRef* refs, uint32_t count, const Binning& binning,
+                         const Split& split, JobSystem* pJobs, std::vector<PrimRef>& scratch )
+{
+    auto isLeft = [&]( const PrimRef& ref )
+    {
+        return binning.binOf( ref.centroid(), split.axis ) <= split.bin;
+    };
+
+    if ( !pJobs )
+    {
+        return uint32_t( std::partition( refs, refs + count, isLeft ) - refs );
+    }
+
+    const size_t Chunks = ( count + kChunkSize - 1 ) / kChunkSize;
+    std::vector<uint32_t> leftCounts( Chunks, 0 );
+    pJobs->parallelFor( Chunks, 1, [&]( size_t begin, size_t end )
+    {
+        for ( size_t chunk = begin; chunk < end; ++chunk )
+        {
+            size_t last = std::min< size_t >( count, ( chunk + 1 ) * kChunkSize );
+            for ( size_t i = chunk * kChunkSize; i < last; ++i )
+            {
+                leftCounts[ chunk ] += isLeft( refs[ i ] ) ? 1 : 0;
+            }
+        }
+    } );
+
+    std::vector<uint32_t> leftStart( Chunks ), rightStart( Chunks );
+    uint32_t leftTotal = 0;
+    for ( size_t chunk = 0; chunk < Chunks; ++chunk )
+    {
+        leftStart[ chunk ] = leftTotal;
+        leftTotal += leftCounts[ chunk ];
+    }
+    uint32_t rightTotal = leftTotal;
+    for ( size_t chunk = 0; chunk < Chunks; ++chunk )
+    {
+        rightStart[ chunk ] = rightTotal;
+        rightTotal += uint32_t( std::min< size_t >( count - chunk * kChunkSize, kChunkSize ) ) - leftCounts[ chunk ];
+    }
+
+    // Scattered through scratch, keeping each side in its original order.
+    scratch.resize( count );
+    pJobs->parallelFor( Chunks, 1, [&]( size_t begin, size_t end )
+    {
+        for ( size_t chunk = begin; chunk < end; ++chunk )
+        {
+            uint32_t left = leftStart[ chunk ], right = rightStart[ chunk ];
+            size_t last = std::min< size_t >( count, ( chunk + 1 ) * kChunkSize );
+            for ( size_t i = chunk * kChunkSize; i < last; ++i )
+            {
+                scratch[ isLeft( refs[ i ] ) ? left++ : right++ ] = refs[ i ];
+            }
+        }
+    } );
+    std::copy( scratch.begin(), scratch.begin() + count, refs );
+    return leftTotal;
+}
+
+// Splits one node, or turns it into a leaf. Returns false for a leaf; otherwise
+// leftCount is the size of the first child's range.
+bool splitNode( PrimRef* refs, uint32_t count, const BvhBuildSettings& settings,
+                JobSystem* pJobs, BvhNode& node, std::vector<Bin>& bins, std::vector<PrimRef>& scratch,
+                uint32_t& leftCount )
+{
+    Aabb bounds, centroidBounds;
+    measureRange( refs, count, pJobs, bounds, centroidBounds );
+    storeBounds( bounds, node );
+    if ( count <= 1 )
+    {
+        return false;
+    }
+
+    // Small nodes have few distinct boundaries to choose from, so fewer bins lose little.
+    Binning binning( centroidBounds, std::min( { settings.binCount, kMaxBins, std::max( count, 4u ) } ) );
+    Split split;
+    if ( binning.scale[ 0 ] != 0.0f || binning.scale[ 1 ] != 0.0f || binning.scale[ 2 ] != 0.0f )
+    {
+        binRange( refs, count, binning, pJobs, bins );
+        split = findSplit( bins.data(), binning );
+    }
+
+    const float LeafCost = settings.intersectionCost * float( count );
+    const float SplitCost = settings.traversalCost + settings.intersectionCost * split.cost / bounds.area();
+    if ( count <= settings.maxLeafSize && ( split.axis < 0 || LeafCost <= SplitCost ) )
+    {
+        return false;
+    }
+
+    leftCount = split.axis < 0 ? 0 : partitionRange( refs, count, binning, split, pJobs, scratch );
+    if ( leftCount == 0 || leftCount == count )
+    {
+        // Coincident centroids: any split is as good as another, so halve the range.
+        leftCount = count / 2;
+    }
+    return true;
+}
+
+// Builds the subtree of one range on the calling thread. local[ 0 ] is the
+// subtree root; child indices are local.
+void buildSubtree( PrimRef* refs, uint32_t first, uint32_t count,
+                   const BvhBuildSettings& settings, std::vector<BvhNode>& local )
+{
+    std::vector<Bin> bins;
+    std::vector<PrimRef> scratch;
+    std::vector<NodeRange> stack;
+
+    local.clear();
+    local.push_back( BvhNode() );
+    stack.push_back( { 0, first, count } );
+    while ( !stack.empty() )
+    {
+        NodeRange range = stack.back();
+        stack.pop_back();
+
+        uint32_t leftCount = 0;
+        BvhNode node;
+        if ( !splitNode( refs + range.first, range.count, settings, nullptr, node, bins, scratch, leftCount ) )
+        {
+            node.leftFirst = range.first;
+            node.count = range.count;
+            local[ range.node ] = node;
+            continue;
+        }
+
+        node.leftFirst = uint32_t( local.size() );
+        node.count = 0;
+        local[ range.node ] = node;
+        local.push_back( BvhNode() );
+        local.push_back( BvhNode() );
+        stack.push_back( { node.leftFirst, range.first, leftCount } );
+        stack.push_back( { node.leftFirst + 1, range.first + leftCount, range.count - leftCount } );
+    }
+}
+
+Aabb triangleAabb( const MeshData& mesh, size_t triangle )
+{
+    Aabb bounds;
+    for ( int corner = 0; corner < 3; ++corner )
+    {
+        const MeshVertex& v = mesh.vertices[ mesh.indices[ triangle * 3 + corner ] ];
+        bounds.grow( float4 { v.x, v.y, v.z, 0.0f } );
+    }
+    return bounds;
+}
+
+}
+
+Bvh buildBvh( const std::vector<BvhBounds>& primitives, const BvhBuildSettings& settings, JobSystem& jobs )
+{
+    Bvh bvh;
+    const uint32_t Count = uint32_t( primitives.size() );
+    bvh.primitiveOrder.resize( Count );
+    bvh.nodes.push_back( BvhNode() );
+
+    std::vector<PrimRef> refs( Count );
+    jobs.parallelFor( Count, kChunkSize, [&]( size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            const BvhBounds& b = primitives[ i ];
+            refs[ i ].bounds.min = float4 { b.min[ 0 ], b.min[ 1 ], b.min[ 2 ], 0.0f };
+            refs[ i ].bounds.max = float4 { b.max[ 0 ], b.max[ 1 ], b.max[ 2 ], 0.0f };
+            refs[ i ].index = uint32_t( i );
+        }
+    } );
+
+    // Top levels: one node at a time, each spread over the job system.
+    std::vector<Bin> bins;
+    std::vector<PrimRef> scratch;
+    std::vector<NodeRange> pending = { { 0, 0, Count } }, subtrees;
+    while ( !pending.empty() )
+    {
+        NodeRange range = pending.back();
+        pending.pop_back();
+        if ( range.count < settings.parallelThreshold )
+        {
+            subtrees.push_back( range );
+            continue;
+        }
+
+        uint32_t leftCount = 0;
+        BvhNode node;
+        if ( !splitNode( refs.data() + range.first, range.count, settings, &jobs, node, bins, scratch, leftCount ) )
+        {
+            node.leftFirst = range.first;
+            node.count = range.count;
+            bvh.nodes[ range.node ] = node;
+            continue;
+        }
+
+        node.leftFirst = uint32_t( bvh.nodes.size() );
+        node.count = 0;
+        bvh.nodes[ range.node ] = node;
+        bvh.nodes.push_back( BvhNode() );
+        bvh.nodes.push_back( BvhNode() );
+        pending.push_back( { node.leftFirst, range.first, leftCount } );
+        pending.push_back( { node.leftFirst + 1, range.first + leftCount, range.count - leftCount } );
+    }
+
+    // Largest subtrees first, so the last job to start is a small one.
+    std::sort( subtrees.begin(), subtrees.end(), []( const NodeRange& a, const NodeRange& b ) { return a.count > b.count; } );
+    std::vector<std::vector<BvhNode>> locals( subtrees.size() );
+    jobs.parallelFor( subtrees.size(), 1, [&]( size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            buildSubtree( refs.data(), subtrees[ i ].first, subtrees[ i ].count, settings, locals[ i ] );
+        }
+    } );
+
+    // The subtree root takes the slot its parent reserved; the rest is appended.
+    for ( size_t i = 0; i < subtrees.size(); ++i )
+    {
+        const std::vector<BvhNode>& local = locals[ i ];
+        const uint32_t Base = uint32_t( bvh.nodes.size() ) - 1;
+        for ( size_t n = 0; n < local.size(); ++n )
+        {
+            BvhNode node = local[ n ];
+            if ( node.count == 0 )
+            {
+                node.leftFirst += Base;
+            }
+            if ( n == 0 )
+            {
+                bvh.nodes[ subtrees[ i ].node ] = node;
+            }
+            else
+            {
+                bvh.nodes.push_back( node );
+            }
+        }
+    }
+
+    jobs.parallelFor( Count, kChunkSize, [&]( size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            bvh.primitiveOrder[ i ] = refs[ i ].index;
+        }
+    } );
+    return bvh;
+}
+
+void refitBvh( Bvh& bvh, const std::vector<BvhBounds>& primitives, JobSystem& jobs )
+{
+    jobs.parallelFor( bvh.nodes.size(), 1024, [&]( size_t begin, size_t end )
+    {
+        for ( size_t n = begin; n < end; ++n )
+        {
+            BvhNode& node = bvh.nodes[ n ];
+            if ( node.count == 0 )
+            {
+                continue;
+            }
+            Aabb bounds;
+            for ( uint32_t i = 0; i < node.count; ++i )
+            {
+                const BvhBounds& b = primitives[ bvh.primitiveOrder[ node.leftFirst + i ] ];
+                bounds.grow( float4 { b.min[ 0 ], b.min[ 1 ], b.min[ 2 ], 0.0f } );
+                bounds.grow( float4 { b.max[ 0 ], b.max[ 1 ], b.max[ 2 ], 0.0f } );
+            }
+            storeBounds( bounds, node );
+        }
+    } );
+
+    // Children come after their parents, so a reverse sweep sees them first.
+    for ( size_t n = bvh.nodes.size(); n-- > 0; )
+    {
+        BvhNode& node = bvh.nodes[ n ];
+        if ( node.count == 0 )
+        {
+            Aabb bounds = loadBounds( bvh.nodes[ node.leftFirst ] );
+            bounds.grow( loadBounds( bvh.nodes[ node.leftFirst + 1 ] ) );
+            storeBounds( bounds, node );
+        }
+    }
+}
+
+float bvhSahCost( const Bvh& bvh, const BvhBuildSettings& settings )
+{
+    if ( bvh.nodes.empty() )
+    {
+        return 0.0f;
+    }
+
+    double cost = 0.0;
+    for ( const BvhNode& node : bvh.nodes )
+    {
+        double area = loadBounds( node ).area();
+        cost += node.count ? settings.intersectionCost * node.count * area : settings.traversalCost * area;
+    }
+    double rootArea = loadBounds( bvh.nodes[ 0 ] ).area();
+    return rootArea > 0.0 ? float( cost / rootArea ) : 0.0f;
+}
+
+size_t validateBvh( const Bvh& bvh, const std::vector<BvhBounds>& primitives )
+{
+    size_t problems = 0;
+    std::vector<uint8_t> seen( primitives.size(), 0 );
+    for ( uint32_t primitive : bvh.primitiveOrder )
+    {
+        if ( primitive >= primitives.size() || seen[ primitive ]++ )
+        {
+            ++problems;
+        }
+    }
+    problems += size_t( std::count( seen.begin(), seen.end(), 0 ) );
+
+    auto encloses = []( const BvhNode& outer, const float* min, const float* max )
+    {
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            if ( min[ axis ] < outer.min[ axis ] || max[ axis ] > outer.max[ axis ] )
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    size_t visited = 0, leafPrimitives = 0;
+    std::vector<uint32_t> stack = { 0 };
+    while ( !stack.empty() && !bvh.nodes.empty() )
+    {
+        const BvhNode& node = bvh.nodes[ stack.back() ];
+        uint32_t index = stack.back();
+        stack.pop_back();
+        if ( ++visited > bvh.nodes.size() )
+        {
+            return problems + 1;    // cycle
+        }
+
+        if ( node.count )
+        {
+            leafPrimitives += node.count;
+            for ( uint32_t i = 0; i < node.count && node.leftFirst + i < bvh.primitiveOrder.size(); ++i )
+            {
+                uint32_t primitive = bvh.primitiveOrder[ node.leftFirst + i ];
+                if ( primitive < primitives.size() && !encloses( node, primitives[ primitive ].min, primitives[ primitive ].max ) )
+                {
+                    ++problems;
+                }
+            }
+            continue;
+        }
+
+        for ( uint32_t child = node.leftFirst; child < node.leftFirst + 2; ++child )
+        {
+            if ( child <= index || child >= bvh.nodes.size() )
+            {
+                ++problems;
+                continue;
+            }
+            problems += encloses( node, bvh.nodes[ child ].min, bvh.nodes[ child ].max ) ? 0 : 1;
+            stack.push_back( child );
+        }
+    }
+    problems += visited == bvh.nodes.size() ? 0 : 1;
+    problems += leafPrimitives == primitives.size() ? 0 : 1;
+    return problems;
+}
+
+std::vector<BvhBounds> triangleBounds( const MeshData& mesh, JobSystem& jobs )
+{
+    std::vector<BvhBounds> bounds( mesh.triangleCount() );
+    jobs.parallelFor( bounds.size(), kChunkSize, [&]( size_t begin, size_t end )
+    {
+        for ( size_t t = begin; t < end; ++t )
+        {
+            Aabb box = triangleAabb( mesh, t );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                bounds[ t ].min[ axis ] = box.min[ axis ];
+                bounds[ t ].max[ axis ] = box.max[ axis ];
+            }
+        }
+    } );
+    return bounds;
+}
+
+BvhUpdateHeuristic::BvhUpdateHeuristic( const BvhUpdatePolicy& policy )
+: _policy( policy )
+{
+}
+
+void BvhUpdateHeuristic::rebuilt( float sahCost )
+{
+    _builtCost = std::max( sahCost, 1e-6f );
+    _lastCost = _builtCost;
+    _refits = 0;
+}
+
+BvhUpdate BvhUpdateHeuristic::refitted( float sahCost )
+{
+    _lastCost = sahCost;
+    ++_refits;
+    return costGrowth() > _policy.maxCostGrowth || _refits >= _policy.maxConsecutiveRefits
+        ? BvhUpdate::Rebuild
+        : BvhUpdate::Refit;
+}
+
+namespace
+{
+
+uint32_t nextRandom( uint32_t& state )
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+float nextUnit( uint32_t& state )
+{
+    return float( nextRandom( state ) >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+// Small triangles scattered through a 100 unit box, denser towards the floor
+// like a typical scene. Same count, same soup.
+MeshData buildTriangleSoup( uint32_t triangles )
+{
+    MeshData mesh;
+    uint32_t state = 0x9e3779b9u ^ triangles;
+    for ( uint32_t t = 0; t < triangles; ++t )
+    {
+        float cx = nextUnit( state ) * 100.0f - 50.0f;
+        float cy = nextUnit( state ) * nextUnit( state ) * 40.0f;
+        float cz = nextUnit( state ) * 100.0f - 50.0f;
+        for ( int corner = 0; corner < 3; ++corner )
+        {
+            mesh.vertices.push_back( { cx + nextUnit( state ) - 0.5f, cy + nextUnit( state ) - 0.5f, cz + nextUnit( state ) - 0.5f } );
+            mesh.indices.push_back( t * 3 + corner );
+        }
+    }
+    return mesh;
+}
+
+// Each triangle orbits its rest position with its own phase, so neighbours
+// drift apart the way debris or crowds do and refits slowly lose quality.
+void animateSoup( const MeshData& rest, float time, MeshData& out, JobSystem& jobs )
+{
+    out.indices = rest.indices;
+    out.vertices.resize( rest.vertices.size() );
+    jobs.parallelFor( rest.vertices.size(), kChunkSize, [&]( size_t begin, size_t end )
+    {
+        for ( size_t v = begin; v < end; ++v )
+        {
+            uint32_t state = uint32_t( v / 3 ) * 2654435761u + 1u;
+            float phase = nextUnit( state ) * 6.2831853f;
+            const MeshVertex& p = rest.vertices[ v ];
+            out.vertices[ v ] = { p.x + 8.0f * std::sin( time + phase ), p.y, p.z + 8.0f * std::cos( time + phase ) };
+        }
+    } );
+}
+
+double elapsedMs( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+}
+
+std::vector<BenchResult> runBvhBench( const std::vector<uint32_t>& triangleCounts, uint32_t frames,
+                                      JobSystem& jobs, size_t& problems )
+{
+    using Clock = std::chrono::steady_clock;
+    const BvhBuildSettings Settings;
+    std::vector<BenchResult> results;
+    problems = 0;
+
+    for ( uint32_t triangles : triangleCounts )
+    {
+        MeshData rest = buildTriangleSoup( triangles );
+        std::vector<BvhBounds> bounds = triangleBounds( rest, jobs );
+
+        std::vector<double> buildMs;
+        Bvh bvh;
+        for ( uint32_t i = 0; i < std::max( frames / 10, 1u ); ++i )
+        {
+            Clock::time_point start = Clock::now();
+            bvh = buildBvh( bounds, Settings, jobs );
+            buildMs.push_back( elapsedMs( start ) );
+        }
+        problems += validateBvh( bvh, bounds );
+
+        BenchResult& build = results.emplace_back();
+        build.scene = "bvh-build-" + std::to_string( triangles );
+        build.cpuEncode = summarizeFrameTimes( buildMs );
+        build.memoryBytes = bvh.nodes.size() * sizeof( BvhNode ) + bvh.primitiveOrder.size() * sizeof( uint32_t );
+        const float BuiltCost = bvhSahCost( bvh, Settings );
+
+        // Animated frames: refit every frame, rebuild when the heuristic says so.
+        BvhUpdateHeuristic heuristic;
+        heuristic.rebuilt( BuiltCost );
+        MeshData animated;
+        std::vector<double> refitMs;
+        uint32_t rebuilds = 0;
+        for ( uint32_t frame = 0; frame < frames; ++frame )
+        {
+            animateSoup( rest, float( frame ) * 0.05f, animated, jobs );
+            bounds = triangleBounds( animated, jobs );
+
+            Clock::time_point start = Clock::now();
+            refitBvh( bvh, bounds, jobs );
+            refitMs.push_back( elapsedMs( start ) );
+            if ( heuristic.refitted( bvhSahCost( bvh, Settings ) ) == BvhUpdate::Rebuild )
+            {
+                bvh = buildBvh( bounds, Settings, jobs );
+                heuristic.rebuilt( bvhSahCost( bvh, Settings ) );
+                ++rebuilds;
+            }
+        }
+        problems += validateBvh( bvh, bounds );
+
+        BenchResult& refit = results.emplace_back();
+        refit.scene = "bvh-refit-" + std::to_string( triangles );
+        refit.cpuEncode = summarizeFrameTimes( refitMs );
+        refit.memoryBytes = build.memoryBytes;
+
+        __builtin_printf( "BVH %u triangles: %zu nodes, SAH cost %.2f, %u rebuilds in %u animated frames (%.0f%% cost growth at the end)\n",
+                          triangles, bvh.nodes.size(), BuiltCost, rebuilds, frames, heuristic.costGrowth() * 100.0f );
+    }
+    return results;
+}
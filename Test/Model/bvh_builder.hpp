@@ -0,0 +1,109 @@
+//
+//  bvh_builder.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef bvh_builder_hpp
+#define bvh_builder_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Model/mesh.hpp"
+#include "Model/bench_suite.hpp"
+
+class JobSystem;
+
+struct BvhBounds
+{
+    float min[ 3 ];
+    float max[ 3 ];
+};
+
+// 32 bytes. Interior nodes have count 0 and their children at leftFirst and
+// leftFirst + 1; leaves cover primitiveOrder[ leftFirst, leftFirst + count ).
+// Children always come after their parent.
+struct BvhNode
+{
+    float    min[ 3 ];
+    uint32_t leftFirst;
+    float    max[ 3 ];
+    uint32_t count;
+};
+
+struct BvhBuildSettings
+{
+    uint32_t binCount           = 16;
+    uint32_t maxLeafSize        = 4;
+    float    traversalCost      = 1.0f;
+    float    intersectionCost   = 1.0f;
+    uint32_t parallelThreshold  = 16384;    // smaller nodes are built as whole subtrees on one worker
+};
+
+struct Bvh
+{
+    std::vector<BvhNode>  nodes;            // nodes[ 0 ] is the root
+    std::vector<uint32_t> primitiveOrder;   // primitive indices in leaf order
+};
+
+// Binned SAH build. Nodes of at least parallelThreshold primitives are binned
+// and partitioned across the job system a level at a time; the subtrees below
+// that are then built in parallel, one per job, and stitched into one array.
+Bvh buildBvh( const std::vector<BvhBounds>& primitives, const BvhBuildSettings& settings, JobSystem& jobs );
+
+// Recomputes every node's bounds for moved primitives, keeping the topology.
+void refitBvh( Bvh& bvh, const std::vector<BvhBounds>& primitives, JobSystem& jobs );
+
+// SAH cost of the tree, relative to the root's surface area, so trees over
+// moving geometry stay comparable.
+float bvhSahCost( const Bvh& bvh, const BvhBuildSettings& settings );
+
+// Number of broken invariants: primitives missing or repeated, unreachable
+// nodes, or nodes not enclosing their children and primitives. 0 for a valid tree.
+size_t validateBvh( const Bvh& bvh, const std::vector<BvhBounds>& primitives );
+
+std::vector<BvhBounds> triangleBounds( const MeshData& mesh, JobSystem& jobs );
+
+enum class BvhUpdate
+{
+    Refit,
+    Rebuild
+};
+
+struct BvhUpdatePolicy
+{
+    float    maxCostGrowth          = 0.25f;    // over the cost right after the last rebuild
+    uint32_t maxConsecutiveRefits   = 240;
+};
+
+// Refit vs rebuild for animated geometry. Refitting keeps the topology, so the
+// tree's quality drifts as primitives move away from where they were grouped;
+// once the refit cost has grown past the policy's limit a rebuild pays for itself.
+class BvhUpdateHeuristic
+{
+public:
+    explicit BvhUpdateHeuristic( const BvhUpdatePolicy& policy = BvhUpdatePolicy() );
+
+    void rebuilt( float sahCost );
+
+    // Called with the cost after a refit; says whether to keep it or rebuild.
+    BvhUpdate refitted( float sahCost );
+
+    float costGrowth() const { return _lastCost / _builtCost - 1.0f; }
+
+private:
+    BvhUpdatePolicy _policy;
+    float           _builtCost = 1.0f;
+    float           _lastCost = 1.0f;
+    uint32_t        _refits = 0;
+};
+
+// Builds, validates and refits animated triangle soups of each size. Results
+// are named "bvh-build-N" and "bvh-refit-N", with times in cpuEncode and node
+// memory in memoryBytes. problems counts invalid trees.
+std::vector<BenchResult> runBvhBench( const std::vector<uint32_t>& triangleCounts, uint32_t frames,
+                                      JobSystem& jobs, size_t& problems );
+
+#endif /* bvh_builder_hpp */
@@ -0,0 +1,85 @@
+//
+//  capture_trigger.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "capture_trigger.hpp"
+
+#include <algorithm>
+
+const char* captureReasonName( CaptureReason reason )
+{
+    switch ( reason )
+    {
+        case CaptureReason::None:       return "none";
+        case CaptureReason::Spike:      return "spike";
+        case CaptureReason::Threshold:  return "threshold";
+        case CaptureReason::Requested:  return "requested";
+    }
+    return "unknown";
+}
+
+CaptureTrigger::CaptureTrigger( const CaptureTriggerSettings& settings )
+: _settings( settings )
+{
+    _frameMs.reserve( settings.window );
+}
+
+double CaptureTrigger::medianMs() const
+{
+    if ( _frameMs.empty() )
+    {
+        return 0.0;
+    }
+    std::vector<double> sorted = _frameMs;
+    std::nth_element( sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end() );
+    return sorted[ sorted.size() / 2 ];
+}
+
+CaptureReason CaptureTrigger::addFrame( double frameMs, double nowSeconds )
+{
+    // Judged against the frames before it, so a spike doesn't raise its own bar.
+    CaptureReason reason = CaptureReason::None;
+    if ( _requested.exchange( false, std::memory_order_relaxed ) )
+    {
+        reason = CaptureReason::Requested;
+    }
+    else if ( _frames >= _settings.warmupFrames )
+    {
+        double median = medianMs();
+        if ( _settings.absoluteMs > 0.0 && frameMs > _settings.absoluteMs )
+        {
+            reason = CaptureReason::Threshold;
+        }
+        else if ( frameMs > median * _settings.spikeFactor && frameMs - median > _settings.minSpikeMs )
+        {
+            reason = CaptureReason::Spike;
+        }
+    }
+
+    if ( _frameMs.size() < _settings.window )
+    {
+        _frameMs.push_back( frameMs );
+    }
+    else
+    {
+        _frameMs[ _frames % _settings.window ] = frameMs;
+    }
+    ++_frames;
+
+    if ( reason == CaptureReason::None )
+    {
+        return reason;
+    }
+    bool tooSoon = _lastCapture >= 0.0 && nowSeconds - _lastCapture < _settings.minIntervalSeconds;
+    if ( _captures >= _settings.maxCaptures || ( tooSoon && reason != CaptureReason::Requested ) )
+    {
+        ++_suppressed;
+        return CaptureReason::None;
+    }
+    _lastCapture = nowSeconds;
+    ++_captures;
+    return reason;
+}
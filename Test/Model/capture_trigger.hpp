@@ -0,0 +1,67 @@
+//
+//  capture_trigger.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef capture_trigger_hpp
+#define capture_trigger_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+struct CaptureTriggerSettings
+{
+    double   spikeFactor        = 2.0;      // over the median of recent frames
+    double   minSpikeMs         = 4.0;      // and at least this much over it, so fast frames doubling isn't a spike
+    double   absoluteMs         = 0.0;      // any frame over this, 0 for none
+    uint32_t window             = 120;      // frames the median is taken over
+    uint32_t warmupFrames       = 60;       // startup hitches are expected, not anomalies
+    double   minIntervalSeconds = 30.0;     // between captures
+    uint32_t maxCaptures        = 5;        // per run
+};
+
+enum class CaptureReason
+{
+    None,
+    Spike,
+    Threshold,
+    Requested
+};
+
+const char* captureReasonName( CaptureReason reason );
+
+// Decides when a frame time anomaly is worth a GPU capture. Captures are
+// expensive, both to take and to store, so they are rate limited: at most
+// maxCaptures per run and one per minIntervalSeconds. Requested captures skip
+// the interval but still count towards maxCaptures.
+class CaptureTrigger
+{
+public:
+    explicit CaptureTrigger( const CaptureTriggerSettings& settings = CaptureTriggerSettings() );
+
+    // Call once per frame. Anything but None means arm a capture now; the
+    // trigger counts it as taken.
+    CaptureReason addFrame( double frameMs, double nowSeconds );
+
+    // Asks for a capture at the next addFrame(). Safe from any thread and from
+    // signal handlers.
+    void request() { _requested.store( true, std::memory_order_relaxed ); }
+
+    double medianMs() const;
+    uint32_t captures() const { return _captures; }
+    uint32_t suppressed() const { return _suppressed; }     // anomalies dropped by the rate limit
+
+private:
+    CaptureTriggerSettings  _settings;
+    std::vector<double>     _frameMs;       // ring of `window` samples
+    uint64_t                _frames = 0;
+    double                  _lastCapture = -1.0;
+    uint32_t                _captures = 0;
+    uint32_t                _suppressed = 0;
+    std::atomic<bool>       _requested { false };
+};
+
+#endif /* capture_trigger_hpp */
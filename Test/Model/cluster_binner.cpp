@@ -0,0 +1,255 @@
+//
+//  cluster_binner.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "cluster_binner.hpp"
+#include "Core/job_system.hpp"
+#include "Core/trace_recorder.hpp"
+#include "Model/simd_math.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using namespace math;
+
+namespace
+{
+
+// Distance from the box to the sphere center along one axis, 0 inside.
+inline detail::Vec4 axisDistance( float lo, float hi, detail::Vec4 c )
+{
+    return detail::max( detail::max( detail::sub( detail::splat( lo ), c ), detail::sub( c, detail::splat( hi ) ) ), detail::splat( 0.0f ) );
+}
+
+}
+
+uint32_t clusterCount( const ClusterGridDesc& grid )
+{
+    return grid.tilesX * grid.tilesY * grid.slices;
+}
+
+std::vector<ClusterBounds> buildClusterBounds( const ClusterGridDesc& grid )
+{
+    std::vector<ClusterBounds> clusters( clusterCount( grid ) );
+    const float TanX = grid.tanHalfFovY * grid.aspect;
+    const float TanY = grid.tanHalfFovY;
+    const float Scale = 1.0f / grid.quantum;
+
+    for ( uint32_t slice = 0; slice < grid.slices; ++slice )
+    {
+        float z0 = grid.nearZ * std::pow( grid.farZ / grid.nearZ, float( slice ) / float( grid.slices ) );
+        float z1 = grid.nearZ * std::pow( grid.farZ / grid.nearZ, float( slice + 1 ) / float( grid.slices ) );
+        for ( uint32_t y = 0; y < grid.tilesY; ++y )
+        {
+            // Tile row 0 is the top of the screen.
+            float ndcY0 = 1.0f - 2.0f * float( y + 1 ) / float( grid.tilesY );
+            float ndcY1 = 1.0f - 2.0f * float( y ) / float( grid.tilesY );
+            for ( uint32_t x = 0; x < grid.tilesX; ++x )
+            {
+                float ndcX0 = -1.0f + 2.0f * float( x ) / float( grid.tilesX );
+                float ndcX1 = -1.0f + 2.0f * float( x + 1 ) / float( grid.tilesX );
+
+                // The froxel's eight corners all lie on the near and far planes of the slice.
+                float lo[ 3 ] = { INFINITY, INFINITY, z0 };
+                float hi[ 3 ] = { -INFINITY, -INFINITY, z1 };
+                for ( float z : { z0, z1 } )
+                {
+                    for ( float ndcX : { ndcX0, ndcX1 } )
+                    {
+                        lo[ 0 ] = std::min( lo[ 0 ], ndcX * z * TanX );
+                        hi[ 0 ] = std::max( hi[ 0 ], ndcX * z * TanX );
+                    }
+                    for ( float ndcY : { ndcY0, ndcY1 } )
+                    {
+                        lo[ 1 ] = std::min( lo[ 1 ], ndcY * z * TanY );
+                        hi[ 1 ] = std::max( hi[ 1 ], ndcY * z * TanY );
+                    }
+                }
+
+                ClusterBounds& bounds = clusters[ ( slice * grid.tilesY + y ) * grid.tilesX + x ];
+                for ( int axis = 0; axis < 3; ++axis )
+                {
+                    bounds.min[ axis ] = std::floor( lo[ axis ] * Scale );
+                    bounds.max[ axis ] = std::ceil( hi[ axis ] * Scale );
+                }
+                bounds.min[ 3 ] = 0.0f;
+                bounds.max[ 3 ] = 0.0f;
+            }
+        }
+    }
+    return clusters;
+}
+
+std::vector<ClusterSphere> buildClusterSpheres( const ClusterGridDesc& grid, const std::vector<ViewSpaceLight>& lights )
+{
+    std::vector<ClusterSphere> spheres( std::min< size_t >( lights.size(), kMaxBinnedLights ) );
+    const float Scale = 1.0f / grid.quantum;
+    bool clamped = false;
+
+    for ( size_t i = 0; i < spheres.size(); ++i )
+    {
+        const ViewSpaceLight& light = lights[ i ];
+        float center[ 3 ] = { light.position[ 0 ], light.position[ 1 ], light.position[ 2 ] };
+        float radius = light.range;
+
+        // Below 60 degrees, the sphere through the apex and the rim of the
+        // cone's cap is smaller than the range sphere.
+        if ( light.cosHalfAngle > 0.5f )
+        {
+            radius = light.range / ( 2.0f * light.cosHalfAngle );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                center[ axis ] += light.direction[ axis ] * radius;
+            }
+        }
+
+        // Rounding the center moves it by at most sqrt(3)/2 quanta.
+        float quantized = std::ceil( radius * Scale ) + 1.0f;
+        clamped |= quantized > kMaxClusterRadiusQuanta;
+        spheres[ i ].radius = std::min( quantized, kMaxClusterRadiusQuanta );
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            spheres[ i ].center[ axis ] = std::round( center[ axis ] * Scale );
+        }
+    }
+
+    if ( clamped )
+    {
+        __builtin_printf( "Cluster binning: light radii clamped to %.1f units; raise ClusterGridDesc::quantum\n",
+                          double( kMaxClusterRadiusQuanta * grid.quantum ) );
+    }
+    if ( lights.size() > kMaxBinnedLights )
+    {
+        __builtin_printf( "Cluster binning: %zu lights, only the first %u are binned\n", lights.size(), kMaxBinnedLights );
+    }
+    return spheres;
+}
+
+ClusterLightLists binLights( const std::vector<ClusterBounds>& clusters, const std::vector<ClusterSphere>& spheres,
+                             JobSystem& jobs )
+{
+    const size_t LightCount = spheres.size();
+    const size_t Groups = ( LightCount + 3 ) / 4;
+    const size_t Words = ( LightCount + 31 ) / 32;
+
+    // Structure of arrays, four lights per vector. Padding lights get a negative
+    // radius, which no distance passes.
+    std::vector<float4> xs( Groups ), ys( Groups ), zs( Groups ), rs( Groups, float4 { -1.0f, -1.0f, -1.0f, -1.0f } );
+    for ( size_t i = 0; i < LightCount; ++i )
+    {
+        xs[ i / 4 ][ i % 4 ] = spheres[ i ].center[ 0 ];
+        ys[ i / 4 ][ i % 4 ] = spheres[ i ].center[ 1 ];
+        zs[ i / 4 ][ i % 4 ] = spheres[ i ].center[ 2 ];
+        rs[ i / 4 ][ i % 4 ] = spheres[ i ].radius;
+    }
+
+    std::vector<uint32_t> masks( clusters.size() * Words, 0 );
+    jobs.parallelFor( clusters.size(), 16, [&]( size_t begin, size_t end )
+    {
+        for ( size_t c = begin; c < end; ++c )
+        {
+            const ClusterBounds& b = clusters[ c ];
+            uint32_t* words = &masks[ c * Words ];
+            for ( size_t g = 0; g < Groups; ++g )
+            {
+                detail::Vec4 dx = axisDistance( b.min[ 0 ], b.max[ 0 ], detail::load( xs[ g ] ) );
+                detail::Vec4 dy = axisDistance( b.min[ 1 ], b.max[ 1 ], detail::load( ys[ g ] ) );
+                detail::Vec4 dz = axisDistance( b.min[ 2 ], b.max[ 2 ], detail::load( zs[ g ] ) );
+                detail::Vec4 r = detail::load( rs[ g ] );
+                // The per-axis checks keep the squared sum below 2^24, as on the GPU.
+                detail::Vec4 distanceSquared = detail::add( detail::add( detail::mul( dx, dx ), detail::mul( dy, dy ) ), detail::mul( dz, dz ) );
+                detail::Mask4 hit = detail::both( detail::both( detail::lessEqual( dx, r ), detail::lessEqual( dy, r ) ),
+                                                  detail::both( detail::lessEqual( dz, r ), detail::lessEqual( distanceSquared, detail::mul( r, r ) ) ) );
+                words[ g / 8 ] |= detail::bits( hit ) << ( ( g % 8 ) * 4 );
+            }
+        }
+    } );
+
+    ClusterLightLists lists;
+    lists.offsets.resize( clusters.size() );
+    lists.counts.resize( clusters.size() );
+    uint32_t total = 0;
+    for ( size_t c = 0; c < clusters.size(); ++c )
+    {
+        uint32_t count = 0;
+        for ( size_t w = 0; w < Words; ++w )
+        {
+            count += uint32_t( __builtin_popcount( masks[ c * Words + w ] ) );
+        }
+        lists.offsets[ c ] = total;
+        lists.counts[ c ] = count;
+        total += count;
+    }
+
+    lists.indices.resize( total );
+    jobs.parallelFor( clusters.size(), 64, [&]( size_t begin, size_t end )
+    {
+        for ( size_t c = begin; c < end; ++c )
+        {
+            uint16_t* out = &lists.indices[ lists.offsets[ c ] ];
+            for ( size_t w = 0; w < Words; ++w )
+            {
+                for ( uint32_t bits = masks[ c * Words + w ]; bits; bits &= bits - 1 )
+                {
+                    *out++ = uint16_t( w * 32 + size_t( __builtin_ctz( bits ) ) );
+                }
+            }
+        }
+    } );
+    return lists;
+}
+
+size_t countDifferingClusters( const ClusterLightLists& a, const ClusterLightLists& b )
+{
+    const size_t Clusters = std::max( a.counts.size(), b.counts.size() );
+    size_t differing = 0;
+    for ( size_t c = 0; c < Clusters; ++c )
+    {
+        if ( c >= a.counts.size() || c >= b.counts.size() || a.counts[ c ] != b.counts[ c ] )
+        {
+            ++differing;
+            continue;
+        }
+        const uint16_t* pa = a.indices.data() + a.offsets[ c ];
+        const uint16_t* pb = b.indices.data() + b.offsets[ c ];
+        differing += std::equal( pa, pa + a.counts[ c ], pb ) ? 0 : 1;
+    }
+    return differing;
+}
+
+std::vector<BenchResult> runClusterBinningBench( const std::vector<uint32_t>& lightCounts, uint32_t frames,
+                                                 JobSystem& jobs, size_t& problems )
+{
+    const ClusterGridDesc Grid;
+    const std::vector<ClusterBounds> Clusters = buildClusterBounds( Grid );
+    JobSystem serialJobs( 1 );
+
+    std::vector<BenchResult> results;
+    for ( uint32_t count : lightCounts )
+    {
+        ViewSpaceLightSetDesc desc;
+        desc.count = count;
+        std::vector<ClusterSphere> spheres = buildClusterSpheres( Grid, generateViewSpaceLights( desc ) );
+
+        ClusterLightLists lists;
+        std::vector<double> binMs;
+        for ( uint32_t frame = 0; frame < frames; ++frame )
+        {
+            uint64_t start = TraceRecorder::nowNs();
+            lists = binLights( Clusters, spheres, jobs );
+            binMs.push_back( double( TraceRecorder::nowNs() - start ) * 1e-6 );
+        }
+        problems += countDifferingClusters( lists, binLights( Clusters, spheres, serialJobs ) );
+
+        BenchResult& result = results.emplace_back();
+        result.scene = "lights-bin-" + std::to_string( count );
+        result.cpuEncode = summarizeFrameTimes( binMs );
+        result.memoryBytes = Clusters.size() * ( sizeof( ClusterBounds ) + 2 * sizeof( uint32_t ) ) +
+                             lists.indices.size() * sizeof( uint16_t ) + spheres.size() * sizeof( ClusterSphere );
+    }
+    return results;
+}
@@ -0,0 +1,87 @@
+//
+//  cluster_binner.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef cluster_binner_hpp
+#define cluster_binner_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Model/bench_suite.hpp"
+#include "Model/light_set.hpp"
+
+class JobSystem;
+
+// The view frustum split into tilesX x tilesY screen tiles and `slices`
+// exponentially spaced depth slices (froxels). Cluster (x, y, slice) has index
+// ( slice * tilesY + y ) * tilesX + x.
+struct ClusterGridDesc
+{
+    uint32_t tilesX         = 16;
+    uint32_t tilesY         = 9;
+    uint32_t slices         = 24;
+    float    nearZ          = 0.5f;
+    float    farZ           = 100.0f;
+    float    tanHalfFovY    = 0.57735f;     // 60 degree vertical field of view
+    float    aspect         = 16.0f / 9.0f;
+    float    quantum        = 1.0f / 64.0f; // view space units per binning unit
+};
+
+// Binning works on whole multiples of the quantum, stored as floats. Every
+// operation of the overlap test is then exact, so the CPU and GPU binners agree
+// bit for bit whatever the compiler does with FMAs or fast math. Bounds round
+// outwards and radii up, which keeps the test conservative.
+struct ClusterBounds
+{
+    float min[ 4 ];     // w unused, matches float4 in Shaders.metal
+    float max[ 4 ];
+};
+
+struct ClusterSphere
+{
+    float center[ 3 ];
+    float radius;
+};
+
+// Radii are clamped to this many quanta so the squared distances stay below
+// 2^24, where floats are still exact; 36 view space units at the default quantum.
+const float kMaxClusterRadiusQuanta = 2364.0f;
+
+// Light indices are 16 bits.
+const uint32_t kMaxBinnedLights = 65536;
+
+struct ClusterLightLists
+{
+    std::vector<uint32_t> offsets;      // per cluster, into indices; exclusive prefix sum of counts
+    std::vector<uint32_t> counts;
+    std::vector<uint16_t> indices;      // ascending within each cluster
+};
+
+uint32_t clusterCount( const ClusterGridDesc& grid );
+
+std::vector<ClusterBounds> buildClusterBounds( const ClusterGridDesc& grid );
+
+// Point lights bin by their range sphere, spot lights by the smallest sphere
+// around their cone when that is tighter.
+std::vector<ClusterSphere> buildClusterSpheres( const ClusterGridDesc& grid, const std::vector<ViewSpaceLight>& lights );
+
+// The CPU binner: per-cluster light bitmasks tested four lights at a time,
+// then counts, offsets and index lists, parallel over clusters on the job
+// system. It produces exactly what GpuClusterBinner does and is its test oracle.
+ClusterLightLists binLights( const std::vector<ClusterBounds>& clusters, const std::vector<ClusterSphere>& spheres,
+                             JobSystem& jobs );
+
+// Clusters whose light lists differ; 0 when the two binnings are identical.
+size_t countDifferingClusters( const ClusterLightLists& a, const ClusterLightLists& b );
+
+// Times binLights() on the default grid for each light count ("lights-bin-N").
+// problems counts clusters that differ from the same binning on a job system
+// with a single worker, so the split over clusters must not change the result.
+std::vector<BenchResult> runClusterBinningBench( const std::vector<uint32_t>& lightCounts, uint32_t frames,
+                                                 JobSystem& jobs, size_t& problems );
+
+#endif /* cluster_binner_hpp */
@@ -0,0 +1,339 @@
+//
+//  ecs.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "ecs.hpp"
+#include "Core/job_system.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <mutex>
+
+namespace
+{
+
+struct ComponentInfo
+{
+    size_t size;
+    size_t alignment;
+};
+
+std::mutex      gComponentMutex;
+ComponentInfo   gComponents[ kMaxComponentTypes ];
+uint32_t        gComponentCount = 0;
+
+// Columns start on 16 bytes at least, so kernels can use vector loads.
+const size_t kColumnAlignment = 16;
+const size_t kChunkAlignment = 64;
+
+inline size_t alignUp( size_t value, size_t alignment )
+{
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+template<typename F>
+void forEachComponent( ComponentMask mask, F&& f )
+{
+    while ( mask )
+    {
+        f( ComponentId( __builtin_ctzll( mask ) ) );
+        mask &= mask - 1;
+    }
+}
+
+}
+
+ComponentId registerComponent( size_t size, size_t alignment )
+{
+    std::lock_guard<std::mutex> lock( gComponentMutex );
+    if ( gComponentCount == kMaxComponentTypes )
+    {
+        __builtin_printf( "ECS: more than %u component types\n", kMaxComponentTypes );
+        assert( false );
+    }
+    gComponents[ gComponentCount ] = { size, alignment };
+    return gComponentCount++;
+}
+
+size_t componentSize( ComponentId id )
+{
+    return gComponents[ id ].size;
+}
+
+Archetype::Archetype( ComponentMask mask )
+: _mask( mask )
+{
+    // Entities first, then one array per component in id order. Start from
+    // the capacity the row size allows and shrink until the padding fits too;
+    // the offsets left behind are those of the capacity that fit.
+    size_t rowBytes = sizeof( Entity );
+    forEachComponent( mask, [&]( ComponentId id ) { rowBytes += gComponents[ id ].size; } );
+
+    auto layout = [&]( uint32_t capacity )
+    {
+        size_t end = sizeof( Entity ) * capacity;
+        forEachComponent( mask, [&]( ComponentId id )
+        {
+            _offsets[ id ] = uint32_t( alignUp( end, std::max( gComponents[ id ].alignment, kColumnAlignment ) ) );
+            end = _offsets[ id ] + gComponents[ id ].size * capacity;
+        } );
+        return end;
+    };
+
+    _capacity = uint32_t( kEcsChunkBytes / rowBytes );
+    while ( _capacity > 0 && layout( _capacity ) > kEcsChunkBytes )
+    {
+        --_capacity;
+    }
+    if ( _capacity == 0 )
+    {
+        __builtin_printf( "ECS: a %zu byte row does not fit in a %zu byte chunk\n", rowBytes, kEcsChunkBytes );
+        assert( false );
+    }
+}
+
+Archetype::~Archetype()
+{
+    for ( EcsChunk& chunk : _chunks )
+    {
+        free( chunk.pData );
+    }
+}
+
+uint8_t* Archetype::cell( uint32_t row, ComponentId id )
+{
+    return _chunks[ row / _capacity ].pData + _offsets[ id ] + size_t( row % _capacity ) * gComponents[ id ].size;
+}
+
+Entity& Archetype::entityAt( uint32_t row )
+{
+    return entities( _chunks[ row / _capacity ] )[ row % _capacity ];
+}
+
+uint32_t Archetype::pushRow( Entity entity )
+{
+    if ( _chunks.empty() || _chunks.back().count == _capacity )
+    {
+        void* pData = nullptr;
+        if ( posix_memalign( &pData, kChunkAlignment, kEcsChunkBytes ) != 0 )
+        {
+            __builtin_printf( "ECS: chunk allocation failed\n" );
+            assert( false );
+        }
+        _chunks.push_back( { static_cast<uint8_t*>( pData ), 0 } );
+    }
+
+    uint32_t row = uint32_t( _count++ );
+    ++_chunks.back().count;
+    entityAt( row ) = entity;
+    return row;
+}
+
+void Archetype::swapRemove( uint32_t row )
+{
+    uint32_t last = uint32_t( _count - 1 );
+    if ( row != last )
+    {
+        entityAt( row ) = entityAt( last );
+        forEachComponent( _mask, [&]( ComponentId id )
+        {
+            memcpy( cell( row, id ), cell( last, id ), gComponents[ id ].size );
+        } );
+    }
+
+    --_count;
+    if ( --_chunks.back().count == 0 )
+    {
+        free( _chunks.back().pData );
+        _chunks.pop_back();
+    }
+}
+
+void World::destroy( Entity entity )
+{
+    assert( alive( entity ) );
+    Record& record = _records[ entity.index ];
+    Archetype* pArchetype = record.pArchetype;
+    pArchetype->swapRemove( record.row );
+    if ( record.row < pArchetype->entityCount() )
+    {
+        _records[ pArchetype->entityAt( record.row ).index ].row = record.row;
+    }
+
+    // Bumping the generation makes every copy of the handle stale.
+    record.pArchetype = nullptr;
+    ++record.generation;
+    _freeIndices.push_back( entity.index );
+    --_liveCount;
+}
+
+bool World::alive( Entity entity ) const
+{
+    return entity.index < _records.size() && _records[ entity.index ].pArchetype
+        && _records[ entity.index ].generation == entity.generation;
+}
+
+size_t World::memoryBytes() const
+{
+    size_t bytes = 0;
+    for ( const std::unique_ptr<Archetype>& pArchetype : _archetypes )
+    {
+        bytes += pArchetype->chunkCount() * kEcsChunkBytes;
+    }
+    return bytes;
+}
+
+Archetype* World::archetype( ComponentMask mask )
+{
+    auto found = _byMask.find( mask );
+    if ( found != _byMask.end() )
+    {
+        return found->second;
+    }
+    Archetype* pArchetype = _archetypes.emplace_back( new Archetype( mask ) ).get();
+    _byMask.emplace( mask, pArchetype );
+    return pArchetype;
+}
+
+Entity World::allocate( Archetype* pArchetype )
+{
+    uint32_t index;
+    if ( _freeIndices.empty() )
+    {
+        index = uint32_t( _records.size() );
+        _records.push_back( { nullptr, 0, 0 } );
+    }
+    else
+    {
+        index = _freeIndices.back();
+        _freeIndices.pop_back();
+    }
+
+    Record& record = _records[ index ];
+    Entity entity = { index, record.generation };
+    record.pArchetype = pArchetype;
+    record.row = pArchetype->pushRow( entity );
+    ++_liveCount;
+    return entity;
+}
+
+void* World::component( Entity entity, ComponentId id )
+{
+    if ( !alive( entity ) )
+    {
+        return nullptr;
+    }
+    const Record& record = _records[ entity.index ];
+    return record.pArchetype->mask() & ( ComponentMask( 1 ) << id ) ? record.pArchetype->cell( record.row, id ) : nullptr;
+}
+
+void World::move( Entity entity, ComponentMask added, ComponentMask removed )
+{
+    assert( alive( entity ) );
+    Record& record = _records[ entity.index ];
+    Archetype* pFrom = record.pArchetype;
+    ComponentMask mask = ( pFrom->mask() | added ) & ~removed;
+    if ( mask == pFrom->mask() )
+    {
+        return;
+    }
+
+    Archetype* pTo = archetype( mask );
+    uint32_t row = pTo->pushRow( entity );
+    forEachComponent( pFrom->mask() & mask, [&]( ComponentId id )
+    {
+        memcpy( pTo->cell( row, id ), pFrom->cell( record.row, id ), gComponents[ id ].size );
+    } );
+
+    pFrom->swapRemove( record.row );
+    if ( record.row < pFrom->entityCount() )
+    {
+        _records[ pFrom->entityAt( record.row ).index ].row = record.row;
+    }
+    record.pArchetype = pTo;
+    record.row = row;
+}
+
+void SystemScheduler::schedule()
+{
+    std::vector<uint32_t> phaseOf( _systems.size(), 0 );
+    for ( size_t i = 0; i < _systems.size(); ++i )
+    {
+        const System& system = _systems[ i ];
+        for ( size_t j = 0; j < i; ++j )
+        {
+            const System& earlier = _systems[ j ];
+            bool conflict = ( system.writes & ( earlier.reads | earlier.writes ) ) || ( system.reads & earlier.writes );
+            if ( conflict )
+            {
+                phaseOf[ i ] = std::max( phaseOf[ i ], phaseOf[ j ] + 1 );
+            }
+        }
+        if ( phaseOf[ i ] >= _phases.size() )
+        {
+            _phases.resize( phaseOf[ i ] + 1 );
+        }
+        _phases[ phaseOf[ i ] ].push_back( uint32_t( i ) );
+    }
+}
+
+void SystemScheduler::run( World& world, JobSystem& jobs )
+{
+    TRACE_SCOPE( "SystemScheduler::run" );
+    if ( _phases.empty() )
+    {
+        schedule();
+    }
+
+    for ( const std::vector<uint32_t>& phase : _phases )
+    {
+        _work.clear();
+        for ( uint32_t system : phase )
+        {
+            world.eachArchetype( _systems[ system ].reads | _systems[ system ].writes, [&]( Archetype& archetype )
+            {
+                for ( size_t chunk = 0; chunk < archetype.chunkCount(); ++chunk )
+                {
+                    _work.push_back( { system, &archetype, uint32_t( chunk ) } );
+                }
+            } );
+        }
+
+        // A chunk is at most 16 KB of components, enough work to be one job.
+        jobs.parallelFor( _work.size(), 1, [&]( size_t begin, size_t end )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const WorkItem& item = _work[ i ];
+                _systems[ item.system ].kernel( *item.pArchetype, item.pArchetype->chunk( item.chunk ) );
+            }
+        } );
+    }
+}
+
+size_t SystemScheduler::phaseCount()
+{
+    if ( _phases.empty() )
+    {
+        schedule();
+    }
+    return _phases.size();
+}
+
+void SystemScheduler::printSchedule()
+{
+    for ( size_t phase = 0; phase < phaseCount(); ++phase )
+    {
+        __builtin_printf( "Phase %zu:", phase );
+        for ( uint32_t system : _phases[ phase ] )
+        {
+            __builtin_printf( " %s", _systems[ system ].name.c_str() );
+        }
+        __builtin_printf( "\n" );
+    }
+}
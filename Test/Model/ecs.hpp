@@ -0,0 +1,277 @@
+//
+//  ecs.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef ecs_hpp
+#define ecs_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+using ComponentId = uint32_t;
+using ComponentMask = uint64_t;
+
+const uint32_t kMaxComponentTypes = 64;
+const size_t kEcsChunkBytes = 16 * 1024;
+
+// Hands out the next id; componentId<T>() calls it once per type.
+ComponentId registerComponent( size_t size, size_t alignment );
+size_t componentSize( ComponentId id );
+
+// Components are plain data, so moving an entity between archetypes is a memcpy.
+template<typename T>
+ComponentId componentId()
+{
+    static_assert( std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>, "ECS components must be plain data" );
+    static const ComponentId Id = registerComponent( sizeof( T ), alignof( T ) );
+    return Id;
+}
+
+template<typename... Ts>
+ComponentMask componentMask()
+{
+    return ( ComponentMask( 0 ) | ... | ( ComponentMask( 1 ) << componentId<std::remove_const_t<Ts>>() ) );
+}
+
+struct Entity
+{
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==( const Entity& other ) const { return index == other.index && generation == other.generation; }
+};
+
+struct EcsChunk
+{
+    uint8_t* pData;
+    uint32_t count;
+};
+
+// Every entity with the same set of components lives in the same archetype, in
+// kEcsChunkBytes chunks. Inside a chunk each component is one contiguous array,
+// so iterating a component walks memory linearly. Removal moves the last entity
+// into the hole, so every chunk but the last is full.
+class Archetype
+{
+public:
+    explicit Archetype( ComponentMask mask );
+    ~Archetype();
+
+    ComponentMask mask() const { return _mask; }
+    uint32_t capacity() const { return _capacity; }
+    size_t entityCount() const { return _count; }
+    size_t chunkCount() const { return _chunks.size(); }
+    EcsChunk& chunk( size_t index ) { return _chunks[ index ]; }
+
+    Entity* entities( const EcsChunk& chunk ) const { return reinterpret_cast<Entity*>( chunk.pData ); }
+    void* column( const EcsChunk& chunk, ComponentId id ) const { return chunk.pData + _offsets[ id ]; }
+
+    template<typename T>
+    T* column( const EcsChunk& chunk ) const
+    {
+        return static_cast<T*>( column( chunk, componentId<std::remove_const_t<T>>() ) );
+    }
+
+private:
+    friend class World;
+
+    uint8_t* cell( uint32_t row, ComponentId id );
+    Entity& entityAt( uint32_t row );
+
+    // Appends a row for entity, adding a chunk when the last one is full.
+    uint32_t pushRow( Entity entity );
+
+    // Fills row with the last row and drops the last. The caller updates the
+    // record of the entity now at row, if any.
+    void swapRemove( uint32_t row );
+
+    ComponentMask               _mask;
+    uint32_t                    _capacity;
+    uint32_t                    _offsets[ kMaxComponentTypes ];     // byte offset of each component's array in a chunk
+    size_t                      _count = 0;
+    std::vector<EcsChunk>       _chunks;
+};
+
+// Entities and their components. Queries name the components they need and get
+// the matching arrays of every chunk, so the per-entity loop is the caller's
+// own inlined code rather than a call through an interface.
+class World
+{
+public:
+    World() { }
+    ~World() { }
+    World( const World& ) = delete;
+    World& operator=( const World& ) = delete;
+
+    template<typename... Ts>
+    Entity create( const Ts&... components )
+    {
+        Entity entity = allocate( archetype( componentMask<Ts...>() ) );
+        ( memcpy( component( entity, componentId<Ts>() ), &components, sizeof( Ts ) ), ... );
+        return entity;
+    }
+
+    void destroy( Entity entity );
+    bool alive( Entity entity ) const;
+
+    // Overwrites the component when the entity already has one.
+    template<typename T>
+    void add( Entity entity, const T& value )
+    {
+        const ComponentId Id = componentId<T>();
+        if ( !component( entity, Id ) )
+        {
+            move( entity, ComponentMask( 1 ) << Id, 0 );
+        }
+        memcpy( component( entity, Id ), &value, sizeof( T ) );
+    }
+
+    template<typename T>
+    void remove( Entity entity )
+    {
+        move( entity, 0, ComponentMask( 1 ) << componentId<T>() );
+    }
+
+    // nullptr when the entity has no T. Invalidated by any structural change.
+    template<typename T>
+    T* get( Entity entity )
+    {
+        return static_cast<T*>( component( entity, componentId<T>() ) );
+    }
+
+    size_t entityCount() const { return _liveCount; }
+    size_t archetypeCount() const { return _archetypes.size(); }
+    size_t memoryBytes() const;
+
+    // Archetypes holding at least the components in required.
+    template<typename F>
+    void eachArchetype( ComponentMask required, F&& f )
+    {
+        for ( const std::unique_ptr<Archetype>& pArchetype : _archetypes )
+        {
+            if ( ( pArchetype->mask() & required ) == required && pArchetype->entityCount() )
+            {
+                f( *pArchetype );
+            }
+        }
+    }
+
+    // f( count, Ts*... ) once per chunk holding every Ts.
+    template<typename... Ts, typename F>
+    void eachChunk( F&& f )
+    {
+        eachArchetype( componentMask<Ts...>(), [&]( Archetype& archetype )
+        {
+            for ( size_t i = 0; i < archetype.chunkCount(); ++i )
+            {
+                EcsChunk& chunk = archetype.chunk( i );
+                f( size_t( chunk.count ), archetype.template column<Ts>( chunk )... );
+            }
+        } );
+    }
+
+    // f( Ts&... ) once per entity holding every Ts.
+    template<typename... Ts, typename F>
+    void each( F&& f )
+    {
+        eachChunk<Ts...>( [&]( size_t count, Ts*... arrays )
+        {
+            for ( size_t i = 0; i < count; ++i )
+            {
+                f( arrays[ i ]... );
+            }
+        } );
+    }
+
+private:
+    struct Record
+    {
+        Archetype*  pArchetype;
+        uint32_t    row;
+        uint32_t    generation;
+    };
+
+    Archetype* archetype( ComponentMask mask );
+    Entity allocate( Archetype* pArchetype );
+    void* component( Entity entity, ComponentId id );
+
+    // Moves the entity to the archetype with added and without removed,
+    // carrying over the components both have.
+    void move( Entity entity, ComponentMask added, ComponentMask removed );
+
+    std::vector<std::unique_ptr<Archetype>>         _archetypes;
+    std::unordered_map<ComponentMask, Archetype*>   _byMask;
+    std::vector<Record>                             _records;
+    std::vector<uint32_t>                           _freeIndices;
+    size_t                                          _liveCount = 0;
+};
+
+// Systems are per-chunk kernels declared with the components they touch: const
+// components are read, the others written. A system goes into the phase after
+// the last earlier system it conflicts with (one writes what the other reads or
+// writes), so results match running them in the order they were added, while
+// systems that don't conflict run together. Each phase runs every matching
+// (system, chunk) pair as one job.
+//
+// Systems must not create or destroy entities or add or remove components.
+class SystemScheduler
+{
+public:
+    using Kernel = std::function<void( Archetype& archetype, EcsChunk& chunk )>;
+
+    // kernel( count, Ts*... ), called once per chunk holding every Ts.
+    template<typename... Ts, typename F>
+    void add( const char* name, F kernel )
+    {
+        System& system = _systems.emplace_back();
+        system.name = name;
+        system.reads = ( ComponentMask( 0 ) | ... | ( std::is_const_v<Ts> ? componentMask<Ts>() : 0 ) );
+        system.writes = ( ComponentMask( 0 ) | ... | ( std::is_const_v<Ts> ? 0 : componentMask<Ts>() ) );
+        system.kernel = [kernel]( Archetype& archetype, EcsChunk& chunk )
+        {
+            kernel( size_t( chunk.count ), archetype.template column<Ts>( chunk )... );
+        };
+        _phases.clear();
+    }
+
+    void run( World& world, JobSystem& jobs );
+
+    size_t phaseCount();
+    void printSchedule();
+
+private:
+    struct System
+    {
+        std::string     name;
+        ComponentMask   reads;
+        ComponentMask   writes;
+        Kernel          kernel;
+    };
+
+    struct WorkItem
+    {
+        uint32_t    system;
+        Archetype*  pArchetype;
+        uint32_t    chunk;
+    };
+
+    void schedule();
+
+    std::vector<System>                 _systems;
+    std::vector<std::vector<uint32_t>>  _phases;
+    std::vector<WorkItem>               _work;
+};
+
+#endif /* ecs_hpp */
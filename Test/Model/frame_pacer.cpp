@@ -0,0 +1,152 @@
+//
+//  frame_pacer.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+void push( std::vector<double>& ring, size_t& next, size_t capacity, double value )
+{
+    if ( ring.size() < capacity )
+    {
+        ring.push_back( value );
+    }
+    else
+    {
+        ring[ next ] = value;
+    }
+    next = ( next + 1 ) % capacity;
+}
+
+}
+
+FramePacer::FramePacer( const FramePacerSettings& settings )
+: _settings( settings )
+{
+    _settings.window = std::max( _settings.window, 1u );
+    setDisplayHz( settings.displayHz );
+}
+
+void FramePacer::setDisplayHz( uint32_t displayHz )
+{
+    _settings.displayHz = std::max( displayHz, 1u );
+    _rates.clear();
+    for ( uint32_t divisor = 1; divisor <= _settings.displayHz; ++divisor )
+    {
+        uint32_t fps = _settings.displayHz / divisor;
+        if ( _settings.displayHz % divisor != 0 )
+        {
+            continue;
+        }
+        if ( fps < _settings.minFps && !_rates.empty() )
+        {
+            break;
+        }
+        _rates.push_back( fps );
+    }
+    _rateIndex = 0;
+    _framesOfSlack = 0;
+}
+
+double FramePacer::budgetMs( uint32_t fps ) const
+{
+    return 1000.0 / double( fps ) * ( 1.0 - double( _settings.headroom ) );
+}
+
+double FramePacer::percentile90( const std::vector<double>& samples )
+{
+    if ( samples.empty() )
+    {
+        return 0.0;
+    }
+    std::vector<double> sorted = samples;
+    size_t rank = std::min( sorted.size() - 1, size_t( std::ceil( 0.9 * double( sorted.size() ) ) ) - 1 );
+    std::nth_element( sorted.begin(), sorted.begin() + rank, sorted.end() );
+    return sorted[ rank ];
+}
+
+void FramePacer::addCpuFrame( double ms )
+{
+    push( _cpuMs, _cpuNext, _settings.window, ms );
+    update();
+}
+
+void FramePacer::addGpuFrame( double ms )
+{
+    push( _gpuMs, _gpuNext, _settings.window, ms );
+}
+
+void FramePacer::addPresentInterval( double ms )
+{
+    push( _presentMs, _presentNext, _settings.window, ms );
+}
+
+void FramePacer::update()
+{
+    if ( _cpuMs.size() < _settings.window )
+    {
+        return;
+    }
+
+    const double Cost = std::max( percentile90( _cpuMs ), percentile90( _gpuMs ) );
+    if ( Cost > budgetMs( targetFps() ) )
+    {
+        // Drop straight to the fastest rate that fits.
+        while ( _rateIndex + 1 < _rates.size() && Cost > budgetMs( _rates[ _rateIndex ] ) )
+        {
+            ++_rateIndex;
+        }
+        _framesOfSlack = 0;
+    }
+    else if ( _rateIndex > 0 && Cost <= budgetMs( _rates[ _rateIndex - 1 ] ) )
+    {
+        if ( ++_framesOfSlack >= _settings.raiseAfterFrames )
+        {
+            --_rateIndex;
+            _framesOfSlack = 0;
+        }
+    }
+    else
+    {
+        _framesOfSlack = 0;
+    }
+}
+
+uint32_t FramePacer::maxFramesInFlight() const
+{
+    if ( _mode == PacingMode::Throughput )
+    {
+        return 3;
+    }
+    // Serial CPU then GPU work fits the interval: no need to queue a second frame.
+    return percentile90( _cpuMs ) + percentile90( _gpuMs ) <= budgetMs( targetFps() ) ? 1 : 2;
+}
+
+double FramePacer::judderMs() const
+{
+    if ( _presentMs.size() < 2 )
+    {
+        return 0.0;
+    }
+    double mean = 0.0;
+    for ( double ms : _presentMs )
+    {
+        mean += ms;
+    }
+    mean /= double( _presentMs.size() );
+
+    double variance = 0.0;
+    for ( double ms : _presentMs )
+    {
+        variance += ( ms - mean ) * ( ms - mean );
+    }
+    return std::sqrt( variance / double( _presentMs.size() ) );
+}
@@ -0,0 +1,78 @@
+//
+//  frame_pacer.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef frame_pacer_hpp
+#define frame_pacer_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class PacingMode
+{
+    Latency,        // as few frames queued as the frame cost allows
+    Throughput,     // always triple buffer, maximizing GPU occupancy
+};
+
+struct FramePacerSettings
+{
+    uint32_t displayHz        = 60;     // the display's maximum refresh rate
+    uint32_t minFps           = 20;     // never pace below this
+    float    headroom         = 0.1f;   // fraction of each interval kept free
+    uint32_t window           = 30;     // frames in the p90 window
+    uint32_t raiseAfterFrames = 120;    // frames of slack needed before raising the rate
+};
+
+// Picks a frame rate the renderer can hold steadily, from the rates that divide
+// the display refresh evenly (120, 60, 40, 30... on a 120 Hz display), so every
+// frame stays on screen for the same number of refreshes.
+//
+// The rate drops as soon as the p90 of max(CPU, GPU) frame time no longer fits
+// the interval and rises again only after raiseAfterFrames frames that would fit
+// the faster one. The pacer also decides how many frames may be in flight: in
+// Latency mode one when CPU and GPU together fit the interval, two otherwise;
+// in Throughput mode three.
+class FramePacer
+{
+public:
+    explicit FramePacer( const FramePacerSettings& settings = FramePacerSettings() );
+
+    void setDisplayHz( uint32_t displayHz );
+    void setMode( PacingMode mode ) { _mode = mode; }
+    PacingMode mode() const         { return _mode; }
+
+    void addCpuFrame( double ms );
+    void addGpuFrame( double ms );
+    void addPresentInterval( double ms );
+
+    uint32_t targetFps() const                  { return _rates[ _rateIndex ]; }
+    double targetIntervalSeconds() const        { return 1.0 / double( targetFps() ); }
+    uint32_t maxFramesInFlight() const;
+
+    // Standard deviation of recent on-screen frame intervals; 0 means no judder.
+    double judderMs() const;
+
+private:
+    static double percentile90( const std::vector<double>& samples );
+    double budgetMs( uint32_t fps ) const;
+    void update();
+
+    FramePacerSettings      _settings;
+    PacingMode              _mode = PacingMode::Latency;
+    std::vector<uint32_t>   _rates;             // descending
+    size_t                  _rateIndex = 0;
+    uint32_t                _framesOfSlack = 0;
+
+    std::vector<double>     _cpuMs;             // rings of `window` samples
+    std::vector<double>     _gpuMs;
+    std::vector<double>     _presentMs;
+    size_t                  _cpuNext = 0;
+    size_t                  _gpuNext = 0;
+    size_t                  _presentNext = 0;
+};
+
+#endif /* frame_pacer_hpp */
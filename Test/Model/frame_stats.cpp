@@ -0,0 +1,53 @@
+//
+//  frame_stats.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "frame_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+FrameTimeStats summarizeFrameTimes( const std::vector<double>& frameMs )
+{
+    FrameTimeStats stats;
+    if ( frameMs.empty() )
+    {
+        return stats;
+    }
+
+    std::vector<double> sorted = frameMs;
+    std::sort( sorted.begin(), sorted.end() );
+
+    auto percentile = [&sorted]( double p )
+    {
+        size_t rank = size_t( std::ceil( p * double( sorted.size() ) ) );
+        return sorted[ std::min( std::max< size_t >( rank, 1 ), sorted.size() ) - 1 ];
+    };
+
+    double total = 0.0;
+    for ( double ms : sorted )
+    {
+        total += ms;
+    }
+
+    stats.frames = sorted.size();
+    stats.totalSeconds = total * 1e-3;
+    stats.fps = total > 0.0 ? double( sorted.size() ) / stats.totalSeconds : 0.0;
+    stats.meanMs = total / double( sorted.size() );
+    stats.minMs = sorted.front();
+    stats.p50Ms = percentile( 0.50 );
+    stats.p90Ms = percentile( 0.90 );
+    stats.p99Ms = percentile( 0.99 );
+    stats.maxMs = sorted.back();
+    return stats;
+}
+
+void printFrameTimeStats( const char* label, const FrameTimeStats& stats )
+{
+    __builtin_printf( "%s: %zu frames in %.2f s, %.1f fps | mean %.3f ms, min %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+                      label, stats.frames, stats.totalSeconds, stats.fps,
+                      stats.meanMs, stats.minMs, stats.p50Ms, stats.p90Ms, stats.p99Ms, stats.maxMs );
+}
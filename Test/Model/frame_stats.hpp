@@ -0,0 +1,32 @@
+//
+//  frame_stats.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef frame_stats_hpp
+#define frame_stats_hpp
+
+#include <cstddef>
+#include <vector>
+
+struct FrameTimeStats
+{
+    size_t frames       = 0;
+    double totalSeconds = 0.0;
+    double fps          = 0.0;      // frames / totalSeconds
+    double meanMs       = 0.0;
+    double minMs        = 0.0;
+    double p50Ms        = 0.0;
+    double p90Ms        = 0.0;
+    double p99Ms        = 0.0;
+    double maxMs        = 0.0;
+};
+
+// Summarizes per-frame times in milliseconds. Percentiles are nearest-rank.
+FrameTimeStats summarizeFrameTimes( const std::vector<double>& frameMs );
+
+void printFrameTimeStats( const char* label, const FrameTimeStats& stats );
+
+#endif /* frame_stats_hpp */
@@ -0,0 +1,162 @@
+//
+//  gpu_selection.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "gpu_selection.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+
+namespace
+{
+
+const double kGiB = 1024.0 * 1024.0 * 1024.0;
+
+// Removable GPUs can be unplugged mid-frame, so they only get work that can be redone.
+const double kRemovablePenalty = 0.5;
+
+}
+
+double estimateGpuSpeed( const GpuDeviceInfo& device )
+{
+    // Working set size tracks the tier of the part closely enough to rank GPUs
+    // of one machine; family and power class refine it.
+    double speed = 0.5 + device.workingSetBytes / ( 8.0 * kGiB );
+    speed *= device.lowPower ? 0.35 : 1.0;
+    speed *= device.appleFamily >= 7 ? 1.5 : 1.0;
+    return speed;
+}
+
+double scoreDisplayGpu( const GpuDeviceInfo& device, GpuPreference preference )
+{
+    if ( device.headless || ( !device.appleFamily && device.macFamily < 2 ) )
+    {
+        return -1.0;
+    }
+
+    double score = estimateGpuSpeed( device );
+    if ( preference == GpuPreference::LowPower )
+    {
+        score = device.lowPower ? 10.0 + score : score;
+    }
+    score *= device.removable ? kRemovablePenalty : 1.0;
+
+    // The system default already drives the main display; moving off it costs
+    // a copy per frame, so it wins ties.
+    return score + ( device.systemDefault ? 0.25 : 0.0 );
+}
+
+double scoreOffscreenGpu( const GpuDeviceInfo& device )
+{
+    if ( !device.appleFamily && device.macFamily < 2 )
+    {
+        return -1.0;
+    }
+    return estimateGpuSpeed( device ) * ( device.removable ? kRemovablePenalty : 1.0 );
+}
+
+GpuSelection selectGpus( const std::vector<GpuDeviceInfo>& devices, GpuPreference preference )
+{
+    GpuSelection selection;
+    double best = 0.0;
+    for ( size_t i = 0; i < devices.size(); ++i )
+    {
+        double score = scoreDisplayGpu( devices[ i ], preference );
+        if ( score >= 0.0 && ( selection.display < 0 || score > best ) )
+        {
+            selection.display = int( i );
+            best = score;
+        }
+    }
+    if ( selection.display < 0 )
+    {
+        return selection;
+    }
+
+    // An integrated GPU shares power and memory bandwidth with the CPU, and
+    // with the display GPU too when that one is integrated, so it only helps
+    // next to a discrete display device.
+    const GpuDeviceInfo& display = devices[ selection.display ];
+    best = 0.0;
+    for ( size_t i = 0; i < devices.size(); ++i )
+    {
+        const GpuDeviceInfo& device = devices[ i ];
+        if ( int( i ) == selection.display || ( device.lowPower && display.lowPower ) || ( device.unifiedMemory && display.unifiedMemory ) )
+        {
+            continue;
+        }
+        double score = scoreOffscreenGpu( device );
+        if ( score > best )
+        {
+            selection.offscreen = int( i );
+            best = score;
+        }
+    }
+    return selection;
+}
+
+std::vector<JobPlacement> scheduleOffscreenJobs( const std::vector<OffscreenJob>& jobs,
+                                                 const std::vector<GpuDeviceInfo>& devices,
+                                                 const GpuSelection& selection, double displayBusyMs )
+{
+    std::vector<JobPlacement> placements;
+    if ( selection.display < 0 )
+    {
+        return placements;
+    }
+
+    std::vector<size_t> order( jobs.size() );
+    std::iota( order.begin(), order.end(), size_t( 0 ) );
+    std::stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b ) { return jobs[ a ].costMs > jobs[ b ].costMs; } );
+
+    // Results made on the secondary device cross to system memory and back,
+    // at the slower of the two links.
+    double transferBytesPerMs = 0.0;
+    if ( selection.offscreen >= 0 )
+    {
+        uint64_t from = devices[ selection.offscreen ].transferBytesPerSec;
+        uint64_t to = devices[ selection.display ].transferBytesPerSec;
+        uint64_t link = from && to ? std::min( from, to ) : std::max( from, to );
+        transferBytesPerMs = link ? double( link ) * 1e-3 : 8e6;    // 8 GB/s when unknown
+    }
+
+    double displayFree = displayBusyMs, offscreenFree = 0.0;
+    const double DisplaySpeed = estimateGpuSpeed( devices[ selection.display ] );
+    for ( size_t job : order )
+    {
+        JobPlacement onDisplay = { job, selection.display, displayFree, displayFree + jobs[ job ].costMs / DisplaySpeed, 0.0 };
+        JobPlacement placement = onDisplay;
+        if ( selection.offscreen >= 0 )
+        {
+            double run = jobs[ job ].costMs / estimateGpuSpeed( devices[ selection.offscreen ] );
+            double transfer = double( jobs[ job ].resultBytes ) / transferBytesPerMs;
+            JobPlacement offscreen = { job, selection.offscreen, offscreenFree, offscreenFree + run + transfer, transfer };
+            placement = offscreen.endMs < onDisplay.endMs ? offscreen : onDisplay;
+        }
+
+        // The transfer happens on the copy engines, so the queue is free again once the job has run.
+        ( placement.device == selection.display ? displayFree : offscreenFree ) = placement.endMs - placement.transferMs;
+        placements.push_back( placement );
+    }
+
+    std::sort( placements.begin(), placements.end(), []( const JobPlacement& a, const JobPlacement& b ) { return a.job < b.job; } );
+    return placements;
+}
+
+void printGpuSelection( const std::vector<GpuDeviceInfo>& devices, const GpuSelection& selection )
+{
+    for ( size_t i = 0; i < devices.size(); ++i )
+    {
+        const GpuDeviceInfo& device = devices[ i ];
+        const char* role = int( i ) == selection.display ? "display" : ( int( i ) == selection.offscreen ? "offscreen" : "-" );
+        __builtin_printf( "  %-9s %-28s display %6.2f offscreen %6.2f  %.1f GB%s%s%s%s\n", role, device.name.c_str(),
+                          scoreDisplayGpu( device, GpuPreference::Performance ), scoreOffscreenGpu( device ),
+                          double( device.workingSetBytes ) / kGiB,
+                          device.lowPower ? " low-power" : "", device.headless ? " headless" : "",
+                          device.removable ? " removable" : "", device.unifiedMemory ? " unified" : "" );
+    }
+}
@@ -0,0 +1,85 @@
+//
+//  gpu_selection.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef gpu_selection_hpp
+#define gpu_selection_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What device selection and work distribution need to know about a GPU. Filled
+// from an MTL::Device by describeDevice(), or by hand for the host tests.
+struct GpuDeviceInfo
+{
+    std::string name;
+    uint64_t    registryId          = 0;
+    uint32_t    appleFamily         = 0;    // highest MTL::GPUFamilyAppleN supported, 0 for none
+    uint32_t    macFamily           = 0;    // highest MTL::GPUFamilyMacN supported, 0 for none
+    uint64_t    workingSetBytes     = 0;    // recommendedMaxWorkingSetSize
+    uint64_t    transferBytesPerSec = 0;    // to system memory; 0 when unified or unknown
+    bool        lowPower            = false;
+    bool        headless            = false;
+    bool        removable           = false;
+    bool        unifiedMemory       = false;
+    bool        raytracing          = false;
+    bool        systemDefault       = false;
+};
+
+enum class GpuPreference
+{
+    Performance,    // fastest device that can drive a display
+    LowPower        // integrated device when there is one
+};
+
+// Higher is better; negative means the device can't take the role at all.
+// The display device must drive a display; the offscreen one needn't.
+double scoreDisplayGpu( const GpuDeviceInfo& device, GpuPreference preference );
+double scoreOffscreenGpu( const GpuDeviceInfo& device );
+
+struct GpuSelection
+{
+    int display   = -1;     // index into the device list
+    int offscreen = -1;     // a second device for offscreen work, -1 if none is worth it
+};
+
+// A secondary device is only chosen when it is not the display device and is
+// not a low power part sharing the display device's power budget.
+GpuSelection selectGpus( const std::vector<GpuDeviceInfo>& devices, GpuPreference preference );
+
+// One piece of offscreen work: its GPU time on a reference device and the bytes
+// that have to reach the display device when it runs elsewhere.
+struct OffscreenJob
+{
+    std::string name;
+    double      costMs;
+    uint64_t    resultBytes;
+};
+
+struct JobPlacement
+{
+    size_t  job;
+    int     device;         // index into the device list
+    double  startMs;        // on that device's queue
+    double  endMs;          // including the transfer when off the display device
+    double  transferMs;
+};
+
+// Relative throughput used by the scheduler, 1.0 being the reference device.
+double estimateGpuSpeed( const GpuDeviceInfo& device );
+
+// Greedy list scheduling, longest jobs first: each job goes to whichever of
+// the two devices would finish it, transfer included, first. displayBusyMs is
+// the frame work the display device already has queued.
+std::vector<JobPlacement> scheduleOffscreenJobs( const std::vector<OffscreenJob>& jobs,
+                                                 const std::vector<GpuDeviceInfo>& devices,
+                                                 const GpuSelection& selection, double displayBusyMs );
+
+void printGpuSelection( const std::vector<GpuDeviceInfo>& devices, const GpuSelection& selection );
+
+#endif /* gpu_selection_hpp */
@@ -0,0 +1,77 @@
+//
+//  light_set.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "light_set.hpp"
+
+#include <cmath>
+
+namespace
+{
+
+// xorshift32, uniform in [0, 1).
+float nextUnit( uint32_t& state )
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return float( state >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+}
+
+std::vector<PointLight> generateLights( const LightSetDesc& desc )
+{
+    std::vector<PointLight> lights( desc.count );
+    uint32_t state = desc.seed * 2654435761u + 1u;
+    for ( PointLight& light : lights )
+    {
+        light.position[ 0 ] = nextUnit( state ) * 2.0f - 1.0f;
+        light.position[ 1 ] = nextUnit( state ) * 2.0f - 1.0f;
+        light.position[ 2 ] = desc.minDepth + nextUnit( state ) * ( desc.maxDepth - desc.minDepth );
+        light.radius = desc.minRadius + nextUnit( state ) * ( desc.maxRadius - desc.minRadius );
+        for ( float& channel : light.color )
+        {
+            channel = 0.2f + 0.8f * nextUnit( state );
+        }
+        light.intensity = 1.0f;
+    }
+    return lights;
+}
+
+std::vector<ViewSpaceLight> generateViewSpaceLights( const ViewSpaceLightSetDesc& desc )
+{
+    std::vector<ViewSpaceLight> lights( desc.count );
+    uint32_t state = desc.seed * 2654435761u + 1u;
+    for ( ViewSpaceLight& light : lights )
+    {
+        float z = desc.nearZ + nextUnit( state ) * ( desc.farZ - desc.nearZ );
+        light.position[ 0 ] = ( nextUnit( state ) * 2.0f - 1.0f ) * z * desc.tanHalfFovY * desc.aspect;
+        light.position[ 1 ] = ( nextUnit( state ) * 2.0f - 1.0f ) * z * desc.tanHalfFovY;
+        light.position[ 2 ] = z;
+        light.range = desc.minRange + nextUnit( state ) * ( desc.maxRange - desc.minRange );
+
+        light.direction[ 0 ] = 0.0f;
+        light.direction[ 1 ] = 0.0f;
+        light.direction[ 2 ] = 1.0f;
+        light.cosHalfAngle = -1.0f;
+        if ( nextUnit( state ) < desc.spotFraction )
+        {
+            float d[ 3 ] = { nextUnit( state ) * 2.0f - 1.0f, nextUnit( state ) * 2.0f - 1.0f, nextUnit( state ) * 2.0f - 1.0f };
+            float length = std::sqrt( d[ 0 ] * d[ 0 ] + d[ 1 ] * d[ 1 ] + d[ 2 ] * d[ 2 ] );
+            if ( length > 1e-3f )
+            {
+                for ( int i = 0; i < 3; ++i )
+                {
+                    light.direction[ i ] = d[ i ] / length;
+                }
+            }
+            // Half angles between 15 and 60 degrees.
+            light.cosHalfAngle = std::cos( ( 15.0f + 45.0f * nextUnit( state ) ) * float( M_PI ) / 180.0f );
+        }
+    }
+    return lights;
+}
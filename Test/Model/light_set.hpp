@@ -0,0 +1,62 @@
+//
+//  light_set.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef light_set_hpp
+#define light_set_hpp
+
+#include <cstdint>
+#include <vector>
+
+// Layout matches PointLight in Shaders.metal. Positions are in the light test
+// scene's space: x and y in normalized device coordinates, z in depth [0, 1].
+struct PointLight
+{
+    float position[ 3 ];
+    float radius;
+    float color[ 3 ];
+    float intensity;
+};
+
+struct LightSetDesc
+{
+    uint32_t count      = 256;
+    uint32_t seed       = 1;
+    float    minRadius  = 0.05f;
+    float    maxRadius  = 0.15f;
+    float    minDepth   = 0.3f;     // lights hover around the test scene's surface
+    float    maxDepth   = 0.7f;
+};
+
+// Deterministic for a given description, so runs stay comparable.
+std::vector<PointLight> generateLights( const LightSetDesc& desc );
+
+// Point or spot light in view space, with the camera at the origin looking
+// down +z, for clustered shading.
+struct ViewSpaceLight
+{
+    float position[ 3 ];
+    float range;
+    float direction[ 3 ];   // spot axis, normalized; unused for point lights
+    float cosHalfAngle;     // -1 for point lights
+};
+
+struct ViewSpaceLightSetDesc
+{
+    uint32_t count          = 4096;
+    uint32_t seed           = 1;
+    float    spotFraction   = 0.5f;
+    float    minRange       = 0.5f;
+    float    maxRange       = 4.0f;
+    float    nearZ          = 1.0f;         // lights are spread through this depth range
+    float    farZ           = 60.0f;
+    float    tanHalfFovY    = 0.57735f;     // of the frustum they are placed in
+    float    aspect         = 16.0f / 9.0f;
+};
+
+std::vector<ViewSpaceLight> generateViewSpaceLights( const ViewSpaceLightSetDesc& desc );
+
+#endif /* light_set_hpp */
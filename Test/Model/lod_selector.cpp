@@ -0,0 +1,203 @@
+//
+//  lod_selector.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "lod_selector.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+float lodProjectionScale( const LodViewParams& params )
+{
+    return params.viewportHeight / ( 2.0f * std::tan( params.verticalFov * 0.5f ) );
+}
+
+uint32_t selectLod( const float* lodErrors, uint32_t lodCount,
+                    float distance, float boundingRadius,
+                    float projectionScale, const LodViewParams& params,
+                    uint32_t previousLod )
+{
+    if ( lodCount == 0 )
+    {
+        return 0;
+    }
+
+    // Measure from the closest point of the bounding sphere; inside it everything is full detail.
+    float d = distance - boundingRadius;
+    if ( d <= 0.0f )
+    {
+        return 0;
+    }
+
+    float pixelsPerUnit = projectionScale / d;
+    uint32_t lod = 0;
+    for ( uint32_t i = lodCount; i-- > 0; )
+    {
+        float threshold = params.pixelErrorThreshold;
+        if ( i > previousLod )
+        {
+            threshold *= 1.0f - params.hysteresis;
+        }
+        if ( lodErrors[ i ] * pixelsPerUnit <= threshold )
+        {
+            lod = i;
+            break;
+        }
+    }
+    return lod;
+}
+
+LodResidency::LodResidency( size_t budgetBytes )
+: _budgetBytes( budgetBytes )
+{
+}
+
+uint32_t LodResidency::addMesh( const std::vector<size_t>& lodSizes )
+{
+    uint32_t mesh = uint32_t( _meshes.size() );
+    std::vector<Level>& levels = _meshes.emplace_back( lodSizes.size() );
+    for ( size_t i = 0; i < lodSizes.size(); ++i )
+    {
+        levels[ i ].sizeInBytes = lodSizes[ i ];
+    }
+
+    if ( !levels.empty() )
+    {
+        levels.back().pinned = true;
+        _pending.push_back( { mesh, uint32_t( levels.size() - 1 ), FLT_MAX } );
+    }
+    return mesh;
+}
+
+bool LodResidency::isResident( uint32_t mesh, uint32_t lod ) const
+{
+    return _meshes[ mesh ][ lod ].resident;
+}
+
+uint32_t LodResidency::request( uint32_t mesh, uint32_t desiredLod, float priority )
+{
+    std::vector<Level>& levels = _meshes[ mesh ];
+    uint32_t count = uint32_t( levels.size() );
+    desiredLod = std::min( desiredLod, count - 1 );
+
+    Level& desired = levels[ desiredLod ];
+    desired.lastUsedFrame = _frame;
+    if ( desired.resident )
+    {
+        return desiredLod;
+    }
+
+    _pending.push_back( { mesh, desiredLod, priority } );
+
+    uint32_t fallback = desiredLod;
+    for ( uint32_t i = desiredLod + 1; i < count; ++i )
+    {
+        if ( levels[ i ].resident )
+        {
+            fallback = i;
+            break;
+        }
+    }
+    if ( fallback == desiredLod )
+    {
+        for ( uint32_t i = desiredLod; i-- > 0; )
+        {
+            if ( levels[ i ].resident )
+            {
+                fallback = i;
+                break;
+            }
+        }
+    }
+
+    levels[ fallback ].lastUsedFrame = _frame;
+    return fallback;
+}
+
+void LodResidency::loadFailed( uint32_t mesh, uint32_t lod )
+{
+    Level& level = _meshes[ mesh ][ lod ];
+    if ( level.resident )
+    {
+        level.resident = false;
+        _residentBytes -= level.sizeInBytes;
+    }
+}
+
+void LodResidency::update( std::vector<Change>& loads, std::vector<Change>& evictions )
+{
+    loads.clear();
+    evictions.clear();
+
+    std::stable_sort( _pending.begin(), _pending.end(),
+                      []( const Pending& a, const Pending& b ) { return a.priority > b.priority; } );
+
+    // Eviction candidates: unpinned resident levels not touched this frame, oldest first.
+    struct Candidate
+    {
+        uint64_t lastUsedFrame;
+        uint32_t mesh;
+        uint32_t lod;
+    };
+    std::vector<Candidate> candidates;
+    for ( uint32_t m = 0; m < _meshes.size(); ++m )
+    {
+        for ( uint32_t l = 0; l < _meshes[ m ].size(); ++l )
+        {
+            const Level& level = _meshes[ m ][ l ];
+            if ( level.resident && !level.pinned && level.lastUsedFrame < _frame )
+            {
+                candidates.push_back( { level.lastUsedFrame, m, l } );
+            }
+        }
+    }
+    std::sort( candidates.begin(), candidates.end(),
+               []( const Candidate& a, const Candidate& b ) { return a.lastUsedFrame < b.lastUsedFrame; } );
+    size_t nextCandidate = 0;
+
+    for ( const Pending& p : _pending )
+    {
+        Level& level = _meshes[ p.mesh ][ p.lod ];
+        if ( level.resident )
+        {
+            continue;
+        }
+
+        if ( !level.pinned && _residentBytes + level.sizeInBytes > _budgetBytes )
+        {
+            // Count how many of the remaining candidates it would take first, so
+            // nothing is evicted for a level that still would not fit.
+            size_t freed = 0;
+            size_t lastCandidate = nextCandidate;
+            while ( _residentBytes - freed + level.sizeInBytes > _budgetBytes && lastCandidate < candidates.size() )
+            {
+                const Candidate& c = candidates[ lastCandidate++ ];
+                freed += _meshes[ c.mesh ][ c.lod ].sizeInBytes;
+            }
+            if ( _residentBytes - freed + level.sizeInBytes > _budgetBytes )
+            {
+                continue;
+            }
+
+            for ( ; nextCandidate < lastCandidate; ++nextCandidate )
+            {
+                const Candidate& c = candidates[ nextCandidate ];
+                Level& victim = _meshes[ c.mesh ][ c.lod ];
+                victim.resident = false;
+                _residentBytes -= victim.sizeInBytes;
+                evictions.push_back( { c.mesh, c.lod } );
+            }
+        }
+
+        level.resident = true;
+        _residentBytes += level.sizeInBytes;
+        loads.push_back( { p.mesh, p.lod } );
+    }
+
+    _pending.clear();
+    ++_frame;
+}
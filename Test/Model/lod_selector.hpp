@@ -0,0 +1,92 @@
+//
+//  lod_selector.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef lod_selector_hpp
+#define lod_selector_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct LodViewParams
+{
+    float viewportHeight      = 512.0f;   // in pixels
+    float verticalFov         = 1.0472f;  // in radians
+    float pixelErrorThreshold = 1.0f;     // largest acceptable projected error, in pixels
+    float hysteresis          = 0.2f;     // fraction of the threshold required before coarsening
+};
+
+// Converts an object-space error at unit distance into pixels for the given view.
+float lodProjectionScale( const LodViewParams& params );
+
+// Picks the coarsest level whose projected error stays under the pixel threshold.
+// lodErrors must be non-decreasing (LOD 0 is the finest). Switching to a coarser level
+// than previousLod needs the error to clear the threshold by the hysteresis margin, so
+// objects sitting on a boundary do not pop back and forth every frame.
+uint32_t selectLod( const float* lodErrors, uint32_t lodCount,
+                    float distance, float boundingRadius,
+                    float projectionScale, const LodViewParams& params,
+                    uint32_t previousLod );
+
+// Tracks which LOD of each mesh is resident on the GPU under a fixed byte budget.
+// The coarsest level of every mesh is pinned so there is always something to draw;
+// finer levels are loaded by priority and evicted least-recently-used first.
+class LodResidency
+{
+public:
+    struct Change
+    {
+        uint32_t mesh;
+        uint32_t lod;
+    };
+
+    explicit LodResidency( size_t budgetBytes );
+
+    // Registers a mesh with the size of each LOD and returns its handle.
+    // The coarsest level is reported by the next update() as a load.
+    uint32_t addMesh( const std::vector<size_t>& lodSizes );
+
+    // Records the level wanted this frame and returns the closest resident level
+    // to draw in the meantime, preferring coarser over finer.
+    uint32_t request( uint32_t mesh, uint32_t desiredLod, float priority );
+
+    // Ends the frame: decides which pending levels to stream in and which resident
+    // levels to drop to stay within budget. Evictions must be applied before loads.
+    void update( std::vector<Change>& loads, std::vector<Change>& evictions );
+
+    // Takes back a load update() reported whose data never arrived, so the level
+    // is requested again and coarser levels are drawn in the meantime.
+    void loadFailed( uint32_t mesh, uint32_t lod );
+
+    size_t budgetBytes() const   { return _budgetBytes; }
+    size_t residentBytes() const { return _residentBytes; }
+    bool isResident( uint32_t mesh, uint32_t lod ) const;
+
+private:
+    struct Level
+    {
+        size_t   sizeInBytes   = 0;
+        uint64_t lastUsedFrame = 0;
+        bool     resident      = false;
+        bool     pinned        = false;
+    };
+
+    struct Pending
+    {
+        uint32_t mesh;
+        uint32_t lod;
+        float    priority;
+    };
+
+    std::vector<std::vector<Level>> _meshes;
+    std::vector<Pending>            _pending;
+    size_t                          _budgetBytes;
+    size_t                          _residentBytes = 0;
+    uint64_t                        _frame = 1;
+};
+
+#endif /* lod_selector_hpp */
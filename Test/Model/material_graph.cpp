@@ -0,0 +1,208 @@
+//
+//  material_graph.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "material_graph.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace
+{
+
+const uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+const uint64_t kFnvPrime = 0x100000001b3ull;
+
+uint64_t hashBytes( uint64_t hash, const void* pData, size_t count )
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>( pData );
+    for ( size_t i = 0; i < count; ++i )
+    {
+        hash = ( hash ^ pBytes[ i ] ) * kFnvPrime;
+    }
+    return hash;
+}
+
+const MaterialNodeKind* findKind( const std::string& function )
+{
+    for ( const MaterialNodeKind& kind : materialNodeKinds() )
+    {
+        if ( function == kind.function )
+        {
+            return &kind;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+const std::vector<MaterialNodeKind>& materialNodeKinds()
+{
+    // Patterns read the uv, lighting reads the normal, tint reads the params.
+    static const std::vector<MaterialNodeKind> Kinds = {
+        { "nodeChecker",    1 },    // ( uv )
+        { "nodeNoise",      1 },    // ( uv )
+        { "nodeStripes",    1 },    // ( uv )
+        { "nodeFresnel",    1 },    // ( normal )
+        { "nodeDesaturate", 1 },    // ( color )
+        { "nodeLambert",    2 },    // ( normal, color )
+        { "nodeTint",       2 },    // ( color, params )
+        { "nodeMultiply",   2 },
+        { "nodeAdd",        2 },
+        { "nodeMix",        3 },    // ( a, b, t )
+    };
+    return Kinds;
+}
+
+uint64_t hashMaterialGraph( const MaterialGraph& graph )
+{
+    uint64_t hash = hashBytes( kFnvOffset, &graph.output, sizeof( graph.output ) );
+    for ( const MaterialNode& node : graph.nodes )
+    {
+        // The terminating zero keeps "ab" + "c" apart from "a" + "bc".
+        hash = hashBytes( hash, node.function.c_str(), node.function.size() + 1 );
+        for ( const MaterialInput& input : node.inputs )
+        {
+            uint32_t packed = input.index << 1 | ( input.source == MaterialInput::Source::Node ? 1u : 0u );
+            hash = hashBytes( hash, &packed, sizeof( packed ) );
+        }
+    }
+    return hash;
+}
+
+std::string validateMaterialGraph( const MaterialGraph& graph )
+{
+    if ( graph.output >= graph.nodes.size() )
+    {
+        return "output is not a node";
+    }
+
+    bool argumentUsed[ kMaterialArgumentCount ] = { };
+    for ( size_t i = 0; i < graph.nodes.size(); ++i )
+    {
+        const MaterialNode& node = graph.nodes[ i ];
+        const MaterialNodeKind* pKind = findKind( node.function );
+        if ( !pKind )
+        {
+            return "node " + std::to_string( i ) + " calls unknown function " + node.function;
+        }
+        if ( node.inputs.size() != pKind->inputCount )
+        {
+            return "node " + std::to_string( i ) + " has the wrong number of inputs for " + node.function;
+        }
+        for ( const MaterialInput& input : node.inputs )
+        {
+            bool isNode = input.source == MaterialInput::Source::Node;
+            if ( isNode ? input.index >= i : input.index >= kMaterialArgumentCount )
+            {
+                return "node " + std::to_string( i ) + " reads " + ( isNode ? "a later node" : "a missing argument" );
+            }
+            if ( !isNode )
+            {
+                argumentUsed[ input.index ] = true;
+            }
+        }
+    }
+    for ( uint32_t i = 0; i < kMaterialArgumentCount; ++i )
+    {
+        if ( !argumentUsed[ i ] )
+        {
+            return std::string( "argument " ) + kMaterialArgumentNames[ i ] + " is never read";
+        }
+    }
+    return std::string();
+}
+
+std::string materialGraphSource( const MaterialGraph& graph )
+{
+    // Appended piece by piece rather than through operator+ temporaries, which
+    // is also one allocation for the usual graph.
+    std::string source;
+    source.reserve( graph.nodes.size() * 64 + 32 );
+    for ( size_t i = 0; i < graph.nodes.size(); ++i )
+    {
+        const MaterialNode& node = graph.nodes[ i ];
+        source.append( "    float4 n" ).append( std::to_string( i ) ).append( " = " ).append( node.function ).append( "( " );
+        for ( size_t j = 0; j < node.inputs.size(); ++j )
+        {
+            const MaterialInput& input = node.inputs[ j ];
+            source.append( j ? ", " : "" );
+            if ( input.source == MaterialInput::Source::Node )
+            {
+                source.append( "n" ).append( std::to_string( input.index ) );
+            }
+            else
+            {
+                source.append( kMaterialArgumentNames[ input.index ] );
+            }
+        }
+        source.append( " );\n" );
+    }
+    source.append( "    return n" ).append( std::to_string( graph.output ) ).append( ";\n" );
+    return source;
+}
+
+std::vector<MaterialGraph> randomMaterialGraphs( uint32_t count, uint32_t uniqueCount, uint32_t seed )
+{
+    std::mt19937 rng( seed );
+    const MaterialInput Uv = { MaterialInput::Source::Argument, 0 };
+    const MaterialInput Normal = { MaterialInput::Source::Argument, 1 };
+    const MaterialInput Params = { MaterialInput::Source::Argument, 2 };
+    const char* const Patterns[] = { "nodeChecker", "nodeNoise", "nodeStripes" };
+    const char* const Combines[] = { "nodeMultiply", "nodeAdd", "nodeMix", "nodeDesaturate", "nodeFresnel" };
+
+    std::vector<MaterialGraph> unique;
+    for ( uint32_t m = 0; m < uniqueCount; ++m )
+    {
+        // A few patterns combined at random, then lit and tinted, so every
+        // graph reads all three arguments.
+        MaterialGraph graph;
+        uint32_t steps = 2 + rng() % 6;
+        graph.nodes.push_back( { Patterns[ rng() % 3 ], { Uv } } );
+        for ( uint32_t s = 0; s < steps; ++s )
+        {
+            uint32_t last = uint32_t( graph.nodes.size() - 1 );
+            MaterialInput previous = { MaterialInput::Source::Node, last };
+            MaterialInput any = { MaterialInput::Source::Node, uint32_t( rng() % ( last + 1 ) ) };
+            std::string function = Combines[ rng() % 5 ];
+            if ( function == "nodeDesaturate" )
+            {
+                graph.nodes.push_back( { function, { previous } } );
+            }
+            else if ( function == "nodeFresnel" )
+            {
+                graph.nodes.push_back( { function, { Normal } } );
+                graph.nodes.push_back( { "nodeAdd", { previous, { MaterialInput::Source::Node, last + 1 } } } );
+            }
+            else
+            {
+                graph.nodes.push_back( { Patterns[ rng() % 3 ], { Uv } } );
+                MaterialInput pattern = { MaterialInput::Source::Node, last + 1 };
+                if ( function == "nodeMix" )
+                {
+                    graph.nodes.push_back( { function, { previous, pattern, any } } );
+                }
+                else
+                {
+                    graph.nodes.push_back( { function, { previous, pattern } } );
+                }
+            }
+        }
+        uint32_t last = uint32_t( graph.nodes.size() - 1 );
+        graph.nodes.push_back( { "nodeLambert", { Normal, { MaterialInput::Source::Node, last } } } );
+        graph.nodes.push_back( { "nodeTint", { { MaterialInput::Source::Node, last + 1 }, Params } } );
+        graph.output = last + 2;
+        unique.push_back( graph );
+    }
+
+    std::vector<MaterialGraph> graphs;
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        graphs.push_back( unique[ i < uniqueCount ? i : rng() % uniqueCount ] );
+    }
+    return graphs;
+}
@@ -0,0 +1,73 @@
+//
+//  material_graph.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef material_graph_hpp
+#define material_graph_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What feeds a node input: one of the material function's arguments, or the
+// result of an earlier node.
+struct MaterialInput
+{
+    enum class Source
+    {
+        Argument,
+        Node
+    };
+
+    Source      source;
+    uint32_t    index;
+};
+
+struct MaterialNode
+{
+    std::string                 function;   // a stitchable node function, see materialNodeKinds()
+    std::vector<MaterialInput>  inputs;
+};
+
+// A material as a graph of node function calls. Nodes only read earlier nodes,
+// so the node order is an evaluation order.
+struct MaterialGraph
+{
+    std::vector<MaterialNode>   nodes;
+    uint32_t                    output = 0;
+};
+
+struct MaterialNodeKind
+{
+    const char* function;
+    uint32_t    inputCount;
+};
+
+// Material functions take ( uv, normal, params ), all float4, and return the
+// surface color as a float4.
+const uint32_t kMaterialArgumentCount = 3;
+const char* const kMaterialArgumentNames[ kMaterialArgumentCount ] = { "uv", "normal", "params" };
+
+// The node functions materials are built from; their code is in MaterialStitcher.
+const std::vector<MaterialNodeKind>& materialNodeKinds();
+
+// Equal for graphs that stitch to the same function, so it keys caches.
+uint64_t hashMaterialGraph( const MaterialGraph& graph );
+
+// Empty when the graph is usable; otherwise what is wrong with it. Every
+// argument has to be read somewhere, since the stitched function's signature
+// only has the arguments its graph uses.
+std::string validateMaterialGraph( const MaterialGraph& graph );
+
+// The graph written out as the body of a function taking the material
+// arguments, for compiling a material as one standalone shader.
+std::string materialGraphSource( const MaterialGraph& graph );
+
+// count random materials, drawn from uniqueCount distinct graphs so a cache
+// sees repeats the way a scene reusing materials would.
+std::vector<MaterialGraph> randomMaterialGraphs( uint32_t count, uint32_t uniqueCount, uint32_t seed );
+
+#endif /* material_graph_hpp */
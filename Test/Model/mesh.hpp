@@ -0,0 +1,34 @@
+//
+//  mesh.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef mesh_hpp
+#define mesh_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// CPU-side mesh data. Kept free of Metal and <simd/simd.h> so the asset
+// processing that works on it can be built and run on any host.
+struct MeshVertex
+{
+    float x, y, z;
+};
+
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t>   indices;
+
+    size_t triangleCount() const { return indices.size() / 3; }
+    size_t sizeInBytes() const
+    {
+        return vertices.size() * sizeof( MeshVertex ) + indices.size() * sizeof( uint32_t );
+    }
+};
+
+#endif /* mesh_hpp */
@@ -0,0 +1,476 @@
+//
+//  mesh_simplifier.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace
+{
+
+struct Vec3
+{
+    double x, y, z;
+};
+
+Vec3 operator-( const Vec3& a, const Vec3& b ) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+Vec3 operator+( const Vec3& a, const Vec3& b ) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+Vec3 operator*( const Vec3& a, double s ) { return { a.x * s, a.y * s, a.z * s }; }
+double dot( const Vec3& a, const Vec3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+Vec3 cross( const Vec3& a, const Vec3& b )
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+// Symmetric 4x4 stored as its upper triangle, plus the total weight of the
+// planes summed into it. Costs are area-weighted squared distances, so they
+// grow with the fourth power of the mesh scale; dividing by the weight gives
+// the mean squared distance to the planes, which scales like a length squared.
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+
+    static Quadric fromPlane( double a, double b, double c, double d, double w )
+    {
+        Quadric q;
+        q.a00 = w * a * a; q.a01 = w * a * b; q.a02 = w * a * c; q.a03 = w * a * d;
+        q.a11 = w * b * b; q.a12 = w * b * c; q.a13 = w * b * d;
+        q.a22 = w * c * c; q.a23 = w * c * d;
+        q.a33 = w * d * d;
+        q.weight = w;
+        return q;
+    }
+
+    Quadric& operator+=( const Quadric& o )
+    {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+        a11 += o.a11; a12 += o.a12; a13 += o.a13;
+        a22 += o.a22; a23 += o.a23;
+        a33 += o.a33;
+        weight += o.weight;
+        return *this;
+    }
+
+    double evaluate( const Vec3& v ) const
+    {
+        double e = a00 * v.x * v.x + 2 * a01 * v.x * v.y + 2 * a02 * v.x * v.z + 2 * a03 * v.x
+                 + a11 * v.y * v.y + 2 * a12 * v.y * v.z + 2 * a13 * v.y
+                 + a22 * v.z * v.z + 2 * a23 * v.z
+                 + a33;
+        return std::max( e, 0.0 );
+    }
+
+    // Squared object-space distance for a cost from evaluate().
+    double distanceSquared( double cost ) const
+    {
+        return weight > 0.0 ? cost / weight : 0.0;
+    }
+
+    // Position minimizing the quadric, or false when the system is singular
+    // (flat or linear neighbourhoods).
+    bool optimum( Vec3& out ) const
+    {
+        double det = a00 * ( a11 * a22 - a12 * a12 )
+                   - a01 * ( a01 * a22 - a12 * a02 )
+                   + a02 * ( a01 * a12 - a11 * a02 );
+        if ( std::fabs( det ) < 1e-12 )
+        {
+            return false;
+        }
+
+        double inv = 1.0 / det;
+        double bx = -a03, by = -a13, bz = -a23;
+        out.x = inv * ( bx * ( a11 * a22 - a12 * a12 ) - a01 * ( by * a22 - a12 * bz ) + a02 * ( by * a12 - a11 * bz ) );
+        out.y = inv * ( a00 * ( by * a22 - bz * a12 ) - bx * ( a01 * a22 - a12 * a02 ) + a02 * ( a01 * bz - by * a02 ) );
+        out.z = inv * ( a00 * ( a11 * bz - a12 * by ) - a01 * ( a01 * bz - by * a02 ) + bx * ( a01 * a12 - a11 * a02 ) );
+        return true;
+    }
+};
+
+struct EdgeCandidate
+{
+    double   cost;          // area-weighted, orders the collapses
+    double   error;         // squared distance, compared against maxError
+    uint32_t v0, v1;
+    uint32_t stamp0, stamp1;
+    Vec3     target;
+
+    bool operator>( const EdgeCandidate& o ) const { return cost > o.cost; }
+};
+
+// Weight of the penalty planes placed along open borders, relative to face quadrics.
+constexpr double kBorderWeight = 1000.0;
+
+class Simplifier
+{
+public:
+    explicit Simplifier( const MeshData& mesh )
+    {
+        _positions.reserve( mesh.vertices.size() );
+        for ( const MeshVertex& v : mesh.vertices )
+        {
+            _positions.push_back( { v.x, v.y, v.z } );
+        }
+
+        _triangles.assign( mesh.indices.begin(), mesh.indices.end() );
+        _triangleAlive.assign( mesh.triangleCount(), true );
+        _liveTriangles = mesh.triangleCount();
+
+        _quadrics.resize( _positions.size() );
+        _stamps.assign( _positions.size(), 0 );
+        _vertexAlive.assign( _positions.size(), true );
+        _vertexTriangles.resize( _positions.size() );
+
+        for ( uint32_t t = 0; t < _triangleAlive.size(); ++t )
+        {
+            for ( int k = 0; k < 3; ++k )
+            {
+                _vertexTriangles[ _triangles[ t * 3 + k ] ].push_back( t );
+            }
+        }
+
+        buildQuadrics();
+        buildEdges();
+    }
+
+    float run( size_t targetIndexCount, float maxError )
+    {
+        double worst = 0.0;
+        const double maxCost = double( maxError ) * double( maxError );
+
+        while ( _liveTriangles * 3 > targetIndexCount && !_heap.empty() )
+        {
+            EdgeCandidate e = _heap.top();
+            _heap.pop();
+
+            if ( !_vertexAlive[ e.v0 ] || !_vertexAlive[ e.v1 ] ||
+                 _stamps[ e.v0 ] != e.stamp0 || _stamps[ e.v1 ] != e.stamp1 )
+            {
+                continue;
+            }
+            if ( e.error > maxCost )
+            {
+                break;
+            }
+            if ( flips( e.v0, e.v1, e.target ) || flips( e.v1, e.v0, e.target ) )
+            {
+                continue;
+            }
+
+            collapse( e.v0, e.v1, e.target );
+            worst = std::max( worst, e.error );
+        }
+
+        return float( std::sqrt( worst ) );
+    }
+
+    MeshData extract() const
+    {
+        MeshData out;
+        std::vector<uint32_t> remap( _positions.size(), UINT32_MAX );
+
+        for ( uint32_t t = 0; t < _triangleAlive.size(); ++t )
+        {
+            if ( !_triangleAlive[ t ] )
+            {
+                continue;
+            }
+            for ( int k = 0; k < 3; ++k )
+            {
+                uint32_t v = _triangles[ t * 3 + k ];
+                if ( remap[ v ] == UINT32_MAX )
+                {
+                    remap[ v ] = uint32_t( out.vertices.size() );
+                    const Vec3& p = _positions[ v ];
+                    out.vertices.push_back( { float( p.x ), float( p.y ), float( p.z ) } );
+                }
+                out.indices.push_back( remap[ v ] );
+            }
+        }
+        return out;
+    }
+
+private:
+    Vec3 corner( uint32_t t, int k ) const { return _positions[ _triangles[ t * 3 + k ] ]; }
+
+    void buildQuadrics()
+    {
+        // Count edge uses to find borders; an edge used by a single triangle is open.
+        std::vector<std::pair<uint64_t, uint32_t>> edges;
+        edges.reserve( _triangles.size() );
+
+        for ( uint32_t t = 0; t < _triangleAlive.size(); ++t )
+        {
+            Vec3 p0 = corner( t, 0 ), p1 = corner( t, 1 ), p2 = corner( t, 2 );
+            Vec3 n = cross( p1 - p0, p2 - p0 );
+            double len = std::sqrt( dot( n, n ) );
+            if ( len <= 0.0 )
+            {
+                continue;
+            }
+            n = n * ( 1.0 / len );
+            double area = 0.5 * len;
+            Quadric q = Quadric::fromPlane( n.x, n.y, n.z, -dot( n, p0 ), area );
+            for ( int k = 0; k < 3; ++k )
+            {
+                _quadrics[ _triangles[ t * 3 + k ] ] += q;
+
+                uint32_t a = _triangles[ t * 3 + k ], b = _triangles[ t * 3 + ( k + 1 ) % 3 ];
+                edges.push_back( { edgeKey( a, b ), t * 3 + k } );
+            }
+        }
+
+        std::sort( edges.begin(), edges.end(),
+                   []( const auto& l, const auto& r ) { return l.first < r.first; } );
+
+        for ( size_t i = 0; i < edges.size(); )
+        {
+            size_t j = i;
+            while ( j < edges.size() && edges[ j ].first == edges[ i ].first )
+            {
+                ++j;
+            }
+            if ( j - i == 1 )
+            {
+                uint32_t t = edges[ i ].second / 3;
+                int k = int( edges[ i ].second % 3 );
+                Vec3 pa = corner( t, k ), pb = corner( t, ( k + 1 ) % 3 ), pc = corner( t, ( k + 2 ) % 3 );
+                Vec3 n = cross( pb - pa, pc - pa );
+                Vec3 e = pb - pa;
+                Vec3 bn = cross( e, n );
+                double len = std::sqrt( dot( bn, bn ) );
+                if ( len > 0.0 )
+                {
+                    bn = bn * ( 1.0 / len );
+                    Quadric q = Quadric::fromPlane( bn.x, bn.y, bn.z, -dot( bn, pa ), kBorderWeight * dot( e, e ) );
+                    _quadrics[ _triangles[ t * 3 + k ] ] += q;
+                    _quadrics[ _triangles[ t * 3 + ( k + 1 ) % 3 ] ] += q;
+                }
+            }
+            i = j;
+        }
+    }
+
+    void buildEdges()
+    {
+        std::vector<uint64_t> keys;
+        keys.reserve( _triangles.size() );
+        for ( uint32_t t = 0; t < _triangleAlive.size(); ++t )
+        {
+            for ( int k = 0; k < 3; ++k )
+            {
+                keys.push_back( edgeKey( _triangles[ t * 3 + k ], _triangles[ t * 3 + ( k + 1 ) % 3 ] ) );
+            }
+        }
+        std::sort( keys.begin(), keys.end() );
+        keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+        for ( uint64_t key : keys )
+        {
+            pushEdge( uint32_t( key >> 32 ), uint32_t( key & 0xffffffffu ) );
+        }
+    }
+
+    static uint64_t edgeKey( uint32_t a, uint32_t b )
+    {
+        if ( a > b )
+        {
+            std::swap( a, b );
+        }
+        return ( uint64_t( a ) << 32 ) | b;
+    }
+
+    void pushEdge( uint32_t v0, uint32_t v1 )
+    {
+        if ( v0 == v1 )
+        {
+            return;
+        }
+
+        Quadric q = _quadrics[ v0 ];
+        q += _quadrics[ v1 ];
+
+        EdgeCandidate e;
+        e.v0 = v0;
+        e.v1 = v1;
+        e.stamp0 = _stamps[ v0 ];
+        e.stamp1 = _stamps[ v1 ];
+
+        Vec3 candidates[ 3 ] = { _positions[ v0 ], _positions[ v1 ], ( _positions[ v0 ] + _positions[ v1 ] ) * 0.5 };
+        e.cost = HUGE_VAL;
+        if ( q.optimum( e.target ) )
+        {
+            e.cost = q.evaluate( e.target );
+        }
+        for ( const Vec3& c : candidates )
+        {
+            double cost = q.evaluate( c );
+            if ( cost < e.cost )
+            {
+                e.cost = cost;
+                e.target = c;
+            }
+        }
+        e.error = q.distanceSquared( e.cost );
+
+        _heap.push( e );
+    }
+
+    // True if moving `moved` to `target` would invert any triangle that does not
+    // also reference `other` (those disappear with the collapse).
+    bool flips( uint32_t moved, uint32_t other, const Vec3& target ) const
+    {
+        for ( uint32_t t : _vertexTriangles[ moved ] )
+        {
+            if ( !_triangleAlive[ t ] )
+            {
+                continue;
+            }
+
+            const uint32_t* tri = &_triangles[ t * 3 ];
+            if ( tri[ 0 ] == other || tri[ 1 ] == other || tri[ 2 ] == other )
+            {
+                continue;
+            }
+
+            Vec3 before[ 3 ], after[ 3 ];
+            for ( int k = 0; k < 3; ++k )
+            {
+                before[ k ] = _positions[ tri[ k ] ];
+                after[ k ] = tri[ k ] == moved ? target : before[ k ];
+            }
+
+            Vec3 n0 = cross( before[ 1 ] - before[ 0 ], before[ 2 ] - before[ 0 ] );
+            Vec3 n1 = cross( after[ 1 ] - after[ 0 ], after[ 2 ] - after[ 0 ] );
+            if ( dot( n0, n1 ) <= 0.0 )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void collapse( uint32_t keep, uint32_t drop, const Vec3& target )
+    {
+        _positions[ keep ] = target;
+        _quadrics[ keep ] += _quadrics[ drop ];
+        _vertexAlive[ drop ] = false;
+        ++_stamps[ keep ];
+
+        for ( uint32_t t : _vertexTriangles[ drop ] )
+        {
+            if ( !_triangleAlive[ t ] )
+            {
+                continue;
+            }
+
+            uint32_t* tri = &_triangles[ t * 3 ];
+            if ( tri[ 0 ] == keep || tri[ 1 ] == keep || tri[ 2 ] == keep )
+            {
+                _triangleAlive[ t ] = false;
+                --_liveTriangles;
+                continue;
+            }
+
+            for ( int k = 0; k < 3; ++k )
+            {
+                if ( tri[ k ] == drop )
+                {
+                    tri[ k ] = keep;
+                }
+            }
+            _vertexTriangles[ keep ].push_back( t );
+        }
+        _vertexTriangles[ drop ].clear();
+
+        // Compact the adjacency list and re-queue every edge around the survivor.
+        std::vector<uint32_t>& adjacency = _vertexTriangles[ keep ];
+        adjacency.erase( std::remove_if( adjacency.begin(), adjacency.end(),
+                                         [this]( uint32_t t ) { return !_triangleAlive[ t ]; } ),
+                         adjacency.end() );
+
+        std::vector<uint32_t> neighbours;
+        for ( uint32_t t : adjacency )
+        {
+            for ( int k = 0; k < 3; ++k )
+            {
+                uint32_t v = _triangles[ t * 3 + k ];
+                if ( v != keep )
+                {
+                    neighbours.push_back( v );
+                }
+            }
+        }
+        std::sort( neighbours.begin(), neighbours.end() );
+        neighbours.erase( std::unique( neighbours.begin(), neighbours.end() ), neighbours.end() );
+
+        for ( uint32_t v : neighbours )
+        {
+            pushEdge( keep, v );
+        }
+    }
+
+    std::vector<Vec3>                   _positions;
+    std::vector<Quadric>                _quadrics;
+    std::vector<uint32_t>               _stamps;
+    std::vector<bool>                   _vertexAlive;
+    std::vector<std::vector<uint32_t>>  _vertexTriangles;
+    std::vector<uint32_t>               _triangles;
+    std::vector<bool>                   _triangleAlive;
+    size_t                              _liveTriangles = 0;
+
+    std::priority_queue<EdgeCandidate, std::vector<EdgeCandidate>, std::greater<EdgeCandidate>> _heap;
+};
+
+}
+
+SimplifyResult simplifyMesh( const MeshData& mesh, size_t targetIndexCount, float maxError )
+{
+    Simplifier simplifier( mesh );
+
+    SimplifyResult result;
+    result.error = simplifier.run( targetIndexCount, maxError );
+    result.mesh = simplifier.extract();
+    return result;
+}
+
+std::vector<MeshLod> buildLodChain( const MeshData& mesh, const LodChainSettings& settings )
+{
+    std::vector<MeshLod> chain;
+    chain.push_back( { mesh, 0.0f } );
+
+    while ( chain.size() < settings.maxLevels )
+    {
+        const MeshLod& previous = chain.back();
+        size_t triangles = previous.mesh.triangleCount();
+        if ( triangles <= settings.minTriangles )
+        {
+            break;
+        }
+
+        size_t target = std::max( settings.minTriangles, size_t( float( triangles ) * settings.reductionPerLevel ) );
+        SimplifyResult simplified = simplifyMesh( previous.mesh, target * 3, settings.maxError );
+
+        // Require real progress, otherwise the chain would just repeat the same level.
+        if ( simplified.mesh.triangleCount() == 0 ||
+             simplified.mesh.triangleCount() > triangles - triangles / 10 )
+        {
+            break;
+        }
+
+        float error = previous.geometricError + simplified.error;
+        chain.push_back( { std::move( simplified.mesh ), error } );
+    }
+
+    return chain;
+}
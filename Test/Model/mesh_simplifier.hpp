@@ -0,0 +1,43 @@
+//
+//  mesh_simplifier.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef mesh_simplifier_hpp
+#define mesh_simplifier_hpp
+
+#include "mesh.hpp"
+
+struct SimplifyResult
+{
+    MeshData mesh;
+    float    error = 0.0f;      // worst collapse, as an RMS object-space distance to the planes it merged
+};
+
+// Quadric error metric edge-collapse simplifier (Garland & Heckbert).
+// Collapses edges cheapest-first until the index count drops to targetIndexCount
+// or the next collapse would exceed maxError. Open borders are kept in place by
+// penalty quadrics and collapses that would flip a triangle are rejected.
+SimplifyResult simplifyMesh( const MeshData& mesh, size_t targetIndexCount, float maxError );
+
+struct LodChainSettings
+{
+    float  reductionPerLevel = 0.5f;   // target triangle ratio between consecutive levels
+    size_t minTriangles      = 16;
+    size_t maxLevels         = 8;
+    float  maxError          = 1e30f;
+};
+
+struct MeshLod
+{
+    MeshData mesh;
+    float    geometricError = 0.0f; // accumulated object-space error relative to LOD 0
+};
+
+// Builds LOD 0 (the source mesh) followed by progressively coarser levels, each
+// simplified from the previous one. Stops early when a level fails to reduce.
+std::vector<MeshLod> buildLodChain( const MeshData& mesh, const LodChainSettings& settings );
+
+#endif /* mesh_simplifier_hpp */
@@ -0,0 +1,313 @@
+//
+//  mip_generator.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "mip_generator.hpp"
+#include "Core/job_system.hpp"
+#include "Model/simd_math.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace math;
+
+namespace
+{
+
+struct Tap
+{
+    uint32_t first;     // first source index
+    uint32_t count;
+    uint32_t weights;   // offset into the weight table
+};
+
+struct Resampler
+{
+    std::vector<Tap>   taps;
+    std::vector<float> weights;
+};
+
+float sinc( float x )
+{
+    if ( std::fabs( x ) < 1e-6f )
+    {
+        return 1.0f;
+    }
+    x *= float( M_PI );
+    return std::sin( x ) / x;
+}
+
+// Modified Bessel function of the first kind, order 0, for the Kaiser window.
+float besselI0( float x )
+{
+    float sum = 1.0f, term = 1.0f, half = x * 0.5f;
+    for ( int k = 1; k < 20; ++k )
+    {
+        term *= ( half / float( k ) ) * ( half / float( k ) );
+        sum += term;
+    }
+    return sum;
+}
+
+float filterSupport( MipFilter filter )
+{
+    switch ( filter )
+    {
+        case MipFilter::Box:     return 0.5f;
+        case MipFilter::Kaiser:  return 3.0f;
+        case MipFilter::Lanczos: return 3.0f;
+    }
+    return 0.5f;
+}
+
+float evaluateFilter( MipFilter filter, float x )
+{
+    x = std::fabs( x );
+    switch ( filter )
+    {
+        case MipFilter::Box:
+            return x < 0.5f ? 1.0f : ( x == 0.5f ? 0.5f : 0.0f );
+        case MipFilter::Kaiser:
+        {
+            const float Support = 3.0f, Beta = 4.0f;
+            if ( x >= Support )
+            {
+                return 0.0f;
+            }
+            float r = x / Support;
+            return sinc( x ) * besselI0( Beta * std::sqrt( 1.0f - r * r ) ) / besselI0( Beta );
+        }
+        case MipFilter::Lanczos:
+            return x < 3.0f ? sinc( x ) * sinc( x / 3.0f ) : 0.0f;
+    }
+    return 0.0f;
+}
+
+// Precomputes normalized taps for resampling srcSize samples down to dstSize, with
+// the kernel stretched by the scale factor and edge samples replicated.
+Resampler buildResampler( MipFilter filter, uint32_t srcSize, uint32_t dstSize )
+{
+    Resampler r;
+    const float Scale = float( srcSize ) / float( dstSize );
+    const float Radius = filterSupport( filter ) * Scale;
+
+    for ( uint32_t i = 0; i < dstSize; ++i )
+    {
+        float center = ( float( i ) + 0.5f ) * Scale;
+        int first = int( std::floor( center - Radius ) );
+        int last = int( std::ceil( center + Radius ) );
+
+        // Accumulate into clamped source indices so edge taps fold onto the border.
+        uint32_t lo = uint32_t( std::clamp( first, 0, int( srcSize ) - 1 ) );
+        uint32_t hi = uint32_t( std::clamp( last, 0, int( srcSize ) - 1 ) );
+        std::vector<float> w( hi - lo + 1, 0.0f );
+        float sum = 0.0f;
+        for ( int j = first; j <= last; ++j )
+        {
+            float weight = evaluateFilter( filter, ( float( j ) + 0.5f - center ) / Scale );
+            if ( weight == 0.0f )
+            {
+                continue;
+            }
+            uint32_t src = uint32_t( std::clamp( j, 0, int( srcSize ) - 1 ) );
+            w[ src - lo ] += weight;
+            sum += weight;
+        }
+
+        r.taps.push_back( { lo, uint32_t( w.size() ), uint32_t( r.weights.size() ) } );
+        for ( float weight : w )
+        {
+            r.weights.push_back( sum != 0.0f ? weight / sum : 0.0f );
+        }
+    }
+    return r;
+}
+
+float srgbToLinear( float c )
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow( ( c + 0.055f ) / 1.055f, 2.4f );
+}
+
+float linearToSrgb( float c )
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow( c, 1.0f / 2.4f ) - 0.055f;
+}
+
+uint8_t toUnorm8( float v )
+{
+    return uint8_t( std::lround( std::clamp( v, 0.0f, 1.0f ) * 255.0f ) );
+}
+
+float alphaCoverage( const std::vector<float4>& pixels, float scale, float cutoff )
+{
+    size_t covered = 0;
+    for ( const float4& p : pixels )
+    {
+        covered += p.w * scale > cutoff ? 1 : 0;
+    }
+    return float( covered ) / float( pixels.size() );
+}
+
+// Scale for alpha that brings this level's coverage back to the target, by bisection.
+float coverageScale( const std::vector<float4>& pixels, float target, float cutoff )
+{
+    float lo = 0.0f, hi = 4.0f;
+    for ( int i = 0; i < 12; ++i )
+    {
+        float mid = 0.5f * ( lo + hi );
+        if ( alphaCoverage( pixels, mid, cutoff ) < target )
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return 0.5f * ( lo + hi );
+}
+
+// One RGBA pixel per float4, so every filter tap is a single vector multiply-add.
+void downsample( const std::vector<float4>& src, uint32_t srcW, uint32_t srcH,
+                 std::vector<float4>& dst, uint32_t dstW, uint32_t dstH,
+                 MipFilter filter, JobSystem& jobs )
+{
+    const Resampler Horizontal = buildResampler( filter, srcW, dstW );
+    const Resampler Vertical = buildResampler( filter, srcH, dstH );
+
+    std::vector<float4> rows( size_t( dstW ) * srcH );
+    jobs.parallelFor( srcH, 16, [&]( size_t begin, size_t end )
+    {
+        for ( size_t y = begin; y < end; ++y )
+        {
+            const float4* in = &src[ y * srcW ];
+            float4* out = &rows[ y * dstW ];
+            for ( uint32_t x = 0; x < dstW; ++x )
+            {
+                const Tap& tap = Horizontal.taps[ x ];
+                const float* w = &Horizontal.weights[ tap.weights ];
+                float4 sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+                for ( uint32_t k = 0; k < tap.count; ++k )
+                {
+                    sum += in[ tap.first + k ] * w[ k ];
+                }
+                out[ x ] = sum;
+            }
+        }
+    } );
+
+    dst.assign( size_t( dstW ) * dstH, float4 { 0.0f, 0.0f, 0.0f, 0.0f } );
+    jobs.parallelFor( dstH, 16, [&]( size_t begin, size_t end )
+    {
+        for ( size_t y = begin; y < end; ++y )
+        {
+            const Tap& tap = Vertical.taps[ y ];
+            float4* out = &dst[ y * dstW ];
+            // Whole-row multiply-adds, contiguous in x.
+            for ( uint32_t k = 0; k < tap.count; ++k )
+            {
+                const float W = Vertical.weights[ tap.weights + k ];
+                const float4* in = &rows[ size_t( tap.first + k ) * dstW ];
+                for ( uint32_t x = 0; x < dstW; ++x )
+                {
+                    out[ x ] += in[ x ] * W;
+                }
+            }
+        }
+    } );
+}
+
+}
+
+std::vector<MipLevel> generateMipChain( const uint8_t* pRgba, uint32_t width, uint32_t height,
+                                        const MipSettings& settings, JobSystem& jobs )
+{
+    std::vector<MipLevel> chain;
+    chain.push_back( { width, height, std::vector<uint8_t>( pRgba, pRgba + size_t( width ) * height * 4 ) } );
+
+    float toLinear[ 256 ];
+    for ( int i = 0; i < 256; ++i )
+    {
+        toLinear[ i ] = settings.sRGB ? srgbToLinear( float( i ) / 255.0f ) : float( i ) / 255.0f;
+    }
+
+    std::vector<float4> level( size_t( width ) * height );
+    for ( size_t p = 0; p < level.size(); ++p )
+    {
+        const uint8_t* in = pRgba + p * 4;
+        float a = float( in[ 3 ] ) / 255.0f;
+        float m = settings.premultiplyAlpha ? a : 1.0f;
+        level[ p ] = float4 { toLinear[ in[ 0 ] ] * m, toLinear[ in[ 1 ] ] * m, toLinear[ in[ 2 ] ] * m, a };
+    }
+
+    const float TargetCoverage = settings.preserveAlphaCoverage
+        ? alphaCoverage( level, 1.0f, settings.alphaCutoff )
+        : 0.0f;
+
+    std::vector<float4> next;
+    uint32_t w = width, h = height;
+    while ( w > 1 || h > 1 )
+    {
+        uint32_t nw = std::max( 1u, w / 2 ), nh = std::max( 1u, h / 2 );
+        downsample( level, w, h, next, nw, nh, settings.filter, jobs );
+        level.swap( next );
+        w = nw;
+        h = nh;
+
+        float alphaScale = settings.preserveAlphaCoverage
+            ? coverageScale( level, TargetCoverage, settings.alphaCutoff )
+            : 1.0f;
+
+        MipLevel& out = chain.emplace_back( MipLevel { w, h, std::vector<uint8_t>( size_t( w ) * h * 4 ) } );
+        jobs.parallelFor( h, 16, [&]( size_t begin, size_t end )
+        {
+            for ( size_t p = begin * w; p < end * w; ++p )
+            {
+                float4 c = level[ p ];
+                float a = c.w;
+                if ( settings.premultiplyAlpha && a > 0.0f )
+                {
+                    c = c / float4 { a, a, a, a };
+                }
+                for ( int ch = 0; ch < 3; ++ch )
+                {
+                    float v = std::clamp( c[ ch ], 0.0f, 1.0f );
+                    out.rgba[ p * 4 + ch ] = toUnorm8( settings.sRGB ? linearToSrgb( v ) : v );
+                }
+                out.rgba[ p * 4 + 3 ] = toUnorm8( a * alphaScale );
+            }
+        } );
+    }
+
+    return chain;
+}
+
+std::vector<MipDifference> compareMipChains( const std::vector<MipLevel>& a, const std::vector<MipLevel>& b )
+{
+    std::vector<MipDifference> result;
+    for ( size_t i = 0; i < std::min( a.size(), b.size() ); ++i )
+    {
+        MipDifference diff;
+        if ( a[ i ].rgba.size() != b[ i ].rgba.size() )
+        {
+            diff.maxAbsDifference = 255;
+            result.push_back( diff );
+            continue;
+        }
+
+        double sum = 0.0;
+        for ( size_t k = 0; k < a[ i ].rgba.size(); ++k )
+        {
+            int d = std::abs( int( a[ i ].rgba[ k ] ) - int( b[ i ].rgba[ k ] ) );
+            diff.maxAbsDifference = std::max( diff.maxAbsDifference, d );
+            sum += double( d ) * d;
+        }
+        double mse = sum / double( std::max< size_t >( a[ i ].rgba.size(), 1 ) );
+        diff.psnr = mse > 0.0 ? 10.0 * std::log10( 255.0 * 255.0 / mse ) : 99.0;
+        result.push_back( diff );
+    }
+    return result;
+}
@@ -0,0 +1,55 @@
+//
+//  mip_generator.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef mip_generator_hpp
+#define mip_generator_hpp
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+enum class MipFilter
+{
+    Box,        // 2x2 average, what BlitCommandEncoder::generateMipmaps does
+    Kaiser,     // Kaiser-windowed sinc, sharper with little ringing
+    Lanczos,    // Lanczos-3, sharpest, can ring on hard edges
+};
+
+struct MipSettings
+{
+    MipFilter filter                = MipFilter::Kaiser;
+    bool      sRGB                  = true;     // RGB is sRGB encoded; filter in linear space
+    bool      premultiplyAlpha      = false;    // weight color by alpha while filtering
+    bool      preserveAlphaCoverage = false;    // keep alpha-tested coverage constant across mips
+    float     alphaCutoff           = 0.5f;
+};
+
+struct MipLevel
+{
+    uint32_t             width;
+    uint32_t             height;
+    std::vector<uint8_t> rgba;
+};
+
+// Builds the full chain down to 1x1 from a tightly packed RGBA8 image. Level 0 is a
+// copy of the input; every following level halves each dimension (rounding down,
+// as Metal does) and is resampled from the previous one. Rows are filtered in
+// parallel over the job system.
+std::vector<MipLevel> generateMipChain( const uint8_t* pRgba, uint32_t width, uint32_t height,
+                                        const MipSettings& settings, JobSystem& jobs );
+
+struct MipDifference
+{
+    int    maxAbsDifference = 0;
+    double psnr             = 0.0;
+};
+
+// Per-level comparison of two chains of the same shape, e.g. CPU against GPU output.
+std::vector<MipDifference> compareMipChains( const std::vector<MipLevel>& a, const std::vector<MipLevel>& b );
+
+#endif /* mip_generator_hpp */
@@ -0,0 +1,77 @@
+//
+//  mock_bench_backend.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "mock_bench_backend.hpp"
+
+#include <chrono>
+
+MockBenchBackend::MockBenchBackend( uint32_t width, uint32_t height, const MockCostModel& costs )
+: _width( width )
+, _height( height )
+, _costs( costs )
+{
+}
+
+void MockBenchBackend::load( const BenchScene& scene )
+{
+    _pScene = &scene;
+    _commands.reserve( scene.draws.size() * 3 );
+}
+
+BenchFrameTiming MockBenchBackend::renderFrame()
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+
+    _commands.clear();
+    uint32_t pipeline = ~0u, texture = ~0u;
+    size_t pipelineChanges = 0, textureChanges = 0, triangles = 0;
+    double pixels = 0.0;
+    const double ScreenPixels = double( _width ) * _height;
+    for ( const BenchDraw& draw : _pScene->draws )
+    {
+        if ( draw.pso != pipeline )
+        {
+            _commands.push_back( { CommandType::SetPipeline, draw.pso, 0 } );
+            pipeline = draw.pso;
+            ++pipelineChanges;
+        }
+        if ( draw.texture != texture )
+        {
+            _commands.push_back( { CommandType::SetTexture, draw.texture, 0 } );
+            texture = draw.texture;
+            ++textureChanges;
+        }
+        _commands.push_back( { CommandType::Draw, draw.firstIndex, draw.indexCount } );
+        triangles += draw.indexCount / 3;
+        pixels += double( draw.coverage ) * ScreenPixels;
+    }
+
+    BenchFrameTiming timing;
+    timing.cpuEncodeMs = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    timing.gpuMs = ( double( _pScene->draws.size() ) * _costs.perDraw
+                   + double( pipelineChanges ) * _costs.perPipeline
+                   + double( textureChanges ) * _costs.perTexture
+                   + double( triangles ) * _costs.perTriangle
+                   + pixels * _costs.perPixel ) * 1e-6;
+    return timing;
+}
+
+size_t MockBenchBackend::memoryBytes() const
+{
+    // What the Metal backend allocates for the same scene: geometry, textures and
+    // a BGRA8 + Depth32Float target.
+    return _pScene->mesh.sizeInBytes()
+         + size_t( _pScene->desc.textureCount ) * kTextureBytes
+         + size_t( _width ) * _height * 8;
+}
+
+void MockBenchBackend::unload()
+{
+    _pScene = nullptr;
+    _commands.clear();
+}
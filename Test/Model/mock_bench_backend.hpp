@@ -0,0 +1,57 @@
+//
+//  mock_bench_backend.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef mock_bench_backend_hpp
+#define mock_bench_backend_hpp
+
+#include "Model/bench_suite.hpp"
+
+// Rough per-item GPU costs for the mock backend, in nanoseconds.
+struct MockCostModel
+{
+    double perDraw          = 1500.0;
+    double perPipeline      = 4000.0;
+    double perTexture       = 500.0;
+    double perTriangle      = 0.5;
+    double perPixel         = 0.02;
+};
+
+// Backend with no GPU behind it, so the suite and its baselines can run on any
+// host. "Encoding" records the same state changes and draws the Metal backend
+// would into a command list and is really timed; GPU time comes from a fixed
+// cost model, so it only moves when the scenes or the model change.
+class MockBenchBackend : public BenchBackend
+{
+public:
+    MockBenchBackend( uint32_t width = 1920, uint32_t height = 1080, const MockCostModel& costs = MockCostModel() );
+
+    const char* name() const override { return "mock"; }
+    void load( const BenchScene& scene ) override;
+    BenchFrameTiming renderFrame() override;
+    size_t memoryBytes() const override;
+    void unload() override;
+
+private:
+    enum class CommandType : uint8_t { SetPipeline, SetTexture, Draw };
+
+    struct Command
+    {
+        CommandType type;
+        uint32_t    a;
+        uint32_t    b;
+    };
+
+    static constexpr size_t kTextureBytes = 256 * 256 * 4;
+
+    uint32_t                _width;
+    uint32_t                _height;
+    MockCostModel           _costs;
+    const BenchScene*       _pScene = nullptr;
+    std::vector<Command>    _commands;
+};
+
+#endif /* mock_bench_backend_hpp */
@@ -0,0 +1,139 @@
+//
+//  mock_timeline.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "mock_timeline.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+
+uint64_t MockTimeline::signaledValue() const
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _value;
+}
+
+void MockTimeline::signal( uint64_t value )
+{
+    std::vector<std::pair<uint64_t, Listener>> due;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        if ( value < _value )
+        {
+            __builtin_printf( "MockTimeline: signal %llu after %llu\n", (unsigned long long)value, (unsigned long long)_value );
+            assert( false );
+            return;
+        }
+        _value = value;
+        auto end = _listeners.upper_bound( value );
+        for ( auto it = _listeners.begin(); it != end; ++it )
+        {
+            due.emplace_back( it->first, std::move( it->second ) );
+        }
+        _listeners.erase( _listeners.begin(), end );
+    }
+    _reached.notify_all();
+
+    // Outside the lock, so listeners may signal or notify in turn.
+    for ( auto& [at, listener] : due )
+    {
+        listener( value );
+    }
+}
+
+bool MockTimeline::wait( uint64_t value, uint32_t timeoutMs )
+{
+    std::unique_lock<std::mutex> lock( _mutex );
+    return _reached.wait_for( lock, std::chrono::milliseconds( timeoutMs ), [&] { return _value >= value; } );
+}
+
+void MockTimeline::notify( uint64_t value, const Listener& listener )
+{
+    uint64_t current;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        current = _value;
+        if ( current < value )
+        {
+            _listeners.emplace( value, listener );
+            return;
+        }
+    }
+    listener( current );
+}
+
+MockQueue::MockQueue()
+: _thread( [this] { run(); } )
+{
+}
+
+MockQueue::~MockQueue()
+{
+    drain();
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _quit = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+void MockQueue::submit( Submission submission )
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _queue.push_back( std::move( submission ) );
+    }
+    _wake.notify_all();
+}
+
+void MockQueue::drain()
+{
+    std::unique_lock<std::mutex> lock( _mutex );
+    _idle.wait( lock, [this] { return _queue.empty() && !_busy; } );
+}
+
+void MockQueue::run()
+{
+    for ( ;; )
+    {
+        Submission submission;
+        {
+            std::unique_lock<std::mutex> lock( _mutex );
+            _wake.wait( lock, [this] { return _quit || !_queue.empty(); } );
+            if ( _queue.empty() )
+            {
+                return;
+            }
+            submission = std::move( _queue.front() );
+            _queue.pop_front();
+            _busy = true;
+        }
+
+        // Like the GPU, a queue blocked on a wait holds up everything behind it.
+        for ( auto& [pTimeline, value] : submission.waits )
+        {
+            while ( !pTimeline->wait( value, 1000 ) )
+            {
+            }
+        }
+        if ( submission.work )
+        {
+            submission.work();
+        }
+        if ( submission.pSignal )
+        {
+            submission.pSignal->signal( submission.signalValue );
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _busy = false;
+        }
+        _idle.notify_all();
+    }
+}
@@ -0,0 +1,72 @@
+//
+//  mock_timeline.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef mock_timeline_hpp
+#define mock_timeline_hpp
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Model/timeline.hpp"
+
+// Timeline with no GPU behind it, so code built on timelines runs on any host.
+// Listeners run on the thread that signals.
+class MockTimeline : public Timeline
+{
+public:
+    uint64_t signaledValue() const override;
+    void signal( uint64_t value ) override;
+    bool wait( uint64_t value, uint32_t timeoutMs ) override;
+    void notify( uint64_t value, const Listener& listener ) override;
+
+private:
+    mutable std::mutex                  _mutex;
+    std::condition_variable             _reached;
+    uint64_t                            _value = 0;
+    std::multimap<uint64_t, Listener>   _listeners;
+};
+
+// Stand-in for a GPU command queue. Submissions run in order on the queue's
+// own thread; each one waits for its timeline dependencies, runs its work and
+// then signals. Two queues therefore overlap exactly as far as their waits
+// allow, which is what the Metal side relies on.
+class MockQueue
+{
+public:
+    struct Submission
+    {
+        std::vector<std::pair<Timeline*, uint64_t>> waits;
+        std::function<void()>                       work;
+        Timeline*                                   pSignal = nullptr;
+        uint64_t                                    signalValue = 0;
+    };
+
+    MockQueue();
+    ~MockQueue();     // runs everything still queued first
+
+    void submit( Submission submission );
+
+    // Blocks until every submission so far has run.
+    void drain();
+
+private:
+    void run();
+
+    std::thread                 _thread;
+    std::mutex                  _mutex;
+    std::condition_variable     _wake;
+    std::condition_variable     _idle;
+    std::deque<Submission>      _queue;
+    bool                        _busy = false;
+    bool                        _quit = false;
+};
+
+#endif /* mock_timeline_hpp */
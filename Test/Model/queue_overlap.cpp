@@ -0,0 +1,94 @@
+//
+//  queue_overlap.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "queue_overlap.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+
+std::vector<QueueInterval> mergeIntervals( std::vector<QueueInterval> intervals )
+{
+    std::sort( intervals.begin(), intervals.end(), []( const QueueInterval& a, const QueueInterval& b ) { return a.startMs < b.startMs; } );
+    std::vector<QueueInterval> merged;
+    for ( const QueueInterval& interval : intervals )
+    {
+        if ( interval.endMs <= interval.startMs )
+        {
+            continue;
+        }
+        if ( !merged.empty() && interval.startMs <= merged.back().endMs )
+        {
+            merged.back().endMs = std::max( merged.back().endMs, interval.endMs );
+        }
+        else
+        {
+            merged.push_back( interval );
+        }
+    }
+    return merged;
+}
+
+double busyMs( const std::vector<QueueInterval>& merged )
+{
+    double total = 0.0;
+    for ( const QueueInterval& interval : merged )
+    {
+        total += interval.endMs - interval.startMs;
+    }
+    return total;
+}
+
+}
+
+QueueOverlap measureQueueOverlap( std::vector<QueueInterval> graphics, std::vector<QueueInterval> compute )
+{
+    graphics = mergeIntervals( std::move( graphics ) );
+    compute = mergeIntervals( std::move( compute ) );
+
+    QueueOverlap overlap;
+    overlap.graphicsBusyMs = busyMs( graphics );
+    overlap.computeBusyMs = busyMs( compute );
+
+    // Both lists are sorted and disjoint, so one merge-style walk finds every intersection.
+    size_t g = 0, c = 0;
+    while ( g < graphics.size() && c < compute.size() )
+    {
+        double start = std::max( graphics[ g ].startMs, compute[ c ].startMs );
+        double end = std::min( graphics[ g ].endMs, compute[ c ].endMs );
+        overlap.overlapMs += std::max( end - start, 0.0 );
+        if ( graphics[ g ].endMs < compute[ c ].endMs )
+        {
+            ++g;
+        }
+        else
+        {
+            ++c;
+        }
+    }
+
+    double first = 1e300, last = -1e300;
+    for ( const std::vector<QueueInterval>* pList : { &graphics, &compute } )
+    {
+        if ( !pList->empty() )
+        {
+            first = std::min( first, pList->front().startMs );
+            last = std::max( last, pList->back().endMs );
+        }
+    }
+    overlap.spanMs = last > first ? last - first : 0.0;
+    return overlap;
+}
+
+void printQueueOverlap( const char* label, const QueueOverlap& overlap )
+{
+    __builtin_printf( "%s: graphics %.2f ms, compute %.2f ms, overlapped %.2f ms (%.0f%% of compute hidden), span %.2f ms\n",
+                      label, overlap.graphicsBusyMs, overlap.computeBusyMs, overlap.overlapMs,
+                      overlap.hiddenFraction() * 100.0, overlap.spanMs );
+}
@@ -0,0 +1,38 @@
+//
+//  queue_overlap.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef queue_overlap_hpp
+#define queue_overlap_hpp
+
+#include <vector>
+
+// When one command buffer ran on the GPU, in milliseconds on a clock shared by
+// every queue of the device.
+struct QueueInterval
+{
+    double startMs;
+    double endMs;
+};
+
+struct QueueOverlap
+{
+    double graphicsBusyMs   = 0.0;
+    double computeBusyMs    = 0.0;
+    double overlapMs        = 0.0;      // both queues busy at once
+    double spanMs           = 0.0;      // first start to last end
+
+    // Share of the compute work that ran under graphics work, i.e. came for free.
+    double hiddenFraction() const { return computeBusyMs > 0.0 ? overlapMs / computeBusyMs : 0.0; }
+};
+
+// Intervals on one queue may overlap each other when several command buffers
+// are in flight; each queue's are merged before they are compared.
+QueueOverlap measureQueueOverlap( std::vector<QueueInterval> graphics, std::vector<QueueInterval> compute );
+
+void printQueueOverlap( const char* label, const QueueOverlap& overlap );
+
+#endif /* queue_overlap_hpp */
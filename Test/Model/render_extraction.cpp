@@ -0,0 +1,245 @@
+//
+//  render_extraction.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "render_extraction.hpp"
+#include "Core/job_system.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+namespace
+{
+
+struct ExtractChunk
+{
+    size_t                  first;
+    size_t                  count;
+    const WorldTransform*   pTransforms;
+    const MeshInstance*     pMeshes;
+};
+
+// Stable LSD radix sort on 8-bit digits, skipping the digits every key shares.
+// Material and mesh ids are small, so that is usually two passes over the
+// packets instead of a comparison sort.
+void sortDrawPackets( std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch )
+{
+    if ( packets.empty() )
+    {
+        return;
+    }
+    uint64_t varying = 0;
+    for ( const DrawPacket& packet : packets )
+    {
+        varying |= packet.sortKey ^ packets[ 0 ].sortKey;
+    }
+
+    scratch.resize( packets.size() );
+    for ( uint32_t shift = 0; shift < 64; shift += 8 )
+    {
+        if ( ( ( varying >> shift ) & 0xFF ) == 0 )
+        {
+            continue;
+        }
+        size_t offsets[ 256 ] = {};
+        for ( const DrawPacket& packet : packets )
+        {
+            ++offsets[ ( packet.sortKey >> shift ) & 0xFF ];
+        }
+        size_t total = 0;
+        for ( size_t& offset : offsets )
+        {
+            size_t count = offset;
+            offset = total;
+            total += count;
+        }
+        for ( const DrawPacket& packet : packets )
+        {
+            scratch[ offsets[ ( packet.sortKey >> shift ) & 0xFF ]++ ] = packet;
+        }
+        packets.swap( scratch );
+    }
+}
+
+// Simulation-side components for the bench.
+struct Position
+{
+    float x, y, z;
+};
+
+struct Velocity
+{
+    float x, y, z;
+};
+
+struct Spin
+{
+    float angle;
+    float rate;
+};
+
+struct Tint
+{
+    float r, g, b, a;
+};
+
+const float kBenchStep = 1.0f / 60.0f;
+
+}
+
+void extractDrawPackets( World& world, JobSystem& jobs, DrawList& list )
+{
+    TRACE_SCOPE( "extractDrawPackets" );
+
+    // Output ranges come from the chunk sizes up front, so every chunk writes
+    // its own slice without synchronization.
+    std::vector<ExtractChunk> chunks;
+    size_t total = 0;
+    world.eachChunk<const WorldTransform, const MeshInstance>( [&]( size_t count, const WorldTransform* pTransforms, const MeshInstance* pMeshes )
+    {
+        chunks.push_back( { total, count, pTransforms, pMeshes } );
+        total += count;
+    } );
+
+    list.packets.resize( total );
+    list.transforms.resize( total );
+    jobs.parallelFor( chunks.size(), 1, [&]( size_t begin, size_t end )
+    {
+        for ( size_t c = begin; c < end; ++c )
+        {
+            const ExtractChunk& chunk = chunks[ c ];
+            for ( size_t i = 0; i < chunk.count; ++i )
+            {
+                const MeshInstance& mesh = chunk.pMeshes[ i ];
+                list.transforms[ chunk.first + i ] = chunk.pTransforms[ i ].matrix;
+                list.packets[ chunk.first + i ] = { drawSortKey( mesh.material, mesh.mesh ), mesh.mesh, mesh.material, uint32_t( chunk.first + i ) };
+            }
+        }
+    } );
+
+    std::vector<DrawPacket> scratch;
+    sortDrawPackets( list.packets, scratch );
+}
+
+std::vector<BenchResult> runEcsBench( const std::vector<uint32_t>& entityCounts, uint32_t frames,
+                                      JobSystem& jobs, size_t& problems )
+{
+    std::vector<BenchResult> results;
+    for ( uint32_t entities : entityCounts )
+    {
+        // Three in four entities are drawn and one in three is tinted, so the
+        // systems span four archetypes.
+        std::mt19937 rng( entities );
+        std::uniform_real_distribution<float> unit( -1.0f, 1.0f );
+        World world;
+        std::vector<Entity> handles;
+        auto spawn = [&]( uint32_t i )
+        {
+            Entity entity = world.create( Position { unit( rng ) * 100.0f, unit( rng ) * 100.0f, 0.0f },
+                                          Velocity { unit( rng ), unit( rng ), 0.0f },
+                                          Spin { 0.0f, unit( rng ) * 3.0f },
+                                          WorldTransform { math::identity4x4() } );
+            if ( i % 4 != 0 )
+            {
+                world.add( entity, MeshInstance { i % 7, i % 13 } );
+            }
+            if ( i % 3 == 0 )
+            {
+                world.add( entity, Tint { 1.0f, 1.0f, 1.0f, 1.0f } );
+            }
+            return entity;
+        };
+        for ( uint32_t i = 0; i < entities; ++i )
+        {
+            handles.push_back( spawn( i ) );
+        }
+        // Some churn, so chunks are refilled through the swap removal and free list.
+        for ( uint32_t i = 0; i < entities; i += 100 )
+        {
+            world.destroy( handles[ i ] );
+        }
+        for ( uint32_t i = 0; i < entities; i += 100 )
+        {
+            handles[ i ] = spawn( i );
+        }
+
+        SystemScheduler systems;
+        systems.add<const Velocity, Position>( "integrate", []( size_t count, const Velocity* pVelocity, Position* pPosition )
+        {
+            for ( size_t i = 0; i < count; ++i )
+            {
+                pPosition[ i ].x += pVelocity[ i ].x * kBenchStep;
+                pPosition[ i ].y += pVelocity[ i ].y * kBenchStep;
+                pPosition[ i ].z += pVelocity[ i ].z * kBenchStep;
+            }
+        } );
+        systems.add<Spin>( "spin", []( size_t count, Spin* pSpin )
+        {
+            for ( size_t i = 0; i < count; ++i )
+            {
+                pSpin[ i ].angle += pSpin[ i ].rate * kBenchStep;
+            }
+        } );
+        systems.add<const Position, const Spin, WorldTransform>( "transform", []( size_t count, const Position* pPosition, const Spin* pSpin, WorldTransform* pWorld )
+        {
+            for ( size_t i = 0; i < count; ++i )
+            {
+                pWorld[ i ].matrix = math::translation4x4( { pPosition[ i ].x, pPosition[ i ].y, pPosition[ i ].z } ) * math::rotationZ4x4( pSpin[ i ].angle );
+            }
+        } );
+
+        DrawList list;
+        std::vector<double> systemMs, extractMs;
+        for ( uint32_t frame = 0; frame < frames; ++frame )
+        {
+            uint64_t start = TraceRecorder::nowNs();
+            systems.run( world, jobs );
+            systemMs.push_back( double( TraceRecorder::nowNs() - start ) * 1e-6 );
+
+            start = TraceRecorder::nowNs();
+            extractDrawPackets( world, jobs, list );
+            extractMs.push_back( double( TraceRecorder::nowNs() - start ) * 1e-6 );
+        }
+
+        world.each<const Position, const Spin, const WorldTransform>( [&]( const Position& position, const Spin& spin, const WorldTransform& transform )
+        {
+            math::float4x4 expected = math::translation4x4( { position.x, position.y, position.z } ) * math::rotationZ4x4( spin.angle );
+            problems += memcmp( &expected, &transform.matrix, sizeof( math::float4x4 ) ) != 0;
+        } );
+
+        // Every drawn entity exactly once: the counts and the translations must add up.
+        size_t drawn = 0;
+        double expectedSum = 0.0, packetSum = 0.0;
+        world.each<const WorldTransform, const MeshInstance>( [&]( const WorldTransform& transform, const MeshInstance& )
+        {
+            ++drawn;
+            expectedSum += transform.matrix.columns[ 3 ].x;
+        } );
+        problems += list.packets.size() != drawn;
+        for ( size_t i = 0; i < list.packets.size(); ++i )
+        {
+            const DrawPacket& packet = list.packets[ i ];
+            problems += packet.sortKey != drawSortKey( packet.material, packet.mesh );
+            problems += i > 0 && packet.sortKey < list.packets[ i - 1 ].sortKey;
+            packetSum += list.transforms[ packet.transform ].columns[ 3 ].x;
+        }
+        problems += fabs( packetSum - expectedSum ) > 1e-6 * ( 1.0 + fabs( expectedSum ) ) * double( drawn );
+
+        BenchResult& update = results.emplace_back();
+        update.scene = "ecs-systems-" + std::to_string( entities );
+        update.cpuEncode = summarizeFrameTimes( systemMs );
+        update.memoryBytes = world.memoryBytes();
+
+        BenchResult& extract = results.emplace_back();
+        extract.scene = "ecs-extract-" + std::to_string( entities );
+        extract.cpuEncode = summarizeFrameTimes( extractMs );
+        extract.memoryBytes = list.packets.capacity() * sizeof( DrawPacket ) + list.transforms.capacity() * sizeof( math::float4x4 );
+    }
+    return results;
+}
@@ -0,0 +1,65 @@
+//
+//  render_extraction.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef render_extraction_hpp
+#define render_extraction_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Model/ecs.hpp"
+#include "Model/bench_suite.hpp"
+#include "Model/simd_math.hpp"
+
+// Components the renderer reads.
+struct WorldTransform
+{
+    math::float4x4 matrix;
+};
+
+struct MeshInstance
+{
+    uint32_t mesh;
+    uint32_t material;
+};
+
+// One draw of one mesh instance. Packets are sorted by material, then mesh,
+// so consecutive packets that share both can go out as one instanced draw.
+struct DrawPacket
+{
+    uint64_t sortKey;
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t transform;     // index into DrawList::transforms
+};
+
+// What the simulation hands the renderer for a frame. Transforms stay in
+// extraction order; packets index into them.
+struct DrawList
+{
+    std::vector<DrawPacket>     packets;
+    std::vector<math::float4x4> transforms;
+};
+
+inline uint64_t drawSortKey( uint32_t material, uint32_t mesh )
+{
+    return uint64_t( material ) << 32 | mesh;
+}
+
+// Copies every entity with a WorldTransform and a MeshInstance into list, one
+// job per chunk, then sorts the packets. Run it once the systems writing those
+// components are done; it only reads the world.
+void extractDrawPackets( World& world, JobSystem& jobs, DrawList& list );
+
+// Simulates entityCounts entities across several archetypes with scheduled
+// systems ("ecs-systems-N", world memory) and extracts their draw packets
+// ("ecs-extract-N", draw list memory). problems counts entities whose
+// transform or packet does not match a direct computation.
+std::vector<BenchResult> runEcsBench( const std::vector<uint32_t>& entityCounts, uint32_t frames,
+                                      JobSystem& jobs, size_t& problems );
+
+#endif /* render_extraction_hpp */
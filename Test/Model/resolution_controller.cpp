@@ -0,0 +1,65 @@
+//
+//  resolution_controller.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "resolution_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionController::ResolutionController( const ResolutionControllerSettings& settings )
+: _settings( settings )
+{
+    _settings.step = std::max( _settings.step, 1e-3f );
+    _settings.minScale = std::clamp( _settings.minScale, _settings.step, 1.0f );
+    _settings.maxScale = std::clamp( _settings.maxScale, _settings.minScale, 1.0f );
+    _scale = _settings.maxScale;
+}
+
+float ResolutionController::quantizeDown( float scale ) const
+{
+    // The small bias keeps exact multiples from falling to the step below.
+    float snapped = std::floor( scale / _settings.step + 1e-4f ) * _settings.step;
+    return std::clamp( snapped, _settings.minScale, _settings.maxScale );
+}
+
+void ResolutionController::addGpuFrame( double ms, float renderedScale )
+{
+    if ( _targetMs <= 0.0 || ms <= 0.0 || renderedScale <= 0.0f )
+    {
+        return;
+    }
+
+    const double Budget = _targetMs * ( 1.0 - double( _settings.headroom ) );
+    const double FullMs = ms / ( double( renderedScale ) * renderedScale );
+    _fullMs = _fullMs > 0.0 ? _fullMs + double( _settings.smoothing ) * ( FullMs - _fullMs ) : FullMs;
+
+    if ( ms > Budget )
+    {
+        // No smoothing on the way down: a spike costs one late frame, not several.
+        _scale = std::min( _scale, quantizeDown( float( std::sqrt( Budget / FullMs ) ) ) );
+        _framesWithRoom = 0;
+        return;
+    }
+
+    if ( quantizeDown( float( std::sqrt( Budget / _fullMs ) ) ) > _scale )
+    {
+        if ( ++_framesWithRoom >= _settings.raiseAfterFrames )
+        {
+            _scale = std::min( _scale + _settings.step, _settings.maxScale );
+            _framesWithRoom = 0;
+        }
+    }
+    else
+    {
+        _framesWithRoom = 0;
+    }
+}
+
+uint32_t ResolutionController::scaledDimension( uint32_t fullDimension ) const
+{
+    return std::max( 1u, uint32_t( std::lround( double( fullDimension ) * _scale ) ) );
+}
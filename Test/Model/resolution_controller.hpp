@@ -0,0 +1,62 @@
+//
+//  resolution_controller.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef resolution_controller_hpp
+#define resolution_controller_hpp
+
+#include <cstdint>
+
+struct ResolutionControllerSettings
+{
+    float    minScale         = 0.5f;           // per axis, so a quarter of the pixels
+    float    maxScale         = 1.0f;
+    float    step             = 1.0f / 16.0f;   // scales are multiples of this
+    float    headroom         = 0.15f;          // fraction of the frame interval kept free
+    float    smoothing        = 0.2f;           // weight of the newest frame in the average
+    uint32_t raiseAfterFrames = 30;             // frames with room for a larger scale before raising
+};
+
+// Picks the render resolution scale that keeps GPU frame time inside the frame
+// interval, assuming GPU time grows with the pixel count (scale squared).
+//
+// Each completed frame reports its GPU time together with the scale it was
+// rendered at, since with several frames in flight that is not the current
+// one. A frame over budget drops the scale at once to what that frame says
+// would fit; the scale goes back up one step at a time, and only after
+// raiseAfterFrames frames in a row where the smoothed cost leaves room for it.
+// Scales snap to multiples of `step` so the target size does not change every
+// frame.
+class ResolutionController
+{
+public:
+    explicit ResolutionController( const ResolutionControllerSettings& settings = ResolutionControllerSettings() );
+
+    // Frame interval the GPU has to fit, normally the pacer's target interval.
+    void setTargetMs( double ms )   { _targetMs = ms; }
+    double targetMs() const         { return _targetMs; }
+
+    void addGpuFrame( double ms, float renderedScale );
+
+    float scale() const             { return _scale; }
+
+    // One axis of the drawable scaled by the current scale, at least 1.
+    uint32_t scaledDimension( uint32_t fullDimension ) const;
+
+    // Smoothed estimate of what a frame would cost at scale 1.
+    double fullResolutionMs() const { return _fullMs; }
+
+private:
+    float quantizeDown( float scale ) const;
+
+    ResolutionControllerSettings    _settings;
+    double                          _targetMs = 0.0;
+    double                          _fullMs = 0.0;
+    float                           _scale;
+    uint32_t                        _framesWithRoom = 0;
+};
+
+#endif /* resolution_controller_hpp */
@@ -0,0 +1,192 @@
+//
+//  resource_tracker.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "resource_tracker.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+const char* resourceCategoryName( ResourceCategory category )
+{
+    switch ( category )
+    {
+        case ResourceCategory::Geometry:     return "Geometry";
+        case ResourceCategory::Texture:      return "Texture";
+        case ResourceCategory::RenderTarget: return "RenderTarget";
+        case ResourceCategory::Streaming:    return "Streaming";
+        case ResourceCategory::Staging:      return "Staging";
+        case ResourceCategory::Readback:     return "Readback";
+        case ResourceCategory::Other:        return "Other";
+        case ResourceCategory::Count:        break;
+    }
+    return "?";
+}
+
+ResourceTracker::AllocationId ResourceTracker::add( ResourceCategory category, size_t bytes, const char* label )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    return addLocked( category, bytes, label );
+}
+
+ResourceTracker::AllocationId ResourceTracker::addLocked( ResourceCategory category, size_t bytes, const char* label )
+{
+    AllocationId id = _nextId++;
+    _live.emplace( id, Allocation { id, category, bytes, label ? label : "" } );
+
+    CategoryStats& stats = _categories[ size_t( category ) ];
+    stats.currentBytes += bytes;
+    stats.highWaterBytes = std::max( stats.highWaterBytes, stats.currentBytes );
+    ++stats.liveCount;
+
+    _totalBytes += bytes;
+    _totalHighWater = std::max( _totalHighWater, _totalBytes );
+    return id;
+}
+
+void ResourceTracker::remove( AllocationId id )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    auto it = _live.find( id );
+    if ( it == _live.end() )
+    {
+        __builtin_printf( "ResourceTracker: removing unknown allocation %llu\n", (unsigned long long)id );
+        assert( false );
+        return;
+    }
+
+    CategoryStats& stats = _categories[ size_t( it->second.category ) ];
+    stats.currentBytes -= it->second.bytes;
+    --stats.liveCount;
+    _totalBytes -= it->second.bytes;
+    _live.erase( it );
+}
+
+void ResourceTracker::setBudget( ResourceCategory category, size_t budgetBytes )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    _categories[ size_t( category ) ].budgetBytes = budgetBytes;
+}
+
+void ResourceTracker::setEvictionFunction( ResourceCategory category, const EvictionFunction& function )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    _evict[ size_t( category ) ] = function;
+}
+
+bool ResourceTracker::fitsLocked( ResourceCategory category, size_t bytes ) const
+{
+    const CategoryStats& stats = _categories[ size_t( category ) ];
+    return bytes == 0 || stats.budgetBytes == 0 || stats.currentBytes + bytes <= stats.budgetBytes;
+}
+
+ResourceTracker::AllocationId ResourceTracker::reserve( ResourceCategory category, size_t bytes, const char* label )
+{
+    const size_t Index = size_t( category );
+    for ( ;; )
+    {
+        EvictionFunction evict;
+        size_t before, over;
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            if ( fitsLocked( category, bytes ) )
+            {
+                return addLocked( category, bytes, label );
+            }
+            if ( !_evict[ Index ] )
+            {
+                return kNoAllocation;
+            }
+            const CategoryStats& stats = _categories[ Index ];
+            evict = _evict[ Index ];
+            before = stats.currentBytes;
+            over = stats.currentBytes + bytes - stats.budgetBytes;
+        }
+
+        evict( over );
+
+        // Give up once the callback stops making progress.
+        std::lock_guard<std::mutex> lock( _mutex );
+        if ( _categories[ Index ].currentBytes >= before )
+        {
+            return fitsLocked( category, bytes ) ? addLocked( category, bytes, label ) : kNoAllocation;
+        }
+    }
+}
+
+void ResourceTracker::commit( AllocationId id, size_t bytes )
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    auto it = _live.find( id );
+    if ( it == _live.end() )
+    {
+        __builtin_printf( "ResourceTracker: committing unknown allocation %llu\n", (unsigned long long)id );
+        assert( false );
+        return;
+    }
+
+    CategoryStats& stats = _categories[ size_t( it->second.category ) ];
+    stats.currentBytes = stats.currentBytes - it->second.bytes + bytes;
+    stats.highWaterBytes = std::max( stats.highWaterBytes, stats.currentBytes );
+    _totalBytes = _totalBytes - it->second.bytes + bytes;
+    _totalHighWater = std::max( _totalHighWater, _totalBytes );
+    it->second.bytes = bytes;
+}
+
+ResourceTracker::CategoryStats ResourceTracker::stats( ResourceCategory category ) const
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _categories[ size_t( category ) ];
+}
+
+size_t ResourceTracker::totalBytes() const
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _totalBytes;
+}
+
+size_t ResourceTracker::totalHighWaterBytes() const
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _totalHighWater;
+}
+
+std::vector<ResourceTracker::Allocation> ResourceTracker::liveAllocations() const
+{
+    std::vector<Allocation> result;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        result.reserve( _live.size() );
+        for ( const auto& entry : _live )
+        {
+            result.push_back( entry.second );
+        }
+    }
+    std::sort( result.begin(), result.end(), []( const Allocation& a, const Allocation& b )
+    {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.id < b.id;
+    } );
+    return result;
+}
+
+void ResourceTracker::dump() const
+{
+    const double MB = 1.0 / ( 1024.0 * 1024.0 );
+    __builtin_printf( "%-14s %10s %10s %10s %6s\n", "category", "live MB", "peak MB", "budget MB", "count" );
+    for ( size_t i = 0; i < kCategoryCount; ++i )
+    {
+        CategoryStats s = stats( ResourceCategory( i ) );
+        __builtin_printf( "%-14s %10.2f %10.2f %10.2f %6zu\n", resourceCategoryName( ResourceCategory( i ) ),
+                          double( s.currentBytes ) * MB, double( s.highWaterBytes ) * MB, double( s.budgetBytes ) * MB, s.liveCount );
+    }
+    __builtin_printf( "%-14s %10.2f %10.2f\n", "total", double( totalBytes() ) * MB, double( totalHighWaterBytes() ) * MB );
+
+    for ( const Allocation& allocation : liveAllocations() )
+    {
+        __builtin_printf( "  #%-6llu %-12s %12zu  %s\n", (unsigned long long)allocation.id,
+                          resourceCategoryName( allocation.category ), allocation.bytes, allocation.label.c_str() );
+    }
+}
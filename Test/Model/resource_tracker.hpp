@@ -0,0 +1,106 @@
+//
+//  resource_tracker.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef resource_tracker_hpp
+#define resource_tracker_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class ResourceCategory : uint8_t
+{
+    Geometry,
+    Texture,
+    RenderTarget,
+    Streaming,
+    Staging,
+    Readback,
+    Other,
+    Count
+};
+
+const char* resourceCategoryName( ResourceCategory category );
+
+// Byte accounting for GPU allocations, by category, with high-water marks and
+// optional per-category budgets. Knows nothing about Metal; View/resource_registry
+// feeds it from the actual allocations. Thread-safe.
+class ResourceTracker
+{
+public:
+    using AllocationId = uint64_t;
+
+    // Asked to free at least bytesToFree from its category, typically by
+    // releasing resources, which calls remove(). Called without the lock held.
+    using EvictionFunction = std::function<void( size_t bytesToFree )>;
+
+    struct Allocation
+    {
+        AllocationId        id;
+        ResourceCategory    category;
+        size_t              bytes;
+        std::string         label;
+    };
+
+    struct CategoryStats
+    {
+        size_t currentBytes   = 0;
+        size_t highWaterBytes = 0;
+        size_t budgetBytes    = 0;  // 0 means unlimited
+        size_t liveCount      = 0;
+    };
+
+    static constexpr AllocationId kNoAllocation = 0;
+
+    // Records an allocation that has already been made, ignoring the budget.
+    AllocationId add( ResourceCategory category, size_t bytes, const char* label );
+    void remove( AllocationId id );
+
+    void setBudget( ResourceCategory category, size_t budgetBytes );
+    void setEvictionFunction( ResourceCategory category, const EvictionFunction& function );
+
+    // Makes room for `bytes` more in the category, running its eviction function
+    // while over budget and it keeps freeing memory, and records them as a live
+    // allocation under the same lock as the budget check, so two threads cannot
+    // both take the last of a budget. Returns kNoAllocation if they don't fit.
+    // Follow with commit() once the resource exists, or remove() if creating it
+    // failed.
+    AllocationId reserve( ResourceCategory category, size_t bytes, const char* label );
+
+    // Replaces a reservation's estimate with the size actually allocated.
+    void commit( AllocationId id, size_t bytes );
+
+    CategoryStats stats( ResourceCategory category ) const;
+    size_t totalBytes() const;
+    size_t totalHighWaterBytes() const;
+
+    // Live allocations, largest first.
+    std::vector<Allocation> liveAllocations() const;
+
+    // Prints per-category totals and every live allocation.
+    void dump() const;
+
+private:
+    static constexpr size_t kCategoryCount = size_t( ResourceCategory::Count );
+
+    AllocationId addLocked( ResourceCategory category, size_t bytes, const char* label );
+    bool fitsLocked( ResourceCategory category, size_t bytes ) const;
+
+    mutable std::mutex                              _mutex;
+    std::unordered_map<AllocationId, Allocation>    _live;
+    CategoryStats                                   _categories[ kCategoryCount ];
+    EvictionFunction                                _evict[ kCategoryCount ];
+    AllocationId                                    _nextId = 1;
+    size_t                                          _totalBytes = 0;
+    size_t                                          _totalHighWater = 0;
+};
+
+#endif /* resource_tracker_hpp */
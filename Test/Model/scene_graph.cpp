@@ -0,0 +1,260 @@
+//
+//  scene_graph.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "scene_graph.hpp"
+#include "Core/job_system.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace
+{
+
+// Levels smaller than this run on the calling thread; splitting them costs more
+// than the multiplies.
+const size_t kLevelGrain = 2048;
+
+}
+
+uint32_t SceneGraph::addNode( uint32_t parent, const math::float4x4& local )
+{
+    uint32_t node = uint32_t( _slotOfNode.size() );
+    uint32_t depth = parent == kNoParent ? 0 : _depth[ parent ] + 1;
+
+    // Appended in handle order, which already puts parents first; levels are
+    // made contiguous again by the next sortByDepth().
+    uint32_t slot = uint32_t( _parent.size() );
+    _parent.push_back( parent == kNoParent ? kNoParent : _slotOfNode[ parent ] );
+    _local.push_back( local );
+    _world.push_back( local );
+    _dirty.push_back( 1 );
+    _changed.push_back( 0 );
+    _slotOfNode.push_back( slot );
+    _nodeOfSlot.push_back( node );
+    _depth.push_back( depth );
+    _unsorted = true;
+    _anyDirty = true;
+    return node;
+}
+
+void SceneGraph::setLocal( uint32_t node, const math::float4x4& local )
+{
+    uint32_t slot = _slotOfNode[ node ];
+    _local[ slot ] = local;
+    _dirty[ slot ] = 1;
+    _anyDirty = true;
+}
+
+uint32_t SceneGraph::slot( uint32_t node )
+{
+    if ( _unsorted )
+    {
+        sortByDepth();
+    }
+    return _slotOfNode[ node ];
+}
+
+const math::float4x4& SceneGraph::world( uint32_t node )
+{
+    return _world[ slot( node ) ];
+}
+
+// Stable counting sort of the slots by depth.
+void SceneGraph::sortByDepth()
+{
+    TRACE_SCOPE( "SceneGraph::sortByDepth" );
+    uint32_t maxDepth = 0;
+    for ( uint32_t depth : _depth )
+    {
+        maxDepth = std::max( maxDepth, depth );
+    }
+    _levelStart.assign( maxDepth + 2, 0 );
+    for ( uint32_t depth : _depth )
+    {
+        ++_levelStart[ depth + 1 ];
+    }
+    for ( size_t level = 1; level < _levelStart.size(); ++level )
+    {
+        _levelStart[ level ] += _levelStart[ level - 1 ];
+    }
+
+    const size_t Count = _parent.size();
+    std::vector<uint32_t> newSlotOf( Count );
+    std::vector<uint32_t> next( _levelStart.begin(), _levelStart.end() - 1 );
+    for ( size_t slot = 0; slot < Count; ++slot )
+    {
+        newSlotOf[ slot ] = next[ _depth[ _nodeOfSlot[ slot ] ] ]++;
+    }
+
+    std::vector<uint32_t> parent( Count );
+    std::vector<math::float4x4> local( Count ), world( Count );
+    std::vector<uint8_t> dirty( Count );
+    for ( size_t slot = 0; slot < Count; ++slot )
+    {
+        uint32_t to = newSlotOf[ slot ];
+        parent[ to ] = _parent[ slot ] == kNoParent ? kNoParent : newSlotOf[ _parent[ slot ] ];
+        local[ to ] = _local[ slot ];
+        world[ to ] = _world[ slot ];
+        dirty[ to ] = _dirty[ slot ];
+    }
+    for ( size_t node = 0; node < Count; ++node )
+    {
+        _slotOfNode[ node ] = newSlotOf[ _slotOfNode[ node ] ];
+        _nodeOfSlot[ _slotOfNode[ node ] ] = uint32_t( node );
+    }
+    _parent.swap( parent );
+    _local.swap( local );
+    _world.swap( world );
+    _dirty.swap( dirty );
+    _unsorted = false;
+}
+
+size_t SceneGraph::update( JobSystem& jobs, math::float4x4* pUpload )
+{
+    TRACE_SCOPE( "SceneGraph::update" );
+    if ( _unsorted )
+    {
+        sortByDepth();
+    }
+
+    if ( !_anyDirty )
+    {
+        // Nothing moved; the upload still needs the whole frame.
+        if ( pUpload )
+        {
+            jobs.parallelFor( _world.size(), kLevelGrain * 8, [&]( size_t begin, size_t end )
+            {
+                memcpy( pUpload + begin, _world.data() + begin, ( end - begin ) * sizeof( math::float4x4 ) );
+            } );
+        }
+        return 0;
+    }
+
+    // Levels in order, so a node's parent is final before it is read. Within a
+    // level nodes are independent.
+    std::atomic<size_t> recomputed { 0 };
+    for ( size_t level = 0; level + 1 < _levelStart.size(); ++level )
+    {
+        const size_t Begin = _levelStart[ level ];
+        const size_t Count = _levelStart[ level + 1 ] - Begin;
+        jobs.parallelFor( Count, Count < kLevelGrain ? Count : kLevelGrain, [&]( size_t begin, size_t end )
+        {
+            size_t changed = 0;
+            for ( size_t i = Begin + begin; i < Begin + end; ++i )
+            {
+                uint32_t parent = _parent[ i ];
+                bool recompute = _dirty[ i ] || ( parent != kNoParent && _changed[ parent ] );
+                if ( recompute )
+                {
+                    _world[ i ] = parent == kNoParent ? _local[ i ] : _world[ parent ] * _local[ i ];
+                    ++changed;
+                }
+                _changed[ i ] = recompute;
+                _dirty[ i ] = 0;
+                if ( pUpload )
+                {
+                    pUpload[ i ] = _world[ i ];
+                }
+            }
+            recomputed.fetch_add( changed, std::memory_order_relaxed );
+        } );
+    }
+    _anyDirty = false;
+    return recomputed.load();
+}
+
+std::vector<BenchResult> runSceneGraphBench( const std::vector<uint32_t>& nodeCounts, uint32_t frames,
+                                             JobSystem& jobs, size_t& problems )
+{
+    std::vector<BenchResult> results;
+    for ( uint32_t nodes : nodeCounts )
+    {
+        // Roughly four children per node, so depth grows with log4 of the
+        // count, with a fresh root every 10k nodes.
+        std::mt19937 rng( nodes );
+        std::vector<uint32_t> parents( nodes );
+        std::vector<math::float4x4> locals( nodes );
+        SceneGraph graph;
+        for ( uint32_t i = 0; i < nodes; ++i )
+        {
+            parents[ i ] = i % 10000 == 0 ? SceneGraph::kNoParent : i - 1 - rng() % std::min( i, ( i + 3 ) / 4 );
+            locals[ i ] = math::translation4x4( { float( rng() % 100 ) * 0.01f, 1.0f, 0.0f } ) * math::rotationZ4x4( float( rng() % 628 ) * 0.01f );
+            graph.addNode( parents[ i ], locals[ i ] );
+        }
+        std::vector<math::float4x4> upload( nodes );
+        graph.update( jobs, upload.data() );
+
+        // Handles are in parent-first order, so one pass evaluates the reference.
+        // Checked after a partial update too, where most nodes keep last frame's world.
+        std::vector<math::float4x4> reference( nodes );
+        auto countWrongWorlds = [&]
+        {
+            size_t wrong = 0;
+            for ( uint32_t i = 0; i < nodes; ++i )
+            {
+                reference[ i ] = parents[ i ] == SceneGraph::kNoParent ? locals[ i ] : reference[ parents[ i ] ] * locals[ i ];
+                const math::float4x4& uploaded = upload[ graph.slot( i ) ];
+                bool close = true;
+                for ( int c = 0; c < 4; ++c )
+                {
+                    for ( int r = 0; r < 4; ++r )
+                    {
+                        float expected = reference[ i ].columns[ c ][ r ];
+                        close &= fabsf( uploaded.columns[ c ][ r ] - expected ) <= 1e-3f * ( 1.0f + fabsf( expected ) );
+                    }
+                }
+                wrong += close ? 0 : 1;
+            }
+            return wrong;
+        };
+
+        const math::float4x4 Step = math::rotationZ4x4( 0.01f );
+        std::vector<double> dirtyMs, fullMs;
+        for ( uint32_t frame = 0; frame < frames; ++frame )
+        {
+            // 2% of the nodes animate; their subtrees follow.
+            for ( uint32_t i = 0; i < nodes / 50; ++i )
+            {
+                uint32_t node = rng() % nodes;
+                locals[ node ] = locals[ node ] * Step;
+                graph.setLocal( node, locals[ node ] );
+            }
+            uint64_t start = TraceRecorder::nowNs();
+            graph.update( jobs, upload.data() );
+            dirtyMs.push_back( double( TraceRecorder::nowNs() - start ) * 1e-6 );
+            if ( frame + 1 == frames )
+            {
+                problems += countWrongWorlds();
+            }
+
+            for ( uint32_t node = 0; node < nodes; ++node )
+            {
+                graph.setLocal( node, locals[ node ] );
+            }
+            start = TraceRecorder::nowNs();
+            graph.update( jobs, upload.data() );
+            fullMs.push_back( double( TraceRecorder::nowNs() - start ) * 1e-6 );
+        }
+        problems += countWrongWorlds();
+
+        BenchResult& dirty = results.emplace_back();
+        dirty.scene = "scene-dirty-" + std::to_string( nodes );
+        dirty.cpuEncode = summarizeFrameTimes( dirtyMs );
+        dirty.memoryBytes = size_t( nodes ) * ( 2 * sizeof( math::float4x4 ) + sizeof( uint32_t ) + 2 );
+
+        BenchResult& full = results.emplace_back();
+        full.scene = "scene-full-" + std::to_string( nodes );
+        full.cpuEncode = summarizeFrameTimes( fullMs );
+        full.memoryBytes = dirty.memoryBytes;
+    }
+    return results;
+}
@@ -0,0 +1,75 @@
+//
+//  scene_graph.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef scene_graph_hpp
+#define scene_graph_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Model/bench_suite.hpp"
+#include "Model/simd_math.hpp"
+
+class JobSystem;
+
+// Transform hierarchy in structure-of-arrays form. Nodes are kept sorted by
+// depth, so every parent comes before its children and each level is one
+// contiguous range; parents are indices into that order. Handles returned by
+// addNode() stay valid while the order changes underneath.
+//
+// setLocal() only marks the node dirty. update() then walks the levels in
+// order, recomputing the world matrix of every dirty node and every node whose
+// parent changed, with the nodes of one level split across the job system.
+class SceneGraph
+{
+public:
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    // parent must be an existing handle, or kNoParent for a root.
+    uint32_t addNode( uint32_t parent, const math::float4x4& local );
+    void setLocal( uint32_t node, const math::float4x4& local );
+
+    size_t size() const { return _parent.size(); }
+    size_t levelCount() const { return _levelStart.empty() ? 0 : _levelStart.size() - 1; }
+
+    // Recomputes dirty subtrees. With pUpload, also writes every node's world
+    // matrix there, in slot() order, so a per-frame upload buffer gets the
+    // whole frame in the same pass instead of a copy afterwards. Returns the
+    // number of world matrices recomputed.
+    size_t update( JobSystem& jobs, math::float4x4* pUpload = nullptr );
+
+    // Where a node's world matrix is in the upload; changes when nodes are added.
+    uint32_t slot( uint32_t node );
+    const math::float4x4& world( uint32_t node );
+
+private:
+    void sortByDepth();
+
+    // Per node, in depth order.
+    std::vector<uint32_t>           _parent;
+    std::vector<math::float4x4>     _local;
+    std::vector<math::float4x4>     _world;
+    std::vector<uint8_t>            _dirty;         // local changed since the last update
+    std::vector<uint8_t>            _changed;       // world recomputed in the current update
+
+    std::vector<uint32_t>           _levelStart;    // level i covers [ _levelStart[ i ], _levelStart[ i + 1 ] )
+    std::vector<uint32_t>           _slotOfNode;    // handle -> depth order
+    std::vector<uint32_t>           _nodeOfSlot;
+    std::vector<uint32_t>           _depth;         // by handle
+    bool                            _unsorted = false;
+    bool                            _anyDirty = false;
+};
+
+// Builds random hierarchies of each size and times updates with a few percent
+// of the nodes animated ("scene-dirty-N") and with every node dirty
+// ("scene-full-N"), uploading into a scratch buffer. problems counts world
+// matrices that differ from a plain recursive evaluation, after the last
+// partial update and again after the last full one.
+std::vector<BenchResult> runSceneGraphBench( const std::vector<uint32_t>& nodeCounts, uint32_t frames,
+                                             JobSystem& jobs, size_t& problems );
+
+#endif /* scene_graph_hpp */
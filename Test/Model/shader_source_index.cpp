@@ -0,0 +1,332 @@
+//
+//  shader_source_index.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "shader_source_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+
+const uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+const uint64_t kFnvPrime = 0x100000001b3ull;
+
+uint64_t hashBytes( uint64_t hash, const char* pBytes, size_t count )
+{
+    for ( size_t i = 0; i < count; ++i )
+    {
+        hash = ( hash ^ uint8_t( pBytes[ i ] ) ) * kFnvPrime;
+    }
+    return hash;
+}
+
+bool isIdentifierStart( char c )
+{
+    return std::isalpha( uint8_t( c ) ) || c == '_';
+}
+
+bool isIdentifierChar( char c )
+{
+    return std::isalnum( uint8_t( c ) ) || c == '_';
+}
+
+// Drops comments and folds every whitespace run into one space, keeping
+// string and character literals as they are.
+std::string normalize( const std::string& source )
+{
+    std::string out;
+    out.reserve( source.size() );
+    bool pendingSpace = false;
+    bool inDirective = false;
+    for ( size_t i = 0; i < source.size(); ++i )
+    {
+        char c = source[ i ];
+        if ( c == '/' && i + 1 < source.size() && source[ i + 1 ] == '/' )
+        {
+            while ( i < source.size() && source[ i ] != '\n' )
+            {
+                ++i;
+            }
+            c = '\n';
+        }
+        else if ( c == '/' && i + 1 < source.size() && source[ i + 1 ] == '*' )
+        {
+            size_t end = source.find( "*/", i + 2 );
+            i = end == std::string::npos ? source.size() : end + 1;
+            pendingSpace = true;
+            continue;
+        }
+
+        // Newlines end preprocessor lines, so those keep theirs; anywhere else
+        // they fold like any other whitespace.
+        if ( c == '\n' && inDirective )
+        {
+            out += '\n';
+            inDirective = false;
+            pendingSpace = false;
+            continue;
+        }
+        if ( std::isspace( uint8_t( c ) ) )
+        {
+            pendingSpace = !out.empty() && out.back() != '\n';
+            continue;
+        }
+        if ( c == '#' && !inDirective && ( out.empty() || out.back() == '\n' || out.back() == ';' || out.back() == '}' ) )
+        {
+            out += out.empty() || out.back() == '\n' ? "" : "\n";
+            inDirective = true;
+            pendingSpace = false;
+        }
+        if ( pendingSpace )
+        {
+            out += ' ';
+            pendingSpace = false;
+        }
+        if ( c == '"' || c == '\'' )
+        {
+            size_t start = i++;
+            while ( i < source.size() && source[ i ] != c )
+            {
+                i += source[ i ] == '\\' ? 2 : 1;
+            }
+            out.append( source, start, std::min( i, source.size() - 1 ) - start + 1 );
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::vector<std::string> identifiers( const std::string& text, size_t begin, size_t end )
+{
+    std::vector<std::string> out;
+    for ( size_t i = begin; i < end; )
+    {
+        if ( isIdentifierStart( text[ i ] ) && ( i == begin || !isIdentifierChar( text[ i - 1 ] ) ) )
+        {
+            size_t start = i;
+            while ( i < end && isIdentifierChar( text[ i ] ) )
+            {
+                ++i;
+            }
+            out.push_back( text.substr( start, i - start ) );
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return out;
+}
+
+struct Item
+{
+    std::string name;
+    bool        entryPoint;
+};
+
+// Names a top-level item: the tag of a struct, the macro of a #define, or the
+// last identifier ahead of the first (, [, = or {. Empty for anything else.
+Item describeItem( const std::string& text )
+{
+    static const std::unordered_set<std::string> Tags = { "struct", "class", "enum", "union" };
+    static const std::unordered_set<std::string> Stages = { "vertex", "fragment", "kernel", "visible", "stitchable" };
+
+    if ( text.compare( 0, 7, "#define" ) == 0 )
+    {
+        std::vector<std::string> words = identifiers( text, 7, text.size() );
+        return { words.empty() ? std::string() : words[ 0 ], false };
+    }
+    if ( text[ 0 ] == '#' || text.compare( 0, 6, "using " ) == 0 )
+    {
+        return { std::string(), false };
+    }
+
+    size_t stop = text.find_first_of( "([={;" );
+    std::vector<std::string> words = identifiers( text, 0, stop == std::string::npos ? text.size() : stop );
+    if ( words.empty() )
+    {
+        return { std::string(), false };
+    }
+    if ( Tags.count( words[ 0 ] ) )
+    {
+        return { words.size() > 1 ? words[ 1 ] : std::string(), false };
+    }
+
+    bool entryPoint = false;
+    for ( const std::string& word : words )
+    {
+        entryPoint |= Stages.count( word ) != 0;
+    }
+    // Attribute forms, [[kernel]] or [[visible]], come ahead of the return type.
+    for ( const char* pStage : { "[[kernel]]", "[[visible]]", "[[stitchable]]" } )
+    {
+        size_t at = text.find( pStage );
+        entryPoint |= at != std::string::npos && at < text.find( '(' );
+    }
+    return { words.back(), entryPoint && text[ stop ] == '(' };
+}
+
+}
+
+const ShaderDeclaration* ShaderSourceIndex::find( const std::string& name ) const
+{
+    for ( const ShaderDeclaration& declaration : declarations )
+    {
+        if ( declaration.name == name )
+        {
+            return &declaration;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t ShaderSourceIndex::closureHash( const std::string& entryPoint ) const
+{
+    std::vector<const ShaderDeclaration*> closure;
+    std::unordered_set<std::string> seen = { entryPoint };
+    std::vector<std::string> pending = { entryPoint };
+    while ( !pending.empty() )
+    {
+        const ShaderDeclaration* pDeclaration = find( pending.back() );
+        pending.pop_back();
+        if ( !pDeclaration )
+        {
+            continue;
+        }
+        closure.push_back( pDeclaration );
+        for ( const std::string& reference : pDeclaration->references )
+        {
+            if ( seen.insert( reference ).second )
+            {
+                pending.push_back( reference );
+            }
+        }
+    }
+
+    // Order independent, so moving a helper around the file changes nothing.
+    std::sort( closure.begin(), closure.end(), []( const ShaderDeclaration* a, const ShaderDeclaration* b ) { return a->name < b->name; } );
+    uint64_t hash = hashBytes( kFnvOffset, reinterpret_cast<const char*>( &globalHash ), sizeof( globalHash ) );
+    for ( const ShaderDeclaration* pDeclaration : closure )
+    {
+        hash = hashBytes( hash, pDeclaration->name.data(), pDeclaration->name.size() );
+        hash = hashBytes( hash, reinterpret_cast<const char*>( &pDeclaration->hash ), sizeof( pDeclaration->hash ) );
+    }
+    return hash;
+}
+
+ShaderSourceIndex indexShaderSource( const std::string& source )
+{
+    const std::string Text = normalize( source );
+
+    // Split at semicolons and closing braces at depth 0. A brace ends the item
+    // unless it closes a struct or an initializer, which end at their semicolon.
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t start = 0;
+    int depth = 0;
+    for ( size_t i = 0; i < Text.size(); ++i )
+    {
+        char c = Text[ i ];
+        if ( depth == 0 && i == start && ( c == '\n' || c == ' ' ) )
+        {
+            ++start;
+            continue;
+        }
+        if ( depth == 0 && c == '#' && i == start )
+        {
+            size_t end = Text.find( '\n', i );
+            end = end == std::string::npos ? Text.size() : end;
+            ranges.push_back( { start, end } );
+            i = end;
+            start = end + 1;
+            continue;
+        }
+
+        depth += c == '{' ? 1 : ( c == '}' ? -1 : 0 );
+        bool closesBody = c == '}' && depth == 0;
+        if ( closesBody )
+        {
+            std::string head = Text.substr( start, Text.find( '{', start ) - start );
+            std::vector<std::string> words = identifiers( head, 0, head.size() );
+            bool waitsForSemicolon = head.find( '=' ) != std::string::npos
+                || ( !words.empty() && ( words[ 0 ] == "struct" || words[ 0 ] == "class" || words[ 0 ] == "enum" || words[ 0 ] == "union" ) );
+            closesBody = !waitsForSemicolon;
+        }
+        if ( closesBody || ( c == ';' && depth == 0 ) )
+        {
+            ranges.push_back( { start, i + 1 } );
+            start = i + 1;
+        }
+    }
+
+    ShaderSourceIndex index;
+    index.globalHash = kFnvOffset;
+    std::unordered_map<std::string, size_t> byName;
+    std::vector<std::string> texts;
+    for ( const std::pair<size_t, size_t>& range : ranges )
+    {
+        std::string text = Text.substr( range.first, range.second - range.first );
+        Item item = describeItem( text );
+        if ( item.name.empty() )
+        {
+            index.globalHash = hashBytes( index.globalHash, text.data(), text.size() );
+            continue;
+        }
+
+        auto found = byName.find( item.name );
+        if ( found == byName.end() )
+        {
+            found = byName.emplace( item.name, index.declarations.size() ).first;
+            index.declarations.push_back( ShaderDeclaration() );
+            index.declarations.back().name = item.name;
+            index.declarations.back().hash = kFnvOffset;
+            texts.emplace_back();
+        }
+        ShaderDeclaration& declaration = index.declarations[ found->second ];
+        declaration.entryPoint |= item.entryPoint;
+        declaration.hash = hashBytes( declaration.hash, text.data(), text.size() );
+        texts[ found->second ] += text;
+        texts[ found->second ] += '\n';
+    }
+
+    // References are resolved once every name is known, so uses ahead of a
+    // declaration (prototypes) still count.
+    for ( size_t i = 0; i < index.declarations.size(); ++i )
+    {
+        ShaderDeclaration& declaration = index.declarations[ i ];
+        std::unordered_set<std::string> seen;
+        for ( std::string& word : identifiers( texts[ i ], 0, texts[ i ].size() ) )
+        {
+            if ( word != declaration.name && byName.count( word ) && seen.insert( word ).second )
+            {
+                declaration.references.push_back( std::move( word ) );
+            }
+        }
+    }
+    return index;
+}
+
+std::vector<std::string> changedEntryPoints( const ShaderSourceIndex& before, const ShaderSourceIndex& after )
+{
+    std::vector<std::string> changed;
+    for ( const ShaderDeclaration& declaration : after.declarations )
+    {
+        if ( !declaration.entryPoint )
+        {
+            continue;
+        }
+        const ShaderDeclaration* pBefore = before.find( declaration.name );
+        if ( !pBefore || after.closureHash( declaration.name ) != before.closureHash( declaration.name ) )
+        {
+            changed.push_back( declaration.name );
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,45 @@
+//
+//  shader_source_index.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef shader_source_index_hpp
+#define shader_source_index_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One top-level declaration of a Metal source: a function, struct, constant or
+// #define. Overloads share one entry.
+struct ShaderDeclaration
+{
+    std::string                 name;
+    bool                        entryPoint = false;     // vertex, fragment, kernel, visible or stitchable
+    uint64_t                    hash = 0;               // of the text with comments and extra whitespace removed
+    std::vector<std::string>    references;             // other declarations named in the text
+};
+
+// A lightweight index of a Metal source, enough to tell which entry points an
+// edit can affect without compiling. It splits on top-level braces and
+// semicolons rather than parsing, which holds for this repo's shaders.
+struct ShaderSourceIndex
+{
+    std::vector<ShaderDeclaration>  declarations;
+    uint64_t                        globalHash = 0;     // #include, using and other unnamed lines, which affect everything
+
+    const ShaderDeclaration* find( const std::string& name ) const;
+
+    // Hash of an entry point and everything it references, directly or not.
+    uint64_t closureHash( const std::string& entryPoint ) const;
+};
+
+ShaderSourceIndex indexShaderSource( const std::string& source );
+
+// Entry points of after whose code, or any declaration it depends on, differs
+// from before, including ones before did not have.
+std::vector<std::string> changedEntryPoints( const ShaderSourceIndex& before, const ShaderSourceIndex& after );
+
+#endif /* shader_source_index_hpp */
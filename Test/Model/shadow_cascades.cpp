@@ -0,0 +1,213 @@
+//
+//  shadow_cascades.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "shadow_cascades.hpp"
+#include "Core/job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const uint32_t kMaxCascades = 8;
+
+float dot3( const float a[ 3 ], const float b[ 3 ] )
+{
+    return a[ 0 ] * b[ 0 ] + a[ 1 ] * b[ 1 ] + a[ 2 ] * b[ 2 ];
+}
+
+void cross3( const float a[ 3 ], const float b[ 3 ], float out[ 3 ] )
+{
+    out[ 0 ] = a[ 1 ] * b[ 2 ] - a[ 2 ] * b[ 1 ];
+    out[ 1 ] = a[ 2 ] * b[ 0 ] - a[ 0 ] * b[ 2 ];
+    out[ 2 ] = a[ 0 ] * b[ 1 ] - a[ 1 ] * b[ 0 ];
+}
+
+void normalize3( float v[ 3 ] )
+{
+    float length = std::sqrt( dot3( v, v ) );
+    for ( int i = 0; i < 3; ++i )
+    {
+        v[ i ] = length > 0.0f ? v[ i ] / length : 0.0f;
+    }
+}
+
+}
+
+ShadowCascades::ShadowCascades( const CascadeSettings& settings )
+: _settings( settings )
+{
+    _settings.cascadeCount = std::clamp( _settings.cascadeCount, 1u, kMaxCascades );
+    _settings.mapSize = std::max( _settings.mapSize, 1u );
+    _cascades.resize( _settings.cascadeCount );
+
+    const float Down[ 3 ] = { 0.0f, -1.0f, 0.0f };
+    setLightDirection( Down );
+}
+
+void ShadowCascades::setLightDirection( const float direction[ 3 ] )
+{
+    float* x = _lightAxes[ 0 ];
+    float* y = _lightAxes[ 1 ];
+    float* z = _lightAxes[ 2 ];
+    for ( int i = 0; i < 3; ++i )
+    {
+        z[ i ] = direction[ i ];
+    }
+    normalize3( z );
+
+    const float UpY[ 3 ] = { 0.0f, 1.0f, 0.0f };
+    const float UpX[ 3 ] = { 1.0f, 0.0f, 0.0f };
+    cross3( std::fabs( z[ 1 ] ) < 0.99f ? UpY : UpX, z, x );
+    normalize3( x );
+    cross3( z, x, y );
+    _valid = false;
+}
+
+void ShadowCascades::toLightSpace( const float world[ 3 ], float light[ 3 ] ) const
+{
+    for ( int i = 0; i < 3; ++i )
+    {
+        light[ i ] = dot3( _lightAxes[ i ], world );
+    }
+}
+
+void ShadowCascades::buildProjection( Cascade& cascade ) const
+{
+    const float E = cascade.extent;
+    const float ZNear = cascade.center[ 2 ] - E - _settings.casterDepth;
+    const float ZFar = cascade.center[ 2 ] + E;
+    const float ZScale = 1.0f / ( ZFar - ZNear );
+
+    // Rows of the light view, scaled and offset into the box; Metal clip z is [0, 1].
+    const float Scale[ 3 ] = { 1.0f / E, 1.0f / E, ZScale };
+    const float Offset[ 3 ] = { -cascade.center[ 0 ] / E, -cascade.center[ 1 ] / E, -ZNear * ZScale };
+    float* m = cascade.viewProjection;
+    for ( int row = 0; row < 3; ++row )
+    {
+        for ( int col = 0; col < 3; ++col )
+        {
+            m[ col * 4 + row ] = _lightAxes[ row ][ col ] * Scale[ row ];
+        }
+        m[ 12 + row ] = Offset[ row ];
+    }
+    m[ 3 ] = m[ 7 ] = m[ 11 ] = 0.0f;
+    m[ 15 ] = 1.0f;
+
+    cascade.depthBias = _settings.depthBiasTexels * cascade.texelSize * ZScale;
+    cascade.normalOffset = _settings.normalOffsetTexels * cascade.texelSize;
+}
+
+void ShadowCascades::update( const ShadowCamera& camera )
+{
+    const uint32_t Count = _settings.cascadeCount;
+    const float Near = std::max( camera.nearZ, 1e-3f );
+    const float Far = std::max( _settings.maxDistance, Near * 1.001f );
+    const float Lambda = std::clamp( _settings.splitLambda, 0.0f, 1.0f );
+
+    // Squared distance from the view axis to a frustum corner, per unit of depth.
+    const float K2 = camera.tanHalfFovY * camera.tanHalfFovY * ( 1.0f + camera.aspect * camera.aspect );
+
+    float splitNear = Near;
+    for ( uint32_t i = 0; i < Count; ++i )
+    {
+        float t = float( i + 1 ) / float( Count );
+        float splitFar = Lambda * Near * std::pow( Far / Near, t ) + ( 1.0f - Lambda ) * ( Near + ( Far - Near ) * t );
+
+        // Smallest sphere around the slice, centered on the view axis: as far
+        // from the near corners as from the far ones, or at the far plane.
+        float a = splitNear, b = splitFar;
+        float c = std::min( 0.5f * ( a + b ) * ( 1.0f + K2 ), b );
+        float radius = std::sqrt( std::max( ( b - c ) * ( b - c ) + b * b * K2, ( c - a ) * ( c - a ) + a * a * K2 ) );
+
+        float worldCenter[ 3 ];
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            worldCenter[ axis ] = camera.position[ axis ] + camera.forward[ axis ] * c;
+        }
+        float lightCenter[ 3 ];
+        toLightSpace( worldCenter, lightCenter );
+
+        const float Extent = radius * ( 1.0f + std::max( _settings.cacheMargin, 0.0f ) );
+        const float Texel = 2.0f * Extent / float( _settings.mapSize );
+
+        Cascade& cascade = _cascades[ i ];
+        cascade.splitNear = splitNear;
+        cascade.splitFar = splitFar;
+
+        // Recenter only once the sphere no longer fits the cached box.
+        const float Slack = Extent - radius;
+        bool resized = !_valid || std::fabs( cascade.extent - Extent ) > Extent * 1e-4f;
+        bool escaped = resized
+            || std::fabs( lightCenter[ 0 ] - cascade.center[ 0 ] ) > Slack
+            || std::fabs( lightCenter[ 1 ] - cascade.center[ 1 ] ) > Slack
+            || std::fabs( lightCenter[ 2 ] - cascade.center[ 2 ] ) > Slack;
+
+        bool moved = false;
+        if ( escaped )
+        {
+            float snapped[ 3 ];
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                snapped[ axis ] = std::floor( lightCenter[ axis ] / Texel + 0.5f ) * Texel;
+                moved |= resized || snapped[ axis ] != cascade.center[ axis ];
+                cascade.center[ axis ] = snapped[ axis ];
+            }
+        }
+        cascade.extent = Extent;
+        cascade.texelSize = Texel;
+        cascade.staticDirty = moved || _forceDirty;
+        buildProjection( cascade );
+
+        splitNear = splitFar;
+    }
+    _valid = true;
+    _forceDirty = false;
+}
+
+std::vector<CascadeCasters> cullShadowCasters( const ShadowCascades& cascades, const std::vector<ShadowCaster>& casters,
+                                               JobSystem& jobs )
+{
+    const std::vector<Cascade>& boxes = cascades.cascades();
+
+    // One bit per cascade for every caster, then compacted in caster order.
+    std::vector<uint8_t> masks( casters.size(), 0 );
+    jobs.parallelFor( casters.size(), 256, [&]( size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            const ShadowCaster& caster = casters[ i ];
+            float p[ 3 ];
+            cascades.toLightSpace( caster.center, p );
+            uint8_t mask = 0;
+            for ( size_t c = 0; c < boxes.size(); ++c )
+            {
+                const Cascade& box = boxes[ c ];
+                float reach = box.extent + caster.radius;
+                bool inside = std::fabs( p[ 0 ] - box.center[ 0 ] ) <= reach
+                           && std::fabs( p[ 1 ] - box.center[ 1 ] ) <= reach
+                           && p[ 2 ] - caster.radius <= box.center[ 2 ] + box.extent;
+                mask |= uint8_t( inside ? 1u << c : 0u );
+            }
+            masks[ i ] = mask;
+        }
+    } );
+
+    std::vector<CascadeCasters> lists( boxes.size() );
+    for ( size_t i = 0; i < casters.size(); ++i )
+    {
+        for ( size_t c = 0; c < boxes.size(); ++c )
+        {
+            if ( masks[ i ] & ( 1u << c ) )
+            {
+                ( casters[ i ].isStatic ? lists[ c ].staticCasters : lists[ c ].dynamicCasters ).push_back( uint32_t( i ) );
+            }
+        }
+    }
+    return lists;
+}
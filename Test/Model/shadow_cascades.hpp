@@ -0,0 +1,111 @@
+//
+//  shadow_cascades.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef shadow_cascades_hpp
+#define shadow_cascades_hpp
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+struct ShadowCamera
+{
+    float position[ 3 ];
+    float forward[ 3 ];         // normalized
+    float up[ 3 ];              // normalized, orthogonal to forward
+    float tanHalfFovY;
+    float aspect;
+    float nearZ;
+};
+
+struct CascadeSettings
+{
+    uint32_t cascadeCount       = 4;
+    uint32_t mapSize            = 2048;
+    float    maxDistance        = 100.0f;   // shadows end here
+    float    splitLambda        = 0.75f;    // 0 linear, 1 logarithmic split distances
+    float    cacheMargin        = 0.15f;    // extra extent so cached cascades recenter less often
+    float    casterDepth        = 200.0f;   // how far towards the light casters are kept in depth range
+    float    depthBiasTexels    = 1.5f;     // constant bias, in texel-sized world units
+    float    slopeBias          = 2.0f;     // scale for setDepthBias()
+    float    slopeBiasClamp     = 0.01f;
+    float    normalOffsetTexels = 1.0f;     // receiver offset along the normal when sampling
+};
+
+struct Cascade
+{
+    float splitNear;
+    float splitFar;
+    float viewProjection[ 16 ]; // world to shadow clip space, column major
+    float center[ 3 ];          // light space, snapped to whole texels
+    float extent;               // half size of the ortho box, margin included
+    float texelSize;            // world units per shadow map texel
+    float depthBias;            // normalized depth, added in the caster vertex shader
+    float normalOffset;         // world units
+    bool  staticDirty;          // the cached static caster layer must be re-rendered
+};
+
+// Fits cascaded shadow map projections to a camera, splitting the view range
+// between linear and logarithmic spacing.
+//
+// Each cascade is fit to the bounding sphere of its slice of the view frustum,
+// whose size does not change as the camera turns, and its center is snapped to
+// whole shadow map texels, so shadow edges do not shimmer as the camera moves.
+// The box is cacheMargin larger than the sphere, and a cascade only recenters
+// once the sphere would leave it; while it does not, the cascade's static
+// casters can be drawn once and reused, and staticDirty stays false.
+class ShadowCascades
+{
+public:
+    explicit ShadowCascades( const CascadeSettings& settings = CascadeSettings() );
+
+    // Direction the light travels in. Invalidates every cached cascade.
+    void setLightDirection( const float direction[ 3 ] );
+
+    // Static geometry changed; every cascade's static layer is redrawn next update.
+    void invalidateStatic() { _forceDirty = true; }
+
+    void update( const ShadowCamera& camera );
+
+    const std::vector<Cascade>& cascades() const { return _cascades; }
+    const CascadeSettings& settings() const     { return _settings; }
+
+    // World position to light space (x and y across the map, z along the light).
+    void toLightSpace( const float world[ 3 ], float light[ 3 ] ) const;
+
+private:
+    void buildProjection( Cascade& cascade ) const;
+
+    CascadeSettings         _settings;
+    float                   _lightAxes[ 3 ][ 3 ];   // rows: x, y, z of light space
+    std::vector<Cascade>    _cascades;
+    bool                    _valid = false;
+    bool                    _forceDirty = true;
+};
+
+// Bounding sphere of a shadow caster, in world space.
+struct ShadowCaster
+{
+    float center[ 3 ];
+    float radius;
+    bool  isStatic;
+};
+
+struct CascadeCasters
+{
+    std::vector<uint32_t> staticCasters;    // indices into the caster list, ascending
+    std::vector<uint32_t> dynamicCasters;
+};
+
+// Casters overlapping each cascade's box, split by whether they are static.
+// Nothing is culled towards the light: the caster pass clamps depth instead.
+// Tested in parallel over casters on the job system.
+std::vector<CascadeCasters> cullShadowCasters( const ShadowCascades& cascades, const std::vector<ShadowCaster>& casters,
+                                               JobSystem& jobs );
+
+#endif /* shadow_cascades_hpp */
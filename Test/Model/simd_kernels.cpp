@@ -0,0 +1,240 @@
+//
+//  simd_kernels.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "simd_kernels.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <cmath>
+#include <random>
+#include <string>
+
+using namespace math;
+
+namespace
+{
+
+// Reference versions with no vector types at all, for timing and checking.
+void transformPointsScalar( const float4x4& matrix, const packed_float3* pPoints, float4* pOut, size_t count )
+{
+    const float* m = &matrix.columns[ 0 ].x;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        const packed_float3& p = pPoints[ i ];
+        float* out = &pOut[ i ].x;
+        for ( int row = 0; row < 4; ++row )
+        {
+            out[ row ] = m[ row ] * p.x + m[ 4 + row ] * p.y + m[ 8 + row ] * p.z + m[ 12 + row ];
+        }
+    }
+}
+
+size_t cullSpheresScalar( const float4 planes[ 6 ], const float* pX, const float* pY, const float* pZ, const float* pRadius,
+                          uint8_t* pVisible, size_t count )
+{
+    size_t visible = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+        bool inside = true;
+        for ( int plane = 0; plane < 6; ++plane )
+        {
+            const float4& p = planes[ plane ];
+            inside = inside && p.x * pX[ i ] + p.y * pY[ i ] + p.z * pZ[ i ] + p.w >= -pRadius[ i ];
+        }
+        pVisible[ i ] = inside;
+        visible += inside;
+    }
+    return visible;
+}
+
+// How far the sphere is from flipping visibility; disagreements closer than
+// rounding are not problems.
+float cullMargin( const float4 planes[ 6 ], float x, float y, float z, float radius )
+{
+    float margin = INFINITY;
+    for ( int plane = 0; plane < 6; ++plane )
+    {
+        const float4& p = planes[ plane ];
+        margin = fminf( margin, fabsf( p.x * x + p.y * y + p.z * z + p.w + radius ) );
+    }
+    return margin;
+}
+
+double elapsedMs( uint64_t startNs )
+{
+    return double( TraceRecorder::nowNs() - startNs ) * 1e-6;
+}
+
+}
+
+void transformPoints( const float4x4& matrix, const packed_float3* pPoints, float4* pOut, size_t count )
+{
+    const detail::Vec4 Column0 = detail::load( matrix.columns[ 0 ] );
+    const detail::Vec4 Column1 = detail::load( matrix.columns[ 1 ] );
+    const detail::Vec4 Column2 = detail::load( matrix.columns[ 2 ] );
+    const detail::Vec4 Column3 = detail::load( matrix.columns[ 3 ] );
+    for ( size_t i = 0; i < count; ++i )
+    {
+        const packed_float3& p = pPoints[ i ];
+        detail::Vec4 result = detail::madd( Column0, detail::splat( p.x ), Column3 );
+        result = detail::madd( Column1, detail::splat( p.y ), result );
+        result = detail::madd( Column2, detail::splat( p.z ), result );
+        detail::store( &pOut[ i ].x, result );
+    }
+}
+
+size_t cullSpheres( const float4 planes[ 6 ], const float* pX, const float* pY, const float* pZ, const float* pRadius,
+                    uint8_t* pVisible, size_t count )
+{
+    size_t visible = 0;
+    size_t i = 0;
+
+    // The smallest signed distance plus radius over the planes decides
+    // visibility, so each batch is multiply-adds and a running minimum.
+#if defined( SIMD_MATH_AVX )
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256 x = _mm256_loadu_ps( pX + i ), y = _mm256_loadu_ps( pY + i ), z = _mm256_loadu_ps( pZ + i );
+        __m256 nearest = _mm256_set1_ps( INFINITY );
+        for ( int plane = 0; plane < 6; ++plane )
+        {
+            const float4& p = planes[ plane ];
+            __m256 distance = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( p.x ), x ), _mm256_set1_ps( p.w ) );
+            distance = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( p.y ), y ), distance );
+            distance = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( p.z ), z ), distance );
+            nearest = _mm256_min_ps( nearest, distance );
+        }
+        int mask = _mm256_movemask_ps( _mm256_cmp_ps( _mm256_add_ps( nearest, _mm256_loadu_ps( pRadius + i ) ), _mm256_setzero_ps(), _CMP_GE_OQ ) );
+        for ( int lane = 0; lane < 8; ++lane )
+        {
+            pVisible[ i + lane ] = ( mask >> lane ) & 1;
+        }
+        visible += size_t( __builtin_popcount( unsigned( mask ) ) );
+    }
+#elif defined( SIMD_MATH_SSE ) || defined( SIMD_MATH_NEON )
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        // Vec4 loads are aligned, and the arrays need not be.
+        alignas( 16 ) float lanes[ 4 ][ 4 ];
+        for ( int lane = 0; lane < 4; ++lane )
+        {
+            lanes[ 0 ][ lane ] = pX[ i + lane ];
+            lanes[ 1 ][ lane ] = pY[ i + lane ];
+            lanes[ 2 ][ lane ] = pZ[ i + lane ];
+            lanes[ 3 ][ lane ] = pRadius[ i + lane ];
+        }
+        detail::Vec4 x = detail::load( lanes[ 0 ] ), y = detail::load( lanes[ 1 ] ), z = detail::load( lanes[ 2 ] );
+        detail::Vec4 nearest = detail::splat( INFINITY );
+        for ( int plane = 0; plane < 6; ++plane )
+        {
+            const float4& p = planes[ plane ];
+            detail::Vec4 distance = detail::madd( detail::splat( p.x ), x, detail::splat( p.w ) );
+            distance = detail::madd( detail::splat( p.y ), y, distance );
+            distance = detail::madd( detail::splat( p.z ), z, distance );
+            nearest = detail::min( nearest, distance );
+        }
+        detail::store( lanes[ 0 ], detail::add( nearest, detail::load( lanes[ 3 ] ) ) );
+        for ( int lane = 0; lane < 4; ++lane )
+        {
+            pVisible[ i + lane ] = lanes[ 0 ][ lane ] >= 0.0f;
+            visible += pVisible[ i + lane ];
+        }
+    }
+#endif
+    return visible + cullSpheresScalar( planes, pX + i, pY + i, pZ + i, pRadius + i, pVisible + i, count - i );
+}
+
+std::vector<BenchResult> runSimdMathBench( const std::vector<uint32_t>& counts, uint32_t frames, size_t& problems )
+{
+    // A camera at the origin looking down -z with a 90 degree field of view,
+    // and a perspective-like matrix so every output lane is used.
+    const float4 Planes[ 6 ] =
+    {
+        { 0.7071f, 0.0f, -0.7071f, 0.0f }, { -0.7071f, 0.0f, -0.7071f, 0.0f },
+        { 0.0f, 0.7071f, -0.7071f, 0.0f }, { 0.0f, -0.7071f, -0.7071f, 0.0f },
+        { 0.0f, 0.0f, -1.0f, -0.1f },      { 0.0f, 0.0f, 1.0f, 100.0f }
+    };
+    const float4x4 Projection = { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f },
+                                    { 0.0f, 0.0f, -1.001f, -1.0f }, { 0.0f, 0.0f, -0.1001f, 0.0f } } };
+    const float4x4 Transform = Projection * rotation4x4( quatFromAxisAngle( 0.3f, float3 { 0.0f, 1.0f, 0.0f } ) )
+                             * translation4x4( float3 { 0.0f, 0.0f, -20.0f } );
+
+    std::vector<BenchResult> results;
+    for ( uint32_t count : counts )
+    {
+        std::mt19937 rng( count );
+        std::uniform_real_distribution<float> coordinate( -60.0f, 60.0f );
+        std::vector<packed_float3> points( count );
+        std::vector<float> x( count ), y( count ), z( count ), radius( count );
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            points[ i ] = { coordinate( rng ), coordinate( rng ), coordinate( rng ) };
+            x[ i ] = points[ i ].x;
+            y[ i ] = points[ i ].y;
+            z[ i ] = points[ i ].z - 50.0f;
+            radius[ i ] = fabsf( coordinate( rng ) ) * 0.05f;
+        }
+
+        std::vector<float4> transformed( count ), reference( count );
+        std::vector<uint8_t> visible( count ), referenceVisible( count );
+        std::vector<double> transformMs, transformScalarMs, cullMs, cullScalarMs;
+        size_t visibleCount = 0, referenceCount = 0;
+        for ( uint32_t frame = 0; frame < frames; ++frame )
+        {
+            uint64_t start = TraceRecorder::nowNs();
+            transformPoints( Transform, points.data(), transformed.data(), count );
+            transformMs.push_back( elapsedMs( start ) );
+
+            start = TraceRecorder::nowNs();
+            transformPointsScalar( Transform, points.data(), reference.data(), count );
+            transformScalarMs.push_back( elapsedMs( start ) );
+
+            start = TraceRecorder::nowNs();
+            visibleCount = cullSpheres( Planes, x.data(), y.data(), z.data(), radius.data(), visible.data(), count );
+            cullMs.push_back( elapsedMs( start ) );
+
+            start = TraceRecorder::nowNs();
+            referenceCount = cullSpheresScalar( Planes, x.data(), y.data(), z.data(), radius.data(), referenceVisible.data(), count );
+            cullScalarMs.push_back( elapsedMs( start ) );
+        }
+
+        size_t disagreements = 0;
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            const float* a = &transformed[ i ].x;
+            const float* b = &reference[ i ].x;
+            for ( int lane = 0; lane < 4; ++lane )
+            {
+                if ( fabsf( a[ lane ] - b[ lane ] ) > 1e-4f * ( 1.0f + fabsf( b[ lane ] ) ) )
+                {
+                    ++problems;
+                    break;
+                }
+            }
+            if ( visible[ i ] != referenceVisible[ i ] )
+            {
+                ++disagreements;
+                problems += cullMargin( Planes, x[ i ], y[ i ], z[ i ], radius[ i ] ) > 1e-3f;
+            }
+        }
+        problems += visibleCount + disagreements < referenceCount || visibleCount > referenceCount + disagreements;
+
+        const size_t TransformBytes = size_t( count ) * ( sizeof( packed_float3 ) + sizeof( float4 ) );
+        const size_t CullBytes = size_t( count ) * ( 4 * sizeof( float ) + 1 );
+        auto addResult = [&]( const char* name, const std::vector<double>& ms, size_t bytes )
+        {
+            BenchResult& result = results.emplace_back();
+            result.scene = name + std::to_string( count );
+            result.cpuEncode = summarizeFrameTimes( ms );
+            result.memoryBytes = bytes;
+        };
+        addResult( "math-transform-", transformMs, TransformBytes );
+        addResult( "math-transform-scalar-", transformScalarMs, TransformBytes );
+        addResult( "math-cull-", cullMs, CullBytes );
+        addResult( "math-cull-scalar-", cullScalarMs, CullBytes );
+    }
+    return results;
+}
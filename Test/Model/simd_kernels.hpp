@@ -0,0 +1,34 @@
+//
+//  simd_kernels.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef simd_kernels_hpp
+#define simd_kernels_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Model/simd_math.hpp"
+#include "Model/bench_suite.hpp"
+
+// Transforms packed positions to homogeneous clip space.
+void transformPoints( const math::float4x4& matrix, const math::packed_float3* pPoints, math::float4* pOut, size_t count );
+
+// Frustum culls bounding spheres stored as separate x, y, z and radius arrays.
+// Planes are ( normal, distance ) with normals pointing inwards; a sphere is
+// visible unless it is entirely behind one of them. Writes 1 or 0 per sphere
+// and returns the number visible. Eight spheres at a time with AVX, four with
+// SSE or NEON.
+size_t cullSpheres( const math::float4 planes[ 6 ], const float* pX, const float* pY, const float* pZ, const float* pRadius,
+                    uint8_t* pVisible, size_t count );
+
+// Times both kernels against plain scalar loops over each count of elements
+// ("math-transform-N", "math-transform-scalar-N", "math-cull-N" and
+// "math-cull-scalar-N"). problems counts results that differ from the scalar
+// loops by more than rounding.
+std::vector<BenchResult> runSimdMathBench( const std::vector<uint32_t>& counts, uint32_t frames, size_t& problems );
+
+#endif /* simd_kernels_hpp */
@@ -0,0 +1,421 @@
+//
+//  simd_math.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef simd_math_hpp
+#define simd_math_hpp
+
+#include <cmath>
+#include <cstddef>
+
+// Backend, picked at compile time: SSE on x86, plus AVX in the batch kernels
+// when the compiler targets it (PORTABLE_AVX in the host build), NEON on arm64,
+// plain C++ anywhere else. Defining SIMD_MATH_SCALAR forces the plain one, to
+// compare against or to rule the vector code out.
+#if !defined( SIMD_MATH_SCALAR ) && ( defined( __SSE2__ ) || defined( _M_X64 ) )
+#define SIMD_MATH_SSE 1
+#include <immintrin.h>
+#if defined( __AVX__ )
+#define SIMD_MATH_AVX 1
+#endif
+#elif !defined( SIMD_MATH_SCALAR ) && defined( __ARM_NEON ) && defined( __aarch64__ )
+#define SIMD_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Vector, quaternion and matrix types with the size, alignment and member
+// layout of Metal's simd types, so data written on the CPU reads the same in
+// shaders, without <simd/simd.h>, which only Apple platforms have. float3 is
+// 16 bytes like simd::float3; packed_float3 is the 12-byte form for tightly
+// packed vertex data.
+//
+// math::detail is the four-lane vector backend itself, for kernels that work on
+// structure-of-arrays data rather than on these types. Comparisons give a Mask4,
+// all bits set in the lanes where they hold.
+namespace math
+{
+
+namespace detail
+{
+
+#if defined( SIMD_MATH_SSE )
+
+typedef __m128 Vec4;
+typedef __m128 Mask4;
+
+inline Vec4 load( const float* p ) { return _mm_load_ps( p ); }
+inline void store( float* p, Vec4 v ) { _mm_store_ps( p, v ); }
+inline Vec4 splat( float s ) { return _mm_set1_ps( s ); }
+inline Vec4 set( float x, float y, float z, float w ) { return _mm_setr_ps( x, y, z, w ); }
+inline Vec4 add( Vec4 a, Vec4 b ) { return _mm_add_ps( a, b ); }
+inline Vec4 sub( Vec4 a, Vec4 b ) { return _mm_sub_ps( a, b ); }
+inline Vec4 mul( Vec4 a, Vec4 b ) { return _mm_mul_ps( a, b ); }
+inline Vec4 div( Vec4 a, Vec4 b ) { return _mm_div_ps( a, b ); }
+inline Vec4 min( Vec4 a, Vec4 b ) { return _mm_min_ps( a, b ); }
+inline Vec4 max( Vec4 a, Vec4 b ) { return _mm_max_ps( a, b ); }
+
+inline Mask4 less( Vec4 a, Vec4 b ) { return _mm_cmplt_ps( a, b ); }
+inline Mask4 lessEqual( Vec4 a, Vec4 b ) { return _mm_cmple_ps( a, b ); }
+inline Mask4 both( Mask4 a, Mask4 b ) { return _mm_and_ps( a, b ); }
+inline Vec4 select( Mask4 m, Vec4 a, Vec4 b ) { return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ); }
+inline unsigned bits( Mask4 m ) { return unsigned( _mm_movemask_ps( m ) ); }    // lane i is bit i
+
+// a * b + c
+#if defined( __FMA__ )
+inline Vec4 madd( Vec4 a, Vec4 b, Vec4 c ) { return _mm_fmadd_ps( a, b, c ); }
+#else
+inline Vec4 madd( Vec4 a, Vec4 b, Vec4 c ) { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+#endif
+
+template<int I>
+inline Vec4 lane( Vec4 v ) { return _mm_shuffle_ps( v, v, _MM_SHUFFLE( I, I, I, I ) ); }
+inline Vec4 yzxw( Vec4 v ) { return _mm_shuffle_ps( v, v, _MM_SHUFFLE( 3, 0, 2, 1 ) ); }
+
+inline float sum( Vec4 v )
+{
+    Vec4 pairs = _mm_add_ps( v, _mm_movehl_ps( v, v ) );
+    return _mm_cvtss_f32( _mm_add_ss( pairs, _mm_shuffle_ps( pairs, pairs, 1 ) ) );
+}
+
+#elif defined( SIMD_MATH_NEON )
+
+typedef float32x4_t Vec4;
+typedef uint32x4_t Mask4;
+
+inline Vec4 load( const float* p ) { return vld1q_f32( p ); }
+inline void store( float* p, Vec4 v ) { vst1q_f32( p, v ); }
+inline Vec4 splat( float s ) { return vdupq_n_f32( s ); }
+
+inline Vec4 set( float x, float y, float z, float w )
+{
+    const float Lanes[ 4 ] = { x, y, z, w };
+    return vld1q_f32( Lanes );
+}
+
+inline Vec4 add( Vec4 a, Vec4 b ) { return vaddq_f32( a, b ); }
+inline Vec4 sub( Vec4 a, Vec4 b ) { return vsubq_f32( a, b ); }
+inline Vec4 mul( Vec4 a, Vec4 b ) { return vmulq_f32( a, b ); }
+inline Vec4 div( Vec4 a, Vec4 b ) { return vdivq_f32( a, b ); }
+inline Vec4 min( Vec4 a, Vec4 b ) { return vminq_f32( a, b ); }
+inline Vec4 max( Vec4 a, Vec4 b ) { return vmaxq_f32( a, b ); }
+inline Vec4 madd( Vec4 a, Vec4 b, Vec4 c ) { return vfmaq_f32( c, a, b ); }
+
+inline Mask4 less( Vec4 a, Vec4 b ) { return vcltq_f32( a, b ); }
+inline Mask4 lessEqual( Vec4 a, Vec4 b ) { return vcleq_f32( a, b ); }
+inline Mask4 both( Mask4 a, Mask4 b ) { return vandq_u32( a, b ); }
+inline Vec4 select( Mask4 m, Vec4 a, Vec4 b ) { return vbslq_f32( m, a, b ); }
+
+inline unsigned bits( Mask4 m )
+{
+    const uint32_t Weights[ 4 ] = { 1, 2, 4, 8 };
+    return vaddvq_u32( vandq_u32( m, vld1q_u32( Weights ) ) );
+}
+
+template<int I>
+inline Vec4 lane( Vec4 v ) { return vdupq_laneq_f32( v, I ); }
+
+inline Vec4 yzxw( Vec4 v )
+{
+    Vec4 yzwx = vextq_f32( v, v, 1 );
+    Vec4 yzxx = vsetq_lane_f32( vgetq_lane_f32( v, 0 ), yzwx, 2 );
+    return vsetq_lane_f32( vgetq_lane_f32( v, 3 ), yzxx, 3 );
+}
+
+inline float sum( Vec4 v ) { return vaddvq_f32( v ); }
+
+#else
+
+struct Vec4
+{
+    float v[ 4 ];
+};
+
+struct Mask4
+{
+    bool v[ 4 ];
+};
+
+inline Vec4 load( const float* p ) { return { { p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] } }; }
+inline void store( float* p, Vec4 v ) { p[ 0 ] = v.v[ 0 ]; p[ 1 ] = v.v[ 1 ]; p[ 2 ] = v.v[ 2 ]; p[ 3 ] = v.v[ 3 ]; }
+inline Vec4 splat( float s ) { return { { s, s, s, s } }; }
+inline Vec4 set( float x, float y, float z, float w ) { return { { x, y, z, w } }; }
+
+template<typename F>
+inline Vec4 perLane( Vec4 a, Vec4 b, F f )
+{
+    return { { f( a.v[ 0 ], b.v[ 0 ] ), f( a.v[ 1 ], b.v[ 1 ] ), f( a.v[ 2 ], b.v[ 2 ] ), f( a.v[ 3 ], b.v[ 3 ] ) } };
+}
+
+inline Vec4 add( Vec4 a, Vec4 b ) { return perLane( a, b, []( float x, float y ) { return x + y; } ); }
+inline Vec4 sub( Vec4 a, Vec4 b ) { return perLane( a, b, []( float x, float y ) { return x - y; } ); }
+inline Vec4 mul( Vec4 a, Vec4 b ) { return perLane( a, b, []( float x, float y ) { return x * y; } ); }
+inline Vec4 div( Vec4 a, Vec4 b ) { return perLane( a, b, []( float x, float y ) { return x / y; } ); }
+inline Vec4 min( Vec4 a, Vec4 b ) { return perLane( a, b, []( float x, float y ) { return x < y ? x : y; } ); }
+inline Vec4 max( Vec4 a, Vec4 b ) { return perLane( a, b, []( float x, float y ) { return x > y ? x : y; } ); }
+inline Vec4 madd( Vec4 a, Vec4 b, Vec4 c ) { return add( mul( a, b ), c ); }
+
+inline Mask4 less( Vec4 a, Vec4 b ) { return { { a.v[ 0 ] < b.v[ 0 ], a.v[ 1 ] < b.v[ 1 ], a.v[ 2 ] < b.v[ 2 ], a.v[ 3 ] < b.v[ 3 ] } }; }
+inline Mask4 lessEqual( Vec4 a, Vec4 b ) { return { { a.v[ 0 ] <= b.v[ 0 ], a.v[ 1 ] <= b.v[ 1 ], a.v[ 2 ] <= b.v[ 2 ], a.v[ 3 ] <= b.v[ 3 ] } }; }
+inline Mask4 both( Mask4 a, Mask4 b ) { return { { a.v[ 0 ] && b.v[ 0 ], a.v[ 1 ] && b.v[ 1 ], a.v[ 2 ] && b.v[ 2 ], a.v[ 3 ] && b.v[ 3 ] } }; }
+
+inline Vec4 select( Mask4 m, Vec4 a, Vec4 b )
+{
+    return { { m.v[ 0 ] ? a.v[ 0 ] : b.v[ 0 ], m.v[ 1 ] ? a.v[ 1 ] : b.v[ 1 ], m.v[ 2 ] ? a.v[ 2 ] : b.v[ 2 ], m.v[ 3 ] ? a.v[ 3 ] : b.v[ 3 ] } };
+}
+
+inline unsigned bits( Mask4 m ) { return unsigned( m.v[ 0 ] ) | unsigned( m.v[ 1 ] ) << 1 | unsigned( m.v[ 2 ] ) << 2 | unsigned( m.v[ 3 ] ) << 3; }
+
+template<int I>
+inline Vec4 lane( Vec4 v ) { return splat( v.v[ I ] ); }
+inline Vec4 yzxw( Vec4 v ) { return { { v.v[ 1 ], v.v[ 2 ], v.v[ 0 ], v.v[ 3 ] } }; }
+inline float sum( Vec4 v ) { return ( v.v[ 0 ] + v.v[ 1 ] ) + ( v.v[ 2 ] + v.v[ 3 ] ); }
+
+#endif
+
+}
+
+struct alignas( 8 ) float2
+{
+    float x, y;
+};
+
+// The fourth lane is padding, kept at zero so whole-register dot products
+// need no masking.
+struct alignas( 16 ) float3
+{
+    float x, y, z;
+    float padding = 0.0f;
+
+    float& operator[]( int i ) { return ( &x )[ i ]; }
+    float operator[]( int i ) const { return ( &x )[ i ]; }
+};
+
+struct alignas( 16 ) float4
+{
+    float x, y, z, w;
+
+    float& operator[]( int i ) { return ( &x )[ i ]; }
+    float operator[]( int i ) const { return ( &x )[ i ]; }
+};
+
+struct packed_float3
+{
+    float x, y, z;
+};
+
+// Imaginary part in xyz, real part in w, like simd::quatf.
+struct quatf
+{
+    float4 vector;
+};
+
+// Column-major, like simd::float4x4.
+struct float4x4
+{
+    float4 columns[ 4 ];
+};
+
+static_assert( sizeof( float2 ) == 8 && alignof( float2 ) == 8, "float2 must match simd::float2" );
+static_assert( sizeof( float3 ) == 16 && alignof( float3 ) == 16, "float3 must match simd::float3" );
+static_assert( sizeof( float4 ) == 16 && alignof( float4 ) == 16, "float4 must match simd::float4" );
+static_assert( sizeof( packed_float3 ) == 12 && alignof( packed_float3 ) == 4, "packed_float3 must match packed::float3" );
+static_assert( sizeof( quatf ) == 16 && sizeof( float4x4 ) == 64 && alignof( float4x4 ) == 16, "quatf and float4x4 must match simd" );
+
+namespace detail
+{
+
+inline Vec4 load( const float3& v ) { return load( &v.x ); }
+inline Vec4 load( const float4& v ) { return load( &v.x ); }
+
+inline float3 toFloat3( Vec4 v )
+{
+    float3 result;
+    store( &result.x, v );
+    result.padding = 0.0f;
+    return result;
+}
+
+inline float4 toFloat4( Vec4 v )
+{
+    float4 result;
+    store( &result.x, v );
+    return result;
+}
+
+}
+
+// float2 is too narrow to gain from vector registers.
+inline float2 operator+( float2 a, float2 b ) { return { a.x + b.x, a.y + b.y }; }
+inline float2 operator-( float2 a, float2 b ) { return { a.x - b.x, a.y - b.y }; }
+inline float2 operator*( float2 a, float2 b ) { return { a.x * b.x, a.y * b.y }; }
+inline float2 operator*( float2 a, float s ) { return { a.x * s, a.y * s }; }
+inline float dot( float2 a, float2 b ) { return a.x * b.x + a.y * b.y; }
+
+inline float3 operator+( const float3& a, const float3& b ) { return detail::toFloat3( detail::add( detail::load( a ), detail::load( b ) ) ); }
+inline float3 operator-( const float3& a, const float3& b ) { return detail::toFloat3( detail::sub( detail::load( a ), detail::load( b ) ) ); }
+inline float3 operator*( const float3& a, const float3& b ) { return detail::toFloat3( detail::mul( detail::load( a ), detail::load( b ) ) ); }
+inline float3 operator*( const float3& a, float s ) { return detail::toFloat3( detail::mul( detail::load( a ), detail::splat( s ) ) ); }
+inline float3 operator-( const float3& a ) { return a * -1.0f; }
+inline float3& operator+=( float3& a, const float3& b ) { return a = a + b; }
+inline float3& operator-=( float3& a, const float3& b ) { return a = a - b; }
+
+inline float4 operator+( const float4& a, const float4& b ) { return detail::toFloat4( detail::add( detail::load( a ), detail::load( b ) ) ); }
+inline float4 operator-( const float4& a, const float4& b ) { return detail::toFloat4( detail::sub( detail::load( a ), detail::load( b ) ) ); }
+inline float4 operator*( const float4& a, const float4& b ) { return detail::toFloat4( detail::mul( detail::load( a ), detail::load( b ) ) ); }
+inline float4 operator*( const float4& a, float s ) { return detail::toFloat4( detail::mul( detail::load( a ), detail::splat( s ) ) ); }
+inline float4 operator/( const float4& a, const float4& b ) { return detail::toFloat4( detail::div( detail::load( a ), detail::load( b ) ) ); }
+inline float4& operator+=( float4& a, const float4& b ) { return a = a + b; }
+
+inline float dot( const float3& a, const float3& b ) { return detail::sum( detail::mul( detail::load( a ), detail::load( b ) ) ); }
+inline float dot( const float4& a, const float4& b ) { return detail::sum( detail::mul( detail::load( a ), detail::load( b ) ) ); }
+inline float length( const float3& v ) { return sqrtf( dot( v, v ) ); }
+inline float3 normalize( const float3& v ) { return v * ( 1.0f / length( v ) ); }
+inline float3 min( const float3& a, const float3& b ) { return detail::toFloat3( detail::min( detail::load( a ), detail::load( b ) ) ); }
+inline float3 max( const float3& a, const float3& b ) { return detail::toFloat3( detail::max( detail::load( a ), detail::load( b ) ) ); }
+inline float4 min( const float4& a, const float4& b ) { return detail::toFloat4( detail::min( detail::load( a ), detail::load( b ) ) ); }
+inline float4 max( const float4& a, const float4& b ) { return detail::toFloat4( detail::max( detail::load( a ), detail::load( b ) ) ); }
+inline float3 mix( const float3& a, const float3& b, float t ) { return a + ( b - a ) * t; }
+
+inline float3 cross( const float3& a, const float3& b )
+{
+    // ( a * b.yzx - a.yzx * b ).yzx: three shuffles instead of the textbook four.
+    detail::Vec4 va = detail::load( a ), vb = detail::load( b );
+    detail::Vec4 swizzled = detail::sub( detail::mul( va, detail::yzxw( vb ) ), detail::mul( detail::yzxw( va ), vb ) );
+    return detail::toFloat3( detail::yzxw( swizzled ) );
+}
+
+inline float3 unpack( const packed_float3& v ) { return { v.x, v.y, v.z }; }
+inline packed_float3 pack( const float3& v ) { return { v.x, v.y, v.z }; }
+inline float4 makeFloat4( const float3& v, float w ) { return { v.x, v.y, v.z, w }; }
+inline float3 xyz( const float4& v ) { return { v.x, v.y, v.z }; }
+
+inline quatf quatFromAxisAngle( float radians, const float3& axis )
+{
+    float3 imaginary = normalize( axis ) * sinf( radians * 0.5f );
+    return { makeFloat4( imaginary, cosf( radians * 0.5f ) ) };
+}
+
+// a * b rotates by b, then by a.
+inline quatf operator*( const quatf& a, const quatf& b )
+{
+    float3 va = xyz( a.vector ), vb = xyz( b.vector );
+    float3 imaginary = vb * a.vector.w + va * b.vector.w + cross( va, vb );
+    return { makeFloat4( imaginary, a.vector.w * b.vector.w - dot( va, vb ) ) };
+}
+
+inline quatf normalize( const quatf& q )
+{
+    return { q.vector * ( 1.0f / sqrtf( dot( q.vector, q.vector ) ) ) };
+}
+
+// Rotates v by the unit quaternion q.
+inline float3 rotate( const quatf& q, const float3& v )
+{
+    float3 u = xyz( q.vector );
+    float3 t = cross( u, v ) * 2.0f;
+    return v + t * q.vector.w + cross( u, t );
+}
+
+inline quatf slerp( const quatf& a, const quatf& b, float t )
+{
+    float cosine = dot( a.vector, b.vector );
+    float4 to = cosine < 0.0f ? b.vector * -1.0f : b.vector;
+    cosine = fabsf( cosine );
+    if ( cosine > 0.9995f )
+    {
+        // Nearly parallel: a normalized lerp is as good and avoids dividing by ~0.
+        return normalize( quatf { a.vector + ( to - a.vector ) * t } );
+    }
+    float angle = acosf( cosine );
+    float inverseSine = 1.0f / sinf( angle );
+    return { a.vector * ( sinf( ( 1.0f - t ) * angle ) * inverseSine ) + to * ( sinf( t * angle ) * inverseSine ) };
+}
+
+inline float4x4 identity4x4()
+{
+    return { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+}
+
+inline float4x4 translation4x4( const float3& t )
+{
+    return { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { t.x, t.y, t.z, 1 } } };
+}
+
+inline float4x4 scale4x4( const float3& s )
+{
+    return { { { s.x, 0, 0, 0 }, { 0, s.y, 0, 0 }, { 0, 0, s.z, 0 }, { 0, 0, 0, 1 } } };
+}
+
+inline float4x4 rotation4x4( const quatf& q )
+{
+    float x = q.vector.x, y = q.vector.y, z = q.vector.z, w = q.vector.w;
+    return { { { 1 - 2 * ( y * y + z * z ), 2 * ( x * y + z * w ), 2 * ( x * z - y * w ), 0 },
+               { 2 * ( x * y - z * w ), 1 - 2 * ( x * x + z * z ), 2 * ( y * z + x * w ), 0 },
+               { 2 * ( x * z + y * w ), 2 * ( y * z - x * w ), 1 - 2 * ( x * x + y * y ), 0 },
+               { 0, 0, 0, 1 } } };
+}
+
+// About +z, the common case, without going through a quaternion.
+inline float4x4 rotationZ4x4( float radians )
+{
+    float c = cosf( radians ), s = sinf( radians );
+    return { { { c, s, 0, 0 }, { -s, c, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+}
+
+inline float4 operator*( const float4x4& m, const float4& v )
+{
+    detail::Vec4 vv = detail::load( v );
+    detail::Vec4 result = detail::mul( detail::load( m.columns[ 0 ] ), detail::lane<0>( vv ) );
+    result = detail::madd( detail::load( m.columns[ 1 ] ), detail::lane<1>( vv ), result );
+    result = detail::madd( detail::load( m.columns[ 2 ] ), detail::lane<2>( vv ), result );
+    result = detail::madd( detail::load( m.columns[ 3 ] ), detail::lane<3>( vv ), result );
+    return detail::toFloat4( result );
+}
+
+// a * b, b applied first.
+inline float4x4 operator*( const float4x4& a, const float4x4& b )
+{
+    return { { a * b.columns[ 0 ], a * b.columns[ 1 ], a * b.columns[ 2 ], a * b.columns[ 3 ] } };
+}
+
+inline float4 transformPoint( const float4x4& m, const float3& p )
+{
+    return m * makeFloat4( p, 1.0f );
+}
+
+inline float4x4 transpose( const float4x4& m )
+{
+    const float4* c = m.columns;
+    return { { { c[ 0 ].x, c[ 1 ].x, c[ 2 ].x, c[ 3 ].x },
+               { c[ 0 ].y, c[ 1 ].y, c[ 2 ].y, c[ 3 ].y },
+               { c[ 0 ].z, c[ 1 ].z, c[ 2 ].z, c[ 3 ].z },
+               { c[ 0 ].w, c[ 1 ].w, c[ 2 ].w, c[ 3 ].w } } };
+}
+
+// Name of the backend compiled in, for benchmark reports.
+inline const char* backendName()
+{
+#if defined( SIMD_MATH_AVX )
+    return "AVX";
+#elif defined( SIMD_MATH_SSE )
+    return "SSE";
+#elif defined( SIMD_MATH_NEON )
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+}
+
+#if defined( __APPLE__ )
+#include <simd/simd.h>
+static_assert( sizeof( math::float3 ) == sizeof( simd::float3 ) && alignof( math::float3 ) == alignof( simd::float3 ), "float3 layout differs from Metal" );
+static_assert( sizeof( math::float4x4 ) == sizeof( simd::float4x4 ) && alignof( math::float4x4 ) == alignof( simd::float4x4 ), "float4x4 layout differs from Metal" );
+static_assert( sizeof( math::quatf ) == sizeof( simd::quatf ), "quatf layout differs from Metal" );
+#endif
+
+#endif /* simd_math_hpp */
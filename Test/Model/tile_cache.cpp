@@ -0,0 +1,207 @@
+//
+//  tile_cache.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "tile_cache.hpp"
+
+TileCache::TileCache( const TileLayout& layout, size_t capacityTiles, uint32_t retainFrames )
+: _layout( layout )
+, _capacity( capacityTiles )
+, _retainFrames( retainFrames )
+{
+}
+
+void TileCache::want( const TileKey& key )
+{
+    uint64_t packed = key.packed();
+    auto it = _entries.find( packed );
+    if ( it != _entries.end() )
+    {
+        if ( it->second.lastSeenFrame != _frame )
+        {
+            it->second.lastSeenFrame = _frame;
+            _lru.splice( _lru.begin(), _lru, it->second.lru );
+        }
+        return;
+    }
+    _wanted[ packed ] = _frame;
+}
+
+void TileCache::addFeedback( const uint8_t* minMipPerCell )
+{
+    ++_frame;
+
+    for ( uint32_t cy = 0; cy < _layout.tilesY; ++cy )
+    {
+        for ( uint32_t cx = 0; cx < _layout.tilesX; ++cx )
+        {
+            uint8_t finest = minMipPerCell[ cy * _layout.tilesX + cx ];
+            if ( finest == kNoFeedback )
+            {
+                continue;
+            }
+            for ( uint32_t mip = finest; mip < _layout.firstTailMip; ++mip )
+            {
+                want( { mip, cx >> mip, cy >> mip } );
+            }
+        }
+    }
+}
+
+bool TileCache::makeRoom( std::vector<TileKey>& evictions )
+{
+    // The list is ordered by last use, so stop at the first tile that is still warm.
+    for ( auto it = _lru.end(); it != _lru.begin(); )
+    {
+        --it;
+        Entry& entry = _entries[ *it ];
+        if ( entry.lastSeenFrame + _retainFrames > _frame )
+        {
+            return false;
+        }
+        if ( entry.state == State::Resident )
+        {
+            evictions.push_back( TileKey::unpack( *it ) );
+            _entries.erase( *it );
+            _lru.erase( it );
+            return true;
+        }
+    }
+    return false;
+}
+
+void TileCache::update( size_t maxLoads,
+                        std::vector<TileKey>& loads,
+                        std::vector<TileKey>& prefetches,
+                        std::vector<TileKey>& evictions )
+{
+    loads.clear();
+    prefetches.clear();
+    evictions.clear();
+
+    struct Candidate
+    {
+        uint64_t key;
+        uint64_t lastSeenFrame;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve( _wanted.size() );
+    for ( const auto& [ key, frame ] : _wanted )
+    {
+        candidates.push_back( { key, frame } );
+    }
+    _wanted.clear();
+
+    // Coarse mips first: they cover more screen and are the fallback for finer ones.
+    std::sort( candidates.begin(), candidates.end(), []( const Candidate& a, const Candidate& b )
+    {
+        uint32_t mipA = uint32_t( a.key >> 48 ), mipB = uint32_t( b.key >> 48 );
+        if ( mipA != mipB )
+        {
+            return mipA > mipB;
+        }
+        if ( a.lastSeenFrame != b.lastSeenFrame )
+        {
+            return a.lastSeenFrame > b.lastSeenFrame;
+        }
+        return a.key < b.key;
+    } );
+
+    for ( const Candidate& c : candidates )
+    {
+        if ( loads.size() >= maxLoads )
+        {
+            break;
+        }
+        if ( _entries.size() >= _capacity && !makeRoom( evictions ) )
+        {
+            break;
+        }
+
+        _lru.push_front( c.key );
+        _entries[ c.key ] = { State::Loading, c.lastSeenFrame, _lru.begin() };
+        loads.push_back( TileKey::unpack( c.key ) );
+    }
+
+    // Speculatively fetch the same-mip neighbours of what was just requested,
+    // in case the camera keeps moving in that direction. Never evicts for these.
+    static const int kOffsets[ 4 ][ 2 ] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for ( size_t i = 0; i < loads.size() && prefetches.size() < maxLoads; ++i )
+    {
+        const TileKey& key = loads[ i ];
+        for ( const auto& offset : kOffsets )
+        {
+            if ( _entries.size() >= _capacity || prefetches.size() >= maxLoads )
+            {
+                break;
+            }
+
+            int64_t x = int64_t( key.x ) + offset[ 0 ];
+            int64_t y = int64_t( key.y ) + offset[ 1 ];
+            if ( x < 0 || y < 0 || x >= _layout.tilesXAt( key.mip ) || y >= _layout.tilesYAt( key.mip ) )
+            {
+                continue;
+            }
+
+            TileKey neighbour = { key.mip, uint32_t( x ), uint32_t( y ) };
+            uint64_t packed = neighbour.packed();
+            if ( _entries.count( packed ) )
+            {
+                continue;
+            }
+
+            // Prefetched tiles start cold so they are the first to go under pressure.
+            _lru.push_back( packed );
+            _entries[ packed ] = { State::Loading, 0, std::prev( _lru.end() ) };
+            prefetches.push_back( neighbour );
+        }
+    }
+}
+
+void TileCache::markResident( const TileKey& key )
+{
+    auto it = _entries.find( key.packed() );
+    if ( it != _entries.end() )
+    {
+        it->second.state = State::Resident;
+    }
+}
+
+void TileCache::cancel( const TileKey& key )
+{
+    auto it = _entries.find( key.packed() );
+    if ( it != _entries.end() )
+    {
+        _lru.erase( it->second.lru );
+        _entries.erase( it );
+    }
+}
+
+bool TileCache::isResident( const TileKey& key ) const
+{
+    auto it = _entries.find( key.packed() );
+    return it != _entries.end() && it->second.state == State::Resident;
+}
+
+void TileCache::buildResidencyMap( std::vector<uint8_t>& out ) const
+{
+    out.resize( size_t( _layout.tilesX ) * _layout.tilesY );
+
+    for ( uint32_t cy = 0; cy < _layout.tilesY; ++cy )
+    {
+        for ( uint32_t cx = 0; cx < _layout.tilesX; ++cx )
+        {
+            // Walk down from the tail while the whole chain is resident, since
+            // filtering between two mips needs both of them mapped.
+            uint32_t mip = _layout.firstTailMip;
+            while ( mip > 0 && isResident( { mip - 1, cx >> ( mip - 1 ), cy >> ( mip - 1 ) } ) )
+            {
+                --mip;
+            }
+            out[ cy * _layout.tilesX + cx ] = uint8_t( mip );
+        }
+    }
+}
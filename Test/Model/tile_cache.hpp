@@ -0,0 +1,99 @@
+//
+//  tile_cache.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef tile_cache_hpp
+#define tile_cache_hpp
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+struct TileKey
+{
+    uint32_t mip;
+    uint32_t x, y;
+
+    uint64_t packed() const { return ( uint64_t( mip ) << 48 ) | ( uint64_t( y ) << 24 ) | x; }
+    static TileKey unpack( uint64_t v ) { return { uint32_t( v >> 48 ), uint32_t( v & 0xffffff ), uint32_t( ( v >> 24 ) & 0xffffff ) }; }
+    bool operator==( const TileKey& o ) const { return mip == o.mip && x == o.x && y == o.y; }
+};
+
+// Tile layout of a sparse texture: the tile grid of every mip above the packed mip tail.
+struct TileLayout
+{
+    uint32_t tilesX        = 0;   // tile grid size of mip 0
+    uint32_t tilesY        = 0;
+    uint32_t firstTailMip  = 0;   // mips from here on are always resident
+
+    uint32_t tilesXAt( uint32_t mip ) const { return std::max( 1u, ( tilesX + ( 1u << mip ) - 1 ) >> mip ); }
+    uint32_t tilesYAt( uint32_t mip ) const { return std::max( 1u, ( tilesY + ( 1u << mip ) - 1 ) >> mip ); }
+};
+
+// LRU cache of sparse texture tiles, driven by GPU sampling feedback.
+//
+// Every frame the feedback grid (one cell per mip 0 tile, holding the finest mip
+// sampled there) is fed through addFeedback(). update() then returns which tiles
+// to stream in, in priority order, and which to drop to stay within capacity.
+// Tiles are only evicted once they have gone unsampled for a few frames.
+class TileCache
+{
+public:
+    static constexpr uint8_t kNoFeedback = 0xff;
+
+    TileCache( const TileLayout& layout, size_t capacityTiles, uint32_t retainFrames = 4 );
+
+    // Consumes one frame of feedback. Wanted tiles also pull in their coarser
+    // ancestors so sampling can always fall back to something resident.
+    void addFeedback( const uint8_t* minMipPerCell );
+
+    // Picks up to maxLoads missing tiles (coarse mips and most recently sampled
+    // first), evicting the least recently used tiles to make room. Prefetches are
+    // neighbours of wanted tiles and only use capacity that is currently free.
+    void update( size_t maxLoads,
+                 std::vector<TileKey>& loads,
+                 std::vector<TileKey>& prefetches,
+                 std::vector<TileKey>& evictions );
+
+    // Called when a load or prefetch has finished and the tile is mapped.
+    void markResident( const TileKey& key );
+    // Called when a load could not be completed; the slot is released.
+    void cancel( const TileKey& key );
+
+    bool isResident( const TileKey& key ) const;
+    size_t size() const          { return _entries.size(); }
+    size_t capacity() const      { return _capacity; }
+
+    // Finest resident mip for each mip 0 tile, for the shader to clamp its LOD.
+    void buildResidencyMap( std::vector<uint8_t>& out ) const;
+
+private:
+    enum class State : uint8_t { Loading, Resident };
+
+    struct Entry
+    {
+        State                          state;
+        uint64_t                       lastSeenFrame;
+        std::list<uint64_t>::iterator  lru;
+    };
+
+    void want( const TileKey& key );
+    bool makeRoom( std::vector<TileKey>& evictions );
+
+    TileLayout                              _layout;
+    size_t                                  _capacity;
+    uint32_t                                _retainFrames;
+    uint64_t                                _frame = 0;
+
+    std::unordered_map<uint64_t, Entry>     _entries;
+    std::list<uint64_t>                     _lru;           // front = most recently used
+    std::unordered_map<uint64_t, uint64_t>  _wanted;        // missing tile -> last frame seen
+};
+
+#endif /* tile_cache_hpp */
@@ -0,0 +1,50 @@
+//
+//  timeline.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef timeline_hpp
+#define timeline_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// A monotonically increasing 64-bit counter that work signals when it is done
+// and other work waits on. Reaching N means everything signalled up to N has
+// finished, so one counter orders a whole chain of submissions across queues
+// and the CPU without a fence per pass.
+//
+// Values are handed out by reserve() in order; the signaller of a value must
+// not signal before every smaller reserved value has been signalled.
+class Timeline
+{
+public:
+    using Listener = std::function<void( uint64_t value )>;
+
+    virtual ~Timeline() { }
+
+    uint64_t reserve() { return _reserved.fetch_add( 1 ) + 1; }
+    uint64_t lastReserved() const { return _reserved.load(); }
+
+    virtual uint64_t signaledValue() const = 0;
+
+    // CPU-side signal, for work done by CPU jobs.
+    virtual void signal( uint64_t value ) = 0;
+
+    // Blocks until value is reached; false once timeoutMs has passed first.
+    virtual bool wait( uint64_t value, uint32_t timeoutMs ) = 0;
+
+    // Calls listener once value is reached, on a thread of the timeline's
+    // choosing; right away on the caller if it already has been.
+    virtual void notify( uint64_t value, const Listener& listener ) = 0;
+
+    bool reached( uint64_t value ) const { return signaledValue() >= value; }
+
+private:
+    std::atomic<uint64_t> _reserved { 0 };
+};
+
+#endif /* timeline_hpp */
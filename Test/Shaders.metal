@@ -14,11 +14,15 @@ struct v2f
     float4 position [[position]];
 };
 
+// instanceMatrices is Renderer::kInstanceMatricesIndex. instance_id includes
+// the draw's base instance, so each run of packets finds its own matrices.
 v2f vertex vertexMain( uint vertexId [[vertex_id]],
-                       device const float3* positions [[buffer(0)]])
+                       uint instanceId [[instance_id]],
+                       device const float3* positions [[buffer(0)]],
+                       device const float4x4* instanceMatrices [[buffer(2)]] )
 {
     v2f o;
-    o.position = float4( positions[ vertexId ], 1.0 );
+    o.position = instanceMatrices[ instanceId ] * float4( positions[ vertexId ], 1.0 );
     return o;
 }
 
@@ -26,3 +30,432 @@ half4 fragment fragmentMain( v2f in [[stage_in]] )
 {
     return half4( 1.0, 0.0, 0.0, 1.0 );
 }
+
+// Sparse texture streaming (see SparseTextureStreamer). Records the finest mip
+// sampled in each mip 0 tile into the feedback buffer and never samples below
+// the finest resident mip reported by the residency map.
+half4 sampleStreamed( texture2d<half> tex, sampler s, float2 uv,
+                      texture2d<uint> residency, device atomic_uint* feedback )
+{
+    uint2 grid = uint2( residency.get_width(), residency.get_height() );
+    uint2 cell = min( uint2( saturate( uv ) * float2( grid ) ), grid - 1 );
+
+    float lod = max( tex.calculate_unclamped_lod( s, uv ), 0.0 );
+    atomic_fetch_min_explicit( &feedback[ cell.y * grid.x + cell.x ], uint( lod ), memory_order_relaxed );
+
+    float minLod = float( residency.read( cell ).r );
+    return tex.sample( s, uv, min_lod_clamp( minLod ) );
+}
+
+// Dynamic resolution upscale (see DynamicResolution). A fullscreen triangle
+// samples the scaled scene from the corner of the internal target it was
+// rendered into, going through the rasterization rate map when there is one.
+constant bool upscaleUsesRateMap [[function_constant(1)]];
+
+struct UpscaleParams
+{
+    float2 screenSize;
+    float2 validSize;
+    float2 textureSize;
+};
+
+struct UpscaleV2F
+{
+    float4 position [[position]];
+    float2 uv;
+};
+
+UpscaleV2F vertex upscaleVertex( uint vertexId [[vertex_id]] )
+{
+    float2 p = float2( ( vertexId << 1 ) & 2, vertexId & 2 );
+    UpscaleV2F o;
+    o.position = float4( p * 2.0 - 1.0, 0.0, 1.0 );
+    o.uv = float2( p.x, 1.0 - p.y );
+    return o;
+}
+
+half4 fragment upscaleFragment( UpscaleV2F in [[stage_in]],
+                                texture2d<half> scene [[texture(0)]],
+                                constant UpscaleParams& params [[buffer(0)]],
+                                constant rasterization_rate_map_data& rateMap [[buffer(1), function_constant(upscaleUsesRateMap)]] )
+{
+    float2 pixel = in.uv * params.screenSize;
+    if ( upscaleUsesRateMap )
+    {
+        rasterization_rate_map_decoder decoder( rateMap );
+        pixel = decoder.map_screen_to_physical_coordinates( pixel );
+    }
+
+    // Clamped half a texel inside the rendered corner, so bilinear taps never
+    // reach pixels this frame did not write.
+    pixel = clamp( pixel, float2( 0.5 ), params.validSize - 0.5 );
+    constexpr sampler s( filter::linear, address::clamp_to_edge );
+    return scene.sample( s, pixel / params.textureSize );
+}
+
+// Sparse texture streaming bench (see runTextureStreamingBench). The fullscreen
+// triangle shows a window of the streamed texture.
+struct StreamedViewParams
+{
+    float2 origin;
+    float2 scale;
+};
+
+half4 fragment streamedTextureFragment( UpscaleV2F in [[stage_in]],
+                                        texture2d<half> tex [[texture(0)]],
+                                        texture2d<uint> residency [[texture(1)]],
+                                        device atomic_uint* feedback [[buffer(0)]],
+                                        constant StreamedViewParams& view [[buffer(1)]] )
+{
+    constexpr sampler s( filter::linear, mip_filter::linear, address::clamp_to_edge );
+    return sampleStreamed( tex, s, view.origin + in.uv * view.scale, residency, feedback );
+}
+
+// Tile deferred lighting (see TileDeferredRenderer). One render pass: the scene
+// writes a G-buffer that only ever lives in tile memory, a tile dispatch culls
+// the lights against each tile's depth bounds into threadgroup memory, and a
+// fullscreen triangle shades every pixel with its tile's lights, reading the
+// G-buffer through programmable blending.
+#define kMaxLightsPerTile 256
+
+struct PointLight
+{
+    packed_float3 position;
+    float         radius;
+    packed_float3 color;
+    float         intensity;
+};
+
+struct DeferredUniforms
+{
+    float2 viewportSize;
+    uint   lightCount;
+    float  ambient;
+};
+
+struct GBufferData
+{
+    half4 lighting [[color(0)]];
+    half4 albedo   [[color(1)]];
+    half4 normal   [[color(2)]];
+    float depth    [[color(3)]];
+};
+
+struct GBufferDepth
+{
+    float depth [[color(3)]];
+};
+
+struct TileLights
+{
+    atomic_uint count;
+    atomic_uint minDepth;       // float bits; non-negative floats order like uints
+    atomic_uint maxDepth;
+    uint        padding;
+    ushort      indices[ kMaxLightsPerTile ];
+};
+
+struct DeferredSceneV2F
+{
+    float4 position [[position]];
+    float3 normal;
+    half3  albedo;
+};
+
+struct DeferredLightingOut
+{
+    half4 lighting [[color(0)]];
+};
+
+// A 64x64 grid of quads over the screen, displaced into a wavy surface.
+constant uint kDeferredGrid = 64;
+constant uint2 kQuadCorners[ 6 ] = { uint2( 0, 0 ), uint2( 1, 0 ), uint2( 0, 1 ),
+                                     uint2( 1, 0 ), uint2( 1, 1 ), uint2( 0, 1 ) };
+
+DeferredSceneV2F vertex deferredSceneVertex( uint vertexId [[vertex_id]] )
+{
+    uint quad = vertexId / 6;
+    uint2 cell = uint2( quad % kDeferredGrid, quad / kDeferredGrid ) + kQuadCorners[ vertexId % 6 ];
+    float2 xy = float2( cell ) / float( kDeferredGrid ) * 2.0 - 1.0;
+
+    float z = 0.5 + 0.15 * sin( xy.x * 5.0 ) * cos( xy.y * 5.0 );
+    float dzdx = 0.75 * cos( xy.x * 5.0 ) * cos( xy.y * 5.0 );
+    float dzdy = -0.75 * sin( xy.x * 5.0 ) * sin( xy.y * 5.0 );
+
+    DeferredSceneV2F o;
+    o.position = float4( xy, z, 1.0 );
+    o.normal = normalize( float3( dzdx, dzdy, -1.0 ) );     // towards the viewer, at -z
+    o.albedo = ( ( cell.x / 8 + cell.y / 8 ) & 1 ) ? half3( 0.8h ) : half3( 0.5h, 0.6h, 0.7h );
+    return o;
+}
+
+float3 deferredScenePosition( float2 pixel, float depth, constant DeferredUniforms& uniforms )
+{
+    float2 ndc = pixel / uniforms.viewportSize * 2.0 - 1.0;
+    return float3( ndc.x, -ndc.y, depth );
+}
+
+half3 shadePointLight( constant PointLight& light, float3 position, float3 normal, half3 albedo )
+{
+    float3 toLight = float3( light.position ) - position;
+    float distance = length( toLight );
+    float falloff = saturate( 1.0 - distance / light.radius );
+    float diffuse = saturate( dot( normal, toLight / max( distance, 1e-4 ) ) );
+    return albedo * half3( float3( light.color ) * ( light.intensity * falloff * falloff * diffuse ) );
+}
+
+GBufferData fragment gbufferFragment( DeferredSceneV2F in [[stage_in]],
+                                      constant DeferredUniforms& uniforms [[buffer(1)]] )
+{
+    GBufferData o;
+    o.lighting = half4( in.albedo * half( uniforms.ambient ), 1.0h );
+    o.albedo = half4( in.albedo, 1.0h );
+    o.normal = half4( half3( normalize( in.normal ) ), 0.0h );
+    o.depth = in.position.z;
+    return o;
+}
+
+kernel void cullLightsTile( imageblock<GBufferDepth, imageblock_layout_implicit> gbuffer,
+                            constant PointLight* lights [[buffer(0)]],
+                            constant DeferredUniforms& uniforms [[buffer(1)]],
+                            threadgroup TileLights& tile [[threadgroup(0)]],
+                            ushort2 threadInTile [[thread_position_in_threadgroup]],
+                            ushort2 tileSize [[threads_per_threadgroup]],
+                            uint2 pixel [[thread_position_in_grid]] )
+{
+    uint threadIndex = threadInTile.y * tileSize.x + threadInTile.x;
+    if ( threadIndex == 0 )
+    {
+        atomic_store_explicit( &tile.count, 0, memory_order_relaxed );
+        atomic_store_explicit( &tile.minDepth, as_type<uint>( 1.0f ), memory_order_relaxed );
+        atomic_store_explicit( &tile.maxDepth, 0, memory_order_relaxed );
+    }
+    threadgroup_barrier( mem_flags::mem_threadgroup );
+
+    // Depth bounds over the pixels the scene covered; cleared pixels stay at 1.
+    float depth = gbuffer.read( threadInTile ).depth;
+    if ( depth < 1.0 )
+    {
+        atomic_fetch_min_explicit( &tile.minDepth, as_type<uint>( depth ), memory_order_relaxed );
+        atomic_fetch_max_explicit( &tile.maxDepth, as_type<uint>( depth ), memory_order_relaxed );
+    }
+    threadgroup_barrier( mem_flags::mem_threadgroup );
+
+    float minDepth = as_type<float>( atomic_load_explicit( &tile.minDepth, memory_order_relaxed ) );
+    float maxDepth = as_type<float>( atomic_load_explicit( &tile.maxDepth, memory_order_relaxed ) );
+    if ( minDepth > maxDepth )
+    {
+        return;
+    }
+
+    // The tile's box in scene space; y flips between pixels and NDC.
+    float2 origin = float2( pixel - uint2( threadInTile ) );
+    float3 cornerA = deferredScenePosition( origin, minDepth, uniforms );
+    float3 cornerB = deferredScenePosition( origin + float2( tileSize ), maxDepth, uniforms );
+    float3 boxMin = min( cornerA, cornerB );
+    float3 boxMax = max( cornerA, cornerB );
+
+    uint threadCount = tileSize.x * tileSize.y;
+    for ( uint i = threadIndex; i < uniforms.lightCount; i += threadCount )
+    {
+        float3 center = float3( lights[ i ].position );
+        float3 offset = center - clamp( center, boxMin, boxMax );
+        if ( dot( offset, offset ) <= lights[ i ].radius * lights[ i ].radius )
+        {
+            uint slot = atomic_fetch_add_explicit( &tile.count, 1, memory_order_relaxed );
+            if ( slot < kMaxLightsPerTile )
+            {
+                tile.indices[ slot ] = ushort( i );
+            }
+        }
+    }
+}
+
+DeferredSceneV2F vertex deferredFullscreenVertex( uint vertexId [[vertex_id]] )
+{
+    float2 p = float2( ( vertexId << 1 ) & 2, vertexId & 2 );
+    DeferredSceneV2F o;
+    o.position = float4( p * 2.0 - 1.0, 0.0, 1.0 );
+    o.normal = float3( 0.0 );
+    o.albedo = half3( 0.0h );
+    return o;
+}
+
+DeferredLightingOut fragment deferredLightingFragment( DeferredSceneV2F in [[stage_in]],
+                                                       GBufferData gbuffer,
+                                                       constant PointLight* lights [[buffer(0)]],
+                                                       constant DeferredUniforms& uniforms [[buffer(1)]],
+                                                       threadgroup TileLights& tile [[threadgroup(0)]] )
+{
+    DeferredLightingOut o;
+    o.lighting = gbuffer.lighting;
+    if ( gbuffer.depth >= 1.0 )
+    {
+        return o;
+    }
+
+    float3 position = deferredScenePosition( in.position.xy, gbuffer.depth, uniforms );
+    float3 normal = float3( gbuffer.normal.xyz );
+    uint count = min( atomic_load_explicit( &tile.count, memory_order_relaxed ), uint( kMaxLightsPerTile ) );
+    for ( uint i = 0; i < count; ++i )
+    {
+        o.lighting.rgb += shadePointLight( lights[ tile.indices[ i ] ], position, normal, gbuffer.albedo.rgb );
+    }
+    return o;
+}
+
+// Reference for the light scaling benchmark: the same scene shaded with every
+// light in every fragment.
+half4 fragment forwardLightingFragment( DeferredSceneV2F in [[stage_in]],
+                                        constant PointLight* lights [[buffer(0)]],
+                                        constant DeferredUniforms& uniforms [[buffer(1)]] )
+{
+    float3 position = deferredScenePosition( in.position.xy, in.position.z, uniforms );
+    float3 normal = normalize( in.normal );
+    half3 color = in.albedo * half( uniforms.ambient );
+    for ( uint i = 0; i < uniforms.lightCount; ++i )
+    {
+        color += shadePointLight( lights[ i ], position, normal, in.albedo );
+    }
+    return half4( color, 1.0h );
+}
+
+// Clustered light binning (see GpuClusterBinner, and binLights() for the CPU
+// oracle). Bounds and spheres hold whole multiples of the binning quantum, so
+// every step of the overlap test is exact and both sides agree bit for bit.
+struct ClusterBounds
+{
+    float4 minimum;
+    float4 maximum;
+};
+
+struct ClusterBinParams
+{
+    uint clusterCount;
+    uint lightCount;
+    uint wordsPerCluster;
+    uint indexCapacity;
+};
+
+// One thread per 32 lights of one cluster.
+kernel void clusterLightMasks( device const ClusterBounds* clusters [[buffer(0)]],
+                               device const float4* spheres [[buffer(1)]],
+                               constant ClusterBinParams& params [[buffer(2)]],
+                               device uint* masks [[buffer(3)]],
+                               uint2 id [[thread_position_in_grid]] )
+{
+    uint word = id.x, cluster = id.y;
+    if ( word >= params.wordsPerCluster || cluster >= params.clusterCount )
+    {
+        return;
+    }
+
+    float3 lo = clusters[ cluster ].minimum.xyz;
+    float3 hi = clusters[ cluster ].maximum.xyz;
+    uint bits = 0;
+    uint last = min( word * 32 + 32, params.lightCount );
+    for ( uint light = word * 32; light < last; ++light )
+    {
+        float4 s = spheres[ light ];
+        float3 d = max( max( lo - s.xyz, s.xyz - hi ), 0.0 );
+        bool hit = all( d <= s.w ) && d.x * d.x + d.y * d.y + d.z * d.z <= s.w * s.w;
+        bits |= uint( hit ) << ( light % 32 );
+    }
+    masks[ cluster * params.wordsPerCluster + word ] = bits;
+}
+
+// A single threadgroup: counts per cluster, then offsets as their exclusive
+// prefix sum in cluster order, the same layout the CPU produces.
+kernel void clusterLightOffsets( device const uint* masks [[buffer(0)]],
+                                 constant ClusterBinParams& params [[buffer(1)]],
+                                 device uint* offsets [[buffer(2)]],
+                                 device uint* counts [[buffer(3)]],
+                                 device uint* total [[buffer(4)]],
+                                 threadgroup uint* partial [[threadgroup(0)]],
+                                 uint thread [[thread_position_in_threadgroup]],
+                                 uint threads [[threads_per_threadgroup]] )
+{
+    uint perThread = ( params.clusterCount + threads - 1 ) / threads;
+    uint first = min( thread * perThread, params.clusterCount );
+    uint last = min( first + perThread, params.clusterCount );
+
+    uint sum = 0;
+    for ( uint cluster = first; cluster < last; ++cluster )
+    {
+        uint count = 0;
+        for ( uint word = 0; word < params.wordsPerCluster; ++word )
+        {
+            count += popcount( masks[ cluster * params.wordsPerCluster + word ] );
+        }
+        counts[ cluster ] = count;
+        sum += count;
+    }
+    partial[ thread ] = sum;
+    threadgroup_barrier( mem_flags::mem_threadgroup );
+
+    if ( thread == 0 )
+    {
+        uint running = 0;
+        for ( uint i = 0; i < threads; ++i )
+        {
+            uint value = partial[ i ];
+            partial[ i ] = running;
+            running += value;
+        }
+        total[ 0 ] = running;
+    }
+    threadgroup_barrier( mem_flags::mem_threadgroup );
+
+    uint running = partial[ thread ];
+    for ( uint cluster = first; cluster < last; ++cluster )
+    {
+        offsets[ cluster ] = running;
+        running += counts[ cluster ];
+    }
+}
+
+// One thread per cluster, expanding its bits into ascending light indices.
+kernel void clusterLightIndices( device const uint* masks [[buffer(0)]],
+                                 constant ClusterBinParams& params [[buffer(1)]],
+                                 device const uint* offsets [[buffer(2)]],
+                                 device ushort* indices [[buffer(3)]],
+                                 uint cluster [[thread_position_in_grid]] )
+{
+    if ( cluster >= params.clusterCount )
+    {
+        return;
+    }
+
+    uint out = offsets[ cluster ];
+    for ( uint word = 0; word < params.wordsPerCluster; ++word )
+    {
+        for ( uint bits = masks[ cluster * params.wordsPerCluster + word ]; bits != 0; bits &= bits - 1 )
+        {
+            // Past the capacity the lists are cut short; total still reports the real size.
+            if ( out < params.indexCapacity )
+            {
+                indices[ out ] = ushort( word * 32 + ctz( bits ) );
+            }
+            ++out;
+        }
+    }
+}
+
+// Cascaded shadow casters (see CascadedShadowRenderer). Depth only; the
+// constant bias is added in clip space so it stays a fixed number of depth
+// units per cascade, and the slope bias comes from the encoder's depth bias.
+struct ShadowCasterUniforms
+{
+    float4x4 viewProjection;
+    float4x4 model;
+    float depthBias;
+};
+
+vertex float4 shadowCasterVertex( uint vertexId [[vertex_id]],
+                                  device const packed_float3* positions [[buffer(0)]],
+                                  constant ShadowCasterUniforms& uniforms [[buffer(1)]] )
+{
+    float4 p = uniforms.viewProjection * ( uniforms.model * float4( positions[ vertexId ], 1.0 ) );
+    p.z += uniforms.depthBias * p.w;
+    return p;
+}
@@ -0,0 +1,178 @@
+//
+//  acceleration_structure_builder.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "acceleration_structure_builder.hpp"
+#include "View/resource_registry.hpp"
+#include "Core/job_system.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+AccelerationStructureBuilder::AccelerationStructureBuilder( MTL::Device* pDevice, ResourceRegistry* pResources,
+                                                            JobSystem& jobs, const BvhBuildSettings& settings )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+, _jobs( jobs )
+, _settings( settings )
+{
+    _pCompactedSize = _pResources->newBuffer( sizeof( uint32_t ), MTL::ResourceStorageModeShared, ResourceCategory::Readback, "Compacted structure size" );
+}
+
+AccelerationStructureBuilder::~AccelerationStructureBuilder()
+{
+    releaseBuffers();
+    _pResources->release( _pCompactedSize );
+    _pDevice->release();
+}
+
+void AccelerationStructureBuilder::releaseBuffers()
+{
+    _pResources->release( _pStructure );
+    _pResources->release( _pVertices );
+    _pResources->release( _pIndices );
+    _pResources->release( _pScratch );
+    if ( _pDesc )
+    {
+        _pDesc->release();
+    }
+    _pStructure = nullptr;
+    _pVertices = _pIndices = _pScratch = nullptr;
+    _pDesc = nullptr;
+}
+
+// Triangles in leaf order, so each BVH leaf is a contiguous index range.
+void AccelerationStructureBuilder::uploadIndices()
+{
+    uint32_t* pOut = static_cast<uint32_t*>( _pIndices->contents() );
+    _jobs.parallelFor( _bvh.primitiveOrder.size(), 4096, [&]( size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            memcpy( pOut + i * 3, &_mesh.indices[ size_t( _bvh.primitiveOrder[ i ] ) * 3 ], 3 * sizeof( uint32_t ) );
+        }
+    } );
+}
+
+void AccelerationStructureBuilder::encodeBuild( MTL::CommandBuffer* pCmd )
+{
+    MTL::AccelerationStructureCommandEncoder* pEnc = pCmd->accelerationStructureCommandEncoder();
+    pEnc->buildAccelerationStructure( _pStructure, _pDesc, _pScratch, 0 );
+    if ( !_animated )
+    {
+        pEnc->writeCompactedAccelerationStructureSize( _pStructure, _pCompactedSize, 0 );
+        pCmd->addCompletedHandler( [this]( MTL::CommandBuffer* )
+        {
+            _compactedSizeReady = true;
+        } );
+    }
+    pEnc->endEncoding();
+}
+
+void AccelerationStructureBuilder::build( MTL::CommandBuffer* pCmd, const MeshData& mesh, bool animated )
+{
+    TRACE_SCOPE( "AccelerationStructureBuilder::build" );
+    releaseBuffers();
+    _mesh = mesh;
+    _animated = animated;
+    _compactedSizeReady = false;
+
+    _bvh = buildBvh( triangleBounds( _mesh, _jobs ), _settings, _jobs );
+    _heuristic.rebuilt( bvhSahCost( _bvh, _settings ) );
+
+    _pVertices = _pResources->newBuffer( _mesh.vertices.data(), _mesh.vertices.size() * sizeof( MeshVertex ),
+                                         MTL::ResourceStorageModeShared, ResourceCategory::Geometry, "Ray tracing vertices" );
+    _pIndices = _pResources->newBuffer( _mesh.indices.size() * sizeof( uint32_t ), MTL::ResourceStorageModeShared,
+                                        ResourceCategory::Geometry, "Ray tracing indices" );
+    uploadIndices();
+
+    MTL::AccelerationStructureTriangleGeometryDescriptor* pGeometry = MTL::AccelerationStructureTriangleGeometryDescriptor::alloc()->init();
+    pGeometry->setVertexBuffer( _pVertices );
+    pGeometry->setVertexStride( sizeof( MeshVertex ) );
+    pGeometry->setIndexBuffer( _pIndices );
+    pGeometry->setIndexType( MTL::IndexTypeUInt32 );
+    pGeometry->setTriangleCount( _mesh.triangleCount() );
+    pGeometry->setOpaque( true );
+
+    _pDesc = MTL::PrimitiveAccelerationStructureDescriptor::alloc()->init();
+    _pDesc->setGeometryDescriptors( NS::Array::array( pGeometry ) );
+    _pDesc->setUsage( animated ? MTL::AccelerationStructureUsageRefit : MTL::AccelerationStructureUsageNone );
+    pGeometry->release();
+
+    MTL::AccelerationStructureSizes sizes = _pDevice->accelerationStructureSizes( _pDesc );
+    _pStructure = _pResources->newAccelerationStructure( sizes.accelerationStructureSize, ResourceCategory::Geometry, "Triangle acceleration structure" );
+    _pScratch = _pResources->newBuffer( std::max( sizes.buildScratchBufferSize, sizes.refitScratchBufferSize ),
+                                        MTL::ResourceStorageModePrivate, ResourceCategory::Other, "Acceleration structure scratch" );
+    encodeBuild( pCmd );
+}
+
+BvhUpdate AccelerationStructureBuilder::update( MTL::CommandBuffer* pCmd, const std::vector<MeshVertex>& positions )
+{
+    TRACE_SCOPE( "AccelerationStructureBuilder::update" );
+    if ( !_animated || positions.size() != _mesh.vertices.size() )
+    {
+        __builtin_printf( "AccelerationStructureBuilder: update() needs an animated mesh with the same vertex count\n" );
+        assert( false );
+        return BvhUpdate::Refit;
+    }
+
+    _mesh.vertices = positions;
+    memcpy( _pVertices->contents(), positions.data(), positions.size() * sizeof( MeshVertex ) );
+
+    // The CPU refit is cheap next to a build and tells how far the tree has
+    // drifted; Metal's tree was grouped the same way, so it drifts alike.
+    std::vector<BvhBounds> bounds = triangleBounds( _mesh, _jobs );
+    refitBvh( _bvh, bounds, _jobs );
+    BvhUpdate decision = _heuristic.refitted( bvhSahCost( _bvh, _settings ) );
+    if ( decision == BvhUpdate::Refit )
+    {
+        MTL::AccelerationStructureCommandEncoder* pEnc = pCmd->accelerationStructureCommandEncoder();
+        pEnc->refitAccelerationStructure( _pStructure, _pDesc, nullptr, _pScratch, 0 );
+        pEnc->endEncoding();
+        return decision;
+    }
+
+    // Same triangle count, so the structure and scratch keep their sizes.
+    _bvh = buildBvh( bounds, _settings, _jobs );
+    _heuristic.rebuilt( bvhSahCost( _bvh, _settings ) );
+    uploadIndices();
+    encodeBuild( pCmd );
+    return decision;
+}
+
+bool AccelerationStructureBuilder::compact( MTL::CommandBuffer* pCmd )
+{
+    if ( _animated || !_compactedSizeReady )
+    {
+        return false;
+    }
+    _compactedSizeReady = false;
+
+    uint32_t compactedSize = *static_cast<const uint32_t*>( _pCompactedSize->contents() );
+    MTL::AccelerationStructure* pCompacted = _pResources->newAccelerationStructure( compactedSize, ResourceCategory::Geometry, "Compacted triangle acceleration structure" );
+    if ( !pCompacted )
+    {
+        return false;
+    }
+
+    MTL::AccelerationStructureCommandEncoder* pEnc = pCmd->accelerationStructureCommandEncoder();
+    pEnc->copyAndCompactAccelerationStructure( _pStructure, pCompacted );
+    pEnc->endEncoding();
+
+    // The build-sized structure and its scratch are only needed until the copy has run.
+    MTL::AccelerationStructure* pOriginal = _pStructure;
+    MTL::Buffer* pScratch = _pScratch;
+    ResourceRegistry* pResources = _pResources;
+    pCmd->addCompletedHandler( [pResources, pOriginal, pScratch]( MTL::CommandBuffer* )
+    {
+        pResources->release( pOriginal );
+        pResources->release( pScratch );
+    } );
+    _pStructure = pCompacted;
+    _pScratch = nullptr;
+    return true;
+}
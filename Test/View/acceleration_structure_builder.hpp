@@ -0,0 +1,75 @@
+//
+//  acceleration_structure_builder.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef acceleration_structure_builder_hpp
+#define acceleration_structure_builder_hpp
+
+#include <Metal/Metal.hpp>
+#include <atomic>
+#include <vector>
+#include "Model/bvh_builder.hpp"
+
+class JobSystem;
+class ResourceRegistry;
+
+// Primitive acceleration structure for one triangle mesh.
+//
+// The CPU BVH orders the triangles, and the index buffer handed to Metal is
+// written in that order, so triangles that share a node are also neighbours in
+// memory when Metal builds and traverses its own tree. Intersection primitive
+// ids are therefore positions in primitiveOrder(), not original triangle ids.
+//
+// Animated meshes are built with refit usage and, on update(), refit in place
+// for as long as BvhUpdateHeuristic accepts the refit CPU tree's cost, then
+// rebuilt. Static meshes are compacted once their build has completed.
+class AccelerationStructureBuilder
+{
+public:
+    AccelerationStructureBuilder( MTL::Device* pDevice, ResourceRegistry* pResources, JobSystem& jobs,
+                                  const BvhBuildSettings& settings = BvhBuildSettings() );
+    ~AccelerationStructureBuilder();
+
+    void build( MTL::CommandBuffer* pCmd, const MeshData& mesh, bool animated );
+
+    // New positions for an animated mesh with unchanged topology. The vertex
+    // and index buffers are rewritten in place, so the previous build or refit
+    // must have completed.
+    BvhUpdate update( MTL::CommandBuffer* pCmd, const std::vector<MeshVertex>& positions );
+
+    // Encodes the copy into a compacted structure once the build's compacted
+    // size is known. Returns false while there is nothing to do.
+    bool compact( MTL::CommandBuffer* pCmd );
+
+    MTL::AccelerationStructure* accelerationStructure() const { return _pStructure; }
+    const std::vector<uint32_t>& primitiveOrder() const { return _bvh.primitiveOrder; }
+    size_t structureBytes() const { return _pStructure ? _pStructure->size() : 0; }
+
+private:
+    void uploadIndices();
+    void encodeBuild( MTL::CommandBuffer* pCmd );
+    void releaseBuffers();
+
+    MTL::Device*                                _pDevice;
+    ResourceRegistry*                           _pResources;
+    JobSystem&                                  _jobs;
+    BvhBuildSettings                            _settings;
+    BvhUpdateHeuristic                          _heuristic;
+
+    MeshData                                    _mesh;
+    Bvh                                         _bvh;
+    bool                                        _animated = false;
+
+    MTL::PrimitiveAccelerationStructureDescriptor* _pDesc = nullptr;
+    MTL::AccelerationStructure*                 _pStructure = nullptr;
+    MTL::Buffer*                                _pVertices = nullptr;
+    MTL::Buffer*                                _pIndices = nullptr;
+    MTL::Buffer*                                _pScratch = nullptr;
+    MTL::Buffer*                                _pCompactedSize = nullptr;
+    std::atomic<bool>                           _compactedSizeReady { false };
+};
+
+#endif /* acceleration_structure_builder_hpp */
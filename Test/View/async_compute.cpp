@@ -0,0 +1,215 @@
+//
+//  async_compute.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "async_compute.hpp"
+#include "View/resource_registry.hpp"
+#include "View/tile_deferred_renderer.hpp"
+#include "View/gpu_cluster_binner.hpp"
+#include "Model/light_set.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <deque>
+
+namespace
+{
+
+const uint32_t kBenchLights = 256;
+const uint32_t kBenchBinnedLights = 4096;
+const uint32_t kBenchBinningPasses = 8;     // enough compute to measure next to the frame
+const uint32_t kBenchIndexCapacity = 1u << 20;
+const uint32_t kBenchFramesInFlight = 2;
+
+}
+
+AsyncCompute::AsyncCompute( MTL::Device* pDevice )
+: _pQueue( pDevice->newCommandQueue() )
+, _timeline( pDevice, "Compute timeline" )
+{
+    _pQueue->setLabel( NS::String::string( "Async compute", NS::StringEncoding::UTF8StringEncoding ) );
+}
+
+AsyncCompute::~AsyncCompute()
+{
+    // Completion handlers refer back to this object.
+    _timeline.wait( _timeline.lastReserved(), 10000 );
+    _pQueue->release();
+}
+
+MTL::CommandBuffer* AsyncCompute::begin( SharedEventTimeline* pWait, uint64_t waitValue )
+{
+    MTL::CommandBuffer* pCmd = _pQueue->commandBuffer();
+    if ( pWait && waitValue )
+    {
+        pWait->encodeWait( pCmd, waitValue );
+    }
+    return pCmd;
+}
+
+uint64_t AsyncCompute::commit( MTL::CommandBuffer* pCmd )
+{
+    uint64_t value = _timeline.reserve();
+    track( pCmd, true );
+    _timeline.encodeSignal( pCmd, value );
+    pCmd->commit();
+    return value;
+}
+
+void AsyncCompute::waitInGraphics( MTL::CommandBuffer* pGraphicsCmd, uint64_t computeValue )
+{
+    _timeline.encodeWait( pGraphicsCmd, computeValue );
+}
+
+void AsyncCompute::trackGraphics( MTL::CommandBuffer* pGraphicsCmd )
+{
+    track( pGraphicsCmd, false );
+}
+
+void AsyncCompute::track( MTL::CommandBuffer* pCmd, bool compute )
+{
+    pCmd->addCompletedHandler( [this, compute]( MTL::CommandBuffer* pDone )
+    {
+        QueueInterval interval = { pDone->GPUStartTime() * 1e3, pDone->GPUEndTime() * 1e3 };
+        std::lock_guard<std::mutex> lock( _mutex );
+        ( compute ? _compute : _graphics ).push_back( interval );
+    } );
+}
+
+QueueOverlap AsyncCompute::takeOverlap()
+{
+    std::vector<QueueInterval> graphics, compute;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        graphics.swap( _graphics );
+        compute.swap( _compute );
+    }
+    return measureQueueOverlap( std::move( graphics ), std::move( compute ) );
+}
+
+std::vector<BenchResult> runAsyncComputeBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                               uint32_t width, uint32_t height,
+                                               uint32_t frames, uint32_t warmupFrames )
+{
+    std::vector<BenchResult> results;
+    if ( !TileDeferredRenderer::supported( pDevice ) )
+    {
+        __builtin_printf( "Async compute bench: %s has no tile shaders (needs Apple4)\n", pDevice->name()->utf8String() );
+        return results;
+    }
+
+    ResourceRegistry* pResources = new ResourceRegistry( pDevice );
+    TileDeferredRenderer* pScene = new TileDeferredRenderer( pDevice, pResources );
+    LightSetDesc lightDesc;
+    lightDesc.count = kBenchLights;
+    pScene->setLights( generateLights( lightDesc ) );
+
+    ClusterGridDesc grid;
+    ViewSpaceLightSetDesc binnedDesc;
+    binnedDesc.count = kBenchBinnedLights;
+    GpuClusterBinner* pBinner = new GpuClusterBinner( pDevice, pResources );
+    pBinner->setInputs( buildClusterBounds( grid ), buildClusterSpheres( grid, generateViewSpaceLights( binnedDesc ) ),
+                        kBenchIndexCapacity );
+
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatBGRA8Unorm_sRGB, width, height, false );
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget );
+    MTL::Texture* pOutput = pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "Async compute bench output" );
+    pDesc->release();
+
+    AsyncCompute* pAsync = new AsyncCompute( pDevice );
+    for ( bool overlapped : { false, true } )
+    {
+        std::deque<MTL::CommandBuffer*> inFlight;
+        std::vector<double> cpuMs, graphicsEndMs;
+        auto retire = [&]()
+        {
+            MTL::CommandBuffer* pDone = inFlight.front();
+            inFlight.pop_front();
+            pDone->waitUntilCompleted();
+            graphicsEndMs.push_back( pDone->GPUEndTime() * 1e3 );
+            pDone->release();
+        };
+
+        uint64_t previousCompute = 0;
+        for ( uint32_t frame = 0; frame < warmupFrames + frames; ++frame )
+        {
+            NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+            if ( frame == warmupFrames )
+            {
+                pAsync->takeOverlap();
+            }
+
+            uint64_t start = TraceRecorder::nowNs();
+            MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+            if ( overlapped )
+            {
+                // Binning for the next frame runs beside this one, which shades
+                // with the lists binned during the previous frame.
+                MTL::CommandBuffer* pCompute = pAsync->begin();
+                for ( uint32_t pass = 0; pass < kBenchBinningPasses; ++pass )
+                {
+                    pBinner->encode( pCompute );
+                }
+                uint64_t computeValue = pAsync->commit( pCompute );
+                if ( previousCompute )
+                {
+                    pAsync->waitInGraphics( pCmd, previousCompute );
+                }
+                previousCompute = computeValue;
+                pAsync->trackGraphics( pCmd );
+            }
+            else
+            {
+                for ( uint32_t pass = 0; pass < kBenchBinningPasses; ++pass )
+                {
+                    pBinner->encode( pCmd );
+                }
+            }
+            pScene->encodeForward( pCmd, pOutput );
+            pCmd->commit();
+            if ( frame >= warmupFrames )
+            {
+                cpuMs.push_back( double( TraceRecorder::nowNs() - start ) * 1e-6 );
+            }
+
+            inFlight.push_back( pCmd->retain() );
+            if ( inFlight.size() > kBenchFramesInFlight )
+            {
+                retire();
+            }
+            pPool->release();
+        }
+        while ( !inFlight.empty() )
+        {
+            retire();
+        }
+
+        // Frame time is the spacing of graphics completions, what a GPU bound loop runs at.
+        std::vector<double> frameMs;
+        for ( size_t i = warmupFrames + 1; i < graphicsEndMs.size(); ++i )
+        {
+            frameMs.push_back( graphicsEndMs[ i ] - graphicsEndMs[ i - 1 ] );
+        }
+
+        BenchResult& result = results.emplace_back();
+        result.scene = overlapped ? "async" : "serial";
+        result.cpuEncode = summarizeFrameTimes( cpuMs );
+        result.gpu = summarizeFrameTimes( frameMs );
+        result.memoryBytes = pResources->tracker().totalBytes();
+        if ( overlapped )
+        {
+            pAsync->timeline().wait( previousCompute, 10000 );
+            printQueueOverlap( "Async compute", pAsync->takeOverlap() );
+        }
+    }
+
+    delete pAsync;
+    pResources->release( pOutput );
+    delete pBinner;
+    delete pScene;
+    delete pResources;
+    return results;
+}
@@ -0,0 +1,71 @@
+//
+//  async_compute.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef async_compute_hpp
+#define async_compute_hpp
+
+#include <Metal/Metal.hpp>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "View/shared_event_timeline.hpp"
+#include "Model/queue_overlap.hpp"
+#include "Model/bench_suite.hpp"
+
+// A second command queue for compute work that can run alongside
+// rasterization, such as culling, particle updates and post effects.
+//
+// Each compute submission signals the next value of the compute timeline.
+// Graphics command buffers wait for exactly the value whose results they
+// read, and only right before the pass that reads them, so whatever graphics
+// work comes first (shadows, a depth prepass) overlaps with the compute. Work
+// that needs graphics results waits on a graphics timeline value the same way.
+// Every command buffer's GPU interval is recorded, so the overlap actually
+// gained can be measured.
+class AsyncCompute
+{
+public:
+    explicit AsyncCompute( MTL::Device* pDevice );
+    ~AsyncCompute();
+
+    MTL::CommandQueue* queue() const { return _pQueue; }
+    SharedEventTimeline& timeline() { return _timeline; }
+
+    // A compute command buffer that starts once pWait reaches waitValue, if given.
+    MTL::CommandBuffer* begin( SharedEventTimeline* pWait = nullptr, uint64_t waitValue = 0 );
+
+    // Signals the next compute value when pCmd is done, commits it and returns the value.
+    uint64_t commit( MTL::CommandBuffer* pCmd );
+
+    // Work encoded into pGraphicsCmd from here on waits for computeValue.
+    void waitInGraphics( MTL::CommandBuffer* pGraphicsCmd, uint64_t computeValue );
+
+    // Includes pGraphicsCmd in the overlap measurement. Call before committing it.
+    void trackGraphics( MTL::CommandBuffer* pGraphicsCmd );
+
+    // Overlap of everything completed since the last call.
+    QueueOverlap takeOverlap();
+
+private:
+    void track( MTL::CommandBuffer* pCmd, bool compute );
+
+    MTL::CommandQueue*              _pQueue;
+    SharedEventTimeline             _timeline;
+    std::mutex                      _mutex;
+    std::vector<QueueInterval>      _graphics;
+    std::vector<QueueInterval>      _compute;
+};
+
+// Renders a forward-lit frame on the graphics queue while cluster light
+// binning for the next frame runs as compute, once serially on the graphics
+// queue and once on an AsyncCompute queue. Reports frame times as "serial" and
+// "async" results and prints the measured overlap of the async run.
+std::vector<BenchResult> runAsyncComputeBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                               uint32_t width, uint32_t height,
+                                               uint32_t frames, uint32_t warmupFrames );
+
+#endif /* async_compute_hpp */
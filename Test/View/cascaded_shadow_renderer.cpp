@@ -0,0 +1,164 @@
+//
+//  cascaded_shadow_renderer.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "cascaded_shadow_renderer.hpp"
+#include "View/resource_registry.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <cstring>
+
+namespace
+{
+
+// Matches ShadowCasterUniforms in Shaders.metal.
+struct ShadowCasterUniforms
+{
+    float viewProjection[ 16 ];
+    float model[ 16 ];
+    float depthBias;
+    float padding[ 3 ];
+};
+
+}
+
+CascadedShadowRenderer::CascadedShadowRenderer( MTL::Device* pDevice, ResourceRegistry* pResources,
+                                                const CascadeSettings& settings )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+, _cascades( settings )
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+
+    NS::Error* pError = nullptr;
+    MTL::Library* pLibrary = _pDevice->newDefaultLibrary();
+    MTL::Function* pVertexFn = pLibrary->newFunction( NS::String::string( "shadowCasterVertex", UTF8StringEncoding ) );
+
+    // Depth only: no fragment function, no color attachments.
+    MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pDesc->setVertexFunction( pVertexFn );
+    pDesc->setDepthAttachmentPixelFormat( MTL::PixelFormatDepth32Float );
+    _pCasterPSO = _pDevice->newRenderPipelineState( pDesc, &pError );
+    if ( !_pCasterPSO )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    pDesc->release();
+    pVertexFn->release();
+    pLibrary->release();
+
+    MTL::DepthStencilDescriptor* pDepthDesc = MTL::DepthStencilDescriptor::alloc()->init();
+    pDepthDesc->setDepthCompareFunction( MTL::CompareFunctionLess );
+    pDepthDesc->setDepthWriteEnabled( true );
+    _pDepthState = _pDevice->newDepthStencilState( pDepthDesc );
+    pDepthDesc->release();
+
+    const CascadeSettings& applied = _cascades.settings();
+    MTL::TextureDescriptor* pTexDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatDepth32Float, applied.mapSize, applied.mapSize, false );
+    pTexDesc->setTextureType( MTL::TextureType2DArray );
+    pTexDesc->setArrayLength( applied.cascadeCount );
+    pTexDesc->setStorageMode( MTL::StorageModePrivate );
+    pTexDesc->setUsage( MTL::TextureUsageRenderTarget );
+    _pStaticMap = _pResources->newTexture( pTexDesc, ResourceCategory::RenderTarget, "Static shadow cascades" );
+    pTexDesc->setUsage( MTL::TextureUsageRenderTarget | MTL::TextureUsageShaderRead );
+    _pShadowMap = _pResources->newTexture( pTexDesc, ResourceCategory::RenderTarget, "Shadow cascades" );
+    pTexDesc->release();
+
+    _pRpd = MTL::RenderPassDescriptor::alloc()->init();
+    _pRpd->depthAttachment()->setStoreAction( MTL::StoreActionStore );
+    _pRpd->depthAttachment()->setClearDepth( 1.0 );
+}
+
+CascadedShadowRenderer::~CascadedShadowRenderer()
+{
+    _pResources->release( _pShadowMap );
+    _pResources->release( _pStaticMap );
+    _pRpd->release();
+    _pDepthState->release();
+    _pCasterPSO->release();
+    _pDevice->release();
+}
+
+void CascadedShadowRenderer::setCasters( const std::vector<ShadowMesh>& meshes, const std::vector<ShadowCaster>& casters )
+{
+    _meshes = meshes;
+    _casters = casters;
+    _cascades.invalidateStatic();
+}
+
+void CascadedShadowRenderer::drawCasters( MTL::RenderCommandEncoder* pEnc, const Cascade& cascade,
+                                          const std::vector<uint32_t>& casters )
+{
+    pEnc->setRenderPipelineState( _pCasterPSO );
+    pEnc->setDepthStencilState( _pDepthState );
+    pEnc->setDepthClipMode( MTL::DepthClipModeClamp );
+    const CascadeSettings& settings = _cascades.settings();
+    pEnc->setDepthBias( 0.0f, settings.slopeBias, settings.slopeBiasClamp );
+
+    ShadowCasterUniforms uniforms = { };
+    memcpy( uniforms.viewProjection, cascade.viewProjection, sizeof( uniforms.viewProjection ) );
+    uniforms.depthBias = cascade.depthBias;
+    for ( uint32_t index : casters )
+    {
+        const ShadowMesh& mesh = _meshes[ index ];
+        memcpy( uniforms.model, mesh.model, sizeof( uniforms.model ) );
+        pEnc->setVertexBuffer( mesh.pPositions, 0, 0 );
+        pEnc->setVertexBytes( &uniforms, sizeof( uniforms ), 1 );
+        pEnc->drawIndexedPrimitives( MTL::PrimitiveTypeTriangle, mesh.indexCount, MTL::IndexTypeUInt32, mesh.pIndices, 0 );
+    }
+}
+
+void CascadedShadowRenderer::encode( MTL::CommandBuffer* pCmd, const ShadowCamera& camera, JobSystem& jobs )
+{
+    TRACE_SCOPE( "CascadedShadowRenderer::encode" );
+    _cascades.update( camera );
+    std::vector<CascadeCasters> visible;
+    {
+        TRACE_SCOPE( "cullShadowCasters" );
+        visible = cullShadowCasters( _cascades, _casters, jobs );
+    }
+
+    _stats = ShadowFrameStats();
+    const std::vector<Cascade>& cascades = _cascades.cascades();
+    MTL::RenderPassDepthAttachmentDescriptor* pDepth = _pRpd->depthAttachment();
+
+    pDepth->setTexture( _pStaticMap );
+    pDepth->setLoadAction( MTL::LoadActionClear );
+    for ( size_t c = 0; c < cascades.size(); ++c )
+    {
+        if ( !cascades[ c ].staticDirty )
+        {
+            continue;
+        }
+        pDepth->setSlice( c );
+        MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( _pRpd );
+        drawCasters( pEnc, cascades[ c ], visible[ c ].staticCasters );
+        pEnc->endEncoding();
+        ++_stats.staticCascadesDrawn;
+        _stats.staticDraws += uint32_t( visible[ c ].staticCasters.size() );
+    }
+
+    // Static depth as the starting point of every cascade.
+    MTL::BlitCommandEncoder* pBlit = pCmd->blitCommandEncoder();
+    pBlit->copyFromTexture( _pStaticMap, 0, 0, _pShadowMap, 0, 0, cascades.size(), 1 );
+    pBlit->endEncoding();
+
+    pDepth->setTexture( _pShadowMap );
+    pDepth->setLoadAction( MTL::LoadActionLoad );
+    for ( size_t c = 0; c < cascades.size(); ++c )
+    {
+        if ( visible[ c ].dynamicCasters.empty() )
+        {
+            continue;
+        }
+        pDepth->setSlice( c );
+        MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( _pRpd );
+        drawCasters( pEnc, cascades[ c ], visible[ c ].dynamicCasters );
+        pEnc->endEncoding();
+        _stats.dynamicDraws += uint32_t( visible[ c ].dynamicCasters.size() );
+    }
+}
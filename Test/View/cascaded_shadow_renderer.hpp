@@ -0,0 +1,81 @@
+//
+//  cascaded_shadow_renderer.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef cascaded_shadow_renderer_hpp
+#define cascaded_shadow_renderer_hpp
+
+#include <Metal/Metal.hpp>
+#include <vector>
+#include "Model/shadow_cascades.hpp"
+
+class JobSystem;
+class ResourceRegistry;
+
+// Geometry of one shadow caster: packed float3 positions, uint32 indices and
+// a column-major model matrix.
+struct ShadowMesh
+{
+    MTL::Buffer*    pPositions;
+    MTL::Buffer*    pIndices;
+    uint32_t        indexCount;
+    float           model[ 16 ];
+};
+
+struct ShadowFrameStats
+{
+    uint32_t staticCascadesDrawn = 0;
+    uint32_t staticDraws         = 0;
+    uint32_t dynamicDraws        = 0;
+};
+
+// Renders cascaded shadow maps into a Depth32Float array, one slice per cascade.
+//
+// Static casters go into a second, cached array that is only redrawn for a
+// cascade when ShadowCascades marks it dirty. Every frame each cached slice is
+// copied into the shadow map and only the dynamic casters are drawn on top.
+// Casters are culled per cascade on the job system. The caster pass clamps
+// depth rather than clipping, so casters between the light and the box still
+// cast into it.
+class CascadedShadowRenderer
+{
+public:
+    CascadedShadowRenderer( MTL::Device* pDevice, ResourceRegistry* pResources,
+                            const CascadeSettings& settings = CascadeSettings() );
+    ~CascadedShadowRenderer();
+
+    ShadowCascades& cascades() { return _cascades; }
+
+    // meshes[i] is drawn for casters[i]. Changing the set invalidates the static cache.
+    void setCasters( const std::vector<ShadowMesh>& meshes, const std::vector<ShadowCaster>& casters );
+
+    // Marks the casters' static layer stale, e.g. after moving static geometry.
+    void invalidateStatic() { _cascades.invalidateStatic(); }
+
+    void encode( MTL::CommandBuffer* pCmd, const ShadowCamera& camera, JobSystem& jobs );
+
+    MTL::Texture* shadowMap() const { return _pShadowMap; }
+    const ShadowFrameStats& lastFrame() const { return _stats; }
+
+private:
+    void drawCasters( MTL::RenderCommandEncoder* pEnc, const Cascade& cascade, const std::vector<uint32_t>& casters );
+
+    MTL::Device*                    _pDevice;
+    ResourceRegistry*               _pResources;
+    ShadowCascades                  _cascades;
+
+    MTL::RenderPipelineState*       _pCasterPSO;
+    MTL::DepthStencilState*         _pDepthState;
+    MTL::RenderPassDescriptor*      _pRpd;
+    MTL::Texture*                   _pStaticMap;
+    MTL::Texture*                   _pShadowMap;
+
+    std::vector<ShadowMesh>         _meshes;
+    std::vector<ShadowCaster>       _casters;
+    ShadowFrameStats                _stats;
+};
+
+#endif /* cascaded_shadow_renderer_hpp */
@@ -0,0 +1,57 @@
+//
+//  compressed_texture.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "compressed_texture.hpp"
+#include "resource_registry.hpp"
+
+MTL::PixelFormat pixelFormatFor( BlockFormat format, bool sRGB )
+{
+    switch ( format )
+    {
+        case BlockFormat::BC1:     return sRGB ? MTL::PixelFormatBC1_RGBA_sRGB : MTL::PixelFormatBC1_RGBA;
+        case BlockFormat::BC3:     return sRGB ? MTL::PixelFormatBC3_RGBA_sRGB : MTL::PixelFormatBC3_RGBA;
+        case BlockFormat::BC4:     return MTL::PixelFormatBC4_RUnorm;
+        case BlockFormat::BC5:     return MTL::PixelFormatBC5_RGUnorm;
+        case BlockFormat::BC7:     return sRGB ? MTL::PixelFormatBC7_RGBAUnorm_sRGB : MTL::PixelFormatBC7_RGBAUnorm;
+        case BlockFormat::ASTC4x4: return sRGB ? MTL::PixelFormatASTC_4x4_sRGB : MTL::PixelFormatASTC_4x4_LDR;
+    }
+    return MTL::PixelFormatInvalid;
+}
+
+bool supportsBlockFormat( MTL::Device* pDevice, BlockFormat format )
+{
+    if ( format == BlockFormat::ASTC4x4 )
+    {
+        return pDevice->supportsFamily( MTL::GPUFamilyApple2 );
+    }
+    return pDevice->supportsBCTextureCompression();
+}
+
+MTL::Texture* newCompressedTexture( MTL::Device* pDevice, ResourceRegistry* pResources, const CompressedImage& image, bool sRGB )
+{
+    if ( !supportsBlockFormat( pDevice, image.format ) )
+    {
+        return nullptr;
+    }
+
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( pixelFormatFor( image.format, sRGB ), image.width, image.height, false );
+    pDesc->setStorageMode( MTL::StorageModeManaged );
+    pDesc->setUsage( MTL::TextureUsageShaderRead );
+
+    MTL::Texture* pTexture = pResources->newTexture( pDesc, ResourceCategory::Texture, "Compressed texture" );
+    pDesc->release();
+    if ( !pTexture )
+    {
+        return nullptr;
+    }
+
+    // For block formats bytesPerRow is the size of one row of blocks.
+    const NS::UInteger BlocksX = ( image.width + 3 ) / 4;
+    pTexture->replaceRegion( MTL::Region::Make2D( 0, 0, image.width, image.height ), 0,
+                             image.data.data(), BlocksX * blockSizeInBytes( image.format ) );
+    return pTexture;
+}
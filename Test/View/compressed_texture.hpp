@@ -0,0 +1,26 @@
+//
+//  compressed_texture.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef compressed_texture_hpp
+#define compressed_texture_hpp
+
+#include <Metal/Metal.hpp>
+#include "Model/block_compressor.hpp"
+
+class ResourceRegistry;
+
+MTL::PixelFormat pixelFormatFor( BlockFormat format, bool sRGB );
+
+// Whether the device can sample the format at all (BC on macOS GPUs, ASTC on Apple GPUs).
+bool supportsBlockFormat( MTL::Device* pDevice, BlockFormat format );
+
+// Creates a single-mip texture holding the compressed blocks, in the registry's
+// Texture category; release it through the registry. Returns nullptr if the
+// device cannot sample the format or the budget cannot fit it.
+MTL::Texture* newCompressedTexture( MTL::Device* pDevice, ResourceRegistry* pResources, const CompressedImage& image, bool sRGB );
+
+#endif /* compressed_texture_hpp */
@@ -0,0 +1,231 @@
+//
+//  dynamic_resolution.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "dynamic_resolution.hpp"
+#include "View/resource_registry.hpp"
+
+#include <algorithm>
+
+namespace
+{
+
+// Matches UpscaleParams in Shaders.metal.
+struct UpscaleParams
+{
+    float screenSize[ 2 ];      // scaled size the scene was laid out at
+    float validSize[ 2 ];       // pixels written in the internal target
+    float textureSize[ 2 ];     // internal target size
+};
+
+// Shading rate per fifth of the screen on each axis; the outer band runs at half rate.
+const float kZoneRates[] = { 0.5f, 1.0f, 1.0f, 1.0f, 0.5f };
+
+}
+
+DynamicResolution::DynamicResolution( MTL::Device* pDevice, ResourceRegistry* pResources,
+                                      const ResolutionControllerSettings& settings )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+, _controller( settings )
+{
+    _pSceneRpd = MTL::RenderPassDescriptor::alloc()->init();
+    _pUpscaleRpd = MTL::RenderPassDescriptor::alloc()->init();
+
+    // Every output pixel is written by the fullscreen triangle.
+    MTL::RenderPassColorAttachmentDescriptor* pOutput = _pUpscaleRpd->colorAttachments()->object( 0 );
+    pOutput->setLoadAction( MTL::LoadActionDontCare );
+    pOutput->setStoreAction( MTL::StoreActionStore );
+
+    buildPipelines();
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    if ( _pRateMap )
+    {
+        _pRateMap->release();
+        _pResources->release( _pRateMapData );
+    }
+    if ( _pColor )
+    {
+        _pResources->release( _pColor );
+    }
+    _pSceneRpd->release();
+    _pUpscaleRpd->release();
+    _pUpscalePSO->release();
+    if ( _pUpscaleRateMapPSO )
+    {
+        _pUpscaleRateMapPSO->release();
+    }
+    _pDevice->release();
+}
+
+void DynamicResolution::buildPipelines()
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+
+    MTL::Library* pLibrary = _pDevice->newDefaultLibrary();
+    MTL::Function* pVertexFn = pLibrary->newFunction( NS::String::string( "upscaleVertex", UTF8StringEncoding ) );
+    MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pDesc->setVertexFunction( pVertexFn );
+    pDesc->colorAttachments()->object( 0 )->setPixelFormat( MTL::PixelFormatBGRA8Unorm_sRGB );
+
+    const bool SupportsRateMap = _pDevice->supportsRasterizationRateMap( 1 );
+    for ( bool useRateMap : { false, true } )
+    {
+        if ( useRateMap && !SupportsRateMap )
+        {
+            break;
+        }
+
+        NS::Error* pError = nullptr;
+        MTL::FunctionConstantValues* pConstants = MTL::FunctionConstantValues::alloc()->init();
+        pConstants->setConstantValue( &useRateMap, MTL::DataTypeBool, NS::UInteger( 1 ) );
+        MTL::Function* pFragFn = pLibrary->newFunction( NS::String::string( "upscaleFragment", UTF8StringEncoding ), pConstants, &pError );
+        pConstants->release();
+        if ( !pFragFn )
+        {
+            __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+            assert( false );
+        }
+
+        pDesc->setFragmentFunction( pFragFn );
+        MTL::RenderPipelineState* pPSO = _pDevice->newRenderPipelineState( pDesc, &pError );
+        if ( !pPSO )
+        {
+            __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+            assert( false );
+        }
+        ( useRateMap ? _pUpscaleRateMapPSO : _pUpscalePSO ) = pPSO;
+        pFragFn->release();
+    }
+
+    pDesc->release();
+    pVertexFn->release();
+    pLibrary->release();
+}
+
+bool DynamicResolution::setRateMapEnabled( bool enabled )
+{
+    _rateMapEnabled = enabled && _pUpscaleRateMapPSO;
+    return _rateMapEnabled == enabled;
+}
+
+void DynamicResolution::allocateTarget( uint32_t width, uint32_t height )
+{
+    if ( _pColor )
+    {
+        // Frames still in flight keep the old texture alive until they complete.
+        _pResources->release( _pColor );
+    }
+
+    // Same format the view uses, so the renderer's pipelines apply unchanged.
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatBGRA8Unorm_sRGB, width, height, false );
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget | MTL::TextureUsageShaderRead );
+    _pColor = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "Dynamic resolution color" );
+    pDesc->release();
+
+    _width = width;
+    _height = height;
+}
+
+void DynamicResolution::rebuildRateMap( uint32_t screenWidth, uint32_t screenHeight )
+{
+    if ( _pRateMap )
+    {
+        _pRateMap->release();
+        _pResources->release( _pRateMapData );
+    }
+
+    const NS::UInteger Zones = sizeof( kZoneRates ) / sizeof( kZoneRates[ 0 ] );
+    MTL::RasterizationRateLayerDescriptor* pLayer = MTL::RasterizationRateLayerDescriptor::alloc()->init( MTL::Size::Make( Zones, Zones, 1 ), kZoneRates, kZoneRates );
+    MTL::RasterizationRateMapDescriptor* pDesc = MTL::RasterizationRateMapDescriptor::rasterizationRateMapDescriptor( MTL::Size::Make( screenWidth, screenHeight, 0 ), pLayer );
+    _pRateMap = _pDevice->newRasterizationRateMap( pDesc );
+    pLayer->release();
+
+    MTL::SizeAndAlign dataSize = _pRateMap->parameterBufferSizeAndAlign();
+    _pRateMapData = _pResources->newBuffer( dataSize.size, MTL::ResourceStorageModeShared, ResourceCategory::Other, "Rasterization rate map data" );
+    _pRateMap->copyParameterDataToBuffer( _pRateMapData, 0 );
+}
+
+MTL::RenderPassDescriptor* DynamicResolution::beginFrame( MTL::RenderPassDescriptor* pOutputRpd )
+{
+    MTL::Texture* pOutput = pOutputRpd->colorAttachments()->object( 0 )->texture();
+    const uint32_t OutputWidth = uint32_t( pOutput->width() );
+    const uint32_t OutputHeight = uint32_t( pOutput->height() );
+    if ( OutputWidth != _width || OutputHeight != _height )
+    {
+        allocateTarget( OutputWidth, OutputHeight );
+    }
+
+    _frameScale = _controller.scale();
+    _screenWidth = std::min( _controller.scaledDimension( OutputWidth ), OutputWidth );
+    _screenHeight = std::min( _controller.scaledDimension( OutputHeight ), OutputHeight );
+
+    if ( _rateMapEnabled )
+    {
+        MTL::Size mapSize = _pRateMap ? _pRateMap->screenSize() : MTL::Size::Make( 0, 0, 0 );
+        if ( mapSize.width != _screenWidth || mapSize.height != _screenHeight )
+        {
+            rebuildRateMap( _screenWidth, _screenHeight );
+        }
+        MTL::Size physical = _pRateMap->physicalSize( 0 );
+        _physicalWidth = uint32_t( physical.width );
+        _physicalHeight = uint32_t( physical.height );
+        _pSceneRpd->setRasterizationRateMap( _pRateMap );
+    }
+    else
+    {
+        _physicalWidth = _screenWidth;
+        _physicalHeight = _screenHeight;
+        _pSceneRpd->setRasterizationRateMap( nullptr );
+    }
+
+    // Limits both the clear and rasterization to the corner in use.
+    _pSceneRpd->setRenderTargetWidth( _physicalWidth );
+    _pSceneRpd->setRenderTargetHeight( _physicalHeight );
+
+    // Set every frame, since the renderer's FrameAttachments may have swapped
+    // in an MSAA texture resolving into it.
+    MTL::RenderPassColorAttachmentDescriptor* pColor = _pSceneRpd->colorAttachments()->object( 0 );
+    pColor->setTexture( _pColor );
+    pColor->setResolveTexture( nullptr );
+    pColor->setLoadAction( MTL::LoadActionClear );
+    pColor->setStoreAction( MTL::StoreActionStore );
+    pColor->setClearColor( pOutputRpd->colorAttachments()->object( 0 )->clearColor() );
+
+    _pUpscaleRpd->colorAttachments()->object( 0 )->setTexture( pOutput );
+    return _pSceneRpd;
+}
+
+void DynamicResolution::setViewport( MTL::RenderCommandEncoder* pEnc ) const
+{
+    // With a rate map the viewport stays in screen space; the map does the rest.
+    pEnc->setViewport( MTL::Viewport { 0.0, 0.0, double( _screenWidth ), double( _screenHeight ), 0.0, 1.0 } );
+}
+
+void DynamicResolution::encodeUpscale( MTL::CommandBuffer* pCmd )
+{
+    UpscaleParams params = {
+        { float( _screenWidth ), float( _screenHeight ) },
+        { float( _physicalWidth ), float( _physicalHeight ) },
+        { float( _width ), float( _height ) },
+    };
+
+    MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( _pUpscaleRpd );
+    pEnc->setLabel( NS::String::string( "Upscale", NS::StringEncoding::UTF8StringEncoding ) );
+    pEnc->setRenderPipelineState( _rateMapEnabled ? _pUpscaleRateMapPSO : _pUpscalePSO );
+    pEnc->setFragmentTexture( _pColor, 0 );
+    pEnc->setFragmentBytes( &params, sizeof( params ), 0 );
+    if ( _rateMapEnabled )
+    {
+        pEnc->setFragmentBuffer( _pRateMapData, 0, 1 );
+    }
+    pEnc->drawPrimitives( MTL::PrimitiveTypeTriangle, NS::UInteger( 0 ), NS::UInteger( 3 ) );
+    pEnc->endEncoding();
+}
@@ -0,0 +1,81 @@
+//
+//  dynamic_resolution.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef dynamic_resolution_hpp
+#define dynamic_resolution_hpp
+
+#include <Metal/Metal.hpp>
+#include "Model/resolution_controller.hpp"
+
+class ResourceRegistry;
+
+// Renders the scene into an internal target at a scale picked by a
+// ResolutionController and upscales it into the output texture afterwards.
+//
+// The internal color target is allocated once at the output size; lower scales
+// render into its top-left corner by limiting the pass's render target size, so
+// changing the scale never reallocates. Depth comes from the renderer's
+// FrameAttachments, like any other scene pass. With the rate map
+// enabled (on devices that support it), the scene pass also gets a
+// MTL::RasterizationRateMap that shades the edges of the screen at half rate,
+// and the upscale pass maps screen coordinates back through it.
+class DynamicResolution
+{
+public:
+    DynamicResolution( MTL::Device* pDevice, ResourceRegistry* pResources,
+                       const ResolutionControllerSettings& settings = ResolutionControllerSettings() );
+    ~DynamicResolution();
+
+    ResolutionController& controller() { return _controller; }
+
+    // Returns false, leaving it off, when the device has no rate map support.
+    bool setRateMapEnabled( bool enabled );
+    bool rateMapEnabled() const { return _rateMapEnabled; }
+
+    // Sets up this frame for an output pass: the scene pass descriptor returned
+    // clears with pOutputRpd's clear color, and the upscale pass writes
+    // pOutputRpd's color texture. The scale is sampled here; frameScale() keeps it.
+    MTL::RenderPassDescriptor* beginFrame( MTL::RenderPassDescriptor* pOutputRpd );
+
+    // Scene viewport, in screen space, for encoders on the beginFrame() pass.
+    void setViewport( MTL::RenderCommandEncoder* pEnc ) const;
+
+    MTL::RenderPassDescriptor* upscaleRenderPass() const { return _pUpscaleRpd; }
+    void encodeUpscale( MTL::CommandBuffer* pCmd );
+
+    float frameScale() const { return _frameScale; }
+
+private:
+    void buildPipelines();
+    void allocateTarget( uint32_t width, uint32_t height );
+    void rebuildRateMap( uint32_t screenWidth, uint32_t screenHeight );
+
+    MTL::Device*                    _pDevice;
+    ResourceRegistry*               _pResources;
+    ResolutionController            _controller;
+
+    MTL::RenderPipelineState*       _pUpscalePSO = nullptr;
+    MTL::RenderPipelineState*       _pUpscaleRateMapPSO = nullptr;
+    MTL::RenderPassDescriptor*      _pSceneRpd;
+    MTL::RenderPassDescriptor*      _pUpscaleRpd;
+
+    MTL::Texture*                   _pColor = nullptr;
+    uint32_t                        _width = 0;
+    uint32_t                        _height = 0;
+
+    bool                            _rateMapEnabled = false;
+    MTL::RasterizationRateMap*      _pRateMap = nullptr;
+    MTL::Buffer*                    _pRateMapData = nullptr;
+
+    float                           _frameScale = 1.0f;
+    uint32_t                        _screenWidth = 0;       // scaled size, what the scene sees
+    uint32_t                        _screenHeight = 0;
+    uint32_t                        _physicalWidth = 0;     // pixels actually rasterized
+    uint32_t                        _physicalHeight = 0;
+};
+
+#endif /* dynamic_resolution_hpp */
@@ -0,0 +1,148 @@
+//
+//  frame_attachments.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "frame_attachments.hpp"
+#include "View/resource_registry.hpp"
+
+namespace
+{
+
+size_t bytesPerPixel( MTL::PixelFormat format )
+{
+    switch ( format )
+    {
+        case MTL::PixelFormatRGBA16Float:   return 8;
+        case MTL::PixelFormatRGBA32Float:   return 16;
+        default:                            return 4;
+    }
+}
+
+}
+
+FrameAttachments::FrameAttachments( MTL::Device* pDevice, ResourceRegistry* pResources )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+, _memoryless( pDevice->supportsFamily( MTL::GPUFamilyApple1 ) )
+{
+}
+
+FrameAttachments::~FrameAttachments()
+{
+    releaseTextures();
+    _pDevice->release();
+}
+
+void FrameAttachments::releaseTextures()
+{
+    if ( _pDepth )
+    {
+        _pResources->release( _pDepth );
+        _pDepth = nullptr;
+    }
+    if ( _pMultisampleColor )
+    {
+        _pResources->release( _pMultisampleColor );
+        _pMultisampleColor = nullptr;
+    }
+    _width = 0;
+    _height = 0;
+}
+
+void FrameAttachments::setSampleCount( NS::UInteger sampleCount )
+{
+    sampleCount = sampleCount > 1 ? sampleCount : 1;
+    if ( !_pDevice->supportsTextureSampleCount( sampleCount ) )
+    {
+        __builtin_printf( "%lu samples are not supported on %s, keeping %lu\n",
+                          sampleCount, _pDevice->name()->utf8String(), _sampleCount );
+        return;
+    }
+    if ( sampleCount != _sampleCount )
+    {
+        // Reallocated at the next attach().
+        releaseTextures();
+        _sampleCount = sampleCount;
+    }
+}
+
+void FrameAttachments::allocate( MTL::Texture* pTarget )
+{
+    releaseTextures();
+    _width = pTarget->width();
+    _height = pTarget->height();
+    _colorFormat = pTarget->pixelFormat();
+
+    const MTL::StorageMode Storage = _memoryless ? MTL::StorageModeMemoryless : MTL::StorageModePrivate;
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatDepth32Float, _width, _height, false );
+    pDesc->setTextureType( _sampleCount > 1 ? MTL::TextureType2DMultisample : MTL::TextureType2D );
+    pDesc->setSampleCount( _sampleCount );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget );
+
+    // What the same textures would take as regular allocations.
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    size_t residentBytes = _pDevice->heapTextureSizeAndAlign( pDesc ).size;
+    pDesc->setStorageMode( Storage );
+    _pDepth = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "Depth attachment" );
+
+    // Depth is never stored; MSAA color only ever leaves tile memory resolved.
+    size_t storedBytes = size_t( _width ) * _height * _sampleCount * 4;
+    if ( _sampleCount > 1 )
+    {
+        pDesc->setPixelFormat( _colorFormat );
+        pDesc->setStorageMode( MTL::StorageModePrivate );
+        residentBytes += _pDevice->heapTextureSizeAndAlign( pDesc ).size;
+        pDesc->setStorageMode( Storage );
+        _pMultisampleColor = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "MSAA color attachment" );
+        storedBytes += size_t( _width ) * _height * _sampleCount * bytesPerPixel( _colorFormat );
+    }
+    pDesc->release();
+
+    _savings.memoryBytes = _memoryless ? residentBytes : 0;
+    _savings.bandwidthBytesPerFrame = storedBytes;
+}
+
+void FrameAttachments::attach( MTL::RenderPassDescriptor* pRpd )
+{
+    MTL::RenderPassColorAttachmentDescriptor* pColor = pRpd->colorAttachments()->object( 0 );
+
+    // Descriptors reused across frames still hold last frame's MSAA texture.
+    MTL::Texture* pTarget = pColor->texture() == _pMultisampleColor && _pMultisampleColor
+        ? pColor->resolveTexture()
+        : pColor->texture();
+    if ( pTarget->width() != _width || pTarget->height() != _height || pTarget->pixelFormat() != _colorFormat || !_pDepth )
+    {
+        allocate( pTarget );
+    }
+
+    if ( _pMultisampleColor )
+    {
+        pColor->setTexture( _pMultisampleColor );
+        pColor->setResolveTexture( pTarget );
+        pColor->setStoreAction( MTL::StoreActionMultisampleResolve );
+    }
+    else
+    {
+        pColor->setTexture( pTarget );
+        pColor->setResolveTexture( nullptr );
+        pColor->setStoreAction( MTL::StoreActionStore );
+    }
+
+    MTL::RenderPassDepthAttachmentDescriptor* pDepth = pRpd->depthAttachment();
+    pDepth->setTexture( _pDepth );
+    pDepth->setLoadAction( MTL::LoadActionClear );
+    pDepth->setStoreAction( MTL::StoreActionDontCare );
+    pDepth->setClearDepth( 1.0 );
+}
+
+void FrameAttachments::printSavings() const
+{
+    const double MB = 1.0 / ( 1024.0 * 1024.0 );
+    __builtin_printf( "Attachments: %lux%lu, %lu sample(s), %s\n", _width, _height, _sampleCount,
+                      _memoryless ? "memoryless" : "private (no memoryless support)" );
+    __builtin_printf( "  memory saved     %8.2f MB\n", double( _savings.memoryBytes ) * MB );
+    __builtin_printf( "  stores avoided   %8.2f MB/frame\n", double( _savings.bandwidthBytesPerFrame ) * MB );
+}
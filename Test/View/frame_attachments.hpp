@@ -0,0 +1,67 @@
+//
+//  frame_attachments.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef frame_attachments_hpp
+#define frame_attachments_hpp
+
+#include <Metal/Metal.hpp>
+
+class ResourceRegistry;
+
+struct AttachmentSavings
+{
+    size_t memoryBytes              = 0;    // allocations memoryless storage avoided
+    size_t bandwidthBytesPerFrame   = 0;    // stores avoided against storing every attachment
+};
+
+// Depth and MSAA color attachments the renderer owns instead of MTK::View.
+//
+// Neither is ever read after its pass, so on Apple GPUs they live only in tile
+// memory (StorageModeMemoryless): depth is cleared on load and never stored,
+// MSAA color is cleared and resolved straight into the pass's color texture.
+// Elsewhere they fall back to private textures with the same load/store
+// actions, which are still losslessly compressed by the driver since they
+// carry no usage beyond RenderTarget.
+class FrameAttachments
+{
+public:
+    FrameAttachments( MTL::Device* pDevice, ResourceRegistry* pResources );
+    ~FrameAttachments();
+
+    // 1 disables MSAA. Pipelines drawing into attach()ed passes need the same count.
+    void setSampleCount( NS::UInteger sampleCount );
+    NS::UInteger sampleCount() const { return _sampleCount; }
+
+    bool memoryless() const { return _memoryless; }
+
+    // Adds depth, and with MSAA a multisample color resolving into the pass's
+    // color texture, sized to match that texture. The color texture and clear
+    // values already on pRpd are kept.
+    void attach( MTL::RenderPassDescriptor* pRpd );
+
+    const AttachmentSavings& savings() const { return _savings; }
+    void printSavings() const;
+
+private:
+    void allocate( MTL::Texture* pTarget );
+    void releaseTextures();
+
+    MTL::Device*            _pDevice;
+    ResourceRegistry*       _pResources;
+    bool                    _memoryless;
+    NS::UInteger            _sampleCount = 1;
+
+    MTL::Texture*           _pDepth = nullptr;
+    MTL::Texture*           _pMultisampleColor = nullptr;
+    NS::UInteger            _width = 0;
+    NS::UInteger            _height = 0;
+    MTL::PixelFormat        _colorFormat = MTL::PixelFormatInvalid;
+
+    AttachmentSavings       _savings;
+};
+
+#endif /* frame_attachments_hpp */
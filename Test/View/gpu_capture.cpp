@@ -0,0 +1,137 @@
+//
+//  gpu_capture.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "gpu_capture.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <atomic>
+#include <csignal>
+
+namespace
+{
+
+std::atomic<CaptureTrigger*> gSignalTrigger { nullptr };
+
+void requestCaptureOnSignal( int )
+{
+    // Only the atomics are touched, which is all a signal handler may do.
+    if ( CaptureTrigger* pTrigger = gSignalTrigger.load() )
+    {
+        pTrigger->request();
+    }
+}
+
+}
+
+GpuCapture::GpuCapture( MTL::CommandQueue* pQueue, const char* directory, const CaptureTriggerSettings& settings )
+: _pQueue( pQueue->retain() )
+, _directory( directory )
+, _trigger( settings )
+{
+    MTL::CaptureManager* pManager = MTL::CaptureManager::sharedCaptureManager();
+    _pScope = pManager->newCaptureScope( _pQueue );
+    _pScope->setLabel( NS::String::string( "Frame", NS::StringEncoding::UTF8StringEncoding ) );
+    pManager->setDefaultCaptureScope( _pScope );
+
+    if ( !pManager->supportsDestination( MTL::CaptureDestinationGPUTraceDocument ) )
+    {
+        __builtin_printf( "GpuCapture: .gputrace files unavailable, set MTL_CAPTURE_ENABLED=1\n" );
+    }
+}
+
+GpuCapture::~GpuCapture()
+{
+    if ( _capturing )
+    {
+        stopCapture();
+    }
+    CaptureTrigger* pTrigger = &_trigger;
+    gSignalTrigger.compare_exchange_strong( pTrigger, nullptr );
+    _pScope->release();
+    _pQueue->release();
+}
+
+void GpuCapture::installSignalHandler()
+{
+    gSignalTrigger = &_trigger;
+    signal( SIGUSR1, requestCaptureOnSignal );
+}
+
+void GpuCapture::addFrameTime( double frameMs )
+{
+    CaptureReason reason = _trigger.addFrame( frameMs, double( TraceRecorder::nowNs() ) * 1e-9 );
+    if ( reason != CaptureReason::None && _armed == CaptureReason::None )
+    {
+        __builtin_printf( "GpuCapture: %s, %.2f ms against a %.2f ms median, capturing the next frame\n",
+                          captureReasonName( reason ), frameMs, _trigger.medianMs() );
+        _armed = reason;
+    }
+}
+
+void GpuCapture::beginFrame()
+{
+    _frameStartNs[ _frames++ % 4 ] = TraceRecorder::nowNs();
+    if ( _armed != CaptureReason::None )
+    {
+        startCapture();
+        _armed = CaptureReason::None;
+    }
+    _pScope->beginScope();
+}
+
+void GpuCapture::endFrame()
+{
+    _pScope->endScope();
+    if ( _capturing )
+    {
+        stopCapture();
+    }
+}
+
+void GpuCapture::startCapture()
+{
+    ++_index;
+    std::string path = _directory + "/capture-" + std::to_string( _index ) + ".gputrace";
+
+    MTL::CaptureDescriptor* pDesc = MTL::CaptureDescriptor::alloc()->init();
+    // The whole device, so work on other queues, such as async compute, is in it too.
+    pDesc->setCaptureObject( _pQueue->device() );
+    pDesc->setDestination( MTL::CaptureDestinationGPUTraceDocument );
+    pDesc->setOutputURL( NS::URL::fileURLWithPath( NS::String::string( path.c_str(), NS::StringEncoding::UTF8StringEncoding ) ) );
+
+    NS::Error* pError = nullptr;
+    _capturing = MTL::CaptureManager::sharedCaptureManager()->startCapture( pDesc, &pError );
+    pDesc->release();
+    if ( !_capturing )
+    {
+        __builtin_printf( "GpuCapture: could not start %s: %s\n", path.c_str(),
+                          pError ? pError->localizedDescription()->utf8String() : "unknown error" );
+        return;
+    }
+
+    // With tracing already on, the rings still hold the frames that spiked,
+    // which finished up to four frames ago; otherwise record this one.
+    _tracingWasOn = TraceRecorder::enabled();
+    _traceStartNs = _tracingWasOn ? _frameStartNs[ _frames % 4 ] : _frameStartNs[ ( _frames - 1 ) % 4 ];
+    TraceRecorder::setEnabled( true );
+}
+
+void GpuCapture::stopCapture()
+{
+    MTL::CaptureManager::sharedCaptureManager()->stopCapture();
+    _capturing = false;
+
+    std::string path = _directory + "/capture-" + std::to_string( _index ) + ".json";
+    TraceRecorder::writeTraceWindow( path.c_str(), _traceStartNs, TraceRecorder::nowNs() );
+    if ( !_tracingWasOn )
+    {
+        // Nobody else wanted these events; don't let them fill the rings.
+        TraceRecorder::setEnabled( false );
+        TraceRecorder::discardTrace();
+    }
+    __builtin_printf( "GpuCapture: wrote %s/capture-%u.gputrace and .json\n", _directory.c_str(), _index );
+}
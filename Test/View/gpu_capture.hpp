@@ -0,0 +1,61 @@
+//
+//  gpu_capture.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef gpu_capture_hpp
+#define gpu_capture_hpp
+
+#include <Metal/Metal.hpp>
+#include <cstdint>
+#include <string>
+#include "Model/capture_trigger.hpp"
+
+// Captures frames that misbehave. Every frame is bracketed by beginFrame() and
+// endFrame(), which also makes it the default capture scope, so Xcode's capture
+// button takes exactly one frame. When the CaptureTrigger fires, on a frame time
+// anomaly or a request (SIGUSR1 with installSignalHandler()), the next frame is
+// captured to directory/capture-N.gputrace, with the CPU trace of the spiking
+// and captured frames next to it as capture-N.json.
+//
+// Capturing to a file outside Xcode needs MTL_CAPTURE_ENABLED=1 in the
+// environment or MetalCaptureEnabled in Info.plist.
+class GpuCapture
+{
+public:
+    GpuCapture( MTL::CommandQueue* pQueue, const char* directory, const CaptureTriggerSettings& settings = CaptureTriggerSettings() );
+    ~GpuCapture();
+
+    // Around everything a frame commits.
+    void beginFrame();
+    void endFrame();
+
+    // Frame times as they complete, in ms; may arm a capture of the next frame.
+    void addFrameTime( double frameMs );
+
+    CaptureTrigger& trigger() { return _trigger; }
+
+    // Makes SIGUSR1 request a capture. The signal goes to the last GpuCapture
+    // to install it.
+    void installSignalHandler();
+
+private:
+    void startCapture();
+    void stopCapture();
+
+    MTL::CommandQueue*  _pQueue;
+    MTL::CaptureScope*  _pScope;
+    std::string         _directory;
+    CaptureTrigger      _trigger;
+    CaptureReason       _armed = CaptureReason::None;
+    bool                _capturing = false;
+    bool                _tracingWasOn = false;
+    uint32_t            _index = 0;
+    uint64_t            _frameStartNs[ 4 ] = { };   // recent frames, enough to reach back past the frames in flight
+    uint64_t            _frames = 0;
+    uint64_t            _traceStartNs = 0;
+};
+
+#endif /* gpu_capture_hpp */
@@ -0,0 +1,199 @@
+//
+//  gpu_cluster_binner.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "gpu_cluster_binner.hpp"
+#include "View/resource_registry.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// Matches ClusterBinParams in Shaders.metal.
+struct ClusterBinParams
+{
+    uint32_t clusterCount;
+    uint32_t lightCount;
+    uint32_t wordsPerCluster;
+    uint32_t indexCapacity;
+};
+
+const NS::UInteger kOffsetsThreads = 1024;
+
+MTL::ComputePipelineState* newKernel( MTL::Device* pDevice, MTL::Library* pLibrary, const char* name )
+{
+    NS::Error* pError = nullptr;
+    MTL::Function* pFn = pLibrary->newFunction( NS::String::string( name, NS::StringEncoding::UTF8StringEncoding ) );
+    MTL::ComputePipelineState* pPSO = pDevice->newComputePipelineState( pFn, &pError );
+    if ( !pPSO )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    pFn->release();
+    return pPSO;
+}
+
+}
+
+GpuClusterBinner::GpuClusterBinner( MTL::Device* pDevice, ResourceRegistry* pResources )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+{
+    MTL::Library* pLibrary = _pDevice->newDefaultLibrary();
+    _pMasksPSO = newKernel( _pDevice, pLibrary, "clusterLightMasks" );
+    _pOffsetsPSO = newKernel( _pDevice, pLibrary, "clusterLightOffsets" );
+    _pIndicesPSO = newKernel( _pDevice, pLibrary, "clusterLightIndices" );
+    pLibrary->release();
+}
+
+GpuClusterBinner::~GpuClusterBinner()
+{
+    releaseBuffers();
+    _pMasksPSO->release();
+    _pOffsetsPSO->release();
+    _pIndicesPSO->release();
+    _pDevice->release();
+}
+
+void GpuClusterBinner::releaseBuffers()
+{
+    for ( MTL::Buffer** ppBuffer : { &_pClusters, &_pSpheres, &_pMasks, &_pOffsets, &_pCounts, &_pIndices, &_pTotal } )
+    {
+        if ( *ppBuffer )
+        {
+            _pResources->release( *ppBuffer );
+            *ppBuffer = nullptr;
+        }
+    }
+}
+
+void GpuClusterBinner::setInputs( const std::vector<ClusterBounds>& clusters, const std::vector<ClusterSphere>& spheres,
+                                  uint32_t indexCapacity )
+{
+    releaseBuffers();
+    _clusterCount = uint32_t( clusters.size() );
+    _lightCount = uint32_t( spheres.size() );
+    _wordsPerCluster = ( _lightCount + 31 ) / 32;
+    _indexCapacity = std::max( indexCapacity, 1u );
+
+    // Shared, since the lists are read back for validation; the binning itself
+    // never touches them from the CPU.
+    const MTL::ResourceOptions Shared = MTL::ResourceStorageModeShared;
+    _pClusters = _pResources->newBuffer( clusters.data(), std::max< size_t >( clusters.size(), 1 ) * sizeof( ClusterBounds ), Shared, ResourceCategory::Other, "Cluster bounds" );
+    _pSpheres = _pResources->newBuffer( spheres.data(), std::max< size_t >( spheres.size(), 1 ) * sizeof( ClusterSphere ), Shared, ResourceCategory::Other, "Cluster light spheres" );
+    _pMasks = _pResources->newBuffer( std::max< size_t >( size_t( _clusterCount ) * _wordsPerCluster, 1 ) * 4, MTL::ResourceStorageModePrivate, ResourceCategory::Other, "Cluster light masks" );
+    _pOffsets = _pResources->newBuffer( std::max( _clusterCount, 1u ) * 4, Shared, ResourceCategory::Other, "Cluster light offsets" );
+    _pCounts = _pResources->newBuffer( std::max( _clusterCount, 1u ) * 4, Shared, ResourceCategory::Other, "Cluster light counts" );
+    _pIndices = _pResources->newBuffer( size_t( _indexCapacity ) * sizeof( uint16_t ), Shared, ResourceCategory::Other, "Cluster light indices" );
+    _pTotal = _pResources->newBuffer( 4, Shared, ResourceCategory::Other, "Cluster light total" );
+}
+
+void GpuClusterBinner::encode( MTL::CommandBuffer* pCmd )
+{
+    TRACE_SCOPE( "GpuClusterBinner::encode" );
+    ClusterBinParams params = { _clusterCount, _lightCount, _wordsPerCluster, _indexCapacity };
+    if ( !_clusterCount || !_lightCount )
+    {
+        return;
+    }
+
+    MTL::ComputeCommandEncoder* pEnc = pCmd->computeCommandEncoder();
+    pEnc->setLabel( NS::String::string( "Cluster light binning", NS::StringEncoding::UTF8StringEncoding ) );
+
+    pEnc->setComputePipelineState( _pMasksPSO );
+    pEnc->setBuffer( _pClusters, 0, 0 );
+    pEnc->setBuffer( _pSpheres, 0, 1 );
+    pEnc->setBytes( &params, sizeof( params ), 2 );
+    pEnc->setBuffer( _pMasks, 0, 3 );
+    pEnc->dispatchThreads( MTL::Size::Make( _wordsPerCluster, _clusterCount, 1 ), MTL::Size::Make( std::min( _wordsPerCluster, 32u ), 8, 1 ) );
+
+    // A serial compute encoder orders the three dispatches.
+    pEnc->setComputePipelineState( _pOffsetsPSO );
+    pEnc->setBuffer( _pMasks, 0, 0 );
+    pEnc->setBytes( &params, sizeof( params ), 1 );
+    pEnc->setBuffer( _pOffsets, 0, 2 );
+    pEnc->setBuffer( _pCounts, 0, 3 );
+    pEnc->setBuffer( _pTotal, 0, 4 );
+    const NS::UInteger Threads = std::min( kOffsetsThreads, _pOffsetsPSO->maxTotalThreadsPerThreadgroup() );
+    pEnc->setThreadgroupMemoryLength( Threads * 4, 0 );
+    pEnc->dispatchThreadgroups( MTL::Size::Make( 1, 1, 1 ), MTL::Size::Make( Threads, 1, 1 ) );
+
+    pEnc->setComputePipelineState( _pIndicesPSO );
+    pEnc->setBuffer( _pMasks, 0, 0 );
+    pEnc->setBytes( &params, sizeof( params ), 1 );
+    pEnc->setBuffer( _pOffsets, 0, 2 );
+    pEnc->setBuffer( _pIndices, 0, 3 );
+    pEnc->dispatchThreads( MTL::Size::Make( _clusterCount, 1, 1 ), MTL::Size::Make( 64, 1, 1 ) );
+    pEnc->endEncoding();
+}
+
+ClusterLightLists GpuClusterBinner::readResults() const
+{
+    ClusterLightLists lists;
+    if ( !_pTotal )
+    {
+        return lists;
+    }
+
+    const uint32_t* pOffsets = static_cast< const uint32_t* >( _pOffsets->contents() );
+    const uint32_t* pCounts = static_cast< const uint32_t* >( _pCounts->contents() );
+    const uint16_t* pIndices = static_cast< const uint16_t* >( _pIndices->contents() );
+    uint32_t total = _lightCount ? *static_cast< const uint32_t* >( _pTotal->contents() ) : 0;
+    if ( total > _indexCapacity )
+    {
+        __builtin_printf( "Cluster binning: %u indices, capacity %u; lists were cut short\n", total, _indexCapacity );
+    }
+
+    lists.offsets.assign( pOffsets, pOffsets + _clusterCount );
+    lists.counts.assign( pCounts, pCounts + _clusterCount );
+    lists.indices.assign( pIndices, pIndices + std::min( total, _indexCapacity ) );
+    if ( !_lightCount )
+    {
+        std::fill( lists.offsets.begin(), lists.offsets.end(), 0u );
+        std::fill( lists.counts.begin(), lists.counts.end(), 0u );
+    }
+    return lists;
+}
+
+ClusterValidation validateGpuClusterBinning( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                             const ClusterGridDesc& grid, const std::vector<ViewSpaceLight>& lights,
+                                             JobSystem& jobs )
+{
+    ClusterValidation result;
+    std::vector<ClusterBounds> clusters = buildClusterBounds( grid );
+    std::vector<ClusterSphere> spheres = buildClusterSpheres( grid, lights );
+
+    uint64_t start = TraceRecorder::nowNs();
+    ClusterLightLists cpu = binLights( clusters, spheres, jobs );
+    result.cpuMs = double( TraceRecorder::nowNs() - start ) * 1e-6;
+    result.indexCount = cpu.indices.size();
+
+    ResourceRegistry* pResources = new ResourceRegistry( pDevice );
+    GpuClusterBinner* pBinner = new GpuClusterBinner( pDevice, pResources );
+    pBinner->setInputs( clusters, spheres, uint32_t( std::max< size_t >( cpu.indices.size(), 1 ) ) );
+
+    MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+    pBinner->encode( pCmd );
+    pCmd->commit();
+    pCmd->waitUntilCompleted();
+    result.gpuMs = ( pCmd->GPUEndTime() - pCmd->GPUStartTime() ) * 1e3;
+
+    ClusterLightLists gpu = pBinner->readResults();
+    result.differingClusters = countDifferingClusters( cpu, gpu );
+    if ( gpu.offsets != cpu.offsets )
+    {
+        // Counts matching but offsets not would mean the prefix sum is wrong.
+        result.differingClusters = std::max< size_t >( result.differingClusters, 1 );
+    }
+
+    delete pBinner;
+    delete pResources;
+    return result;
+}
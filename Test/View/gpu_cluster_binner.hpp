@@ -0,0 +1,77 @@
+//
+//  gpu_cluster_binner.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef gpu_cluster_binner_hpp
+#define gpu_cluster_binner_hpp
+
+#include <Metal/Metal.hpp>
+#include "Model/cluster_binner.hpp"
+
+class ResourceRegistry;
+
+// Compute version of binLights(): per-cluster light bitmasks, counts and
+// offsets in one threadgroup, then the index lists, in three dispatches. The
+// output buffers have exactly the layout of ClusterLightLists, so shading can
+// bind offsets(), counts() and indices() directly.
+class GpuClusterBinner
+{
+public:
+    GpuClusterBinner( MTL::Device* pDevice, ResourceRegistry* pResources );
+    ~GpuClusterBinner();
+
+    // Uploads the inputs and sizes the buffers for them. Lists past
+    // indexCapacity indices in total are cut short; readResults() reports it.
+    void setInputs( const std::vector<ClusterBounds>& clusters, const std::vector<ClusterSphere>& spheres,
+                    uint32_t indexCapacity );
+
+    void encode( MTL::CommandBuffer* pCmd );
+
+    // Copies the lists out once the command buffer has completed.
+    ClusterLightLists readResults() const;
+
+    MTL::Buffer* offsets() const { return _pOffsets; }
+    MTL::Buffer* counts() const  { return _pCounts; }
+    MTL::Buffer* indices() const { return _pIndices; }
+
+private:
+    void releaseBuffers();
+
+    MTL::Device*                    _pDevice;
+    ResourceRegistry*               _pResources;
+    MTL::ComputePipelineState*      _pMasksPSO;
+    MTL::ComputePipelineState*      _pOffsetsPSO;
+    MTL::ComputePipelineState*      _pIndicesPSO;
+
+    MTL::Buffer*                    _pClusters = nullptr;
+    MTL::Buffer*                    _pSpheres = nullptr;
+    MTL::Buffer*                    _pMasks = nullptr;
+    MTL::Buffer*                    _pOffsets = nullptr;
+    MTL::Buffer*                    _pCounts = nullptr;
+    MTL::Buffer*                    _pIndices = nullptr;
+    MTL::Buffer*                    _pTotal = nullptr;
+
+    uint32_t                        _clusterCount = 0;
+    uint32_t                        _lightCount = 0;
+    uint32_t                        _wordsPerCluster = 0;
+    uint32_t                        _indexCapacity = 0;
+};
+
+struct ClusterValidation
+{
+    size_t differingClusters = 0;
+    size_t indexCount        = 0;
+    double cpuMs             = 0.0;
+    double gpuMs             = 0.0;
+};
+
+// Bins the lights on both the GPU and the CPU and compares the lists. Blocks
+// until the GPU is done.
+ClusterValidation validateGpuClusterBinning( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                             const ClusterGridDesc& grid, const std::vector<ViewSpaceLight>& lights,
+                                             JobSystem& jobs );
+
+#endif /* gpu_cluster_binner_hpp */
@@ -0,0 +1,97 @@
+//
+//  gpu_mip_generator.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "gpu_mip_generator.hpp"
+#include "resource_registry.hpp"
+
+#include <algorithm>
+
+void encodeGenerateMipmaps( MTL::CommandBuffer* pCmd, MTL::Texture* pTexture )
+{
+    MTL::BlitCommandEncoder* pBlit = pCmd->blitCommandEncoder();
+    pBlit->generateMipmaps( pTexture );
+    pBlit->endEncoding();
+}
+
+MTL::Texture* newMipmappedTexture( ResourceRegistry* pResources, const std::vector<MipLevel>& chain, bool sRGB )
+{
+    const MipLevel& base = chain.front();
+    MTL::PixelFormat format = sRGB ? MTL::PixelFormatRGBA8Unorm_sRGB : MTL::PixelFormatRGBA8Unorm;
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( format, base.width, base.height, true );
+    pDesc->setMipmapLevelCount( chain.size() );
+    pDesc->setStorageMode( MTL::StorageModeManaged );
+    pDesc->setUsage( MTL::TextureUsageShaderRead );
+
+    MTL::Texture* pTexture = pResources->newTexture( pDesc, ResourceCategory::Texture, "Mipmapped texture" );
+    pDesc->release();
+    if ( !pTexture )
+    {
+        return nullptr;
+    }
+
+    for ( size_t i = 0; i < chain.size(); ++i )
+    {
+        const MipLevel& level = chain[ i ];
+        pTexture->replaceRegion( MTL::Region::Make2D( 0, 0, level.width, level.height ), i,
+                                 level.rgba.data(), level.width * 4 );
+    }
+    return pTexture;
+}
+
+std::vector<MipLevel> readMipChain( MTL::Texture* pTexture )
+{
+    std::vector<MipLevel> chain;
+    for ( NS::UInteger i = 0; i < pTexture->mipmapLevelCount(); ++i )
+    {
+        uint32_t width = std::max< uint32_t >( 1, uint32_t( pTexture->width() ) >> i );
+        uint32_t height = std::max< uint32_t >( 1, uint32_t( pTexture->height() ) >> i );
+        MipLevel& level = chain.emplace_back( MipLevel { width, height, std::vector<uint8_t>( size_t( width ) * height * 4 ) } );
+        pTexture->getBytes( level.rgba.data(), width * 4, MTL::Region::Make2D( 0, 0, width, height ), i );
+    }
+    return chain;
+}
+
+bool validateGpuMipmaps( ResourceRegistry* pResources, MTL::CommandQueue* pQueue,
+                         const uint8_t* pRgba, uint32_t width, uint32_t height,
+                         int maxChannelDifference, JobSystem& jobs )
+{
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatRGBA8Unorm_sRGB, width, height, true );
+    pDesc->setStorageMode( MTL::StorageModeManaged );
+    pDesc->setUsage( MTL::TextureUsageShaderRead | MTL::TextureUsageRenderTarget );
+
+    MTL::Texture* pTexture = pResources->newTexture( pDesc, ResourceCategory::Texture, "Mipmap validation" );
+    pDesc->release();
+    pTexture->replaceRegion( MTL::Region::Make2D( 0, 0, width, height ), 0, pRgba, width * 4 );
+
+    MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+    MTL::BlitCommandEncoder* pBlit = pCmd->blitCommandEncoder();
+    pBlit->generateMipmaps( pTexture );
+    pBlit->synchronizeResource( pTexture );
+    pBlit->endEncoding();
+    pCmd->commit();
+
+    // Overlap the CPU chain with the GPU work.
+    MipSettings settings;
+    settings.filter = MipFilter::Box;
+    settings.sRGB = true;
+    std::vector<MipLevel> cpu = generateMipChain( pRgba, width, height, settings, jobs );
+
+    pCmd->waitUntilCompleted();
+    std::vector<MipLevel> gpu = readMipChain( pTexture );
+    pResources->release( pTexture );
+
+    bool ok = cpu.size() == gpu.size();
+    std::vector<MipDifference> diffs = compareMipChains( cpu, gpu );
+    for ( size_t i = 0; i < diffs.size(); ++i )
+    {
+        bool levelOk = diffs[ i ].maxAbsDifference <= maxChannelDifference;
+        __builtin_printf( "mip %zu (%ux%u): max |cpu - gpu| %d, PSNR %.2f dB%s\n", i, cpu[ i ].width, cpu[ i ].height,
+                          diffs[ i ].maxAbsDifference, diffs[ i ].psnr, levelOk ? "" : " FAILED" );
+        ok = ok && levelOk;
+    }
+    return ok;
+}
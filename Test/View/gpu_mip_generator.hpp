@@ -0,0 +1,37 @@
+//
+//  gpu_mip_generator.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef gpu_mip_generator_hpp
+#define gpu_mip_generator_hpp
+
+#include <Metal/Metal.hpp>
+#include "Model/mip_generator.hpp"
+
+class ResourceRegistry;
+
+// Fills mips 1..N of pTexture from mip 0 with the blit encoder's box filter.
+// sRGB textures are filtered in linear space by the driver.
+void encodeGenerateMipmaps( MTL::CommandBuffer* pCmd, MTL::Texture* pTexture );
+
+// Creates a mipmapped RGBA8 texture holding a chain from generateMipChain(), for
+// assets that want the CPU Kaiser/Lanczos filters instead of the blit box filter.
+// It is in the registry's Texture category; release it through the registry.
+MTL::Texture* newMipmappedTexture( ResourceRegistry* pResources, const std::vector<MipLevel>& chain, bool sRGB );
+
+// Reads every mip of an RGBA8 texture back into a chain. Managed textures must
+// have been synchronized and the GPU work completed.
+std::vector<MipLevel> readMipChain( MTL::Texture* pTexture );
+
+// Generates the chain for the image on both the GPU (generateMipmaps) and the
+// CPU (box filter, linear space), reads the GPU result back and compares the two
+// per level. Returns false if any channel of any level differs by more than
+// maxChannelDifference. Blocks until the GPU is done; meant for validation runs.
+bool validateGpuMipmaps( ResourceRegistry* pResources, MTL::CommandQueue* pQueue,
+                         const uint8_t* pRgba, uint32_t width, uint32_t height,
+                         int maxChannelDifference, JobSystem& jobs );
+
+#endif /* gpu_mip_generator_hpp */
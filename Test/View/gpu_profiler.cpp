@@ -0,0 +1,285 @@
+//
+//  gpu_profiler.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "gpu_profiler.hpp"
+#include "resource_registry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+// MTLCounterErrorValue and MTLCounterDontSample, which metal-cpp does not expose.
+const uint64_t      kCounterErrorValue = ~0ull;
+const NS::UInteger  kCounterDontSample = NS::UInteger( -1 );
+
+}
+
+GpuProfiler::GpuProfiler( MTL::Device* pDevice, ResourceRegistry* pResources )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+{
+    if ( !_pDevice->supportsCounterSampling( MTL::CounterSamplingPointAtStageBoundary ) )
+    {
+        __builtin_printf( "GpuProfiler: stage boundary counter sampling is not supported, profiling disabled\n" );
+        return;
+    }
+
+    NS::Array* pSets = _pDevice->counterSets();
+    for ( NS::UInteger i = 0; pSets && i < pSets->count(); ++i )
+    {
+        MTL::CounterSet* pSet = pSets->object<MTL::CounterSet>( i );
+        if ( pSet->name()->isEqualToString( MTL::CommonCounterSetTimestamp ) )
+        {
+            _pCounterSet = pSet->retain();
+            break;
+        }
+    }
+    if ( !_pCounterSet )
+    {
+        __builtin_printf( "GpuProfiler: no timestamp counter set, profiling disabled\n" );
+        return;
+    }
+
+    MTL::CounterSampleBufferDescriptor* pDesc = MTL::CounterSampleBufferDescriptor::alloc()->init();
+    pDesc->setCounterSet( _pCounterSet );
+    pDesc->setStorageMode( MTL::StorageModeShared );
+    pDesc->setSampleCount( GpuFrameTiming::kMaxPasses * 2 );
+    for ( Slot& slot : _slots )
+    {
+        NS::Error* pError = nullptr;
+        slot.pSamples = _pResources->newCounterSampleBuffer( pDesc, ResourceCategory::Readback, "GPU profiler samples", &pError );
+        if ( !slot.pSamples )
+        {
+            __builtin_printf( "%s", pError ? pError->localizedDescription()->utf8String() : "GpuProfiler: the Readback budget refused the sample buffers\n" );
+            assert( false );
+        }
+    }
+    pDesc->release();
+
+    _pDevice->sampleTimestamps( &_cpuBase, &_gpuBase );
+    _cpuLatest = _cpuBase;
+    _gpuLatest = _gpuBase;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for ( Slot& slot : _slots )
+    {
+        _pResources->release( slot.pSamples );
+    }
+    if ( _pCounterSet )
+    {
+        _pCounterSet->release();
+    }
+    _pDevice->release();
+}
+
+void GpuProfiler::beginFrame()
+{
+    _pCurrent = nullptr;
+    if ( !enabled() )
+    {
+        return;
+    }
+
+    // A slot can stay pending for longer than kSlots frames while the GPU is
+    // behind (those frames are just not profiled), so look at every pending slot
+    // rather than the last kSlots frames, and resolve in frame order so the
+    // history stays sorted.
+    Slot* pendingSlots[ kSlots ];
+    uint32_t pendingCount = 0;
+    for ( Slot& slot : _slots )
+    {
+        if ( slot.pending && slot.completed.load( std::memory_order_acquire ) )
+        {
+            pendingSlots[ pendingCount++ ] = &slot;
+        }
+    }
+    std::sort( pendingSlots, pendingSlots + pendingCount, []( const Slot* a, const Slot* b ) { return a->frame < b->frame; } );
+    for ( uint32_t i = 0; i < pendingCount; ++i )
+    {
+        resolve( *pendingSlots[ i ] );
+    }
+
+    // If the GPU is still holding this slot, skip profiling the frame rather than wait.
+    Slot& slot = _slots[ _frame % kSlots ];
+    if ( !slot.pending )
+    {
+        slot.frame = _frame;
+        slot.passCount = 0;
+        slot.completed.store( false, std::memory_order_relaxed );
+        _pCurrent = &slot;
+    }
+}
+
+uint32_t GpuProfiler::reservePass( const char* name )
+{
+    if ( !_pCurrent || _pCurrent->passCount == GpuFrameTiming::kMaxPasses )
+    {
+        return kNoPass;
+    }
+    _pCurrent->names[ _pCurrent->passCount ] = name;
+    return _pCurrent->passCount++;
+}
+
+uint32_t GpuProfiler::addRenderPass( MTL::RenderPassDescriptor* pDesc, const char* name )
+{
+    uint32_t pass = reservePass( name );
+    MTL::RenderPassSampleBufferAttachmentDescriptor* pAttachment = pDesc->sampleBufferAttachments()->object( 0 );
+    pAttachment->setSampleBuffer( pass != kNoPass ? _pCurrent->pSamples : nullptr );
+    if ( pass != kNoPass )
+    {
+        pAttachment->setStartOfVertexSampleIndex( pass * 2 );
+        pAttachment->setEndOfVertexSampleIndex( kCounterDontSample );
+        pAttachment->setStartOfFragmentSampleIndex( kCounterDontSample );
+        pAttachment->setEndOfFragmentSampleIndex( pass * 2 + 1 );
+    }
+    return pass;
+}
+
+uint32_t GpuProfiler::addComputePass( MTL::ComputePassDescriptor* pDesc, const char* name )
+{
+    uint32_t pass = reservePass( name );
+    MTL::ComputePassSampleBufferAttachmentDescriptor* pAttachment = pDesc->sampleBufferAttachments()->object( 0 );
+    pAttachment->setSampleBuffer( pass != kNoPass ? _pCurrent->pSamples : nullptr );
+    if ( pass != kNoPass )
+    {
+        pAttachment->setStartOfEncoderSampleIndex( pass * 2 );
+        pAttachment->setEndOfEncoderSampleIndex( pass * 2 + 1 );
+    }
+    return pass;
+}
+
+uint32_t GpuProfiler::addBlitPass( MTL::BlitPassDescriptor* pDesc, const char* name )
+{
+    uint32_t pass = reservePass( name );
+    MTL::BlitPassSampleBufferAttachmentDescriptor* pAttachment = pDesc->sampleBufferAttachments()->object( 0 );
+    pAttachment->setSampleBuffer( pass != kNoPass ? _pCurrent->pSamples : nullptr );
+    if ( pass != kNoPass )
+    {
+        pAttachment->setStartOfEncoderSampleIndex( pass * 2 );
+        pAttachment->setEndOfEncoderSampleIndex( pass * 2 + 1 );
+    }
+    return pass;
+}
+
+void GpuProfiler::endFrame( MTL::CommandBuffer* pCmd )
+{
+    if ( _pCurrent )
+    {
+        _pCurrent->pending = true;
+        std::atomic<bool>* pCompleted = &_pCurrent->completed;
+        pCmd->addCompletedHandler( [pCompleted]( MTL::CommandBuffer* ) { pCompleted->store( true, std::memory_order_release ); } );
+        _pCurrent = nullptr;
+
+        // Refresh the calibration; the longer the interval, the better the rate estimate.
+        _pDevice->sampleTimestamps( &_cpuLatest, &_gpuLatest );
+    }
+    ++_frame;
+}
+
+double GpuProfiler::gpuToCpuMs( uint64_t gpuTimestamp ) const
+{
+    // CPU timestamps are nanoseconds; GPU ticks run at a device specific rate.
+    double rate = _gpuLatest > _gpuBase ? double( _cpuLatest - _cpuBase ) / double( _gpuLatest - _gpuBase ) : 1.0;
+    double cpuNs = double( _cpuBase ) + ( double( gpuTimestamp ) - double( _gpuBase ) ) * rate;
+    return cpuNs * 1e-6;
+}
+
+void GpuProfiler::resolve( Slot& slot )
+{
+    slot.pending = false;
+    if ( slot.passCount == 0 )
+    {
+        return;
+    }
+
+    NS::Data* pData = slot.pSamples->resolveCounterRange( NS::Range::Make( 0, slot.passCount * 2 ) );
+    if ( !pData )
+    {
+        return;
+    }
+    const MTL::CounterResultTimestamp* pSamples = static_cast<const MTL::CounterResultTimestamp*>( pData->mutableBytes() );
+
+    GpuFrameTiming& timing = _history[ _historyHead ];
+    timing.frame = slot.frame;
+    timing.passCount = 0;
+
+    double frameStart = 0.0, frameEnd = 0.0;
+    for ( uint32_t pass = 0; pass < slot.passCount; ++pass )
+    {
+        uint64_t begin = pSamples[ pass * 2 ].timestamp;
+        uint64_t end = pSamples[ pass * 2 + 1 ].timestamp;
+        if ( begin == kCounterErrorValue || end == kCounterErrorValue || end < begin )
+        {
+            continue;
+        }
+
+        GpuPassTiming& out = timing.passes[ timing.passCount++ ];
+        out.name = slot.names[ pass ];
+        out.startMs = gpuToCpuMs( begin );
+        out.durationMs = gpuToCpuMs( end ) - out.startMs;
+
+        frameStart = timing.passCount == 1 ? out.startMs : std::min( frameStart, out.startMs );
+        frameEnd = std::max( frameEnd, out.startMs + out.durationMs );
+    }
+    timing.gpuStartMs = frameStart;
+    timing.gpuMs = timing.passCount ? frameEnd - frameStart : 0.0;
+
+    _historyHead = ( _historyHead + 1 ) % kHistoryFrames;
+    _historyCount = std::min( _historyCount + 1, kHistoryFrames );
+}
+
+const GpuFrameTiming& GpuProfiler::history( size_t framesAgo ) const
+{
+    return _history[ ( _historyHead + kHistoryFrames - 1 - framesAgo ) % kHistoryFrames ];
+}
+
+double GpuProfiler::averagePassMs( const char* name, size_t frames ) const
+{
+    double total = 0.0;
+    size_t samples = 0;
+    for ( size_t i = 0; i < std::min( frames, _historyCount ); ++i )
+    {
+        const GpuFrameTiming& timing = history( i );
+        for ( uint32_t pass = 0; pass < timing.passCount; ++pass )
+        {
+            if ( strcmp( timing.passes[ pass ].name, name ) == 0 )
+            {
+                total += timing.passes[ pass ].durationMs;
+                ++samples;
+            }
+        }
+    }
+    return samples ? total / double( samples ) : 0.0;
+}
+
+bool GpuProfiler::writeCsv( const char* path ) const
+{
+    FILE* pFile = fopen( path, "w" );
+    if ( !pFile )
+    {
+        __builtin_printf( "GpuProfiler: could not open %s\n", path );
+        return false;
+    }
+
+    fprintf( pFile, "frame,pass,start_ms,duration_ms\n" );
+    for ( size_t i = _historyCount; i-- > 0; )
+    {
+        const GpuFrameTiming& timing = history( i );
+        for ( uint32_t pass = 0; pass < timing.passCount; ++pass )
+        {
+            const GpuPassTiming& p = timing.passes[ pass ];
+            fprintf( pFile, "%llu,%s,%.4f,%.4f\n", (unsigned long long)timing.frame, p.name, p.startMs, p.durationMs );
+        }
+    }
+    fclose( pFile );
+    return true;
+}
@@ -0,0 +1,114 @@
+//
+//  gpu_profiler.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef gpu_profiler_hpp
+#define gpu_profiler_hpp
+
+#include <Metal/Metal.hpp>
+#include <atomic>
+#include <cstdint>
+
+class ResourceRegistry;
+
+struct GpuPassTiming
+{
+    const char* name;
+    double      startMs;        // CPU clock, see GpuFrameTiming::gpuStartMs
+    double      durationMs;
+};
+
+struct GpuFrameTiming
+{
+    static constexpr uint32_t kMaxPasses = 16;
+
+    uint64_t        frame;
+    double          gpuStartMs;     // first sample of the frame, on the CPU uptime clock in ms
+    double          gpuMs;          // first sample to last sample
+    uint32_t        passCount;
+    GpuPassTiming   passes[ kMaxPasses ];
+};
+
+// Per-pass GPU timings from the timestamp counter set.
+//
+// Each frame gets its own CounterSampleBuffer; passes are attached to it through
+// the pass descriptors' sample buffer attachments, so the GPU writes one
+// timestamp when the pass starts and one when it ends. A frame's samples are
+// resolved in a later beginFrame() once its command buffer has completed, never
+// stalling on the GPU, and converted to the CPU clock with the pair of
+// timestamps Device::sampleTimestamps() returns.
+//
+// Needs stage boundary sampling (Apple GPUs). Elsewhere enabled() is false and
+// every call is a no-op.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t kNoPass        = ~0u;
+    static constexpr size_t   kHistoryFrames = 256;
+
+    GpuProfiler( MTL::Device* pDevice, ResourceRegistry* pResources );
+    ~GpuProfiler();
+
+    bool enabled() const { return _pCounterSet != nullptr; }
+
+    // Resolves frames the GPU has finished and starts recording a new one.
+    void beginFrame();
+
+    // Attach sampling to a pass before creating its encoder. name must outlive the
+    // profiler (a string literal). Returns kNoPass when disabled or out of slots, in
+    // which case the descriptor's sample buffer is cleared, since MTKView hands out
+    // the same render pass descriptor every frame.
+    uint32_t addRenderPass( MTL::RenderPassDescriptor* pDesc, const char* name );
+    uint32_t addComputePass( MTL::ComputePassDescriptor* pDesc, const char* name );
+    uint32_t addBlitPass( MTL::BlitPassDescriptor* pDesc, const char* name );
+
+    // Call with the last command buffer of the frame, before it is committed.
+    void endFrame( MTL::CommandBuffer* pCmd );
+
+    // Resolved frames, newest first. framesAgo must be below historySize().
+    size_t historySize() const { return _historyCount; }
+    const GpuFrameTiming& history( size_t framesAgo ) const;
+
+    // Mean duration of the named pass over the last `frames` resolved frames.
+    double averagePassMs( const char* name, size_t frames ) const;
+
+    // Dumps the history as CSV (frame, pass, start_ms, duration_ms), oldest first.
+    bool writeCsv( const char* path ) const;
+
+private:
+    static constexpr uint32_t kSlots = 4;
+
+    struct Slot
+    {
+        MTL::CounterSampleBuffer*   pSamples = nullptr;
+        std::atomic<bool>           completed { false };
+        bool                        pending = false;
+        uint64_t                    frame = 0;
+        uint32_t                    passCount = 0;
+        const char*                 names[ GpuFrameTiming::kMaxPasses ];
+    };
+
+    uint32_t reservePass( const char* name );
+    void resolve( Slot& slot );
+    double gpuToCpuMs( uint64_t gpuTimestamp ) const;
+
+    MTL::Device*        _pDevice;
+    ResourceRegistry*   _pResources;
+    MTL::CounterSet*    _pCounterSet = nullptr;
+    Slot                _slots[ kSlots ];
+    Slot*               _pCurrent = nullptr;
+    uint64_t            _frame = 0;
+
+    // Calibration pairs: the first one taken and the latest.
+    MTL::Timestamp      _cpuBase = 0, _gpuBase = 0;
+    MTL::Timestamp      _cpuLatest = 0, _gpuLatest = 0;
+
+    GpuFrameTiming      _history[ kHistoryFrames ];
+    size_t              _historyHead = 0;
+    size_t              _historyCount = 0;
+};
+
+#endif /* gpu_profiler_hpp */
@@ -0,0 +1,401 @@
+//
+//  lod_streamer.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "lod_streamer.hpp"
+#include "resource_registry.hpp"
+#include "renderer.hpp"
+#include "Core/trace_recorder.hpp"
+#include "Model/simd_math.hpp"
+#include <algorithm>
+#include <cmath>
+
+LodStreamer::LodStreamer( ResourceRegistry* pResources, size_t budgetBytes )
+: _pResources( pResources )
+, _residency( budgetBytes )
+, _loader( &LodStreamer::loaderMain, this )
+{
+}
+
+LodStreamer::~LodStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _quit = true;
+    }
+    _wake.notify_one();
+    _loader.join();
+
+    for ( const Load& load : _completed )
+    {
+        _pResources->release( load.level.pVertexBuffer );
+        _pResources->release( load.level.pIndexBuffer );
+    }
+    for ( uint32_t m = 0; m < _meshes.size(); ++m )
+    {
+        for ( uint32_t l = 0; l < _meshes[ m ].gpu.size(); ++l )
+        {
+            evict( m, l );
+        }
+    }
+}
+
+size_t LodStreamer::gpuSize( const MeshData& mesh )
+{
+    return mesh.vertices.size() * sizeof( math::float3 ) + mesh.indices.size() * sizeof( UInt32 );
+}
+
+uint32_t LodStreamer::addMesh( const MeshData& mesh, const LodChainSettings& settings )
+{
+    StreamedMesh& streamed = _meshes.emplace_back();
+    streamed.lods = buildLodChain( mesh, settings );
+    streamed.gpu.resize( streamed.lods.size() );
+    streamed.previousLod = uint32_t( streamed.lods.size() - 1 );
+
+    std::vector<size_t> sizes;
+    for ( const MeshLod& lod : streamed.lods )
+    {
+        streamed.errors.push_back( lod.geometricError );
+        sizes.push_back( gpuSize( lod.mesh ) );
+    }
+
+    uint32_t handle = _residency.addMesh( sizes );
+
+    // The pinned coarsest level has to exist before the first draw.
+    endFrame();
+    assert( streamed.gpu.back().pVertexBuffer );
+
+    return handle;
+}
+
+LodStreamer::DrawItem LodStreamer::select( uint32_t mesh, float distance, float boundingRadius, const LodViewParams& params )
+{
+    StreamedMesh& streamed = _meshes[ mesh ];
+
+    uint32_t desired = selectLod( streamed.errors.data(), uint32_t( streamed.errors.size() ),
+                                  distance, boundingRadius, lodProjectionScale( params ), params,
+                                  streamed.previousLod );
+    streamed.previousLod = desired;
+
+    // Closer objects, which need the detail most, stream in first.
+    float priority = 1.0f / std::max( distance, 1e-3f );
+    uint32_t lod = _residency.request( mesh, desired, priority );
+
+    // The residency counts a level as soon as its load is queued. Until the
+    // buffers arrive, draw the nearest level that has them, coarser first; the
+    // pinned coarsest level always does.
+    uint32_t loaded = lod;
+    const uint32_t LevelCount = uint32_t( streamed.gpu.size() );
+    for ( uint32_t step = 1; !streamed.gpu[ loaded ].pVertexBuffer; ++step )
+    {
+        if ( lod + step < LevelCount && streamed.gpu[ lod + step ].pVertexBuffer )
+        {
+            loaded = lod + step;
+        }
+        else if ( step <= lod && streamed.gpu[ lod - step ].pVertexBuffer )
+        {
+            loaded = lod - step;
+        }
+    }
+
+    const GpuLevel& level = streamed.gpu[ loaded ];
+    return { level.pVertexBuffer, level.pIndexBuffer, uint32_t( streamed.lods[ loaded ].mesh.indices.size() ), loaded, desired };
+}
+
+void LodStreamer::endFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _arrived.swap( _completed );
+    }
+    for ( const Load& load : _arrived )
+    {
+        install( load );
+    }
+    _inFlight -= _arrived.size();
+    _arrived.clear();
+
+    _residency.update( _loads, _evictions );
+
+    for ( const LodResidency::Change& c : _evictions )
+    {
+        evict( c.mesh, c.lod );
+    }
+
+    size_t queued = 0;
+    for ( const LodResidency::Change& c : _loads )
+    {
+        StreamedMesh& streamed = _meshes[ c.mesh ];
+        GpuLevel& level = streamed.gpu[ c.lod ];
+        Load load = { c.mesh, c.lod, ++level.ticket, &streamed.lods[ c.lod ].mesh, {} };
+
+        // Only addMesh() loads the pinned level, and it needs it right away.
+        if ( c.lod + 1 == streamed.gpu.size() )
+        {
+            load.level = upload( *load.pData );
+            install( load );
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        _queue.push_back( load );
+        ++queued;
+    }
+    if ( queued )
+    {
+        _inFlight += queued;
+        _wake.notify_one();
+    }
+}
+
+LodStreamer::GpuLevel LodStreamer::upload( const MeshData& data )
+{
+    const size_t SizeOfVertexBuffer = sizeof( math::float3 ) * data.vertices.size();
+    const size_t SizeOfIndexBuffer = sizeof( UInt32 ) * data.indices.size();
+
+    GpuLevel level;
+    level.pVertexBuffer = _pResources->newBuffer( SizeOfVertexBuffer, MTL::ResourceStorageModeManaged, ResourceCategory::Streaming, "LOD vertices" );
+    level.pIndexBuffer = _pResources->newBuffer( SizeOfIndexBuffer, MTL::ResourceStorageModeManaged, ResourceCategory::Streaming, "LOD indices" );
+    if ( !level.pVertexBuffer || !level.pIndexBuffer )
+    {
+        // The Streaming budget is full; install() hands the level back to the residency.
+        __builtin_printf( "LodStreamer: the Streaming budget refused a %zu byte level\n", SizeOfVertexBuffer + SizeOfIndexBuffer );
+        _pResources->release( level.pVertexBuffer );
+        _pResources->release( level.pIndexBuffer );
+        return GpuLevel();
+    }
+
+    math::float3* pPositions = reinterpret_cast< math::float3* >( level.pVertexBuffer->contents() );
+    for ( size_t i = 0; i < data.vertices.size(); ++i )
+    {
+        pPositions[ i ] = math::float3{ data.vertices[ i ].x, data.vertices[ i ].y, data.vertices[ i ].z };
+    }
+    memcpy( level.pIndexBuffer->contents(), data.indices.data(), SizeOfIndexBuffer );
+
+    level.pVertexBuffer->didModifyRange( NS::Range::Make( 0, level.pVertexBuffer->length() ) );
+    level.pIndexBuffer->didModifyRange( NS::Range::Make( 0, level.pIndexBuffer->length() ) );
+    return level;
+}
+
+void LodStreamer::install( const Load& load )
+{
+    GpuLevel& level = _meshes[ load.mesh ].gpu[ load.lod ];
+    if ( load.ticket != level.ticket || level.pVertexBuffer )
+    {
+        // Evicted, or evicted and requested again, while it was loading.
+        _pResources->release( load.level.pVertexBuffer );
+        _pResources->release( load.level.pIndexBuffer );
+        return;
+    }
+    if ( !load.level.pVertexBuffer )
+    {
+        _residency.loadFailed( load.mesh, load.lod );
+        return;
+    }
+    level.pVertexBuffer = load.level.pVertexBuffer;
+    level.pIndexBuffer = load.level.pIndexBuffer;
+}
+
+void LodStreamer::evict( uint32_t mesh, uint32_t lod )
+{
+    GpuLevel& level = _meshes[ mesh ].gpu[ lod ];
+    ++level.ticket;
+    if ( level.pVertexBuffer )
+    {
+        _pResources->release( level.pVertexBuffer );
+        _pResources->release( level.pIndexBuffer );
+        level.pVertexBuffer = nullptr;
+        level.pIndexBuffer = nullptr;
+    }
+
+    // Drop the load if it has not started yet.
+    std::lock_guard<std::mutex> lock( _mutex );
+    auto it = std::find_if( _queue.begin(), _queue.end(), [&]( const Load& l ) { return l.mesh == mesh && l.lod == lod; } );
+    if ( it != _queue.end() )
+    {
+        _queue.erase( it );
+        --_inFlight;
+    }
+}
+
+void LodStreamer::loaderMain()
+{
+    for ( ;; )
+    {
+        Load load;
+        {
+            std::unique_lock<std::mutex> lock( _mutex );
+            _wake.wait( lock, [this] { return _quit || !_queue.empty(); } );
+            if ( _quit )
+            {
+                return;
+            }
+            load = _queue.front();
+            _queue.pop_front();
+        }
+
+        NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+        load.level = upload( *load.pData );
+        pPool->release();
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        _completed.push_back( load );
+    }
+}
+
+namespace
+{
+
+const uint32_t kBenchPatches = 24;
+const uint32_t kBenchPatchCells = 96;
+const float kBenchPatchSpacing = 4.0f;
+const float kBenchPatchRadius = 1.5f;
+const uint32_t kBenchWidth = 1280;
+const uint32_t kBenchHeight = 720;
+
+// A bumpy square in clip space, different for every seed.
+MeshData terrainPatch( uint32_t cells, uint32_t seed )
+{
+    MeshData mesh;
+    const float FrequencyX = 3.0f + float( seed % 5 );
+    const float FrequencyY = 2.0f + float( seed % 3 );
+    for ( uint32_t y = 0; y <= cells; ++y )
+    {
+        for ( uint32_t x = 0; x <= cells; ++x )
+        {
+            float fx = float( x ) / float( cells ) * 2.0f - 1.0f;
+            float fy = float( y ) / float( cells ) * 2.0f - 1.0f;
+            mesh.vertices.push_back( { fx, fy, 0.5f + 0.1f * sinf( fx * FrequencyX ) * cosf( fy * FrequencyY ) } );
+        }
+    }
+    for ( uint32_t y = 0; y < cells; ++y )
+    {
+        for ( uint32_t x = 0; x < cells; ++x )
+        {
+            uint32_t i0 = y * ( cells + 1 ) + x, i1 = i0 + 1, i2 = i0 + cells + 1, i3 = i2 + 1;
+            mesh.indices.insert( mesh.indices.end(), { i0, i1, i2, i1, i3, i2 } );
+        }
+    }
+    return mesh;
+}
+
+}
+
+std::vector<BenchResult> runLodStreamingBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                               uint32_t frames, uint32_t warmupFrames )
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+    ResourceRegistry* pResources = new ResourceRegistry( pDevice );
+
+    // A quarter of the finest levels fits, so moving the camera keeps loading and evicting.
+    std::vector<MeshData> patches;
+    size_t finestBytes = 0;
+    for ( uint32_t i = 0; i < kBenchPatches; ++i )
+    {
+        patches.push_back( terrainPatch( kBenchPatchCells, i ) );
+        finestBytes += patches.back().vertices.size() * sizeof( math::float3 ) + patches.back().indices.size() * sizeof( UInt32 );
+    }
+    LodStreamer* pStreamer = new LodStreamer( pResources, finestBytes / 4 );
+    for ( const MeshData& patch : patches )
+    {
+        pStreamer->addMesh( patch, LodChainSettings() );
+    }
+
+    MTL::TextureDescriptor* pTexDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatBGRA8Unorm, kBenchWidth, kBenchHeight, false );
+    pTexDesc->setStorageMode( MTL::StorageModePrivate );
+    pTexDesc->setUsage( MTL::TextureUsageRenderTarget );
+    MTL::Texture* pColor = pResources->newTexture( pTexDesc, ResourceCategory::RenderTarget, "LOD streaming bench color" );
+    pTexDesc->release();
+
+    MTL::Library* pLibrary = pDevice->newDefaultLibrary();
+    MTL::Function* pVertexFn = pLibrary->newFunction( NS::String::string( "vertexMain", UTF8StringEncoding ) );
+    MTL::Function* pFragFn = pLibrary->newFunction( NS::String::string( "fragmentMain", UTF8StringEncoding ) );
+    MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pDesc->setVertexFunction( pVertexFn );
+    pDesc->setFragmentFunction( pFragFn );
+    pDesc->colorAttachments()->object( 0 )->setPixelFormat( MTL::PixelFormatBGRA8Unorm );
+    NS::Error* pError = nullptr;
+    MTL::RenderPipelineState* pPSO = pDevice->newRenderPipelineState( pDesc, &pError );
+    if ( !pPSO )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    pDesc->release();
+    pFragFn->release();
+    pVertexFn->release();
+    pLibrary->release();
+
+    MTL::RenderPassDescriptor* pRpd = MTL::RenderPassDescriptor::alloc()->init();
+    pRpd->colorAttachments()->object( 0 )->setTexture( pColor );
+    pRpd->colorAttachments()->object( 0 )->setLoadAction( MTL::LoadActionClear );
+    pRpd->colorAttachments()->object( 0 )->setStoreAction( MTL::StoreActionStore );
+
+    // Fly from before the first patch to past the last and back, once over the run.
+    const math::float4x4 Identity = math::identity4x4();
+    const float PathLength = float( kBenchPatches ) * kBenchPatchSpacing + 10.0f;
+    LodViewParams view;
+    view.viewportHeight = float( kBenchHeight );
+
+    std::vector<double> cpuMs, gpuMs;
+    size_t draws = 0, fallbackDraws = 0;
+    for ( uint32_t frame = 0; frame < warmupFrames + frames; ++frame )
+    {
+        NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+        float t = float( frame ) / float( warmupFrames + frames );
+        float cameraZ = -5.0f + PathLength * ( t < 0.5f ? 2.0f * t : 2.0f - 2.0f * t );
+
+        uint64_t start = TraceRecorder::nowNs();
+        MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+        MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( pRpd );
+        pEnc->setRenderPipelineState( pPSO );
+        pEnc->setVertexBytes( &Identity, sizeof( Identity ), Renderer::kInstanceMatricesIndex );
+        for ( uint32_t i = 0; i < kBenchPatches; ++i )
+        {
+            float distance = std::fabs( float( i ) * kBenchPatchSpacing - cameraZ );
+            LodStreamer::DrawItem item = pStreamer->select( i, distance, kBenchPatchRadius, view );
+            pEnc->setVertexBuffer( item.pVertexBuffer, 0, 0 );
+            pEnc->drawIndexedPrimitives( MTL::PrimitiveTypeTriangle, item.indexCount, MTL::IndexTypeUInt32, item.pIndexBuffer, 0 );
+            if ( frame >= warmupFrames )
+            {
+                ++draws;
+                fallbackDraws += item.lod != item.desiredLod;
+            }
+        }
+        pEnc->endEncoding();
+        pCmd->commit();
+        // The command buffer holds on to anything evicted here until it is done with it.
+        pStreamer->endFrame();
+        uint64_t end = TraceRecorder::nowNs();
+
+        pCmd->waitUntilCompleted();
+        if ( frame >= warmupFrames )
+        {
+            cpuMs.push_back( double( end - start ) * 1e-6 );
+            gpuMs.push_back( ( pCmd->GPUEndTime() - pCmd->GPUStartTime() ) * 1e3 );
+        }
+        pPool->release();
+    }
+
+    __builtin_printf( "LOD streaming: %u patches, %.2f MB budget, %.1f%% of draws on a fallback level, %zu loads in flight at the end\n",
+                      kBenchPatches, double( finestBytes / 4 ) / ( 1024.0 * 1024.0 ),
+                      draws ? 100.0 * double( fallbackDraws ) / double( draws ) : 0.0, pStreamer->loadsInFlight() );
+
+    std::vector<BenchResult> results;
+    BenchResult result;
+    result.scene = "lod-streaming";
+    result.cpuEncode = summarizeFrameTimes( cpuMs );
+    result.gpu = summarizeFrameTimes( gpuMs );
+    result.memoryBytes = pStreamer->residentBytes();
+    results.push_back( result );
+
+    pRpd->release();
+    pPSO->release();
+    pResources->release( pColor );
+    delete pStreamer;
+    delete pResources;
+    return results;
+}
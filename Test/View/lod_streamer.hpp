@@ -0,0 +1,115 @@
+//
+//  lod_streamer.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef lod_streamer_hpp
+#define lod_streamer_hpp
+
+#include <Metal/Metal.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "Model/mesh_simplifier.hpp"
+#include "Model/lod_selector.hpp"
+#include "Model/bench_suite.hpp"
+
+class ResourceRegistry;
+
+// Owns the GPU copies of every mesh LOD chain and keeps only the levels the
+// selector asks for resident, within the LodResidency byte budget. The buffers
+// are allocated from the registry's Streaming category.
+//
+// Loads run on a background thread that creates and fills the buffers, and are
+// picked up by the next endFrame() after they finish. Until then select() keeps
+// returning the closest level that has arrived. A load the Streaming budget
+// refuses is handed back to the residency and retried on a later frame.
+class LodStreamer
+{
+public:
+    struct DrawItem
+    {
+        MTL::Buffer* pVertexBuffer;   // float3 positions, 16-byte stride to match vertexMain
+        MTL::Buffer* pIndexBuffer;    // UInt32 indices
+        uint32_t     indexCount;
+        uint32_t     lod;
+        uint32_t     desiredLod;      // differs from lod while the wanted level streams in
+    };
+
+    LodStreamer( ResourceRegistry* pResources, size_t budgetBytes );
+    ~LodStreamer();
+
+    // Builds the LOD chain and uploads its coarsest level before returning. Call
+    // at load time, not between select() and endFrame().
+    uint32_t addMesh( const MeshData& mesh, const LodChainSettings& settings );
+
+    // Selects the LOD for this frame from the object's distance to the camera and
+    // returns the buffers to draw, falling back to a loaded level while streaming.
+    DrawItem select( uint32_t mesh, float distance, float boundingRadius, const LodViewParams& params );
+
+    // Takes in the loads that have finished and applies the residency decisions
+    // for the frame, queueing its loads. Call once after all select() calls.
+    void endFrame();
+
+    size_t residentBytes() const { return _residency.residentBytes(); }
+    size_t loadsInFlight() const { return _inFlight; }
+
+private:
+    struct GpuLevel
+    {
+        MTL::Buffer* pVertexBuffer = nullptr;
+        MTL::Buffer* pIndexBuffer  = nullptr;
+        uint32_t     ticket        = 0;         // bumped by every load and eviction, so stale loads are dropped
+    };
+
+    struct StreamedMesh
+    {
+        std::vector<MeshLod>  lods;
+        std::vector<float>    errors;
+        std::vector<GpuLevel> gpu;
+        uint32_t              previousLod;
+    };
+
+    struct Load
+    {
+        uint32_t        mesh;
+        uint32_t        lod;
+        uint32_t        ticket;
+        const MeshData* pData;      // points into the chain's storage, which never moves
+        GpuLevel        level;
+    };
+
+    static size_t gpuSize( const MeshData& mesh );
+    GpuLevel upload( const MeshData& data );
+    void install( const Load& load );
+    void evict( uint32_t mesh, uint32_t lod );
+    void loaderMain();
+
+    ResourceRegistry*                   _pResources;
+    LodResidency                        _residency;
+    std::vector<StreamedMesh>           _meshes;
+    std::vector<LodResidency::Change>   _loads;
+    std::vector<LodResidency::Change>   _evictions;
+    size_t                              _inFlight = 0;
+
+    std::mutex                          _mutex;
+    std::condition_variable             _wake;
+    std::deque<Load>                    _queue;
+    std::vector<Load>                   _completed;
+    std::vector<Load>                   _arrived;
+    bool                                _quit = false;
+
+    // Last, so everything it touches exists before it starts.
+    std::thread                         _loader;
+};
+
+// Streams a row of terrain patches in and out as the camera flies over it and
+// back, drawing whatever select() returns offscreen. Reports the CPU time of
+// selection, residency and encoding, the GPU time, and the resident bytes.
+std::vector<BenchResult> runLodStreamingBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                               uint32_t frames, uint32_t warmupFrames );
+
+#endif /* lod_streamer_hpp */
@@ -0,0 +1,420 @@
+//
+//  material_stitcher.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "material_stitcher.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <cassert>
+#include <unordered_set>
+
+namespace
+{
+
+// The material shaders are compiled at run time rather than living in
+// Shaders.metal: the node library links against a dynamic library made here,
+// which the build-time default library can't.
+
+const char* const kPrelude = R"(
+#include <metal_stdlib>
+using namespace metal;
+)";
+
+// Shared helpers, compiled once into the dynamic library.
+const char* const kUtilitySource = R"(
+float materialHash( float2 p )
+{
+    p = fract( p * float2( 123.34, 456.21 ) );
+    p += dot( p, p + 45.32 );
+    return fract( p.x * p.y );
+}
+
+float materialValueNoise( float2 p )
+{
+    float2 i = floor( p );
+    float2 f = fract( p );
+    float2 u = f * f * ( 3.0 - 2.0 * f );
+    return mix( mix( materialHash( i ), materialHash( i + float2( 1, 0 ) ), u.x ),
+                mix( materialHash( i + float2( 0, 1 ) ), materialHash( i + float2( 1, 1 ) ), u.x ), u.y );
+}
+
+float materialLuminance( float3 c )
+{
+    return dot( c, float3( 0.2126, 0.7152, 0.0722 ) );
+}
+)";
+
+const char* const kUtilityDeclarations = R"(
+extern float materialValueNoise( float2 p );
+extern float materialLuminance( float3 c );
+)";
+
+// One function per entry of materialNodeKinds().
+const char* const kNodeSource = R"(
+[[stitchable]] float4 nodeChecker( float4 uv )
+{
+    float2 cell = floor( uv.xy * 8.0 );
+    return float4( float3( fmod( cell.x + cell.y, 2.0 ) ), 1.0 );
+}
+
+[[stitchable]] float4 nodeNoise( float4 uv )
+{
+    return float4( float3( materialValueNoise( uv.xy * 16.0 ) ), 1.0 );
+}
+
+[[stitchable]] float4 nodeStripes( float4 uv )
+{
+    return float4( float3( step( 0.5, fract( uv.x * 10.0 ) ) ), 1.0 );
+}
+
+[[stitchable]] float4 nodeFresnel( float4 normal )
+{
+    float f = pow( 1.0 - saturate( -normal.z ), 4.0 );
+    return float4( f, f, f, 0.0 );
+}
+
+[[stitchable]] float4 nodeDesaturate( float4 color )
+{
+    return float4( float3( materialLuminance( color.rgb ) ), color.a );
+}
+
+[[stitchable]] float4 nodeLambert( float4 normal, float4 color )
+{
+    float diffuse = saturate( dot( normal.xyz, normalize( float3( 0.4, 0.6, -0.7 ) ) ) );
+    return float4( color.rgb * ( 0.15 + diffuse ), color.a );
+}
+
+[[stitchable]] float4 nodeTint( float4 color, float4 params )
+{
+    return color * float4( 0.5 + 0.5 * cos( params.x + float3( 0.0, 2.0, 4.0 ) ), 1.0 );
+}
+
+[[stitchable]] float4 nodeMultiply( float4 a, float4 b )
+{
+    return a * b;
+}
+
+[[stitchable]] float4 nodeAdd( float4 a, float4 b )
+{
+    return a + b;
+}
+
+[[stitchable]] float4 nodeMix( float4 a, float4 b, float4 t )
+{
+    return mix( a, b, t.x );
+}
+)";
+
+// A fullscreen triangle shading a sphere-like normal field with the material,
+// which is linked in at pipeline creation.
+const char* const kShaderSource = R"(
+extern float4 materialSurface( float4 uv, float4 normal, float4 params );
+
+struct MaterialV2F
+{
+    float4 position [[position]];
+    float2 uv;
+};
+
+vertex MaterialV2F materialVertex( uint vertexId [[vertex_id]] )
+{
+    float2 p = float2( ( vertexId << 1 ) & 2, vertexId & 2 );
+    MaterialV2F o;
+    o.position = float4( p * 2.0 - 1.0, 0.0, 1.0 );
+    o.uv = float2( p.x, 1.0 - p.y );
+    return o;
+}
+
+fragment half4 materialFragment( MaterialV2F in [[stage_in]],
+                                 constant float4& params [[buffer(0)]] )
+{
+    float2 p = in.uv * 2.0 - 1.0;
+    float3 normal = float3( p, -sqrt( saturate( 1.0 - dot( p, p ) ) ) );
+    return half4( materialSurface( float4( in.uv, 0.0, 0.0 ), float4( normal, 0.0 ), params ) );
+}
+)";
+
+const char* const kMaterialFunction = "materialSurface";
+
+NS::String* nsString( const char* text )
+{
+    return NS::String::string( text, NS::StringEncoding::UTF8StringEncoding );
+}
+
+double msSince( uint64_t startNs )
+{
+    return double( TraceRecorder::nowNs() - startNs ) * 1e-6;
+}
+
+}
+
+bool MaterialStitcher::supported( MTL::Device* pDevice )
+{
+    return pDevice->supportsDynamicLibraries() && pDevice->supportsFunctionPointersFromRender();
+}
+
+MaterialStitcher::MaterialStitcher( MTL::Device* pDevice, MTL::PixelFormat colorFormat )
+: _pDevice( pDevice->retain() )
+, _colorFormat( colorFormat )
+{
+    TRACE_SCOPE( "MaterialStitcher::MaterialStitcher" );
+    const uint64_t Start = TraceRecorder::nowNs();
+    NS::Error* pError = nullptr;
+
+    MTL::CompileOptions* pOptions = MTL::CompileOptions::alloc()->init();
+    pOptions->setLibraryType( MTL::LibraryTypeDynamic );
+    pOptions->setInstallName( nsString( "@executable_path/material_utilities.metallib" ) );
+    MTL::Library* pUtilityLibrary = newLibrary( std::string( kPrelude ) + kUtilitySource, pOptions );
+    _pUtilities = _pDevice->newDynamicLibrary( pUtilityLibrary, &pError );
+    pUtilityLibrary->release();
+    pOptions->release();
+    if ( !_pUtilities )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+
+    pOptions = MTL::CompileOptions::alloc()->init();
+    pOptions->setLibraries( NS::Array::array( _pUtilities ) );
+    _pNodes = newLibrary( std::string( kPrelude ) + kUtilityDeclarations + kNodeSource + kShaderSource, pOptions );
+    pOptions->release();
+
+    for ( const MaterialNodeKind& kind : materialNodeKinds() )
+    {
+        _nodeFunctions[ kind.function ] = _pNodes->newFunction( nsString( kind.function ) );
+    }
+    _pVertexFn = _pNodes->newFunction( nsString( "materialVertex" ) );
+    _pFragmentFn = _pNodes->newFunction( nsString( "materialFragment" ) );
+    _setupMs = msSince( Start );
+}
+
+MaterialStitcher::~MaterialStitcher()
+{
+    for ( auto& entry : _cache )
+    {
+        entry.second.pPSO->release();
+        entry.second.pLibrary->release();
+    }
+    for ( auto& entry : _nodeFunctions )
+    {
+        entry.second->release();
+    }
+    _pFragmentFn->release();
+    _pVertexFn->release();
+    _pNodes->release();
+    _pUtilities->release();
+    _pDevice->release();
+}
+
+MTL::Library* MaterialStitcher::newLibrary( const std::string& source, const MTL::CompileOptions* pOptions )
+{
+    NS::Error* pError = nullptr;
+    MTL::Library* pLibrary = _pDevice->newLibrary( nsString( source.c_str() ), pOptions, &pError );
+    if ( !pLibrary )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    return pLibrary;
+}
+
+MTL::RenderPipelineState* MaterialStitcher::newPipeline( MTL::Function* pVertexFn, MTL::Function* pFragmentFn, MTL::LinkedFunctions* pLinked )
+{
+    MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pDesc->setVertexFunction( pVertexFn );
+    pDesc->setFragmentFunction( pFragmentFn );
+    pDesc->colorAttachments()->object( 0 )->setPixelFormat( _colorFormat );
+    if ( pLinked )
+    {
+        pDesc->setFragmentLinkedFunctions( pLinked );
+        pDesc->setFragmentPreloadedLibraries( NS::Array::array( _pUtilities ) );
+    }
+
+    NS::Error* pError = nullptr;
+    MTL::RenderPipelineState* pPSO = _pDevice->newRenderPipelineState( pDesc, &pError );
+    if ( !pPSO )
+    {
+        __builtin_printf( "Material pipeline: %s\n", pError->localizedDescription()->utf8String() );
+    }
+    pDesc->release();
+    return pPSO;
+}
+
+MTL::RenderPipelineState* MaterialStitcher::pipeline( const MaterialGraph& graph )
+{
+    TRACE_SCOPE( "MaterialStitcher::pipeline" );
+    ++_stats.requests;
+    const uint64_t Hash = hashMaterialGraph( graph );
+    auto found = _cache.find( Hash );
+    if ( found != _cache.end() )
+    {
+        ++_stats.hits;
+        return found->second.pPSO;
+    }
+
+    std::string problem = validateMaterialGraph( graph );
+    if ( !problem.empty() )
+    {
+        __builtin_printf( "Material graph: %s\n", problem.c_str() );
+        ++_stats.failures;
+        return nullptr;
+    }
+
+    NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+    uint64_t start = TraceRecorder::nowNs();
+
+    // One input node per argument, shared by every node reading it.
+    std::vector<NS::Object*> arguments;
+    for ( uint32_t i = 0; i < kMaterialArgumentCount; ++i )
+    {
+        arguments.push_back( MTL::FunctionStitchingInputNode::alloc()->init( i )->autorelease() );
+    }
+    std::vector<NS::Object*> nodes;
+    std::vector<NS::Object*> functions;
+    std::unordered_set<std::string> used;
+    for ( const MaterialNode& node : graph.nodes )
+    {
+        std::vector<NS::Object*> inputs;
+        for ( const MaterialInput& input : node.inputs )
+        {
+            inputs.push_back( input.source == MaterialInput::Source::Node ? nodes[ input.index ] : arguments[ input.index ] );
+        }
+        NS::Array* pInputs = NS::Array::array( inputs.data(), inputs.size() );
+        nodes.push_back( MTL::FunctionStitchingFunctionNode::alloc()->init( nsString( node.function.c_str() ), pInputs, NS::Array::array() )->autorelease() );
+        if ( used.insert( node.function ).second )
+        {
+            functions.push_back( _nodeFunctions[ node.function ] );
+        }
+    }
+
+    // Nodes stay calls into the node functions rather than being inlined, which
+    // keeps each stitched library to the graph's glue code.
+    MTL::FunctionStitchingGraph* pGraph = MTL::FunctionStitchingGraph::alloc()->init(
+        nsString( kMaterialFunction ), NS::Array::array( nodes.data(), nodes.size() ),
+        static_cast<MTL::FunctionStitchingFunctionNode*>( nodes[ graph.output ] ), NS::Array::array() );
+    MTL::StitchedLibraryDescriptor* pStitchDesc = MTL::StitchedLibraryDescriptor::alloc()->init();
+    pStitchDesc->setFunctionGraphs( NS::Array::array( pGraph ) );
+    pStitchDesc->setFunctions( NS::Array::array( functions.data(), functions.size() ) );
+
+    NS::Error* pError = nullptr;
+    MTL::Library* pLibrary = _pDevice->newLibrary( pStitchDesc, &pError );
+    pStitchDesc->release();
+    pGraph->release();
+    if ( !pLibrary )
+    {
+        __builtin_printf( "Material stitching: %s\n", pError->localizedDescription()->utf8String() );
+        ++_stats.failures;
+        pPool->release();
+        return nullptr;
+    }
+    MTL::Function* pSurfaceFn = pLibrary->newFunction( nsString( kMaterialFunction ) );
+    _stats.stitchMs += msSince( start );
+
+    start = TraceRecorder::nowNs();
+    MTL::LinkedFunctions* pLinked = MTL::LinkedFunctions::alloc()->init();
+    pLinked->setPrivateFunctions( NS::Array::array( pSurfaceFn ) );
+    MTL::RenderPipelineState* pPSO = newPipeline( _pVertexFn, _pFragmentFn, pLinked );
+    pLinked->release();
+    pSurfaceFn->release();
+    _stats.pipelineMs += msSince( start );
+
+    if ( !pPSO )
+    {
+        ++_stats.failures;
+        pLibrary->release();
+        pPool->release();
+        return nullptr;
+    }
+    _cache[ Hash ] = { pLibrary, pPSO };
+    pPool->release();
+    return pPSO;
+}
+
+MTL::RenderPipelineState* MaterialStitcher::newMonolithicPipeline( const MaterialGraph& graph )
+{
+    TRACE_SCOPE( "MaterialStitcher::newMonolithicPipeline" );
+    std::string problem = validateMaterialGraph( graph );
+    if ( !problem.empty() )
+    {
+        __builtin_printf( "Material graph: %s\n", problem.c_str() );
+        return nullptr;
+    }
+
+    // Helpers, every node and the graph body in one source, compiled whole.
+    std::string source = std::string( kPrelude ) + kUtilitySource + kNodeSource;
+    source += std::string( "float4 " ) + kMaterialFunction + "( float4 uv, float4 normal, float4 params )\n{\n" + materialGraphSource( graph ) + "}\n";
+    source += kShaderSource;
+
+    MTL::Library* pLibrary = newLibrary( source, nullptr );
+    MTL::Function* pVertexFn = pLibrary->newFunction( nsString( "materialVertex" ) );
+    MTL::Function* pFragmentFn = pLibrary->newFunction( nsString( "materialFragment" ) );
+    MTL::RenderPipelineState* pPSO = newPipeline( pVertexFn, pFragmentFn, nullptr );
+    pFragmentFn->release();
+    pVertexFn->release();
+    pLibrary->release();
+    return pPSO;
+}
+
+std::vector<BenchResult> runMaterialBench( MTL::Device* pDevice, uint32_t materialCount, uint32_t uniqueCount )
+{
+    std::vector<BenchResult> results;
+    if ( !MaterialStitcher::supported( pDevice ) )
+    {
+        __builtin_printf( "Material bench: %s has no dynamic libraries or render function pointers\n", pDevice->name()->utf8String() );
+        return results;
+    }
+
+    std::vector<MaterialGraph> graphs = randomMaterialGraphs( materialCount, uniqueCount, 1 );
+
+    // The stitcher's one-time setup counts towards the first material.
+    std::vector<double> stitchedMs;
+    uint64_t start = TraceRecorder::nowNs();
+    MaterialStitcher stitcher( pDevice, MTL::PixelFormatBGRA8Unorm_sRGB );
+    for ( const MaterialGraph& graph : graphs )
+    {
+        stitcher.pipeline( graph );
+        stitchedMs.push_back( msSince( start ) );
+        start = TraceRecorder::nowNs();
+    }
+    const double StitchedTotalMs = stitcher.setupMs() + stitcher.stats().stitchMs + stitcher.stats().pipelineMs;
+
+    // Standalone shaders would be cached by graph too, so only distinct graphs compile.
+    std::vector<double> monolithicMs;
+    std::unordered_set<uint64_t> compiled;
+    double monolithicTotalMs = 0.0;
+    for ( const MaterialGraph& graph : graphs )
+    {
+        start = TraceRecorder::nowNs();
+        if ( compiled.insert( hashMaterialGraph( graph ) ).second )
+        {
+            MTL::RenderPipelineState* pPSO = stitcher.newMonolithicPipeline( graph );
+            if ( pPSO )
+            {
+                pPSO->release();
+            }
+        }
+        monolithicMs.push_back( msSince( start ) );
+        monolithicTotalMs += monolithicMs.back();
+    }
+
+    const MaterialCacheStats& Stats = stitcher.stats();
+    __builtin_printf( "Materials: %u requests, %zu distinct graphs, %zu cache hits, %zu failures\n",
+                      materialCount, compiled.size(), Stats.hits, Stats.failures );
+    __builtin_printf( "  stitched:   %.1f ms total (%.1f setup, %.1f stitching, %.1f pipelines)\n",
+                      StitchedTotalMs, stitcher.setupMs(), Stats.stitchMs, Stats.pipelineMs );
+    __builtin_printf( "  monolithic: %.1f ms total\n", monolithicTotalMs );
+
+    BenchResult stitched;
+    stitched.scene = "materials-stitched";
+    stitched.cpuEncode = summarizeFrameTimes( stitchedMs );
+    results.push_back( stitched );
+
+    BenchResult monolithic;
+    monolithic.scene = "materials-monolithic";
+    monolithic.cpuEncode = summarizeFrameTimes( monolithicMs );
+    results.push_back( monolithic );
+    return results;
+}
@@ -0,0 +1,80 @@
+//
+//  material_stitcher.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef material_stitcher_hpp
+#define material_stitcher_hpp
+
+#include <Metal/Metal.hpp>
+#include <unordered_map>
+#include <vector>
+#include "Model/material_graph.hpp"
+#include "Model/bench_suite.hpp"
+
+struct MaterialCacheStats
+{
+    size_t  requests = 0;
+    size_t  hits = 0;
+    size_t  failures = 0;
+    double  stitchMs = 0.0;     // stitched libraries, misses only
+    double  pipelineMs = 0.0;
+};
+
+// Builds material pipelines from MaterialGraphs without compiling a shader per
+// material. Shared helpers are compiled once into an MTL::DynamicLibrary, and
+// the node functions once into a library linked against it. Each material is
+// then a FunctionStitchingGraph over those nodes, stitched into a small
+// library of its own and linked into the material fragment shader as a
+// private function. Pipelines are cached by graph hash, so materials sharing a
+// graph share one pipeline.
+class MaterialStitcher
+{
+public:
+    MaterialStitcher( MTL::Device* pDevice, MTL::PixelFormat colorFormat );
+    ~MaterialStitcher();
+
+    // Needs dynamic libraries and function pointers from render pipelines.
+    static bool supported( MTL::Device* pDevice );
+
+    // nullptr when the graph is invalid or fails to stitch.
+    MTL::RenderPipelineState* pipeline( const MaterialGraph& graph );
+
+    // The same material compiled as one standalone shader, as it would be
+    // without stitching. For comparison; not cached.
+    MTL::RenderPipelineState* newMonolithicPipeline( const MaterialGraph& graph );
+
+    const MaterialCacheStats& stats() const { return _stats; }
+    double setupMs() const { return _setupMs; }
+
+private:
+    struct Stitched
+    {
+        MTL::Library*               pLibrary;
+        MTL::RenderPipelineState*   pPSO;
+    };
+
+    MTL::Library* newLibrary( const std::string& source, const MTL::CompileOptions* pOptions );
+    MTL::RenderPipelineState* newPipeline( MTL::Function* pVertexFn, MTL::Function* pFragmentFn, MTL::LinkedFunctions* pLinked );
+
+    MTL::Device*                                    _pDevice;
+    MTL::PixelFormat                                _colorFormat;
+    MTL::DynamicLibrary*                            _pUtilities;
+    MTL::Library*                                   _pNodes;
+    MTL::Function*                                  _pVertexFn;
+    MTL::Function*                                  _pFragmentFn;
+    std::unordered_map<std::string, MTL::Function*> _nodeFunctions;
+    std::unordered_map<uint64_t, Stitched>          _cache;
+    MaterialCacheStats                              _stats;
+    double                                          _setupMs = 0.0;
+};
+
+// Builds pipelines for materialCount materials drawn from uniqueCount graphs,
+// once stitched through a MaterialStitcher and once compiled standalone per
+// distinct graph. Reports per-material build times as "materials-stitched" and
+// "materials-monolithic" results in cpuEncode.
+std::vector<BenchResult> runMaterialBench( MTL::Device* pDevice, uint32_t materialCount, uint32_t uniqueCount );
+
+#endif /* material_stitcher_hpp */
@@ -0,0 +1,89 @@
+//
+//  metal_bench_backend.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "metal_bench_backend.hpp"
+#include "renderer.hpp"
+#include "resource_registry.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+
+MetalBenchBackend::MetalBenchBackend( Renderer* pRenderer, uint32_t width, uint32_t height )
+: _pRenderer( pRenderer )
+{
+    // The renderer's pipeline format; depth comes from its FrameAttachments.
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatBGRA8Unorm_sRGB, width, height, false );
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget );
+    _pColor = _pRenderer->resources()->newTexture( pDesc, ResourceCategory::RenderTarget, "Bench color" );
+    pDesc->release();
+
+    _pRpd = MTL::RenderPassDescriptor::alloc()->init();
+    _pRpd->colorAttachments()->object( 0 )->setTexture( _pColor );
+    _pRpd->colorAttachments()->object( 0 )->setLoadAction( MTL::LoadActionClear );
+    _pRpd->colorAttachments()->object( 0 )->setStoreAction( MTL::StoreActionStore );
+}
+
+MetalBenchBackend::~MetalBenchBackend()
+{
+    unload();
+    _pRpd->release();
+    _pRenderer->resources()->release( _pColor );
+}
+
+void MetalBenchBackend::load( const BenchScene& scene )
+{
+    const uint32_t TextureCount = std::max( scene.desc.textureCount, 1u );
+    _drawList.packets.clear();
+    _drawList.transforms.clear();
+    for ( const BenchDraw& draw : scene.draws )
+    {
+        const MeshVertex& corner = scene.mesh.vertices[ scene.mesh.indices[ draw.firstIndex ] ];
+        uint32_t material = draw.pso * TextureCount + draw.texture;
+        _drawList.packets.push_back( { drawSortKey( material, 0 ), 0, material, uint32_t( _drawList.transforms.size() ) } );
+        _drawList.transforms.push_back( math::translation4x4( { corner.x, corner.y, 0.0f } ) );
+    }
+
+    // As extraction hands them over: sorted, so equal keys form one instanced draw.
+    std::stable_sort( _drawList.packets.begin(), _drawList.packets.end(),
+                      []( const DrawPacket& a, const DrawPacket& b ) { return a.sortKey < b.sortKey; } );
+    _pRenderer->setDrawList( &_drawList );
+}
+
+BenchFrameTiming MetalBenchBackend::renderFrame()
+{
+    NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+
+    uint64_t start = TraceRecorder::nowNs();
+    MTL::CommandBuffer* pCmd = _pRenderer->commandQueue()->commandBuffer();
+    _pRenderer->encodeFrame( pCmd, _pRpd );
+    pCmd->commit();
+    uint64_t end = TraceRecorder::nowNs();
+
+    pCmd->waitUntilCompleted();
+
+    BenchFrameTiming timing;
+    timing.cpuEncodeMs = double( end - start ) * 1e-6;
+    timing.gpuMs = ( pCmd->GPUEndTime() - pCmd->GPUStartTime() ) * 1e3;
+
+    pPool->release();
+    return timing;
+}
+
+size_t MetalBenchBackend::memoryBytes() const
+{
+    // Everything the renderer holds, which includes the upload arena's growth
+    // for the scene's instance matrices.
+    return _pRenderer->resources()->tracker().totalBytes();
+}
+
+void MetalBenchBackend::unload()
+{
+    _pRenderer->setDrawList( nullptr );
+    _drawList.packets.clear();
+    _drawList.transforms.clear();
+}
@@ -0,0 +1,48 @@
+//
+//  metal_bench_backend.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef metal_bench_backend_hpp
+#define metal_bench_backend_hpp
+
+#include <Metal/Metal.hpp>
+#include <vector>
+#include "Model/bench_suite.hpp"
+#include "Model/render_extraction.hpp"
+
+class Renderer;
+
+// Renders benchmark scenes offscreen through Renderer::encodeFrame(), so the
+// timings cover the renderer's own per-frame work: the upload arena, instance
+// matrix gathering, draw batching and the profiler.
+//
+// Each scene draw becomes a draw packet placed where the draw is, keyed by its
+// pipeline and texture, so the scene's state changes decide how many instanced
+// draws the renderer issues. The renderer only has its one mesh and pipeline,
+// so that is what every packet draws.
+//
+// Each frame is committed and waited on, so GPU time is that frame alone; use
+// the headless mode for throughput.
+class MetalBenchBackend : public BenchBackend
+{
+public:
+    MetalBenchBackend( Renderer* pRenderer, uint32_t width = 1920, uint32_t height = 1080 );
+    ~MetalBenchBackend() override;
+
+    const char* name() const override { return "metal"; }
+    void load( const BenchScene& scene ) override;
+    BenchFrameTiming renderFrame() override;
+    size_t memoryBytes() const override;
+    void unload() override;
+
+private:
+    Renderer*                   _pRenderer;
+    MTL::Texture*               _pColor;
+    MTL::RenderPassDescriptor*  _pRpd;
+    DrawList                    _drawList;
+};
+
+#endif /* metal_bench_backend_hpp */
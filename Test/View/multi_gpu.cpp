@@ -0,0 +1,165 @@
+//
+//  multi_gpu.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "multi_gpu.hpp"
+#include "resource_registry.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <unistd.h>
+
+GpuDeviceInfo describeDevice( MTL::Device* pDevice, bool systemDefault )
+{
+    GpuDeviceInfo info;
+    info.name = pDevice->name()->utf8String();
+    info.registryId = pDevice->registryID();
+    for ( uint32_t family = 8; family >= 1 && !info.appleFamily; --family )
+    {
+        info.appleFamily = pDevice->supportsFamily( MTL::GPUFamily( MTL::GPUFamilyApple1 + family - 1 ) ) ? family : 0;
+    }
+    info.macFamily = pDevice->supportsFamily( MTL::GPUFamilyMac2 ) ? 2 : 0;
+    info.workingSetBytes = pDevice->recommendedMaxWorkingSetSize();
+    info.transferBytesPerSec = pDevice->hasUnifiedMemory() ? 0 : pDevice->maxTransferRate();
+    info.lowPower = pDevice->lowPower();
+    info.headless = pDevice->headless();
+    info.removable = pDevice->removable();
+    info.unifiedMemory = pDevice->hasUnifiedMemory();
+    info.raytracing = pDevice->supportsRaytracing();
+    info.systemDefault = systemDefault;
+    return info;
+}
+
+DeviceSet::DeviceSet( GpuPreference preference )
+{
+    MTL::Device* pDefault = MTL::CreateSystemDefaultDevice();
+    uint64_t defaultId = pDefault ? pDefault->registryID() : 0;
+
+    // Notifications arrive on an arbitrary thread; they only see the atomics.
+    NS::Array* pAll = MTL::CopyAllDevicesWithObserver( &_pObserver, [this]( MTL::Device* pDevice, MTL::DeviceNotificationName name )
+    {
+        bool leaving = name->isEqualToString( MTL::DeviceRemovalRequestedNotification ) || name->isEqualToString( MTL::DeviceWasRemovedNotification );
+        if ( leaving && pDevice->registryID() == _offscreenId.load() )
+        {
+            _offscreenLost = true;
+        }
+    } );
+    for ( NS::UInteger i = 0; i < pAll->count(); ++i )
+    {
+        MTL::Device* pDevice = pAll->object<MTL::Device>( i );
+        _devices.push_back( pDevice->retain() );
+        _infos.push_back( describeDevice( pDevice, pDevice->registryID() == defaultId ) );
+    }
+    pAll->release();
+
+    // CopyAllDevices lists nothing for some sandboxed processes even though a
+    // default device exists.
+    if ( _devices.empty() && pDefault )
+    {
+        _devices.push_back( pDefault->retain() );
+        _infos.push_back( describeDevice( pDefault, true ) );
+    }
+    if ( pDefault )
+    {
+        pDefault->release();
+    }
+
+    _selection = selectGpus( _infos, preference );
+    if ( _selection.display < 0 && !_devices.empty() )
+    {
+        // Nothing scored as a display device; fall back to the system's choice.
+        _selection.display = 0;
+        for ( size_t i = 0; i < _infos.size(); ++i )
+        {
+            _selection.display = _infos[ i ].systemDefault ? int( i ) : _selection.display;
+        }
+    }
+    _offscreenId = _selection.offscreen < 0 ? 0 : _infos[ _selection.offscreen ].registryId;
+}
+
+DeviceSet::~DeviceSet()
+{
+    if ( _pObserver )
+    {
+        MTL::RemoveDeviceObserver( _pObserver );
+    }
+    for ( MTL::Device* pDevice : _devices )
+    {
+        pDevice->release();
+    }
+}
+
+MTL::Device* DeviceSet::offscreen() const
+{
+    return _selection.offscreen < 0 || _offscreenLost.load() ? nullptr : _devices[ _selection.offscreen ];
+}
+
+CrossDeviceTransfer::CrossDeviceTransfer( ResourceRegistry* pSource, ResourceRegistry* pDestination, uint32_t width, uint32_t height, uint32_t bytesPerPixel )
+: _pSourceResources( pSource )
+, _pDestinationResources( pDestination )
+, _width( width )
+, _height( height )
+, _bytesPerRow( width * bytesPerPixel )
+{
+    // No-copy buffers need page-aligned memory of a whole number of pages.
+    const size_t PageSize = size_t( getpagesize() );
+    _bytes = ( size_t( _bytesPerRow ) * height + PageSize - 1 ) / PageSize * PageSize;
+    if ( posix_memalign( &_pHostMemory, PageSize, _bytes ) != 0 )
+    {
+        __builtin_printf( "CrossDeviceTransfer: failed to allocate %zu staging bytes\n", _bytes );
+        assert( false );
+    }
+
+    _pSourceStaging = pSource->newBufferNoCopy( _pHostMemory, _bytes, MTL::ResourceStorageModeShared, ResourceCategory::Staging, "Cross-device staging (source)" );
+    _pDestinationStaging = pDestination->newBufferNoCopy( _pHostMemory, _bytes, MTL::ResourceStorageModeShared, ResourceCategory::Staging, "Cross-device staging (destination)" );
+    if ( !_pSourceStaging || !_pDestinationStaging )
+    {
+        __builtin_printf( "CrossDeviceTransfer: the Staging budget refused %zu bytes\n", _bytes );
+        assert( false );
+    }
+
+    _pSourceEvent = pSource->device()->newSharedEvent();
+    MTL::SharedEventHandle* pHandle = _pSourceEvent->newSharedEventHandle();
+    _pDestinationEvent = pDestination->device()->newSharedEvent( pHandle );
+    pHandle->release();
+}
+
+CrossDeviceTransfer::~CrossDeviceTransfer()
+{
+    // Buffers first: they point into the host memory.
+    _pDestinationResources->release( _pDestinationStaging );
+    _pSourceResources->release( _pSourceStaging );
+    _pDestinationEvent->release();
+    _pSourceEvent->release();
+    free( _pHostMemory );
+}
+
+// Transfer n (from 1) is sent at event value 2n - 1 and received at 2n.
+uint64_t CrossDeviceTransfer::encodeSend( MTL::CommandBuffer* pSourceCmd, MTL::Texture* pTexture )
+{
+    uint64_t value = ++_sends;
+    pSourceCmd->encodeWait( _pSourceEvent, 2 * value - 2 );
+
+    MTL::BlitCommandEncoder* pBlit = pSourceCmd->blitCommandEncoder();
+    pBlit->copyFromTexture( pTexture, 0, 0, MTL::Origin::Make( 0, 0, 0 ), MTL::Size::Make( _width, _height, 1 ),
+                            _pSourceStaging, 0, _bytesPerRow, size_t( _bytesPerRow ) * _height );
+    pBlit->endEncoding();
+
+    pSourceCmd->encodeSignalEvent( _pSourceEvent, 2 * value - 1 );
+    return value;
+}
+
+void CrossDeviceTransfer::encodeReceive( MTL::CommandBuffer* pDestinationCmd, uint64_t value, MTL::Texture* pTexture )
+{
+    pDestinationCmd->encodeWait( _pDestinationEvent, 2 * value - 1 );
+
+    MTL::BlitCommandEncoder* pBlit = pDestinationCmd->blitCommandEncoder();
+    pBlit->copyFromBuffer( _pDestinationStaging, 0, _bytesPerRow, size_t( _bytesPerRow ) * _height, MTL::Size::Make( _width, _height, 1 ),
+                           pTexture, 0, 0, MTL::Origin::Make( 0, 0, 0 ) );
+    pBlit->endEncoding();
+
+    pDestinationCmd->encodeSignalEvent( _pDestinationEvent, 2 * value );
+}
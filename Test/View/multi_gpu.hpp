@@ -0,0 +1,82 @@
+//
+//  multi_gpu.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef multi_gpu_hpp
+#define multi_gpu_hpp
+
+#include <Metal/Metal.hpp>
+#include <atomic>
+#include <vector>
+#include "Model/gpu_selection.hpp"
+
+class ResourceRegistry;
+
+GpuDeviceInfo describeDevice( MTL::Device* pDevice, bool systemDefault );
+
+// Every GPU in the machine, with one picked to drive the display and possibly
+// a second one for offscreen work (see selectGpus). Devices stay retained for
+// the set's lifetime; when the offscreen GPU is unplugged or asks to be,
+// offscreenLost() turns true and its work should move back to the display GPU.
+class DeviceSet
+{
+public:
+    explicit DeviceSet( GpuPreference preference );
+    ~DeviceSet();
+
+    MTL::Device* display() const { return _selection.display < 0 ? nullptr : _devices[ _selection.display ]; }
+    MTL::Device* offscreen() const;
+
+    const std::vector<GpuDeviceInfo>& infos() const { return _infos; }
+    const GpuSelection& selection() const { return _selection; }
+    bool offscreenLost() const { return _offscreenLost.load(); }
+
+private:
+    std::vector<MTL::Device*>   _devices;
+    std::vector<GpuDeviceInfo>  _infos;
+    GpuSelection                _selection;
+    NS::Object*                 _pObserver = nullptr;
+    std::atomic<uint64_t>       _offscreenId { 0 };
+    std::atomic<bool>           _offscreenLost { false };
+};
+
+// Moves 2D textures from one GPU to another. Devices can't see each other's
+// memory, so the texels go through one page-aligned host allocation wrapped
+// as a shared buffer on both; a shared event, imported on the destination
+// device through its handle, orders the two sides. The staging memory is
+// reused, so each send also waits for the previous receive to finish. Each
+// device's wrapper is counted as Staging in that device's registry.
+class CrossDeviceTransfer
+{
+public:
+    CrossDeviceTransfer( ResourceRegistry* pSource, ResourceRegistry* pDestination, uint32_t width, uint32_t height, uint32_t bytesPerPixel );
+    ~CrossDeviceTransfer();
+
+    // Copies pTexture into staging once pSourceCmd runs; returns the transfer's
+    // value for encodeReceive().
+    uint64_t encodeSend( MTL::CommandBuffer* pSourceCmd, MTL::Texture* pTexture );
+
+    // Copies staging into pTexture once transfer value's send has completed.
+    void encodeReceive( MTL::CommandBuffer* pDestinationCmd, uint64_t value, MTL::Texture* pTexture );
+
+    size_t bytes() const { return _bytes; }
+
+private:
+    ResourceRegistry*   _pSourceResources;
+    ResourceRegistry*   _pDestinationResources;
+    MTL::Buffer*        _pSourceStaging;
+    MTL::Buffer*        _pDestinationStaging;
+    MTL::SharedEvent*   _pSourceEvent;
+    MTL::SharedEvent*   _pDestinationEvent;     // the same event, as the destination device sees it
+    void*               _pHostMemory;
+    size_t              _bytes;
+    uint32_t            _width;
+    uint32_t            _height;
+    uint32_t            _bytesPerRow;
+    uint64_t            _sends = 0;
+};
+
+#endif /* multi_gpu_hpp */
@@ -0,0 +1,126 @@
+//
+//  offscreen_runner.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "offscreen_runner.hpp"
+#include "View/renderer.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+
+OffscreenRunner::OffscreenRunner( MTL::Device* pDevice, Renderer* pRenderer, const OffscreenSettings& settings )
+: _pDevice( pDevice->retain() )
+, _pRenderer( pRenderer )
+, _settings( settings )
+{
+    // Same format the window uses, so the renderer's pipelines apply unchanged.
+    // Depth comes from the renderer's FrameAttachments.
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatBGRA8Unorm_sRGB, settings.width, settings.height, false );
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget | MTL::TextureUsageShaderRead );
+    ResourceRegistry* pResources = _pRenderer->resources();
+    _pColor = pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "Offscreen color" );
+    pDesc->release();
+
+    _pRpd = MTL::RenderPassDescriptor::alloc()->init();
+    MTL::RenderPassColorAttachmentDescriptor* pColorAttachment = _pRpd->colorAttachments()->object( 0 );
+    pColorAttachment->setTexture( _pColor );
+    pColorAttachment->setLoadAction( MTL::LoadActionClear );
+    pColorAttachment->setStoreAction( MTL::StoreActionStore );
+    pColorAttachment->setClearColor( MTL::ClearColor::Make( 1.0, 1.0, 1.0, 1.0 ) );
+
+    _readbackBytesPerRow = size_t( settings.width ) * 4;
+    for ( uint32_t i = 0; i < kFramesInFlight; ++i )
+    {
+        _pReadbackBuffers[ i ] = settings.readbackInterval
+            ? pResources->newBuffer( _readbackBytesPerRow * settings.height, MTL::ResourceStorageModeShared, ResourceCategory::Readback, "Offscreen readback" )
+            : nullptr;
+    }
+}
+
+OffscreenRunner::~OffscreenRunner()
+{
+    ResourceRegistry* pResources = _pRenderer->resources();
+    for ( MTL::Buffer* pBuffer : _pReadbackBuffers )
+    {
+        pResources->release( pBuffer );
+    }
+    _pRpd->release();
+    pResources->release( _pColor );
+    _pDevice->release();
+}
+
+OffscreenReport OffscreenRunner::run()
+{
+    const uint32_t TotalFrames = _settings.warmupFrames + _settings.frames;
+    std::vector<double> completedAt( TotalFrames, 0.0 );
+    std::vector<double> gpuMs( TotalFrames, 0.0 );
+
+    MTL::CommandQueue* pQueue = _pRenderer->commandQueue();
+    for ( uint32_t frame = 0; frame < TotalFrames; ++frame )
+    {
+        TRACE_SCOPE( "OffscreenRunner frame" );
+        NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+
+        // Block only when kFramesInFlight frames are already queued.
+        _inFlight.acquire();
+
+        MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+        _pRenderer->encodeFrame( pCmd, _pRpd );
+
+        MTL::Buffer* pReadback = nullptr;
+        if ( _settings.readbackInterval && frame % _settings.readbackInterval == 0 )
+        {
+            pReadback = _pReadbackBuffers[ frame % kFramesInFlight ];
+            MTL::BlitCommandEncoder* pBlit = pCmd->blitCommandEncoder();
+            pBlit->copyFromTexture( _pColor, 0, 0, MTL::Origin::Make( 0, 0, 0 ), MTL::Size::Make( _settings.width, _settings.height, 1 ),
+                                    pReadback, 0, _readbackBytesPerRow, _readbackBytesPerRow * _settings.height );
+            pBlit->endEncoding();
+        }
+
+        // Each handler writes its own slot; the vectors are read after the last frame completes.
+        double* pCompletedAt = &completedAt[ frame ];
+        double* pGpuMs = &gpuMs[ frame ];
+        pCmd->addCompletedHandler( [this, frame, pReadback, pCompletedAt, pGpuMs]( MTL::CommandBuffer* pDone )
+        {
+            *pCompletedAt = double( TraceRecorder::nowNs() ) * 1e-6;
+            *pGpuMs = ( pDone->GPUEndTime() - pDone->GPUStartTime() ) * 1e3;
+            if ( pReadback && _readback )
+            {
+                _readback( frame, static_cast<const uint8_t*>( pReadback->contents() ),
+                           _settings.width, _settings.height, _readbackBytesPerRow );
+            }
+            _inFlight.release();
+        } );
+        pCmd->commit();
+        pPool->release();
+    }
+
+    // Every completed handler returns its slot, so holding all of them means every
+    // frame has finished and been recorded.
+    for ( uint32_t i = 0; i < kFramesInFlight; ++i )
+    {
+        _inFlight.acquire();
+    }
+    for ( uint32_t i = 0; i < kFramesInFlight; ++i )
+    {
+        _inFlight.release();
+    }
+
+    // Frame time is the spacing between completions, which is what an uncapped
+    // loop is bound by; the first measured frame is timed from the last warmup one.
+    std::vector<double> frameMs, measuredGpuMs;
+    for ( uint32_t frame = std::max( _settings.warmupFrames, 1u ); frame < TotalFrames; ++frame )
+    {
+        frameMs.push_back( completedAt[ frame ] - completedAt[ frame - 1 ] );
+        measuredGpuMs.push_back( gpuMs[ frame ] );
+    }
+
+    OffscreenReport report;
+    report.frameTimes = summarizeFrameTimes( frameMs );
+    report.gpuTimes = summarizeFrameTimes( measuredGpuMs );
+    return report;
+}
@@ -0,0 +1,70 @@
+//
+//  offscreen_runner.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef offscreen_runner_hpp
+#define offscreen_runner_hpp
+
+#include <Metal/Metal.hpp>
+#include <functional>
+#include <semaphore>
+#include <vector>
+#include "Model/frame_stats.hpp"
+
+class Renderer;
+
+struct OffscreenSettings
+{
+    uint32_t width            = 1920;
+    uint32_t height           = 1080;
+    uint32_t frames           = 1000;
+    uint32_t warmupFrames     = 30;     // rendered but left out of the report
+    uint32_t readbackInterval = 0;      // copy the color target back every N frames, 0 disables
+};
+
+struct OffscreenReport
+{
+    FrameTimeStats frameTimes;      // completion to completion, i.e. throughput
+    FrameTimeStats gpuTimes;        // GPUStartTime to GPUEndTime per command buffer
+};
+
+// Renders frames into its own color texture with no window, no
+// drawable and no vsync, keeping up to kFramesInFlight frames queued so the
+// GPU never idles. Use it to measure throughput without the compositor.
+class OffscreenRunner
+{
+public:
+    // Called on a Metal completion thread with the BGRA8 pixels of a read back frame.
+    using ReadbackFunction = std::function<void( uint64_t frame, const uint8_t* pPixels,
+                                                 uint32_t width, uint32_t height, size_t bytesPerRow )>;
+
+    OffscreenRunner( MTL::Device* pDevice, Renderer* pRenderer, const OffscreenSettings& settings );
+    ~OffscreenRunner();
+
+    void setReadbackFunction( const ReadbackFunction& function ) { _readback = function; }
+
+    // Runs warmup plus settings.frames frames and blocks until the GPU has finished them.
+    OffscreenReport run();
+
+    MTL::Texture* colorTexture() const { return _pColor; }
+
+private:
+    static constexpr uint32_t kFramesInFlight = 3;
+
+    MTL::Device*                        _pDevice;
+    Renderer*                           _pRenderer;
+    OffscreenSettings                   _settings;
+
+    MTL::Texture*                       _pColor;
+    MTL::RenderPassDescriptor*          _pRpd;
+    MTL::Buffer*                        _pReadbackBuffers[ kFramesInFlight ];
+    size_t                              _readbackBytesPerRow;
+    ReadbackFunction                    _readback;
+
+    std::counting_semaphore<kFramesInFlight>   _inFlight { kFramesInFlight };
+};
+
+#endif /* offscreen_runner_hpp */
@@ -6,56 +6,82 @@
 //
 
 #include "renderer.hpp"
+#include "Core/trace_recorder.hpp"
+#include "Model/simd_math.hpp"
 
 Renderer::Renderer( MTL::Device* pDevice )
 : _pDevice( pDevice->retain() )
 {
+    _pResources = new ResourceRegistry( _pDevice );
+    _pAttachments = new FrameAttachments( _pDevice, _pResources );
     _pCommandQueue = _pDevice->newCommandQueue();
+    _pFrameTimeline = new SharedEventTimeline( _pDevice, "Frame timeline" );
+    _pUploadArena = new UploadArena( _pResources, 64 * 1024 );
+    _pProfiler = new GpuProfiler( _pDevice, _pResources );
     buildBuffers();
     buildShaders();
 }
 
 Renderer::~Renderer()
 {
+    // Completion handlers still queued refer back to the renderer.
+    {
+        std::unique_lock<std::mutex> lock( _frameMutex );
+        _frameCondition.wait( lock, [this] { return _framesInFlight == 0; } );
+    }
+    delete _pCapture;
+    delete _pShaderReloader;
+    delete _pAsyncCompute;
+    delete _pShadows;
+    delete _pJobs;
+    delete _pDynamicResolution;
+    delete _pUploadArena;
+    delete _pFrameTimeline;
+    delete _pAttachments;
+    delete _pProfiler;
+    _pResources->release( _pVertexPositionsBuffer );
+    _pResources->release( _pIndexBuffer );
+    delete _pResources;
     _pCommandQueue->release();
     _pDevice->release();
-    _pVertexPositionsBuffer->release();
-    _pVertexColorsBuffer->release();
     _pPSO->release();
 }
 
 void Renderer::buildBuffers() {
+    TRACE_SCOPE( "Renderer::buildBuffers" );
+
     const size_t NumVertices = 3;
     const size_t NumIndices  = 3;
     
     numVertices = NumVertices;
     numIndices = NumIndices;
     
-    vertices = new simd::float3[NumVertices] {
+    const math::float3 Vertices[NumVertices] = {
         {   0,  0.3, 0},
         { 0.3, -0.3, 0},
         {-0.3, -0.3, 0}
         
     };
     
-    indices = new UInt32[NumIndices] {
+    const UInt32 Indices[NumIndices] = {
         0, 1, 2
     };
     
-    const size_t SizeOfVertexPositionsBuffer = sizeof(simd::float3) * NumVertices;
+    const size_t SizeOfVertexPositionsBuffer = sizeof(math::float3) * NumVertices;
     const size_t SizeOfIndexBuffer = sizeof(UInt32) * NumIndices;
     
-    _pVertexPositionsBuffer = _pDevice->newBuffer(SizeOfVertexPositionsBuffer, MTL::ResourceStorageModeManaged);
-    _pIndexBuffer = _pDevice->newBuffer(SizeOfIndexBuffer, MTL::ResourceStorageModeManaged);
+    _pVertexPositionsBuffer = _pResources->newBuffer(SizeOfVertexPositionsBuffer, MTL::ResourceStorageModeManaged, ResourceCategory::Geometry, "Triangle positions");
+    _pIndexBuffer = _pResources->newBuffer(SizeOfIndexBuffer, MTL::ResourceStorageModeManaged, ResourceCategory::Geometry, "Triangle indices");
     
-    memcpy(_pVertexPositionsBuffer->contents(), vertices, SizeOfVertexPositionsBuffer);
-    memcpy(_pIndexBuffer->contents(), indices, SizeOfIndexBuffer);
+    memcpy(_pVertexPositionsBuffer->contents(), Vertices, SizeOfVertexPositionsBuffer);
+    memcpy(_pIndexBuffer->contents(), Indices, SizeOfIndexBuffer);
     
     _pVertexPositionsBuffer->didModifyRange(NS::Range::Make(0, _pVertexPositionsBuffer->length()));
     _pIndexBuffer->didModifyRange(NS::Range::Make(0, _pIndexBuffer->length()));
 }
 
 void Renderer::buildShaders() {
+    TRACE_SCOPE( "Renderer::buildShaders" );
     using NS::StringEncoding::UTF8StringEncoding;
 
     NS::Error* pError = nullptr;
@@ -74,6 +100,7 @@ void Renderer::buildShaders() {
     pDesc->setFragmentFunction( pFragFn );
     pDesc->colorAttachments()->object(0)->setPixelFormat( MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB );
     pDesc->setDepthAttachmentPixelFormat(MTL::PixelFormatDepth32Float);
+    pDesc->setRasterSampleCount( _pAttachments->sampleCount() );
 
     _pPSO = _pDevice->newRenderPipelineState( pDesc, &pError );
     if ( !_pPSO )
@@ -81,6 +108,14 @@ void Renderer::buildShaders() {
         __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
         assert( false );
     }
+    if ( _pShaderReloader )
+    {
+        if ( _pReloadablePSO )
+        {
+            _pShaderReloader->remove( _pReloadablePSO );
+        }
+        _pReloadablePSO = _pShaderReloader->addRenderPipeline( pDesc, _pPSO );
+    }
 
     pVertexFn->release();
     pFragFn->release();
@@ -90,21 +125,300 @@ void Renderer::buildShaders() {
 
 void Renderer::draw( MTK::View* pView )
 {
+    TRACE_SCOPE( "Renderer::draw" );
     NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
     
+    waitForFrameSlot();
+
+    MTL::RenderPassDescriptor* pRpd = nullptr;
+    CA::MetalDrawable* pDrawable = nullptr;
+    {
+        TRACE_SCOPE( "MTK::View::currentDrawable" );
+        pRpd = pView->currentRenderPassDescriptor();
+        pDrawable = pView->currentDrawable();
+    }
+
+    const uint64_t CpuStart = TraceRecorder::nowNs();
+    if ( _pCapture )
+    {
+        _pCapture->beginFrame();
+    }
     MTL::CommandBuffer* pCmd = _pCommandQueue->commandBuffer();
-    MTL::RenderPassDescriptor* pRpd = pView->currentRenderPassDescriptor();
-    MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( pRpd );
+    encodeFrame( pCmd, pRpd );
     
-    pEnc->setRenderPipelineState(_pPSO);
+    const float ResolutionScale = _pDynamicResolution ? _pDynamicResolution->frameScale() : 1.0f;
+    pCmd->addCompletedHandler( [this, ResolutionScale]( MTL::CommandBuffer* pDone )
+    {
+        frameCompleted( ( pDone->GPUEndTime() - pDone->GPUStartTime() ) * 1e3, ResolutionScale );
+    } );
+    pDrawable->addPresentedHandler( [this]( MTL::Drawable* pPresented )
+    {
+        framePresented( pPresented->presentedTime() );
+    } );
+
+    // Keep every frame on screen for the whole pacing interval, so frame times
+    // do not alternate between one and two refreshes.
+    pCmd->presentDrawableAfterMinimumDuration( pDrawable, _pacer.targetIntervalSeconds() );
+    pCmd->commit();
+    if ( _pCapture )
+    {
+        _pCapture->endFrame();
+    }
+    _pacer.addCpuFrame( double( TraceRecorder::nowNs() - CpuStart ) * 1e-6 );
+
+    if ( _pacer.targetFps() != _appliedFps )
+    {
+        _appliedFps = _pacer.targetFps();
+        pView->setPreferredFramesPerSecond( NS::Integer( _appliedFps ) );
+    }
+
+    pPool->release();
+}
+
+void Renderer::waitForFrameSlot()
+{
+    TRACE_SCOPE( "Renderer::waitForFrameSlot" );
+    std::vector<CompletedFrame> completed;
+    std::vector<double> presentedTimes;
+    {
+        // Fewer frames queued means input is sampled closer to when it is shown.
+        std::unique_lock<std::mutex> lock( _frameMutex );
+        _frameCondition.wait( lock, [this] { return _framesInFlight < _pacer.maxFramesInFlight(); } );
+        ++_framesInFlight;
+        completed.swap( _completedFrames );
+        presentedTimes.swap( _presentedTimes );
+    }
+
+    for ( const CompletedFrame& frame : completed )
+    {
+        _pacer.addGpuFrame( frame.gpuMs );
+        if ( _pDynamicResolution )
+        {
+            _pDynamicResolution->controller().addGpuFrame( frame.gpuMs, frame.resolutionScale );
+        }
+    }
+    if ( _pDynamicResolution )
+    {
+        // The controller keeps more headroom than the pacer, so resolution gives
+        // way first and the rate only drops once the minimum scale does not fit.
+        _pDynamicResolution->controller().setTargetMs( _pacer.targetIntervalSeconds() * 1e3 );
+    }
+    for ( double time : presentedTimes )
+    {
+        // A presentedTime of 0 means the drawable was dropped, not shown.
+        if ( time > 0.0 && _lastPresentedTime > 0.0 )
+        {
+            _pacer.addPresentInterval( ( time - _lastPresentedTime ) * 1e3 );
+            if ( _pCapture )
+            {
+                _pCapture->addFrameTime( ( time - _lastPresentedTime ) * 1e3 );
+            }
+        }
+        _lastPresentedTime = time > 0.0 ? time : _lastPresentedTime;
+    }
+}
+
+void Renderer::frameCompleted( double gpuMs, float resolutionScale )
+{
+    {
+        std::lock_guard<std::mutex> lock( _frameMutex );
+        --_framesInFlight;
+        _completedFrames.push_back( { gpuMs, resolutionScale } );
+    }
+    _frameCondition.notify_all();
+}
+
+void Renderer::framePresented( double presentedTime )
+{
+    std::lock_guard<std::mutex> lock( _frameMutex );
+    _presentedTimes.push_back( presentedTime );
+}
+
+// Everything but presentation, so the same frame can target a view or offscreen textures.
+void Renderer::encodeFrame( MTL::CommandBuffer* pCmd, MTL::RenderPassDescriptor* pRpd )
+{
+    TRACE_SCOPE( "Renderer::encodeFrame" );
+    _pProfiler->beginFrame();
+    if ( _pShaderReloader )
+    {
+        _pShaderReloader->applyPending();
+    }
+
+    // The value reserved at the end of this function is the one this frame signals.
+    _pUploadArena->begin( _pFrameTimeline->lastReserved() + 1, *_pFrameTimeline );
+    if ( _pSceneGraph )
+    {
+        _pSceneGraph->update( *_pJobs );
+    }
+    UploadArena::Allocation instanceMatrices = {};
+    if ( _pDrawList && !_pDrawList->packets.empty() )
+    {
+        // Gathered in packet order, so each run's instances are contiguous.
+        // update() has sorted the graph, so world() only reads here.
+        const std::vector<DrawPacket>& Packets = _pDrawList->packets;
+        instanceMatrices = _pUploadArena->allocate( Packets.size() * sizeof( math::float4x4 ) );
+        math::float4x4* pMatrices = static_cast<math::float4x4*>( instanceMatrices.pContents );
+        _pJobs->parallelFor( Packets.size(), 4096, [&]( size_t begin, size_t end )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                uint32_t transform = Packets[ i ].transform;
+                pMatrices[ i ] = _pSceneGraph ? _pSceneGraph->world( transform ) : _pDrawList->transforms[ transform ];
+            }
+        } );
+    }
+    else
+    {
+        // The built-in triangle is a single untransformed instance.
+        instanceMatrices = _pUploadArena->allocate( sizeof( math::float4x4 ) );
+        *static_cast<math::float4x4*>( instanceMatrices.pContents ) = math::identity4x4();
+    }
+
+    uint64_t computeValue = 0;
+    if ( !_computeWork.empty() )
+    {
+        MTL::CommandBuffer* pComputeCmd = _pAsyncCompute ? _pAsyncCompute->begin() : pCmd;
+        for ( const ComputeWork& work : _computeWork )
+        {
+            work( pComputeCmd );
+        }
+        computeValue = _pAsyncCompute ? _pAsyncCompute->commit( pComputeCmd ) : 0;
+    }
+
+    if ( _pShadows )
+    {
+        _pShadows->encode( pCmd, _shadowCamera, *_pJobs );
+    }
+
+    // Shadows don't read the compute results, so only the passes after them wait.
+    if ( computeValue )
+    {
+        _pAsyncCompute->waitInGraphics( pCmd, computeValue );
+    }
+
+    // With dynamic resolution the scene goes to a scaled internal target, and
+    // pRpd only receives the upscale.
+    MTL::RenderPassDescriptor* pSceneRpd = _pDynamicResolution ? _pDynamicResolution->beginFrame( pRpd ) : pRpd;
+    _pAttachments->attach( pSceneRpd );
+    _pProfiler->addRenderPass( pSceneRpd, "Main" );
+    MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( pSceneRpd );
+    if ( _pDynamicResolution )
+    {
+        _pDynamicResolution->setViewport( pEnc );
+    }
+    
+    pEnc->setRenderPipelineState( _pReloadablePSO ? _pReloadablePSO->renderState() : _pPSO );
     pEnc->setVertexBuffer(_pVertexPositionsBuffer, 0, 0);
+    pEnc->setVertexBuffer( instanceMatrices.pBuffer, instanceMatrices.offset, kInstanceMatricesIndex );
     
-    pEnc->drawIndexedPrimitives(MTL::PrimitiveTypeTriangle, numIndices, MTL::IndexTypeUInt32, _pIndexBuffer, 0);
+    if ( _pDrawList && !_pDrawList->packets.empty() )
+    {
+        const std::vector<DrawPacket>& Packets = _pDrawList->packets;
+        size_t first = 0;
+        while ( first < Packets.size() )
+        {
+            size_t end = first + 1;
+            while ( end < Packets.size() && Packets[ end ].sortKey == Packets[ first ].sortKey )
+            {
+                ++end;
+            }
+            pEnc->drawIndexedPrimitives( MTL::PrimitiveTypeTriangle, numIndices, MTL::IndexTypeUInt32, _pIndexBuffer, 0, end - first, 0, first );
+            first = end;
+        }
+    }
+    else
+    {
+        pEnc->drawIndexedPrimitives(MTL::PrimitiveTypeTriangle, numIndices, MTL::IndexTypeUInt32, _pIndexBuffer, 0);
+    }
     
     pEnc->endEncoding();
-    
-    pCmd->presentDrawable( pView->currentDrawable() );
-    pCmd->commit();
 
-    pPool->release();
+    if ( _pDynamicResolution )
+    {
+        _pProfiler->addRenderPass( _pDynamicResolution->upscaleRenderPass(), "Upscale" );
+        _pDynamicResolution->encodeUpscale( pCmd );
+    }
+    _pProfiler->endFrame( pCmd );
+
+    _frameValue = _pFrameTimeline->reserve();
+    _pFrameTimeline->encodeSignal( pCmd, _frameValue );
+    if ( _pAsyncCompute )
+    {
+        _pAsyncCompute->trackGraphics( pCmd );
+    }
+}
+
+void Renderer::setSampleCount( NS::UInteger sampleCount )
+{
+    _pAttachments->setSampleCount( sampleCount );
+    _pPSO->release();
+    buildShaders();
+}
+
+void Renderer::enableDynamicResolution( bool useRateMap )
+{
+    if ( !_pDynamicResolution )
+    {
+        _pDynamicResolution = new DynamicResolution( _pDevice, _pResources );
+    }
+    if ( useRateMap && !_pDynamicResolution->setRateMapEnabled( true ) )
+    {
+        __builtin_printf( "Rasterization rate maps are not supported on %s\n", _pDevice->name()->utf8String() );
+    }
+}
+
+void Renderer::enableShadows( const CascadeSettings& settings )
+{
+    if ( !_pShadows )
+    {
+        if ( !_pJobs )
+        {
+            _pJobs = new JobSystem();
+        }
+        _pShadows = new CascadedShadowRenderer( _pDevice, _pResources, settings );
+    }
+}
+
+void Renderer::enableAsyncCompute()
+{
+    if ( !_pAsyncCompute )
+    {
+        _pAsyncCompute = new AsyncCompute( _pDevice );
+    }
+}
+
+void Renderer::enableShaderHotReload( const char* sourcePath )
+{
+    if ( !_pShaderReloader )
+    {
+        _pShaderReloader = new ShaderReloader( _pDevice, sourcePath );
+        _pPSO->release();
+        buildShaders();
+    }
+}
+
+void Renderer::enableGpuCapture( const char* directory, const CaptureTriggerSettings& settings )
+{
+    if ( !_pCapture )
+    {
+        _pCapture = new GpuCapture( _pCommandQueue, directory, settings );
+    }
+}
+
+void Renderer::setSceneGraph( SceneGraph* pSceneGraph )
+{
+    if ( !_pJobs )
+    {
+        _pJobs = new JobSystem();
+    }
+    _pSceneGraph = pSceneGraph;
+}
+
+void Renderer::setDrawList( const DrawList* pDrawList )
+{
+    if ( !_pJobs )
+    {
+        _pJobs = new JobSystem();
+    }
+    _pDrawList = pDrawList;
 }
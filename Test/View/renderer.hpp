@@ -11,7 +11,24 @@
 #include <Metal/Metal.hpp>
 #include <AppKit/AppKit.hpp>
 #include <MetalKit/MetalKit.hpp>
-#include <simd/simd.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "View/gpu_profiler.hpp"
+#include "View/resource_registry.hpp"
+#include "View/dynamic_resolution.hpp"
+#include "View/frame_attachments.hpp"
+#include "View/cascaded_shadow_renderer.hpp"
+#include "View/shared_event_timeline.hpp"
+#include "View/async_compute.hpp"
+#include "View/shader_reloader.hpp"
+#include "View/gpu_capture.hpp"
+#include "View/upload_arena.hpp"
+#include "Core/job_system.hpp"
+#include "Model/frame_pacer.hpp"
+#include "Model/scene_graph.hpp"
+#include "Model/render_extraction.hpp"
 
 class Renderer
 {
@@ -19,23 +36,120 @@ public:
     Renderer( MTL::Device* pDevice );
     ~Renderer();
     void draw( MTK::View* pView );
+    void encodeFrame( MTL::CommandBuffer* pCmd, MTL::RenderPassDescriptor* pRpd );
     void buildBuffers();
     void buildShaders();
+
+    MTL::CommandQueue* commandQueue() const { return _pCommandQueue; }
+    GpuProfiler* gpuProfiler() const { return _pProfiler; }
+    ResourceRegistry* resources() const { return _pResources; }
+    FrameAttachments* attachments() const { return _pAttachments; }
+
+    // MSAA sample count for the scene pass; rebuilds the pipelines.
+    void setSampleCount( NS::UInteger sampleCount );
+    FramePacer& framePacer() { return _pacer; }
+
+    // Every frame encoded by encodeFrame() signals the next value on this
+    // timeline when its GPU work is done, so other queues and CPU jobs can wait
+    // for or be notified of a specific frame.
+    SharedEventTimeline* frameTimeline() const { return _pFrameTimeline; }
+    uint64_t lastFrameValue() const { return _frameValue; }
+
+    // Per-frame CPU-written data; begun at the start of every encodeFrame(), so
+    // allocations made while encoding a frame live until it has finished.
+    UploadArena* uploadArena() const { return _pUploadArena; }
+
+    // Updates the graph at the start of every frame. While one is set, the draw
+    // list's DrawPacket::transform is a node handle and each instance gets that
+    // node's world matrix instead of an entry of DrawList::transforms. nullptr
+    // to stop; the graph must outlive its use here.
+    void setSceneGraph( SceneGraph* pSceneGraph );
+
+    // Draws the list's packets every frame in place of the built-in triangle,
+    // one instanced draw per run of packets sharing a material and mesh, with
+    // their transforms uploaded in packet order at kInstanceMatricesIndex, where
+    // vertexMain reads them by instance. There is only the one mesh and pipeline
+    // so far, so every run draws the triangle. nullptr to stop; the list must
+    // outlive its use here.
+    static constexpr NS::UInteger kInstanceMatricesIndex = 2;
+    void setDrawList( const DrawList* pDrawList );
+
+    // Renders the scene at a GPU-time driven scale and upscales it into the
+    // pass encodeFrame() is given. Off by default; nullptr while off.
+    void enableDynamicResolution( bool useRateMap );
+    DynamicResolution* dynamicResolution() const { return _pDynamicResolution; }
+
+    // Cascaded shadow maps, drawn ahead of the main pass once casters are set.
+    // Off by default; nullptr while off.
+    void enableShadows( const CascadeSettings& settings = CascadeSettings() );
+    CascadedShadowRenderer* shadows() const { return _pShadows; }
+    void setShadowCamera( const ShadowCamera& camera ) { _shadowCamera = camera; }
+
+    // Compute work run every frame ahead of the main pass, such as culling or
+    // particle updates. With async compute it goes to the second queue and
+    // overlaps with the shadow pass; otherwise it is encoded inline.
+    using ComputeWork = std::function<void( MTL::CommandBuffer* pCmd )>;
+    void addComputeWork( const ComputeWork& work ) { _computeWork.push_back( work ); }
+    void enableAsyncCompute();
+    AsyncCompute* asyncCompute() const { return _pAsyncCompute; }
+
+    // Rebuilds the scene pipeline from sourcePath whenever it is saved, swapping
+    // it in at the start of the next frame. Off by default; nullptr while off.
+    void enableShaderHotReload( const char* sourcePath );
+    ShaderReloader* shaderReloader() const { return _pShaderReloader; }
+
+    // Captures the frame after a present interval spike, or after a request,
+    // to .gputrace files in directory. Off by default; nullptr while off.
+    void enableGpuCapture( const char* directory, const CaptureTriggerSettings& settings = CaptureTriggerSettings() );
+    GpuCapture* gpuCapture() const { return _pCapture; }
     
 private:
+    void waitForFrameSlot();
+    void frameCompleted( double gpuMs, float resolutionScale );
+    void framePresented( double presentedTime );
+
     MTL::Device*                    _pDevice;
     MTL::CommandQueue*              _pCommandQueue;
     MTL::RenderPipelineState*       _pPSO;
+    GpuProfiler*                    _pProfiler;
+    ResourceRegistry*               _pResources;
+    DynamicResolution*              _pDynamicResolution = nullptr;
+    FrameAttachments*               _pAttachments;
+    SharedEventTimeline*            _pFrameTimeline;
+    uint64_t                        _frameValue = 0;
+    CascadedShadowRenderer*         _pShadows = nullptr;
+    JobSystem*                      _pJobs = nullptr;
+    AsyncCompute*                   _pAsyncCompute = nullptr;
+    std::vector<ComputeWork>        _computeWork;
+    ShaderReloader*                 _pShaderReloader = nullptr;
+    ReloadablePipeline*             _pReloadablePSO = nullptr;
+    GpuCapture*                     _pCapture = nullptr;
+    UploadArena*                    _pUploadArena;
+    SceneGraph*                     _pSceneGraph = nullptr;
+    const DrawList*                 _pDrawList = nullptr;
+    ShadowCamera                    _shadowCamera = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f }, 0.4142f, 1.0f, 0.1f };
     
     MTL::Buffer*                    _pVertexPositionsBuffer;
-    MTL::Buffer*                    _pVertexColorsBuffer;
     MTL::Buffer*                    _pIndexBuffer;
     
-    simd::float3*                   vertices    = nullptr;
-    UInt32*                         indices     = nullptr;
-    
     size_t                          numVertices = 0;
     size_t                          numIndices  = 0;
+
+    // Frame pacing. Completion and presentation handlers only queue their
+    // timings; the pacer itself is touched on the draw thread.
+    FramePacer                      _pacer;
+    uint32_t                        _appliedFps = 0;
+    std::mutex                      _frameMutex;
+    std::condition_variable         _frameCondition;
+    uint32_t                        _framesInFlight = 0;
+    struct CompletedFrame
+    {
+        double gpuMs;
+        float  resolutionScale;
+    };
+    std::vector<CompletedFrame>     _completedFrames;
+    std::vector<double>             _presentedTimes;
+    double                          _lastPresentedTime = 0.0;
 };
 
 #endif /* renderer_hpp */
@@ -0,0 +1,184 @@
+//
+//  resource_registry.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "resource_registry.hpp"
+
+ResourceRegistry::ResourceRegistry( MTL::Device* pDevice )
+: _pDevice( pDevice->retain() )
+{
+}
+
+ResourceRegistry::~ResourceRegistry()
+{
+    if ( !_ids.empty() )
+    {
+        __builtin_printf( "ResourceRegistry: %zu allocations still alive at shutdown\n", _ids.size() );
+        _tracker.dump();
+    }
+    _pDevice->release();
+}
+
+void ResourceRegistry::commit( NS::Object* pObject, ResourceTracker::AllocationId id, size_t bytes )
+{
+    if ( !pObject )
+    {
+        _tracker.remove( id );
+        return;
+    }
+
+    _tracker.commit( id, bytes );
+    std::lock_guard<std::mutex> lock( _mutex );
+    _ids[ pObject ] = id;
+}
+
+MTL::Buffer* ResourceRegistry::newBuffer( size_t length, MTL::ResourceOptions options, ResourceCategory category, const char* label )
+{
+    return newBuffer( nullptr, length, options, category, label );
+}
+
+MTL::Buffer* ResourceRegistry::newBuffer( const void* pData, size_t length, MTL::ResourceOptions options, ResourceCategory category, const char* label )
+{
+    ResourceTracker::AllocationId id = _tracker.reserve( category, _pDevice->heapBufferSizeAndAlign( length, options ).size, label );
+    if ( id == ResourceTracker::kNoAllocation )
+    {
+        __builtin_printf( "ResourceRegistry: %s budget cannot fit buffer \"%s\" (%zu bytes)\n", resourceCategoryName( category ), label, length );
+        return nullptr;
+    }
+
+    MTL::Buffer* pBuffer = pData ? _pDevice->newBuffer( pData, length, options ) : _pDevice->newBuffer( length, options );
+    if ( pBuffer )
+    {
+        pBuffer->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+    }
+    commit( pBuffer, id, pBuffer ? pBuffer->allocatedSize() : 0 );
+    return pBuffer;
+}
+
+MTL::Buffer* ResourceRegistry::newBufferNoCopy( void* pHostMemory, size_t length, MTL::ResourceOptions options, ResourceCategory category, const char* label )
+{
+    ResourceTracker::AllocationId id = _tracker.reserve( category, length, label );
+    if ( id == ResourceTracker::kNoAllocation )
+    {
+        __builtin_printf( "ResourceRegistry: %s budget cannot fit buffer \"%s\" (%zu bytes)\n", resourceCategoryName( category ), label, length );
+        return nullptr;
+    }
+
+    MTL::Buffer* pBuffer = _pDevice->newBuffer( pHostMemory, length, options, nullptr );
+    if ( pBuffer )
+    {
+        pBuffer->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+    }
+    commit( pBuffer, id, pBuffer ? length : 0 );
+    return pBuffer;
+}
+
+MTL::Texture* ResourceRegistry::newTexture( const MTL::TextureDescriptor* pDesc, ResourceCategory category, const char* label )
+{
+    // Memoryless textures take no memory, so they skip the budget.
+    bool memoryless = pDesc->storageMode() == MTL::StorageModeMemoryless;
+    ResourceTracker::AllocationId id = _tracker.reserve( category, memoryless ? 0 : _pDevice->heapTextureSizeAndAlign( pDesc ).size, label );
+    if ( id == ResourceTracker::kNoAllocation )
+    {
+        __builtin_printf( "ResourceRegistry: %s budget cannot fit texture \"%s\"\n", resourceCategoryName( category ), label );
+        return nullptr;
+    }
+
+    MTL::Texture* pTexture = _pDevice->newTexture( pDesc );
+    if ( pTexture )
+    {
+        pTexture->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+    }
+    commit( pTexture, id, pTexture && !memoryless ? pTexture->allocatedSize() : 0 );
+    return pTexture;
+}
+
+MTL::Heap* ResourceRegistry::newHeap( const MTL::HeapDescriptor* pDesc, ResourceCategory category, const char* label )
+{
+    ResourceTracker::AllocationId id = _tracker.reserve( category, pDesc->size(), label );
+    if ( id == ResourceTracker::kNoAllocation )
+    {
+        __builtin_printf( "ResourceRegistry: %s budget cannot fit heap \"%s\" (%zu bytes)\n", resourceCategoryName( category ), label, size_t( pDesc->size() ) );
+        return nullptr;
+    }
+
+    MTL::Heap* pHeap = _pDevice->newHeap( pDesc );
+    if ( pHeap )
+    {
+        pHeap->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+    }
+    commit( pHeap, id, pHeap ? pHeap->size() : 0 );
+    return pHeap;
+}
+
+MTL::AccelerationStructure* ResourceRegistry::newAccelerationStructure( size_t size, ResourceCategory category, const char* label )
+{
+    ResourceTracker::AllocationId id = _tracker.reserve( category, size, label );
+    if ( id == ResourceTracker::kNoAllocation )
+    {
+        __builtin_printf( "ResourceRegistry: %s budget cannot fit acceleration structure \"%s\" (%zu bytes)\n", resourceCategoryName( category ), label, size );
+        return nullptr;
+    }
+
+    MTL::AccelerationStructure* pStructure = _pDevice->newAccelerationStructure( size );
+    if ( pStructure )
+    {
+        pStructure->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+    }
+    commit( pStructure, id, pStructure ? pStructure->allocatedSize() : 0 );
+    return pStructure;
+}
+
+MTL::CounterSampleBuffer* ResourceRegistry::newCounterSampleBuffer( const MTL::CounterSampleBufferDescriptor* pDesc, ResourceCategory category, const char* label, NS::Error** pError )
+{
+    const size_t Bytes = size_t( pDesc->sampleCount() ) * sizeof( MTL::CounterResultTimestamp );
+    ResourceTracker::AllocationId id = _tracker.reserve( category, Bytes, label );
+    if ( id == ResourceTracker::kNoAllocation )
+    {
+        __builtin_printf( "ResourceRegistry: %s budget cannot fit counter sample buffer \"%s\" (%zu bytes)\n", resourceCategoryName( category ), label, Bytes );
+        return nullptr;
+    }
+
+    // The label is only settable on the descriptor.
+    MTL::CounterSampleBufferDescriptor* pLabeled = pDesc->copy();
+    pLabeled->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+    MTL::CounterSampleBuffer* pSamples = _pDevice->newCounterSampleBuffer( pLabeled, pError );
+    pLabeled->release();
+    commit( pSamples, id, pSamples ? Bytes : 0 );
+    return pSamples;
+}
+
+void ResourceRegistry::release( NS::Object* pObject )
+{
+    if ( !pObject )
+    {
+        return;
+    }
+
+    ResourceTracker::AllocationId id = 0;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        auto it = _ids.find( pObject );
+        if ( it == _ids.end() )
+        {
+            __builtin_printf( "ResourceRegistry: releasing an object it did not create\n" );
+            assert( false );
+            return;
+        }
+        id = it->second;
+        _ids.erase( it );
+    }
+    _tracker.remove( id );
+    pObject->release();
+}
+
+void ResourceRegistry::dump() const
+{
+    _tracker.dump();
+    __builtin_printf( "Device currentAllocatedSize: %.2f MB (recommended working set %.2f MB)\n",
+                      double( _pDevice->currentAllocatedSize() ) / ( 1024.0 * 1024.0 ),
+                      double( _pDevice->recommendedMaxWorkingSetSize() ) / ( 1024.0 * 1024.0 ) );
+}
@@ -0,0 +1,62 @@
+//
+//  resource_registry.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef resource_registry_hpp
+#define resource_registry_hpp
+
+#include <Metal/Metal.hpp>
+#include <mutex>
+#include <unordered_map>
+#include "Model/resource_tracker.hpp"
+
+// Creates buffers, textures, heaps and acceleration structures on behalf of the rest of the renderer and
+// records each one's allocatedSize() in a ResourceTracker.
+//
+// Allocations in a category with a budget first ask the tracker for room, which
+// may run that category's eviction function; if the budget still cannot fit the
+// allocation, nullptr is returned. Objects created here must be released with
+// release(), never directly, or the accounting drifts.
+class ResourceRegistry
+{
+public:
+    explicit ResourceRegistry( MTL::Device* pDevice );
+
+    // Lists anything still alive; each entry is a leak in the owner.
+    ~ResourceRegistry();
+
+    MTL::Buffer* newBuffer( size_t length, MTL::ResourceOptions options, ResourceCategory category, const char* label );
+    MTL::Buffer* newBuffer( const void* pData, size_t length, MTL::ResourceOptions options, ResourceCategory category, const char* label );
+    // Wraps page-aligned host memory the caller owns and frees after releasing
+    // the buffer; counted at its length.
+    MTL::Buffer* newBufferNoCopy( void* pHostMemory, size_t length, MTL::ResourceOptions options, ResourceCategory category, const char* label );
+    MTL::Texture* newTexture( const MTL::TextureDescriptor* pDesc, ResourceCategory category, const char* label );
+    MTL::Heap* newHeap( const MTL::HeapDescriptor* pDesc, ResourceCategory category, const char* label );
+    MTL::AccelerationStructure* newAccelerationStructure( size_t size, ResourceCategory category, const char* label );
+
+    // Sample buffers report no size, so they are counted at one timestamp per sample.
+    MTL::CounterSampleBuffer* newCounterSampleBuffer( const MTL::CounterSampleBufferDescriptor* pDesc, ResourceCategory category, const char* label, NS::Error** pError );
+
+    void release( NS::Object* pObject );
+
+    MTL::Device* device() const { return _pDevice; }
+    ResourceTracker& tracker() { return _tracker; }
+
+    // Tracker totals and live allocations, plus what the device reports.
+    void dump() const;
+
+private:
+    // Settles a reservation: records the object at its real size, or rolls the
+    // reservation back when creation failed and pObject is null.
+    void commit( NS::Object* pObject, ResourceTracker::AllocationId id, size_t bytes );
+
+    MTL::Device*                                                _pDevice;
+    ResourceTracker                                             _tracker;
+    std::mutex                                                  _mutex;
+    std::unordered_map<NS::Object*, ResourceTracker::AllocationId> _ids;
+};
+
+#endif /* resource_registry_hpp */
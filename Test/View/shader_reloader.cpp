@@ -0,0 +1,314 @@
+//
+//  shader_reloader.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "shader_reloader.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+
+bool readSource( const std::string& path, std::string& source )
+{
+    std::ifstream file( path );
+    if ( !file )
+    {
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    source = contents.str();
+    return true;
+}
+
+double msSince( uint64_t startNs )
+{
+    return double( TraceRecorder::nowNs() - startNs ) * 1e-6;
+}
+
+MTL::Function* newFunction( MTL::Library* pLibrary, const std::string& name, MTL::FunctionConstantValues* pConstants )
+{
+    NS::String* pName = NS::String::string( name.c_str(), NS::StringEncoding::UTF8StringEncoding );
+    if ( !pConstants )
+    {
+        return pLibrary->newFunction( pName );
+    }
+    NS::Error* pError = nullptr;
+    return pLibrary->newFunction( pName, pConstants, &pError );
+}
+
+}
+
+ReloadablePipeline::~ReloadablePipeline()
+{
+    if ( _pDesc )
+    {
+        _pDesc->release();
+    }
+    if ( _pConstants )
+    {
+        _pConstants->release();
+    }
+    if ( _pRender )
+    {
+        _pRender->release();
+    }
+    if ( _pCompute )
+    {
+        _pCompute->release();
+    }
+}
+
+bool ReloadablePipeline::uses( const std::vector<std::string>& functions ) const
+{
+    for ( const std::string& function : _functions )
+    {
+        if ( std::find( functions.begin(), functions.end(), function ) != functions.end() )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+ShaderReloader::ShaderReloader( MTL::Device* pDevice, const std::string& sourcePath )
+: _pDevice( pDevice->retain() )
+, _sourcePath( sourcePath )
+{
+    // The running pipelines come from the default library, built from this
+    // source, so its index is the baseline the first save is diffed against.
+    std::string source;
+    if ( !readSource( sourcePath, source ) )
+    {
+        __builtin_printf( "Shader reload: can't read %s\n", sourcePath.c_str() );
+    }
+    _index = indexShaderSource( source );
+    _watcher.watch( sourcePath, [this]( const std::string& ) { reload(); } );
+}
+
+ShaderReloader::~ShaderReloader()
+{
+    for ( Rebuilt& rebuilt : _pending )
+    {
+        if ( rebuilt.pRender )
+        {
+            rebuilt.pRender->release();
+        }
+        if ( rebuilt.pCompute )
+        {
+            rebuilt.pCompute->release();
+        }
+    }
+    _pDevice->release();
+}
+
+ReloadablePipeline* ShaderReloader::addRenderPipeline( const MTL::RenderPipelineDescriptor* pDesc, MTL::RenderPipelineState* pState,
+                                                       MTL::FunctionConstantValues* pConstants )
+{
+    std::shared_ptr<ReloadablePipeline> pipeline( new ReloadablePipeline(), []( ReloadablePipeline* p ) { delete p; } );
+    pipeline->_pDesc = pDesc->copy();
+    for ( MTL::Function* pFn : { pDesc->vertexFunction(), pDesc->fragmentFunction() } )
+    {
+        if ( pFn )
+        {
+            pipeline->_functions.push_back( pFn->name()->utf8String() );
+        }
+    }
+    pipeline->_pConstants = pConstants ? pConstants->retain() : nullptr;
+    pipeline->_pRender = pState->retain();
+
+    std::lock_guard<std::mutex> lock( _mutex );
+    _pipelines.push_back( pipeline );
+    return pipeline.get();
+}
+
+ReloadablePipeline* ShaderReloader::addComputePipeline( const char* functionName, MTL::ComputePipelineState* pState,
+                                                        MTL::FunctionConstantValues* pConstants )
+{
+    std::shared_ptr<ReloadablePipeline> pipeline( new ReloadablePipeline(), []( ReloadablePipeline* p ) { delete p; } );
+    pipeline->_functions.push_back( functionName );
+    pipeline->_pConstants = pConstants ? pConstants->retain() : nullptr;
+    pipeline->_pCompute = pState->retain();
+
+    std::lock_guard<std::mutex> lock( _mutex );
+    _pipelines.push_back( pipeline );
+    return pipeline.get();
+}
+
+void ShaderReloader::remove( ReloadablePipeline* pPipeline )
+{
+    // A reload in progress may still hold it; it is dropped when its rebuild is applied.
+    std::lock_guard<std::mutex> lock( _mutex );
+    auto found = std::find_if( _pipelines.begin(), _pipelines.end(),
+                               [pPipeline]( const std::shared_ptr<ReloadablePipeline>& p ) { return p.get() == pPipeline; } );
+    if ( found != _pipelines.end() )
+    {
+        ( *found )->_removed = true;
+        _pipelines.erase( found );
+    }
+}
+
+size_t ShaderReloader::applyPending()
+{
+    std::vector<Rebuilt> pending;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        if ( _pending.empty() )
+        {
+            return 0;
+        }
+        pending.swap( _pending );
+    }
+
+    TRACE_SCOPE( "ShaderReloader::applyPending" );
+    size_t swapped = 0;
+    for ( Rebuilt& rebuilt : pending )
+    {
+        ReloadablePipeline& pipeline = *rebuilt.pipeline;
+        if ( !pipeline._removed )
+        {
+            std::swap( pipeline._pRender, rebuilt.pRender );
+            std::swap( pipeline._pCompute, rebuilt.pCompute );
+            ++swapped;
+        }
+
+        // Now the previous states, or the rebuilt ones of a removed pipeline.
+        if ( rebuilt.pRender )
+        {
+            rebuilt.pRender->release();
+        }
+        if ( rebuilt.pCompute )
+        {
+            rebuilt.pCompute->release();
+        }
+    }
+    return swapped;
+}
+
+ShaderReloadStats ShaderReloader::lastReload() const
+{
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _lastReload;
+}
+
+// Runs on the watcher thread.
+void ShaderReloader::reload()
+{
+    TRACE_SCOPE( "ShaderReloader::reload" );
+    NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+
+    ShaderReloadStats stats;
+    std::string source;
+    if ( !readSource( _sourcePath, source ) )
+    {
+        pPool->release();
+        return;
+    }
+    ShaderSourceIndex index = indexShaderSource( source );
+    std::vector<std::string> changed = changedEntryPoints( _index, index );
+    stats.changedFunctions = changed.size();
+    if ( changed.empty() )
+    {
+        _index = std::move( index );
+        __builtin_printf( "Shader reload: no entry point changed\n" );
+        pPool->release();
+        return;
+    }
+
+    // The whole file compiles as one library either way; what the index saves
+    // is rebuilding pipelines that could not have changed.
+    uint64_t start = TraceRecorder::nowNs();
+    NS::Error* pError = nullptr;
+    MTL::CompileOptions* pOptions = MTL::CompileOptions::alloc()->init();
+    MTL::Library* pLibrary = _pDevice->newLibrary( NS::String::string( source.c_str(), NS::StringEncoding::UTF8StringEncoding ), pOptions, &pError );
+    pOptions->release();
+    stats.compileMs = msSince( start );
+    if ( !pLibrary )
+    {
+        // _index stays at the last good source, so the fix is diffed against it.
+        __builtin_printf( "Shader reload: %s failed to compile, keeping the running pipelines\n%s\n", _sourcePath.c_str(),
+                          pError ? pError->localizedDescription()->utf8String() : "" );
+        stats.succeeded = false;
+        std::lock_guard<std::mutex> lock( _mutex );
+        _lastReload = stats;
+        pPool->release();
+        return;
+    }
+
+    std::vector<std::shared_ptr<ReloadablePipeline>> affected;
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        for ( const std::shared_ptr<ReloadablePipeline>& pipeline : _pipelines )
+        {
+            if ( pipeline->uses( changed ) )
+            {
+                affected.push_back( pipeline );
+            }
+        }
+    }
+
+    start = TraceRecorder::nowNs();
+    std::vector<Rebuilt> rebuilt;
+    for ( const std::shared_ptr<ReloadablePipeline>& pipeline : affected )
+    {
+        // Description and constants never change after registration, so they are
+        // safe to read here while the draw thread uses the pipeline.
+        Rebuilt result = { pipeline, nullptr, nullptr };
+        if ( pipeline->_pDesc )
+        {
+            MTL::RenderPipelineDescriptor* pDesc = pipeline->_pDesc->copy();
+            MTL::Function* pVertexFn = newFunction( pLibrary, pipeline->_functions[ 0 ], pipeline->_pConstants );
+            MTL::Function* pFragFn = pipeline->_functions.size() > 1 ? newFunction( pLibrary, pipeline->_functions[ 1 ], pipeline->_pConstants ) : nullptr;
+            pDesc->setVertexFunction( pVertexFn );
+            pDesc->setFragmentFunction( pFragFn );
+            result.pRender = pVertexFn ? _pDevice->newRenderPipelineState( pDesc, &pError ) : nullptr;
+            if ( pVertexFn )
+            {
+                pVertexFn->release();
+            }
+            if ( pFragFn )
+            {
+                pFragFn->release();
+            }
+            pDesc->release();
+        }
+        else
+        {
+            MTL::Function* pFn = newFunction( pLibrary, pipeline->_functions[ 0 ], pipeline->_pConstants );
+            result.pCompute = pFn ? _pDevice->newComputePipelineState( pFn, &pError ) : nullptr;
+            if ( pFn )
+            {
+                pFn->release();
+            }
+        }
+
+        if ( !result.pRender && !result.pCompute )
+        {
+            __builtin_printf( "Shader reload: pipeline for %s failed, keeping the running one\n%s\n", pipeline->_functions[ 0 ].c_str(),
+                              pError ? pError->localizedDescription()->utf8String() : "" );
+            stats.succeeded = false;
+            continue;
+        }
+        rebuilt.push_back( result );
+    }
+    stats.pipelineMs = msSince( start );
+    stats.rebuiltPipelines = rebuilt.size();
+    pLibrary->release();
+
+    __builtin_printf( "Shader reload: %zu entry points changed, %zu pipelines rebuilt, %.1f ms compile, %.1f ms pipelines\n",
+                      stats.changedFunctions, stats.rebuiltPipelines, stats.compileMs, stats.pipelineMs );
+    _index = std::move( index );
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _pending.insert( _pending.end(), rebuilt.begin(), rebuilt.end() );
+        _lastReload = stats;
+    }
+    pPool->release();
+}
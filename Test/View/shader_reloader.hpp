@@ -0,0 +1,98 @@
+//
+//  shader_reloader.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef shader_reloader_hpp
+#define shader_reloader_hpp
+
+#include <Metal/Metal.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Core/file_watcher.hpp"
+#include "Model/shader_source_index.hpp"
+
+class ShaderReloader;
+
+// A pipeline kept in step with the shader source. Read its state when encoding;
+// it only changes inside ShaderReloader::applyPending().
+class ReloadablePipeline
+{
+public:
+    MTL::RenderPipelineState* renderState() const { return _pRender; }
+    MTL::ComputePipelineState* computeState() const { return _pCompute; }
+
+private:
+    friend class ShaderReloader;
+
+    ~ReloadablePipeline();
+    bool uses( const std::vector<std::string>& functions ) const;
+
+    MTL::RenderPipelineDescriptor*  _pDesc = nullptr;       // render pipelines
+    std::vector<std::string>        _functions;             // entry points the pipeline is built from
+    MTL::FunctionConstantValues*    _pConstants = nullptr;
+    MTL::RenderPipelineState*       _pRender = nullptr;
+    MTL::ComputePipelineState*      _pCompute = nullptr;
+    bool                            _removed = false;
+};
+
+struct ShaderReloadStats
+{
+    size_t  changedFunctions = 0;
+    size_t  rebuiltPipelines = 0;
+    double  compileMs = 0.0;
+    double  pipelineMs = 0.0;
+    bool    succeeded = true;
+};
+
+// Shader hot-reload for iterating on a running app. Watches a .metal source and,
+// on every save, compiles it with newLibrary() on the watcher's thread. Only
+// pipelines using an entry point whose code or dependencies changed (see
+// changedEntryPoints) are rebuilt, also off the draw thread; applyPending()
+// then swaps them in between frames. Frames already encoded keep the old
+// states, since command buffers retain what they reference. A source that
+// fails to compile is reported and leaves every pipeline as it was.
+class ShaderReloader
+{
+public:
+    ShaderReloader( MTL::Device* pDevice, const std::string& sourcePath );
+    ~ShaderReloader();
+
+    // pState is the pipeline as built from the default library; it is retained.
+    ReloadablePipeline* addRenderPipeline( const MTL::RenderPipelineDescriptor* pDesc, MTL::RenderPipelineState* pState,
+                                           MTL::FunctionConstantValues* pConstants = nullptr );
+    ReloadablePipeline* addComputePipeline( const char* functionName, MTL::ComputePipelineState* pState,
+                                            MTL::FunctionConstantValues* pConstants = nullptr );
+    void remove( ReloadablePipeline* pPipeline );
+
+    // Call between frames on the thread that encodes them. Returns the number
+    // of pipelines swapped.
+    size_t applyPending();
+
+    ShaderReloadStats lastReload() const;
+
+private:
+    struct Rebuilt
+    {
+        std::shared_ptr<ReloadablePipeline> pipeline;
+        MTL::RenderPipelineState*           pRender;
+        MTL::ComputePipelineState*          pCompute;
+    };
+
+    void reload();
+
+    MTL::Device*                                        _pDevice;
+    std::string                                         _sourcePath;
+    ShaderSourceIndex                                   _index;         // of the last source that compiled; watcher thread only
+    mutable std::mutex                                  _mutex;
+    std::vector<std::shared_ptr<ReloadablePipeline>>    _pipelines;
+    std::vector<Rebuilt>                                _pending;
+    ShaderReloadStats                                   _lastReload;
+    FileWatcher                                         _watcher;       // last, so it stops before the rest goes away
+};
+
+#endif /* shader_reloader_hpp */
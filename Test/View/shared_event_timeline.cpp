@@ -0,0 +1,67 @@
+//
+//  shared_event_timeline.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "shared_event_timeline.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+SharedEventTimeline::SharedEventTimeline( MTL::Device* pDevice, const char* label )
+: _pEvent( pDevice->newSharedEvent() )
+, _pListener( MTL::SharedEventListener::alloc()->init() )
+{
+    _pEvent->setLabel( NS::String::string( label, NS::StringEncoding::UTF8StringEncoding ) );
+}
+
+SharedEventTimeline::~SharedEventTimeline()
+{
+    _pListener->release();
+    _pEvent->release();
+}
+
+void SharedEventTimeline::notify( uint64_t value, const Listener& listener )
+{
+    uint64_t current = _pEvent->signaledValue();
+    if ( current >= value )
+    {
+        listener( current );
+        return;
+    }
+
+    __block Listener blockListener = listener;
+    _pEvent->notifyListener( _pListener, value, ^( MTL::SharedEvent*, uint64_t signaled ) { blockListener( signaled ); } );
+}
+
+bool SharedEventTimeline::wait( uint64_t value, uint32_t timeoutMs )
+{
+    if ( _pEvent->signaledValue() >= value )
+    {
+        return true;
+    }
+
+    // Shared, because the listener can still fire after a timed out wait returns.
+    struct WaitState
+    {
+        std::mutex              mutex;
+        std::condition_variable reached;
+        bool                    done = false;
+    };
+    std::shared_ptr<WaitState> pState = std::make_shared<WaitState>();
+    notify( value, [pState]( uint64_t )
+    {
+        {
+            std::lock_guard<std::mutex> lock( pState->mutex );
+            pState->done = true;
+        }
+        pState->reached.notify_all();
+    } );
+
+    std::unique_lock<std::mutex> lock( pState->mutex );
+    return pState->reached.wait_for( lock, std::chrono::milliseconds( timeoutMs ), [&] { return pState->done; } );
+}
@@ -0,0 +1,41 @@
+//
+//  shared_event_timeline.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef shared_event_timeline_hpp
+#define shared_event_timeline_hpp
+
+#include <Metal/Metal.hpp>
+#include "Model/timeline.hpp"
+
+// Timeline over an MTL::SharedEvent. Command buffers wait for and signal values
+// on the GPU through encodeWait() and encodeSignal(), on any queue of the
+// device; CPU jobs use the Timeline interface. Listeners run on the shared
+// event listener's dispatch queue.
+class SharedEventTimeline : public Timeline
+{
+public:
+    SharedEventTimeline( MTL::Device* pDevice, const char* label );
+    ~SharedEventTimeline();
+
+    uint64_t signaledValue() const override { return _pEvent->signaledValue(); }
+    void signal( uint64_t value ) override { _pEvent->setSignaledValue( value ); }
+    bool wait( uint64_t value, uint32_t timeoutMs ) override;
+    void notify( uint64_t value, const Listener& listener ) override;
+
+    // pCmd starts only once value is reached.
+    void encodeWait( MTL::CommandBuffer* pCmd, uint64_t value ) { pCmd->encodeWait( _pEvent, value ); }
+    // Reaches value once everything encoded in pCmd so far has finished.
+    void encodeSignal( MTL::CommandBuffer* pCmd, uint64_t value ) { pCmd->encodeSignalEvent( _pEvent, value ); }
+
+    MTL::SharedEvent* event() const { return _pEvent; }
+
+private:
+    MTL::SharedEvent*           _pEvent;
+    MTL::SharedEventListener*   _pListener;
+};
+
+#endif /* shared_event_timeline_hpp */
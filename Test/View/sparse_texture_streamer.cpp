@@ -0,0 +1,498 @@
+//
+//  sparse_texture_streamer.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "sparse_texture_streamer.hpp"
+#include "resource_registry.hpp"
+#include "Core/trace_recorder.hpp"
+#include <filesystem>
+
+SparseTextureStreamer::SparseTextureStreamer( MTL::Device* pDevice, ResourceRegistry* pResources, MTL::CommandQueue* pQueue, const char* tileFilePath,
+                                              uint32_t width, uint32_t height, uint32_t mipCount, size_t budgetBytes )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+, _width( width )
+, _height( height )
+, _mipCount( mipCount )
+, _reader( tileFilePath )
+{
+    _tileSize = _pDevice->sparseTileSize( MTL::TextureType2D, MTL::PixelFormatRGBA8Unorm, 1 );
+    _tileBytes = _tileSize.width * _tileSize.height * kBytesPerPixel;
+
+    const size_t HeapTileBytes = _pDevice->sparseTileSizeInBytes();
+    const size_t HeapSize = ( budgetBytes + HeapTileBytes - 1 ) / HeapTileBytes * HeapTileBytes;
+
+    MTL::HeapDescriptor* pHeapDesc = MTL::HeapDescriptor::alloc()->init();
+    pHeapDesc->setType( MTL::HeapTypeSparse );
+    pHeapDesc->setStorageMode( MTL::StorageModePrivate );
+    pHeapDesc->setSize( HeapSize );
+    _pHeap = _pResources->newHeap( pHeapDesc, ResourceCategory::Streaming, "Sparse texture heap" );
+    pHeapDesc->release();
+
+    MTL::TextureDescriptor* pTexDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatRGBA8Unorm, width, height, true );
+    pTexDesc->setMipmapLevelCount( mipCount );
+    pTexDesc->setStorageMode( MTL::StorageModePrivate );
+    pTexDesc->setUsage( MTL::TextureUsageShaderRead );
+    _pTexture = _pHeap->newTexture( pTexDesc );
+    if ( !_pTexture )
+    {
+        __builtin_printf( "SparseTextureStreamer: sparse textures are not supported on this device\n" );
+        assert( false );
+    }
+
+    _layout.tilesX = uint32_t( ( width + _tileSize.width - 1 ) / _tileSize.width );
+    _layout.tilesY = uint32_t( ( height + _tileSize.height - 1 ) / _tileSize.height );
+    _layout.firstTailMip = uint32_t( std::min< NS::UInteger >( _pTexture->firstMipmapInTail(), mipCount ) );
+
+    uint64_t offset = 0;
+    for ( uint32_t mip = 0; mip < _layout.firstTailMip; ++mip )
+    {
+        _mipTileOffsets.push_back( offset );
+        offset += uint64_t( _layout.tilesXAt( mip ) ) * _layout.tilesYAt( mip ) * _tileBytes;
+    }
+    _tailOffset = offset;
+
+    // The tail is mapped for the lifetime of the texture and comes out of the same heap.
+    const size_t TailBytes = _layout.firstTailMip < mipCount ? _pTexture->tailSizeInBytes() : 0;
+    const size_t TileCapacity = HeapSize > TailBytes ? ( HeapSize - TailBytes ) / HeapTileBytes : 0;
+    _pCache = new TileCache( _layout, TileCapacity );
+
+    // Written only by blits in update(), ordered after the mappings they describe.
+    MTL::TextureDescriptor* pMapDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatR8Uint, _layout.tilesX, _layout.tilesY, false );
+    pMapDesc->setStorageMode( MTL::StorageModePrivate );
+    pMapDesc->setUsage( MTL::TextureUsageShaderRead );
+    _pResidencyMap = _pResources->newTexture( pMapDesc, ResourceCategory::Streaming, "Sparse texture residency map" );
+
+    const size_t FeedbackCells = size_t( _layout.tilesX ) * _layout.tilesY;
+    for ( uint32_t i = 0; i < kFeedbackSlots; ++i )
+    {
+        _pFeedback[ i ] = _pResources->newBuffer( FeedbackCells * sizeof( uint32_t ), MTL::ResourceStorageModeShared, ResourceCategory::Streaming, "Sparse texture feedback" );
+        memset( _pFeedback[ i ]->contents(), 0xff, _pFeedback[ i ]->length() );
+        _feedbackReady[ i ] = false;
+    }
+    _feedbackCells.resize( FeedbackCells );
+
+    uploadMipTail( pQueue, tileFilePath );
+}
+
+SparseTextureStreamer::~SparseTextureStreamer()
+{
+    delete _pCache;
+    for ( MTL::Buffer* pBuffer : _pFeedback )
+    {
+        _pResources->release( pBuffer );
+    }
+    _pResources->release( _pResidencyMap );
+    _pTexture->release();
+    _pResources->release( _pHeap );
+    _pDevice->release();
+}
+
+bool SparseTextureStreamer::supported( MTL::Device* pDevice )
+{
+    return pDevice->supportsFamily( MTL::GPUFamilyApple6 );
+}
+
+uint64_t SparseTextureStreamer::tileOffset( const TileKey& key ) const
+{
+    return _mipTileOffsets[ key.mip ] + ( uint64_t( key.y ) * _layout.tilesXAt( key.mip ) + key.x ) * _tileBytes;
+}
+
+MTL::Region SparseTextureStreamer::tilePixelRegion( const TileKey& key ) const
+{
+    const NS::UInteger MipWidth = std::max( 1u, _width >> key.mip );
+    const NS::UInteger MipHeight = std::max( 1u, _height >> key.mip );
+    const NS::UInteger X = key.x * _tileSize.width;
+    const NS::UInteger Y = key.y * _tileSize.height;
+    return MTL::Region::Make2D( X, Y, std::min( _tileSize.width, MipWidth - X ), std::min( _tileSize.height, MipHeight - Y ) );
+}
+
+void SparseTextureStreamer::uploadMipTail( MTL::CommandQueue* pQueue, const char* tileFilePath )
+{
+    MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+
+    if ( _layout.firstTailMip < _mipCount )
+    {
+        MTL::ResourceStateCommandEncoder* pStateEnc = pCmd->resourceStateCommandEncoder();
+        const NS::UInteger TailWidth = std::max( 1u, _width >> _layout.firstTailMip );
+        const NS::UInteger TailHeight = std::max( 1u, _height >> _layout.firstTailMip );
+        pStateEnc->updateTextureMapping( _pTexture, MTL::SparseTextureMappingModeMap,
+                                         MTL::Region::Make2D( 0, 0,
+                                                              ( TailWidth + _tileSize.width - 1 ) / _tileSize.width,
+                                                              ( TailHeight + _tileSize.height - 1 ) / _tileSize.height ),
+                                         _layout.firstTailMip, 0 );
+        pStateEnc->endEncoding();
+
+        // The tail is small, a blocking read at load time is fine.
+        FILE* pFile = fopen( tileFilePath, "rb" );
+        if ( pFile )
+        {
+            fseek( pFile, long( _tailOffset ), SEEK_SET );
+
+            MTL::BlitCommandEncoder* pBlit = pCmd->blitCommandEncoder();
+            for ( uint32_t mip = _layout.firstTailMip; mip < _mipCount; ++mip )
+            {
+                const NS::UInteger W = std::max( 1u, _width >> mip );
+                const NS::UInteger H = std::max( 1u, _height >> mip );
+                const size_t Bytes = W * H * kBytesPerPixel;
+
+                MTL::Buffer* pStaging = _pResources->newBuffer( Bytes, MTL::ResourceStorageModeShared, ResourceCategory::Staging, "Sparse texture tail upload" );
+                if ( fread( pStaging->contents(), 1, Bytes, pFile ) == Bytes )
+                {
+                    pBlit->copyFromBuffer( pStaging, 0, W * kBytesPerPixel, Bytes, MTL::Size::Make( W, H, 1 ),
+                                           _pTexture, 0, mip, MTL::Origin::Make( 0, 0, 0 ) );
+                }
+                _pResources->release( pStaging );
+            }
+            pBlit->endEncoding();
+            fclose( pFile );
+        }
+    }
+
+    // Nothing above the tail is resident yet.
+    _pCache->buildResidencyMap( _residency );
+    MTL::Buffer* pMapStaging = _pResources->newBuffer( _residency.size(), MTL::ResourceStorageModeShared, ResourceCategory::Staging, "Sparse texture residency upload" );
+    memcpy( pMapStaging->contents(), _residency.data(), _residency.size() );
+    MTL::BlitCommandEncoder* pMapBlit = pCmd->blitCommandEncoder();
+    pMapBlit->copyFromBuffer( pMapStaging, 0, _layout.tilesX, _residency.size(), MTL::Size::Make( _layout.tilesX, _layout.tilesY, 1 ),
+                              _pResidencyMap, 0, 0, MTL::Origin::Make( 0, 0, 0 ) );
+    pMapBlit->endEncoding();
+    _pResources->release( pMapStaging );
+
+    pCmd->commit();
+    pCmd->waitUntilCompleted();
+}
+
+void SparseTextureStreamer::readFeedback()
+{
+    // Use the newest slot the GPU has finished with. Every finished slot is
+    // cleared, used or not, since the GPU only ever lowers what is in a slot
+    // and would otherwise carry stale requests into the frame that reuses it.
+    bool used = false;
+    for ( uint32_t age = 1; age <= kFeedbackSlots; ++age )
+    {
+        uint32_t slot = uint32_t( ( _frame + kFeedbackSlots - age ) % kFeedbackSlots );
+        if ( !_feedbackReady[ slot ].exchange( false ) )
+        {
+            continue;
+        }
+
+        uint32_t* pCells = reinterpret_cast< uint32_t* >( _pFeedback[ slot ]->contents() );
+        if ( !used )
+        {
+            for ( size_t i = 0; i < _feedbackCells.size(); ++i )
+            {
+                _feedbackCells[ i ] = uint8_t( std::min< uint32_t >( pCells[ i ], TileCache::kNoFeedback ) );
+            }
+            _pCache->addFeedback( _feedbackCells.data() );
+            used = true;
+        }
+        memset( pCells, 0xff, _pFeedback[ slot ]->length() );
+    }
+}
+
+void SparseTextureStreamer::update( MTL::CommandBuffer* pCmd )
+{
+    readFeedback();
+
+    _completions.clear();
+    _reader.poll( _completions );
+
+    _pCache->update( kMaxLoadsPerFrame, _loads, _prefetches, _evictions );
+    for ( const TileKey& key : _loads )
+    {
+        _reader.submit( { key.packed(), tileOffset( key ), _tileBytes, 1 } );
+    }
+    for ( const TileKey& key : _prefetches )
+    {
+        _reader.submit( { key.packed(), tileOffset( key ), _tileBytes, 0 } );
+    }
+
+    bool residencyChanged = !_evictions.empty();
+    if ( !_evictions.empty() || !_completions.empty() )
+    {
+        MTL::ResourceStateCommandEncoder* pStateEnc = pCmd->resourceStateCommandEncoder();
+        for ( const TileKey& key : _evictions )
+        {
+            pStateEnc->updateTextureMapping( _pTexture, MTL::SparseTextureMappingModeUnmap,
+                                             MTL::Region::Make2D( key.x, key.y, 1, 1 ), key.mip, 0 );
+        }
+        for ( const AsyncFileReader::Completion& c : _completions )
+        {
+            if ( c.ok )
+            {
+                TileKey key = TileKey::unpack( c.tag );
+                pStateEnc->updateTextureMapping( _pTexture, MTL::SparseTextureMappingModeMap,
+                                                 MTL::Region::Make2D( key.x, key.y, 1, 1 ), key.mip, 0 );
+            }
+        }
+        pStateEnc->endEncoding();
+    }
+
+    // The residency map is copied in by the same blit as the tiles, so shaders
+    // see a tile as resident only once this command buffer has mapped and
+    // filled it, and frames still in flight keep reading the map they had.
+    size_t uploads = 0;
+    for ( const AsyncFileReader::Completion& c : _completions )
+    {
+        if ( c.ok )
+        {
+            _pCache->markResident( TileKey::unpack( c.tag ) );
+            ++uploads;
+            residencyChanged = true;
+        }
+        else
+        {
+            _pCache->cancel( TileKey::unpack( c.tag ) );
+        }
+    }
+
+    if ( residencyChanged )
+    {
+        _pCache->buildResidencyMap( _residency );
+
+        const size_t MapOffset = uploads * _tileBytes;
+        MTL::Buffer* pStaging = _pResources->newBuffer( MapOffset + _residency.size(), MTL::ResourceStorageModeShared, ResourceCategory::Staging, "Sparse texture tile upload" );
+        uint8_t* pContents = static_cast< uint8_t* >( pStaging->contents() );
+        MTL::BlitCommandEncoder* pBlit = pCmd->blitCommandEncoder();
+
+        size_t offset = 0;
+        for ( const AsyncFileReader::Completion& c : _completions )
+        {
+            if ( !c.ok )
+            {
+                continue;
+            }
+
+            TileKey key = TileKey::unpack( c.tag );
+            memcpy( pContents + offset, c.data.data(), _tileBytes );
+            MTL::Region region = tilePixelRegion( key );
+            pBlit->copyFromBuffer( pStaging, offset, _tileSize.width * kBytesPerPixel, _tileBytes, region.size,
+                                   _pTexture, 0, key.mip, region.origin );
+            offset += _tileBytes;
+        }
+
+        memcpy( pContents + MapOffset, _residency.data(), _residency.size() );
+        pBlit->copyFromBuffer( pStaging, MapOffset, _layout.tilesX, _residency.size(),
+                               MTL::Size::Make( _layout.tilesX, _layout.tilesY, 1 ),
+                               _pResidencyMap, 0, 0, MTL::Origin::Make( 0, 0, 0 ) );
+
+        pBlit->endEncoding();
+        // The command buffer keeps the staging buffer alive until it has executed.
+        _pResources->release( pStaging );
+    }
+
+    // Feedback written this frame is read back once this command buffer completes.
+    uint32_t slot = uint32_t( _frame % kFeedbackSlots );
+    std::atomic<bool>* pReady = &_feedbackReady[ slot ];
+    pCmd->addCompletedHandler( [pReady]( MTL::CommandBuffer* ) { pReady->store( true ); } );
+    ++_frame;
+}
+
+namespace
+{
+
+const uint32_t kBenchTextureSize = 4096;
+const uint32_t kBenchMipCount = 13;
+const size_t kBenchBudgetBytes = 16 * 1024 * 1024;
+const uint32_t kBenchWidth = 1280;
+const uint32_t kBenchHeight = 720;
+const float kBenchWindow = 0.3f;        // fraction of the texture on screen, so mip 0 is sampled
+
+// Matches StreamedViewParams in Shaders.metal.
+struct StreamedViewParams
+{
+    float origin[ 2 ];
+    float scale[ 2 ];
+};
+
+// A checkerboard that differs per mip, so a wrong tile shows.
+void fillBenchTexels( uint8_t* pOut, uint32_t mip, uint32_t x0, uint32_t y0, uint32_t width, uint32_t height )
+{
+    for ( uint32_t y = 0; y < height; ++y )
+    {
+        for ( uint32_t x = 0; x < width; ++x, pOut += 4 )
+        {
+            uint32_t px = x0 + x, py = y0 + y;
+            pOut[ 0 ] = ( ( px >> 4 ) ^ ( py >> 4 ) ) & 1 ? 230 : 30;
+            pOut[ 1 ] = uint8_t( mip * 20 );
+            pOut[ 2 ] = uint8_t( px ^ py );
+            pOut[ 3 ] = 255;
+        }
+    }
+}
+
+// Writes the tile file SparseTextureStreamer reads for this size on this device.
+bool writeBenchTileFile( MTL::Device* pDevice, ResourceRegistry* pResources, const char* path,
+                         uint32_t width, uint32_t height, uint32_t mipCount )
+{
+    // Where the mip tail starts is up to the device, and only a sparse texture says.
+    MTL::HeapDescriptor* pHeapDesc = MTL::HeapDescriptor::alloc()->init();
+    pHeapDesc->setType( MTL::HeapTypeSparse );
+    pHeapDesc->setStorageMode( MTL::StorageModePrivate );
+    pHeapDesc->setSize( pDevice->sparseTileSizeInBytes() );
+    MTL::Heap* pHeap = pResources->newHeap( pHeapDesc, ResourceCategory::Staging, "Sparse tail probe" );
+    pHeapDesc->release();
+
+    MTL::TextureDescriptor* pTexDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatRGBA8Unorm, width, height, true );
+    pTexDesc->setMipmapLevelCount( mipCount );
+    pTexDesc->setStorageMode( MTL::StorageModePrivate );
+    pTexDesc->setUsage( MTL::TextureUsageShaderRead );
+    MTL::Texture* pProbe = pHeap ? pHeap->newTexture( pTexDesc ) : nullptr;
+    pTexDesc->release();
+    if ( !pProbe )
+    {
+        pResources->release( pHeap );
+        return false;
+    }
+    const uint32_t FirstTailMip = uint32_t( std::min< NS::UInteger >( pProbe->firstMipmapInTail(), mipCount ) );
+    pProbe->release();
+    pResources->release( pHeap );
+
+    FILE* pFile = fopen( path, "wb" );
+    if ( !pFile )
+    {
+        return false;
+    }
+
+    const MTL::Size Tile = pDevice->sparseTileSize( MTL::TextureType2D, MTL::PixelFormatRGBA8Unorm, 1 );
+    TileLayout layout;
+    layout.tilesX = uint32_t( ( width + Tile.width - 1 ) / Tile.width );
+    layout.tilesY = uint32_t( ( height + Tile.height - 1 ) / Tile.height );
+
+    bool ok = true;
+    std::vector<uint8_t> texels( Tile.width * Tile.height * 4 );
+    for ( uint32_t mip = 0; mip < FirstTailMip; ++mip )
+    {
+        for ( uint32_t ty = 0; ty < layout.tilesYAt( mip ); ++ty )
+        {
+            for ( uint32_t tx = 0; tx < layout.tilesXAt( mip ); ++tx )
+            {
+                fillBenchTexels( texels.data(), mip, tx * uint32_t( Tile.width ), ty * uint32_t( Tile.height ),
+                                 uint32_t( Tile.width ), uint32_t( Tile.height ) );
+                ok = ok && fwrite( texels.data(), 1, texels.size(), pFile ) == texels.size();
+            }
+        }
+    }
+    for ( uint32_t mip = FirstTailMip; mip < mipCount; ++mip )
+    {
+        const uint32_t W = std::max( 1u, width >> mip );
+        const uint32_t H = std::max( 1u, height >> mip );
+        texels.resize( size_t( W ) * H * 4 );
+        fillBenchTexels( texels.data(), mip, 0, 0, W, H );
+        ok = ok && fwrite( texels.data(), 1, texels.size(), pFile ) == texels.size();
+    }
+    fclose( pFile );
+    return ok;
+}
+
+}
+
+std::vector<BenchResult> runTextureStreamingBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                                   uint32_t frames, uint32_t warmupFrames )
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+    std::vector<BenchResult> results;
+    if ( !SparseTextureStreamer::supported( pDevice ) )
+    {
+        __builtin_printf( "Texture streaming bench: %s has no sparse textures (needs Apple6)\n", pDevice->name()->utf8String() );
+        return results;
+    }
+
+    ResourceRegistry* pResources = new ResourceRegistry( pDevice );
+    const std::string Path = ( std::filesystem::temp_directory_path() / "texture_streaming_bench.tiles" ).string();
+    if ( !writeBenchTileFile( pDevice, pResources, Path.c_str(), kBenchTextureSize, kBenchTextureSize, kBenchMipCount ) )
+    {
+        __builtin_printf( "Texture streaming bench: could not write %s\n", Path.c_str() );
+        delete pResources;
+        return results;
+    }
+
+    SparseTextureStreamer* pStreamer = new SparseTextureStreamer( pDevice, pResources, pQueue, Path.c_str(),
+                                                                  kBenchTextureSize, kBenchTextureSize, kBenchMipCount,
+                                                                  kBenchBudgetBytes );
+
+    MTL::TextureDescriptor* pTexDesc = MTL::TextureDescriptor::texture2DDescriptor( MTL::PixelFormatBGRA8Unorm, kBenchWidth, kBenchHeight, false );
+    pTexDesc->setStorageMode( MTL::StorageModePrivate );
+    pTexDesc->setUsage( MTL::TextureUsageRenderTarget );
+    MTL::Texture* pColor = pResources->newTexture( pTexDesc, ResourceCategory::RenderTarget, "Texture streaming bench color" );
+    pTexDesc->release();
+
+    MTL::Library* pLibrary = pDevice->newDefaultLibrary();
+    MTL::Function* pVertexFn = pLibrary->newFunction( NS::String::string( "upscaleVertex", UTF8StringEncoding ) );
+    MTL::Function* pFragFn = pLibrary->newFunction( NS::String::string( "streamedTextureFragment", UTF8StringEncoding ) );
+    MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pDesc->setVertexFunction( pVertexFn );
+    pDesc->setFragmentFunction( pFragFn );
+    pDesc->colorAttachments()->object( 0 )->setPixelFormat( MTL::PixelFormatBGRA8Unorm );
+    NS::Error* pError = nullptr;
+    MTL::RenderPipelineState* pPSO = pDevice->newRenderPipelineState( pDesc, &pError );
+    if ( !pPSO )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    pDesc->release();
+    pFragFn->release();
+    pVertexFn->release();
+    pLibrary->release();
+
+    MTL::RenderPassDescriptor* pRpd = MTL::RenderPassDescriptor::alloc()->init();
+    pRpd->colorAttachments()->object( 0 )->setTexture( pColor );
+    pRpd->colorAttachments()->object( 0 )->setLoadAction( MTL::LoadActionDontCare );
+    pRpd->colorAttachments()->object( 0 )->setStoreAction( MTL::StoreActionStore );
+
+    // The window sweeps diagonally across the texture and back once over the run.
+    std::vector<double> cpuMs, gpuMs;
+    for ( uint32_t frame = 0; frame < warmupFrames + frames; ++frame )
+    {
+        NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+        float t = float( frame ) / float( warmupFrames + frames );
+        float along = ( 1.0f - kBenchWindow ) * ( t < 0.5f ? 2.0f * t : 2.0f - 2.0f * t );
+        StreamedViewParams view = { { along, along * 0.5f }, { kBenchWindow, kBenchWindow * float( kBenchHeight ) / float( kBenchWidth ) } };
+
+        uint64_t start = TraceRecorder::nowNs();
+        MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+        pStreamer->update( pCmd );
+
+        MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( pRpd );
+        pEnc->setRenderPipelineState( pPSO );
+        pEnc->setFragmentTexture( pStreamer->texture(), 0 );
+        pEnc->setFragmentTexture( pStreamer->residencyMap(), 1 );
+        pEnc->setFragmentBuffer( pStreamer->feedbackBuffer(), 0, 0 );
+        pEnc->setFragmentBytes( &view, sizeof( view ), 1 );
+        pEnc->drawPrimitives( MTL::PrimitiveTypeTriangle, NS::UInteger( 0 ), NS::UInteger( 3 ) );
+        pEnc->endEncoding();
+        pCmd->commit();
+        uint64_t end = TraceRecorder::nowNs();
+
+        pCmd->waitUntilCompleted();
+        if ( frame >= warmupFrames )
+        {
+            cpuMs.push_back( double( end - start ) * 1e-6 );
+            gpuMs.push_back( ( pCmd->GPUEndTime() - pCmd->GPUStartTime() ) * 1e3 );
+        }
+        pPool->release();
+    }
+
+    __builtin_printf( "Texture streaming: %ux%u, %zu of %zu tiles cached\n", kBenchTextureSize, kBenchTextureSize,
+                      pStreamer->cache().size(), pStreamer->cache().capacity() );
+
+    BenchResult result;
+    result.scene = "texture-streaming";
+    result.cpuEncode = summarizeFrameTimes( cpuMs );
+    result.gpu = summarizeFrameTimes( gpuMs );
+    result.memoryBytes = pResources->tracker().stats( ResourceCategory::Streaming ).currentBytes;
+    results.push_back( result );
+
+    pRpd->release();
+    pPSO->release();
+    pResources->release( pColor );
+    delete pStreamer;
+    delete pResources;
+    std::filesystem::remove( Path );
+    return results;
+}
@@ -0,0 +1,102 @@
+//
+//  sparse_texture_streamer.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef sparse_texture_streamer_hpp
+#define sparse_texture_streamer_hpp
+
+#include <Metal/Metal.hpp>
+#include <atomic>
+#include "Model/tile_cache.hpp"
+#include "Model/async_file_reader.hpp"
+#include "Model/bench_suite.hpp"
+
+class ResourceRegistry;
+
+// Streams a large RGBA8 texture through a sparse heap, keeping only the tiles
+// that shaders sampled in the last few frames mapped.
+//
+// Shaders sample through sampleStreamed() in Shaders.metal, which writes the
+// finest mip used per mip 0 tile into feedbackBuffer() and clamps to the
+// residency map. update() reads that feedback back once the GPU is done with
+// it, streams missing tiles in from disk and maps/unmaps them with a
+// ResourceStateCommandEncoder.
+//
+// The heap, residency map and feedback buffers come from the registry's
+// Streaming category, and per-frame upload buffers from Staging.
+//
+// The tile file holds, for every mip above the mip tail, its tiles in row-major
+// order (each tile a full tileWidth x tileHeight block), followed by the tail
+// mips stored linearly.
+class SparseTextureStreamer
+{
+public:
+    SparseTextureStreamer( MTL::Device* pDevice, ResourceRegistry* pResources, MTL::CommandQueue* pQueue, const char* tileFilePath,
+                           uint32_t width, uint32_t height, uint32_t mipCount, size_t budgetBytes );
+    ~SparseTextureStreamer();
+
+    // Sparse textures need Apple6.
+    static bool supported( MTL::Device* pDevice );
+
+    MTL::Texture* texture() const         { return _pTexture; }
+    MTL::Texture* residencyMap() const    { return _pResidencyMap; }
+    const TileLayout& layout() const      { return _layout; }
+    const TileCache& cache() const        { return *_pCache; }
+
+    // The feedback slot of the frame the last update() was encoded for.
+    MTL::Buffer* feedbackBuffer() const   { return _pFeedback[ ( _frame + kFeedbackSlots - 1 ) % kFeedbackSlots ]; }
+
+    // Encodes this frame's unmaps, maps, tile uploads and residency map copy
+    // into pCmd. Call before encoding the passes that sample the texture.
+    void update( MTL::CommandBuffer* pCmd );
+
+private:
+    static constexpr uint32_t kFeedbackSlots    = 3;
+    static constexpr size_t   kMaxLoadsPerFrame = 32;
+    static constexpr uint32_t kBytesPerPixel    = 4;
+
+    uint64_t tileOffset( const TileKey& key ) const;
+    MTL::Region tilePixelRegion( const TileKey& key ) const;
+    void uploadMipTail( MTL::CommandQueue* pQueue, const char* tileFilePath );
+    void readFeedback();
+
+    MTL::Device*                _pDevice;
+    ResourceRegistry*           _pResources;
+    MTL::Heap*                  _pHeap;
+    MTL::Texture*               _pTexture;
+    MTL::Texture*               _pResidencyMap;
+    MTL::Buffer*                _pFeedback[ kFeedbackSlots ];
+    std::atomic<bool>           _feedbackReady[ kFeedbackSlots ];
+
+    uint32_t                    _width;
+    uint32_t                    _height;
+    uint32_t                    _mipCount;
+    MTL::Size                   _tileSize;
+    size_t                      _tileBytes;
+    TileLayout                  _layout;
+    std::vector<uint64_t>       _mipTileOffsets;    // file offset of each mip's first tile
+    uint64_t                    _tailOffset;
+
+    TileCache*                  _pCache;
+    AsyncFileReader             _reader;
+    uint64_t                    _frame = 0;
+
+    std::vector<uint8_t>                        _feedbackCells;
+    std::vector<uint8_t>                        _residency;
+    std::vector<TileKey>                        _loads;
+    std::vector<TileKey>                        _prefetches;
+    std::vector<TileKey>                        _evictions;
+    std::vector<AsyncFileReader::Completion>    _completions;
+};
+
+// Pans a window over a procedural texture streamed from a tile file written to
+// the temporary directory, sampling it through sampleStreamed() in a fullscreen
+// pass. Reports the CPU time of update() and encoding, the GPU time, and the
+// Streaming category's bytes.
+std::vector<BenchResult> runTextureStreamingBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                                   uint32_t frames, uint32_t warmupFrames );
+
+#endif /* sparse_texture_streamer_hpp */
@@ -0,0 +1,363 @@
+//
+//  tile_deferred_renderer.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "tile_deferred_renderer.hpp"
+#include "View/resource_registry.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+// Match DeferredUniforms and TileLights in Shaders.metal.
+struct DeferredUniforms
+{
+    float    viewportSize[ 2 ];
+    uint32_t lightCount;
+    float    ambient;
+};
+
+const NS::UInteger kMaxLightsPerTile = 256;
+const NS::UInteger kTileLightsSize = 16 + kMaxLightsPerTile * sizeof( uint16_t );
+const uint32_t kGridVertexCount = 64 * 64 * 6;
+
+const MTL::PixelFormat kOutputFormat = MTL::PixelFormatBGRA8Unorm_sRGB;
+const MTL::PixelFormat kAlbedoFormat = MTL::PixelFormatRGBA8Unorm;
+const MTL::PixelFormat kNormalFormat = MTL::PixelFormatRGBA16Float;
+const MTL::PixelFormat kLinearDepthFormat = MTL::PixelFormatR32Float;
+
+MTL::Function* newFunction( MTL::Library* pLibrary, const char* name )
+{
+    MTL::Function* pFn = pLibrary->newFunction( NS::String::string( name, NS::StringEncoding::UTF8StringEncoding ) );
+    if ( !pFn )
+    {
+        __builtin_printf( "Missing shader function %s\n", name );
+        assert( false );
+    }
+    return pFn;
+}
+
+void setGBufferFormats( MTL::RenderPipelineColorAttachmentDescriptorArray* pAttachments )
+{
+    pAttachments->object( 0 )->setPixelFormat( kOutputFormat );
+    pAttachments->object( 1 )->setPixelFormat( kAlbedoFormat );
+    pAttachments->object( 2 )->setPixelFormat( kNormalFormat );
+    pAttachments->object( 3 )->setPixelFormat( kLinearDepthFormat );
+}
+
+MTL::RenderPipelineState* newPipeline( MTL::Device* pDevice, MTL::RenderPipelineDescriptor* pDesc )
+{
+    NS::Error* pError = nullptr;
+    MTL::RenderPipelineState* pPSO = pDevice->newRenderPipelineState( pDesc, &pError );
+    if ( !pPSO )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    return pPSO;
+}
+
+}
+
+bool TileDeferredRenderer::supported( MTL::Device* pDevice )
+{
+    return pDevice->supportsFamily( MTL::GPUFamilyApple4 );
+}
+
+TileDeferredRenderer::TileDeferredRenderer( MTL::Device* pDevice, ResourceRegistry* pResources )
+: _pDevice( pDevice->retain() )
+, _pResources( pResources )
+{
+    buildPipelines();
+
+    MTL::DepthStencilDescriptor* pDepthDesc = MTL::DepthStencilDescriptor::alloc()->init();
+    pDepthDesc->setDepthCompareFunction( MTL::CompareFunctionLess );
+    pDepthDesc->setDepthWriteEnabled( true );
+    _pSceneDepthState = _pDevice->newDepthStencilState( pDepthDesc );
+    pDepthDesc->setDepthCompareFunction( MTL::CompareFunctionAlways );
+    pDepthDesc->setDepthWriteEnabled( false );
+    _pLightingDepthState = _pDevice->newDepthStencilState( pDepthDesc );
+    pDepthDesc->release();
+
+    // Everything but the lit color is cleared on load and dropped on store.
+    _pDeferredRpd = MTL::RenderPassDescriptor::alloc()->init();
+    _pDeferredRpd->setTileWidth( kTileSize );
+    _pDeferredRpd->setTileHeight( kTileSize );
+    _pDeferredRpd->setThreadgroupMemoryLength( kTileLightsSize );
+    for ( NS::UInteger i = 0; i < 4; ++i )
+    {
+        MTL::RenderPassColorAttachmentDescriptor* pColor = _pDeferredRpd->colorAttachments()->object( i );
+        pColor->setLoadAction( MTL::LoadActionClear );
+        pColor->setStoreAction( i == 0 ? MTL::StoreActionStore : MTL::StoreActionDontCare );
+        pColor->setClearColor( i == 3 ? MTL::ClearColor::Make( 1.0, 0.0, 0.0, 0.0 ) : MTL::ClearColor::Make( 1.0, 1.0, 1.0, 1.0 ) );
+    }
+    _pDeferredRpd->depthAttachment()->setLoadAction( MTL::LoadActionClear );
+    _pDeferredRpd->depthAttachment()->setStoreAction( MTL::StoreActionDontCare );
+    _pDeferredRpd->depthAttachment()->setClearDepth( 1.0 );
+
+    _pForwardRpd = MTL::RenderPassDescriptor::alloc()->init();
+    _pForwardRpd->colorAttachments()->object( 0 )->setLoadAction( MTL::LoadActionClear );
+    _pForwardRpd->colorAttachments()->object( 0 )->setStoreAction( MTL::StoreActionStore );
+    _pForwardRpd->colorAttachments()->object( 0 )->setClearColor( MTL::ClearColor::Make( 1.0, 1.0, 1.0, 1.0 ) );
+    _pForwardRpd->depthAttachment()->setLoadAction( MTL::LoadActionClear );
+    _pForwardRpd->depthAttachment()->setStoreAction( MTL::StoreActionDontCare );
+    _pForwardRpd->depthAttachment()->setClearDepth( 1.0 );
+}
+
+TileDeferredRenderer::~TileDeferredRenderer()
+{
+    for ( MTL::Texture* pTexture : { _pAlbedo, _pNormal, _pLinearDepth, _pDepth } )
+    {
+        if ( pTexture )
+        {
+            _pResources->release( pTexture );
+        }
+    }
+    if ( _pLights )
+    {
+        _pResources->release( _pLights );
+    }
+    _pDeferredRpd->release();
+    _pForwardRpd->release();
+    _pSceneDepthState->release();
+    _pLightingDepthState->release();
+    _pGBufferPSO->release();
+    _pCullPSO->release();
+    _pLightingPSO->release();
+    _pForwardPSO->release();
+    _pDevice->release();
+}
+
+void TileDeferredRenderer::buildPipelines()
+{
+    MTL::Library* pLibrary = _pDevice->newDefaultLibrary();
+    MTL::Function* pSceneFn = newFunction( pLibrary, "deferredSceneVertex" );
+    MTL::Function* pFullscreenFn = newFunction( pLibrary, "deferredFullscreenVertex" );
+    MTL::Function* pGBufferFn = newFunction( pLibrary, "gbufferFragment" );
+    MTL::Function* pCullFn = newFunction( pLibrary, "cullLightsTile" );
+    MTL::Function* pLightingFn = newFunction( pLibrary, "deferredLightingFragment" );
+    MTL::Function* pForwardFn = newFunction( pLibrary, "forwardLightingFragment" );
+
+    // Every pipeline in the deferred pass sees the same four attachments.
+    MTL::RenderPipelineDescriptor* pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    setGBufferFormats( pDesc->colorAttachments() );
+    pDesc->setDepthAttachmentPixelFormat( MTL::PixelFormatDepth32Float );
+    pDesc->setVertexFunction( pSceneFn );
+    pDesc->setFragmentFunction( pGBufferFn );
+    _pGBufferPSO = newPipeline( _pDevice, pDesc );
+
+    pDesc->setVertexFunction( pFullscreenFn );
+    pDesc->setFragmentFunction( pLightingFn );
+    _pLightingPSO = newPipeline( _pDevice, pDesc );
+
+    pDesc->reset();
+    pDesc->colorAttachments()->object( 0 )->setPixelFormat( kOutputFormat );
+    pDesc->setDepthAttachmentPixelFormat( MTL::PixelFormatDepth32Float );
+    pDesc->setVertexFunction( pSceneFn );
+    pDesc->setFragmentFunction( pForwardFn );
+    _pForwardPSO = newPipeline( _pDevice, pDesc );
+    pDesc->release();
+
+    MTL::TileRenderPipelineDescriptor* pTileDesc = MTL::TileRenderPipelineDescriptor::alloc()->init();
+    pTileDesc->setTileFunction( pCullFn );
+    pTileDesc->setThreadgroupSizeMatchesTileSize( true );
+    pTileDesc->colorAttachments()->object( 0 )->setPixelFormat( kOutputFormat );
+    pTileDesc->colorAttachments()->object( 1 )->setPixelFormat( kAlbedoFormat );
+    pTileDesc->colorAttachments()->object( 2 )->setPixelFormat( kNormalFormat );
+    pTileDesc->colorAttachments()->object( 3 )->setPixelFormat( kLinearDepthFormat );
+    NS::Error* pError = nullptr;
+    _pCullPSO = _pDevice->newRenderPipelineState( pTileDesc, MTL::PipelineOptionNone, nullptr, &pError );
+    if ( !_pCullPSO )
+    {
+        __builtin_printf( "%s", pError->localizedDescription()->utf8String() );
+        assert( false );
+    }
+    pTileDesc->release();
+
+    for ( MTL::Function* pFn : { pSceneFn, pFullscreenFn, pGBufferFn, pCullFn, pLightingFn, pForwardFn } )
+    {
+        pFn->release();
+    }
+    pLibrary->release();
+}
+
+void TileDeferredRenderer::allocateTargets( NS::UInteger width, NS::UInteger height )
+{
+    for ( MTL::Texture* pTexture : { _pAlbedo, _pNormal, _pLinearDepth, _pDepth } )
+    {
+        if ( pTexture )
+        {
+            _pResources->release( pTexture );
+        }
+    }
+
+    // All four only exist in tile memory.
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( kAlbedoFormat, width, height, false );
+    pDesc->setStorageMode( MTL::StorageModeMemoryless );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget );
+    _pAlbedo = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "G-buffer albedo" );
+    pDesc->setPixelFormat( kNormalFormat );
+    _pNormal = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "G-buffer normal" );
+    pDesc->setPixelFormat( kLinearDepthFormat );
+    _pLinearDepth = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "G-buffer depth" );
+    pDesc->setPixelFormat( MTL::PixelFormatDepth32Float );
+    _pDepth = _pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "G-buffer depth attachment" );
+    pDesc->release();
+
+    _pDeferredRpd->colorAttachments()->object( 1 )->setTexture( _pAlbedo );
+    _pDeferredRpd->colorAttachments()->object( 2 )->setTexture( _pNormal );
+    _pDeferredRpd->colorAttachments()->object( 3 )->setTexture( _pLinearDepth );
+    _pDeferredRpd->depthAttachment()->setTexture( _pDepth );
+    _pForwardRpd->depthAttachment()->setTexture( _pDepth );
+    _width = width;
+    _height = height;
+}
+
+void TileDeferredRenderer::setLights( const std::vector<PointLight>& lights )
+{
+    const size_t Length = std::max< size_t >( lights.size(), 1 ) * sizeof( PointLight );
+    if ( !_pLights || _pLights->length() < Length )
+    {
+        if ( _pLights )
+        {
+            _pResources->release( _pLights );
+        }
+        _pLights = _pResources->newBuffer( Length, MTL::ResourceStorageModeShared, ResourceCategory::Other, "Point lights" );
+    }
+    memcpy( _pLights->contents(), lights.data(), lights.size() * sizeof( PointLight ) );
+    _lightCount = uint32_t( lights.size() );
+}
+
+void TileDeferredRenderer::setUniforms( MTL::RenderCommandEncoder* pEnc, MTL::Texture* pOutput, bool tile )
+{
+    DeferredUniforms uniforms = { { float( pOutput->width() ), float( pOutput->height() ) }, _lightCount, 0.05f };
+    pEnc->setFragmentBuffer( _pLights, 0, 0 );
+    pEnc->setFragmentBytes( &uniforms, sizeof( uniforms ), 1 );
+    if ( tile )
+    {
+        pEnc->setTileBuffer( _pLights, 0, 0 );
+        pEnc->setTileBytes( &uniforms, sizeof( uniforms ), 1 );
+    }
+}
+
+void TileDeferredRenderer::encode( MTL::CommandBuffer* pCmd, MTL::Texture* pOutput )
+{
+    TRACE_SCOPE( "TileDeferredRenderer::encode" );
+    if ( pOutput->width() != _width || pOutput->height() != _height )
+    {
+        allocateTargets( pOutput->width(), pOutput->height() );
+    }
+    _pDeferredRpd->colorAttachments()->object( 0 )->setTexture( pOutput );
+
+    MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( _pDeferredRpd );
+    pEnc->setLabel( NS::String::string( "Tile deferred", NS::StringEncoding::UTF8StringEncoding ) );
+    setUniforms( pEnc, pOutput, true );
+
+    pEnc->setRenderPipelineState( _pGBufferPSO );
+    pEnc->setDepthStencilState( _pSceneDepthState );
+    pEnc->drawPrimitives( MTL::PrimitiveTypeTriangle, NS::UInteger( 0 ), NS::UInteger( kGridVertexCount ) );
+
+    // Waits for the tile's G-buffer writes before it runs.
+    pEnc->setRenderPipelineState( _pCullPSO );
+    pEnc->setThreadgroupMemoryLength( kTileLightsSize, 0, 0 );
+    pEnc->dispatchThreadsPerTile( MTL::Size::Make( kTileSize, kTileSize, 1 ) );
+
+    pEnc->setRenderPipelineState( _pLightingPSO );
+    pEnc->setDepthStencilState( _pLightingDepthState );
+    pEnc->drawPrimitives( MTL::PrimitiveTypeTriangle, NS::UInteger( 0 ), NS::UInteger( 3 ) );
+    pEnc->endEncoding();
+}
+
+void TileDeferredRenderer::encodeForward( MTL::CommandBuffer* pCmd, MTL::Texture* pOutput )
+{
+    TRACE_SCOPE( "TileDeferredRenderer::encodeForward" );
+    if ( pOutput->width() != _width || pOutput->height() != _height )
+    {
+        allocateTargets( pOutput->width(), pOutput->height() );
+    }
+    _pForwardRpd->colorAttachments()->object( 0 )->setTexture( pOutput );
+
+    MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder( _pForwardRpd );
+    pEnc->setLabel( NS::String::string( "Forward lighting", NS::StringEncoding::UTF8StringEncoding ) );
+    setUniforms( pEnc, pOutput, false );
+    pEnc->setRenderPipelineState( _pForwardPSO );
+    pEnc->setDepthStencilState( _pSceneDepthState );
+    pEnc->drawPrimitives( MTL::PrimitiveTypeTriangle, NS::UInteger( 0 ), NS::UInteger( kGridVertexCount ) );
+    pEnc->endEncoding();
+}
+
+std::vector<BenchResult> runLightScalingBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                               uint32_t width, uint32_t height,
+                                               const std::vector<uint32_t>& lightCounts,
+                                               uint32_t frames, uint32_t warmupFrames )
+{
+    std::vector<BenchResult> results;
+    if ( !TileDeferredRenderer::supported( pDevice ) )
+    {
+        __builtin_printf( "Light bench: %s has no tile shaders (needs Apple4)\n", pDevice->name()->utf8String() );
+        return results;
+    }
+
+    ResourceRegistry* pResources = new ResourceRegistry( pDevice );
+    TileDeferredRenderer* pRenderer = new TileDeferredRenderer( pDevice, pResources );
+
+    MTL::TextureDescriptor* pDesc = MTL::TextureDescriptor::texture2DDescriptor( kOutputFormat, width, height, false );
+    pDesc->setStorageMode( MTL::StorageModePrivate );
+    pDesc->setUsage( MTL::TextureUsageRenderTarget );
+    MTL::Texture* pOutput = pResources->newTexture( pDesc, ResourceCategory::RenderTarget, "Light bench output" );
+    pDesc->release();
+
+    for ( uint32_t lightCount : lightCounts )
+    {
+        LightSetDesc lightDesc;
+        lightDesc.count = lightCount;
+        pRenderer->setLights( generateLights( lightDesc ) );
+
+        for ( bool deferred : { true, false } )
+        {
+            std::vector<double> cpuMs, gpuMs;
+            for ( uint32_t frame = 0; frame < warmupFrames + frames; ++frame )
+            {
+                NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
+                uint64_t start = TraceRecorder::nowNs();
+                MTL::CommandBuffer* pCmd = pQueue->commandBuffer();
+                if ( deferred )
+                {
+                    pRenderer->encode( pCmd, pOutput );
+                }
+                else
+                {
+                    pRenderer->encodeForward( pCmd, pOutput );
+                }
+                pCmd->commit();
+                uint64_t end = TraceRecorder::nowNs();
+                pCmd->waitUntilCompleted();
+                if ( frame >= warmupFrames )
+                {
+                    cpuMs.push_back( double( end - start ) * 1e-6 );
+                    gpuMs.push_back( ( pCmd->GPUEndTime() - pCmd->GPUStartTime() ) * 1e3 );
+                }
+                pPool->release();
+            }
+
+            BenchResult result;
+            result.scene = std::string( deferred ? "deferred-" : "forward-" ) + std::to_string( lightCount );
+            result.cpuEncode = summarizeFrameTimes( cpuMs );
+            result.gpu = summarizeFrameTimes( gpuMs );
+            result.memoryBytes = pResources->tracker().totalBytes();
+            results.push_back( result );
+        }
+    }
+
+    pResources->release( pOutput );
+    delete pRenderer;
+    delete pResources;
+    return results;
+}
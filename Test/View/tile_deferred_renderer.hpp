@@ -0,0 +1,84 @@
+//
+//  tile_deferred_renderer.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef tile_deferred_renderer_hpp
+#define tile_deferred_renderer_hpp
+
+#include <Metal/Metal.hpp>
+#include <vector>
+#include "Model/bench_suite.hpp"
+#include "Model/light_set.hpp"
+
+class ResourceRegistry;
+
+// Single-pass deferred lighting for many point lights on tile-based GPUs.
+//
+// The scene writes albedo, normal and depth into memoryless color attachments,
+// so the G-buffer never leaves tile memory. In the same render pass a tile
+// dispatch reads each tile's depth from the imageblock, culls the lights
+// against the tile's bounds into threadgroup memory, and a fullscreen triangle
+// shades every pixel with only its tile's lights. Only the lit color is stored.
+//
+// Needs tile shaders (Apple4 and later). At most 256 lights reach a tile; more
+// are dropped. The test scene is a procedural wavy grid, with lights placed by
+// generateLights() in its space.
+class TileDeferredRenderer
+{
+public:
+    static constexpr uint32_t kTileSize = 16;
+
+    static bool supported( MTL::Device* pDevice );
+
+    TileDeferredRenderer( MTL::Device* pDevice, ResourceRegistry* pResources );
+    ~TileDeferredRenderer();
+
+    void setLights( const std::vector<PointLight>& lights );
+
+    // pOutput must be BGRA8Unorm_sRGB with RenderTarget usage.
+    void encode( MTL::CommandBuffer* pCmd, MTL::Texture* pOutput );
+
+    // The same scene in a plain forward pass, every light shaded in every
+    // fragment; the reference the benchmark compares against.
+    void encodeForward( MTL::CommandBuffer* pCmd, MTL::Texture* pOutput );
+
+private:
+    void buildPipelines();
+    void allocateTargets( NS::UInteger width, NS::UInteger height );
+    void setUniforms( MTL::RenderCommandEncoder* pEnc, MTL::Texture* pOutput, bool tile );
+
+    MTL::Device*                    _pDevice;
+    ResourceRegistry*               _pResources;
+
+    MTL::RenderPipelineState*       _pGBufferPSO;
+    MTL::RenderPipelineState*       _pCullPSO;
+    MTL::RenderPipelineState*       _pLightingPSO;
+    MTL::RenderPipelineState*       _pForwardPSO;
+    MTL::DepthStencilState*         _pSceneDepthState;
+    MTL::DepthStencilState*         _pLightingDepthState;
+    MTL::RenderPassDescriptor*      _pDeferredRpd;
+    MTL::RenderPassDescriptor*      _pForwardRpd;
+
+    MTL::Texture*                   _pAlbedo = nullptr;
+    MTL::Texture*                   _pNormal = nullptr;
+    MTL::Texture*                   _pLinearDepth = nullptr;
+    MTL::Texture*                   _pDepth = nullptr;
+    NS::UInteger                    _width = 0;
+    NS::UInteger                    _height = 0;
+
+    MTL::Buffer*                    _pLights = nullptr;
+    uint32_t                        _lightCount = 0;
+};
+
+// Renders the light test scene offscreen at each light count with both the
+// tile deferred and the forward path and reports the GPU time of each as
+// "deferred-N" / "forward-N" results, comparable with a bench baseline.
+std::vector<BenchResult> runLightScalingBench( MTL::Device* pDevice, MTL::CommandQueue* pQueue,
+                                               uint32_t width, uint32_t height,
+                                               const std::vector<uint32_t>& lightCounts,
+                                               uint32_t frames, uint32_t warmupFrames );
+
+#endif /* tile_deferred_renderer_hpp */
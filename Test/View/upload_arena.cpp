@@ -0,0 +1,82 @@
+//
+//  upload_arena.cpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#include "upload_arena.hpp"
+#include "Model/timeline.hpp"
+#include "Core/trace_recorder.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+UploadArena::UploadArena( ResourceRegistry* pResources, size_t initialBytes )
+: _pResources( pResources )
+{
+    for ( Slot& slot : _slots )
+    {
+        slot.pBuffer = _pResources->newBuffer( initialBytes, MTL::ResourceStorageModeShared | MTL::ResourceCPUCacheModeWriteCombined,
+                                               ResourceCategory::Staging, "Upload arena" );
+    }
+}
+
+// The owner waits for its frames to finish before tearing the arena down.
+UploadArena::~UploadArena()
+{
+    for ( Slot& slot : _slots )
+    {
+        for ( MTL::Buffer* pRetired : slot.retired )
+        {
+            _pResources->release( pRetired );
+        }
+        _pResources->release( slot.pBuffer );
+    }
+}
+
+void UploadArena::begin( uint64_t frameValue, Timeline& timeline )
+{
+    TRACE_SCOPE( "UploadArena::begin" );
+    _current = uint32_t( frameValue % kFramesInFlight );
+    if ( frameValue > kFramesInFlight && !timeline.wait( frameValue - kFramesInFlight, 10000 ) )
+    {
+        __builtin_printf( "Upload arena: frame %llu never finished\n", (unsigned long long)( frameValue - kFramesInFlight ) );
+        assert( false );
+    }
+
+    Slot& slot = _slots[ _current ];
+    for ( MTL::Buffer* pRetired : slot.retired )
+    {
+        _pResources->release( pRetired );
+    }
+    slot.retired.clear();
+    slot.used = 0;
+}
+
+UploadArena::Allocation UploadArena::allocate( size_t bytes, size_t alignment )
+{
+    Slot& slot = _slots[ _current ];
+    size_t offset = ( slot.used + alignment - 1 ) / alignment * alignment;
+    if ( offset + bytes > slot.pBuffer->length() )
+    {
+        // Doubling keeps a growing scene from reallocating every frame.
+        size_t length = std::max( slot.pBuffer->length() * 2, bytes );
+        slot.retired.push_back( slot.pBuffer );
+        slot.pBuffer = _pResources->newBuffer( length, MTL::ResourceStorageModeShared | MTL::ResourceCPUCacheModeWriteCombined,
+                                               ResourceCategory::Staging, "Upload arena" );
+        offset = 0;
+    }
+    slot.used = offset + bytes;
+    return { slot.pBuffer, offset, static_cast<uint8_t*>( slot.pBuffer->contents() ) + offset };
+}
+
+size_t UploadArena::capacity() const
+{
+    size_t bytes = 0;
+    for ( const Slot& slot : _slots )
+    {
+        bytes += slot.pBuffer->length();
+    }
+    return bytes;
+}
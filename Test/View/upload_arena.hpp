@@ -0,0 +1,60 @@
+//
+//  upload_arena.hpp
+//  Test
+//
+//  Created by Gustavo Binder on 19/10/26.
+//
+
+#ifndef upload_arena_hpp
+#define upload_arena_hpp
+
+#include <Metal/Metal.hpp>
+#include <vector>
+#include "View/resource_registry.hpp"
+
+class Timeline;
+
+// Linear allocator for data the CPU writes every frame and the GPU reads once,
+// such as world matrices. Each of kFramesInFlight slots owns a shared buffer
+// that is reset when its frame comes around again, so nothing is freed per
+// allocation and the CPU never writes memory a queued frame is still reading.
+class UploadArena
+{
+public:
+    struct Allocation
+    {
+        MTL::Buffer* pBuffer;
+        size_t       offset;
+        void*        pContents;     // CPU address of offset
+    };
+
+    UploadArena( ResourceRegistry* pResources, size_t initialBytes );
+    ~UploadArena();
+
+    // Starts the frame that will signal frameValue on timeline, waiting for the
+    // frame that used the same slot kFramesInFlight frames ago to finish first.
+    void begin( uint64_t frameValue, Timeline& timeline );
+
+    // Valid until the same slot begins again. A slot that runs out moves to a
+    // larger buffer; the old one is kept until then, since earlier allocations
+    // of the frame still point into it.
+    Allocation allocate( size_t bytes, size_t alignment = 256 );
+
+    size_t capacity() const;
+
+    static constexpr uint32_t kFramesInFlight = 3;
+
+private:
+    struct Slot
+    {
+        MTL::Buffer*              pBuffer = nullptr;
+        size_t                    used = 0;
+        std::vector<MTL::Buffer*> retired;
+    };
+
+    ResourceRegistry*   _pResources;
+    Slot                _slots[ kFramesInFlight ];
+    uint32_t            _current = 0;
+};
+
+#endif /* upload_arena_hpp */
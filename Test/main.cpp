@@ -11,6 +11,42 @@ int main( int argc, char* argv[] )
 {
     NS::AutoreleasePool* pAutoreleasePool = NS::AutoreleasePool::alloc()->init();
 
+    // TEST_TRACE=/path/trace.json (or .perfetto-trace) records a CPU trace until exit.
+    if ( const char* tracePath = getenv( "TEST_TRACE" ) )
+    {
+        TraceOverhead overhead = measureTraceOverhead();
+        __builtin_printf( "Trace scope overhead: %.1f ns disabled, %.1f ns enabled\n",
+                          overhead.disabledNsPerScope, overhead.enabledNsPerScope );
+        TraceRecorder::setThreadName( "Main" );
+        TraceRecorder::writeTraceOnExit( tracePath );
+    }
+
+    // TEST_HEADLESS=WIDTHxHEIGHT[xFRAMES] renders offscreen and exits instead of opening a window.
+    if ( const char* headless = getenv( "TEST_HEADLESS" ) )
+    {
+        const char* readback = getenv( "TEST_READBACK" );
+        int result = runHeadless( headless, readback ? unsigned( atoi( readback ) ) : 0 );
+        pAutoreleasePool->release();
+        return result;
+    }
+
+    // TEST_BENCH=metal|mock|lights|mips|bvh|scene|ecs|math|async|materials|streaming|compress runs the benchmark suite, optionally against TEST_BENCH_BASELINE.
+    if ( const char* bench = getenv( "TEST_BENCH" ) )
+    {
+        const char* update = getenv( "TEST_BENCH_UPDATE" );
+        int result = runBench( bench, getenv( "TEST_BENCH_BASELINE" ), update && atoi( update ) != 0 );
+        pAutoreleasePool->release();
+        return result;
+    }
+
+    // TEST_GPUS=metal prints GPU selection and the offscreen work split.
+    if ( const char* gpus = getenv( "TEST_GPUS" ) )
+    {
+        int result = runGpuReport( gpus );
+        pAutoreleasePool->release();
+        return result;
+    }
+
     MyAppDelegate del;
 
     NS::Application* pSharedApplication = NS::Application::sharedApplication();
@@ -17,5 +17,9 @@
 #include <AppKit/AppKit.hpp>
 #include <MetalKit/MetalKit.hpp>
 #include "Control/app_delegate.hpp"
+#include "Control/headless_app.hpp"
+#include "Control/bench_app.hpp"
+#include "Control/gpu_app.hpp"
+#include "Core/trace_recorder.hpp"
 
 #endif /* main_hpp */